@@ -28,6 +28,17 @@ typedef struct OC_APPLE_CHUNKLIST_CONTEXT_ {
   UINT8                       Hash[SHA256_DIGEST_SIZE];
 } OC_APPLE_CHUNKLIST_CONTEXT;
 
+//
+// Chunklist verification state for data passed in order.
+//
+typedef struct OC_APPLE_CHUNKLIST_STREAM_ {
+  CONST OC_APPLE_CHUNKLIST_CONTEXT *Context;
+  SHA256_CONTEXT                   Sha256Context;
+  UINT64                           ChunkIndex;
+  UINT32                           ChunkOffset;
+  BOOLEAN                          Valid;
+} OC_APPLE_CHUNKLIST_STREAM;
+
 //
 // Chunklist functions.
 //
@@ -56,6 +67,26 @@ OcAppleChunklistVerifySignature (
   IN     RSA_PUBLIC_KEY              *PublicKey
   );
 
+/**
+  Verifies a single chunk against a chunklist context.
+  Chunk data is hashed in place, across extent boundaries.
+
+  @param[in] Context            The Context to verify against.
+  @param[in] ExtentTable        A pointer to the RAM disk extent table to be
+                                verified.
+  @param[in] Index              Chunk index.
+  @param[in] Offset             Chunk offset in the RAM disk.
+
+  @retval TRUE                  The chunk was verified successfully.
+**/
+BOOLEAN
+OcAppleChunklistVerifyChunk (
+  IN CONST OC_APPLE_CHUNKLIST_CONTEXT   *Context,
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN UINT64                             Index,
+  IN UINT64                             Offset
+  );
+
 /**
   Verifies the specified data against a chunklist context.
 
@@ -74,4 +105,44 @@ OcAppleChunklistVerifyData (
   IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
   );
 
+/**
+  Starts verifying data passed in order against a chunklist context.
+
+  @param[out] Stream            The Stream to initialize.
+  @param[in]  Context           The Context to verify against.
+**/
+VOID
+OcAppleChunklistStreamInit (
+  OUT OC_APPLE_CHUNKLIST_STREAM         *Stream,
+  IN  CONST OC_APPLE_CHUNKLIST_CONTEXT  *Context
+  );
+
+/**
+  Hashes the next part of data, chunks are checked as soon as they complete.
+  Data past the last chunk is ignored.
+
+  @param[in,out] Stream         The Stream to update.
+  @param[in]     Data           Next part of data.
+  @param[in]     Size           Size of Data.
+**/
+VOID
+OcAppleChunklistStreamUpdate (
+  IN OUT OC_APPLE_CHUNKLIST_STREAM  *Stream,
+  IN     CONST VOID                 *Data,
+  IN     UINTN                      Size
+  );
+
+/**
+  Finishes stream verification.
+
+  @param[in,out] Stream         The Stream to finish.
+
+  @retval TRUE                  All chunks were passed and verified
+                                successfully.
+**/
+BOOLEAN
+OcAppleChunklistStreamFinal (
+  IN OUT OC_APPLE_CHUNKLIST_STREAM  *Stream
+  );
+
 #endif // APPLE_CHUNKLIST_LIB_H
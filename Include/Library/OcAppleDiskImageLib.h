@@ -20,6 +20,21 @@
 #include <Library/OcAppleChunklistLib.h>
 #include <Library/OcAppleRamDiskLib.h>
 
+//
+// Default memory budget for decompressed chunk cache.
+//
+#define OC_APPLE_DISK_IMAGE_CACHE_BUDGET  BASE_4MB
+
+//
+// Disk image chunk with data, indexed by absolute starting sector.
+//
+typedef struct {
+    UINT64                            SectorNumber;
+    APPLE_DISK_IMAGE_CHUNK            *Chunk;
+    UINT32                            BlockIndex;
+    UINT32                            ChunkIndex;
+} OC_APPLE_DISK_IMAGE_CHUNK_ENTRY;
+
 //
 // Disk image context.
 //
@@ -30,6 +45,37 @@ typedef struct {
 
     UINT32                            BlockCount;
     APPLE_DISK_IMAGE_BLOCK_DATA       **Blocks;
+
+    //
+    // Chunks sorted by starting sector, and last looked up chunk.
+    //
+    UINT32                            ChunkCount;
+    OC_APPLE_DISK_IMAGE_CHUNK_ENTRY   *Chunks;
+    UINT32                            LastChunk;
+
+    //
+    // RAM disk range with the plist and the trailer.
+    //
+    UINT64                            MetadataOffset;
+    UINT64                            MetadataSize;
+
+    //
+    // Chunklist verified on first read, with cumulative chunk offsets
+    // and a bitmap of verified chunks.
+    //
+    OC_APPLE_CHUNKLIST_CONTEXT        *Chunklist;
+    UINT64                            *ChunklistOffsets;
+    UINT8                             *ChunklistVerified;
+    UINT64                            ChunklistPending;
+
+    //
+    // Decompressed chunks, least recently used first.
+    //
+    LIST_ENTRY                        CacheChunks;
+    UINTN                             CacheSize;
+    UINTN                             CacheBudget;
+    UINT64                            CacheHits;
+    UINT64                            CacheMisses;
 } OC_APPLE_DISK_IMAGE_CONTEXT;
 
 BOOLEAN
@@ -39,10 +85,15 @@ OcAppleDiskImageInitializeContext (
   IN  UINTN                              FileSize
   );
 
+//
+// Load disk image from file. When ChunklistContext is passed, data is
+// verified against it while being loaded.
+//
 BOOLEAN
 OcAppleDiskImageInitializeFromFile (
   OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  EFI_FILE_PROTOCOL            *File
+  IN  EFI_FILE_PROTOCOL            *File,
+  IN  OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext  OPTIONAL
   );
 
 VOID
@@ -54,12 +105,34 @@ OcAppleDiskImageFreeFile (
   IN OC_APPLE_DISK_IMAGE_CONTEXT  *Context
   );
 
+//
+// Set decompressed chunk cache budget in bytes, 0 disables the cache.
+// Cached chunks over the new budget are evicted.
+//
+VOID
+OcAppleDiskImageSetCacheBudget (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Budget
+  );
+
 BOOLEAN
 OcAppleDiskImageVerifyData (
   IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
   IN OUT OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext
   );
 
+//
+// Verify data against the chunklist chunk by chunk, on first read.
+// Plist and trailer are verified immediately. ChunklistContext must stay
+// valid until the context is freed. On failure no verification state is
+// left attached to the context.
+//
+BOOLEAN
+OcAppleDiskImageVerifyDataOnRead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext
+  );
+
 BOOLEAN
 OcAppleDiskImageRead (
   IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
@@ -128,12 +128,62 @@ typedef struct {
   // Used for caching prelinked kexts.
   //
   LIST_ENTRY               PrelinkedKexts;
+  //
+  // Hashed CFBundleIdentifier index of KextList and PrelinkedKexts.
+  //
+  struct PRELINKED_KEXT_INDEX_ENTRY_  *KextIndex;
+  //
+  // Number of KextIndex slots, always a power of two.
+  //
+  UINT32                   KextIndexSize;
+  //
+  // Number of used KextIndex slots.
+  //
+  UINT32                   KextIndexCount;
+  //
+  // Current dependency walk generation, see PRELINKED_KEXT Processed.
+  //
+  UINT32                   KextWalkGeneration;
 } PRELINKED_CONTEXT;
 
 //
-// Kernel and kext patching context.
+// Kext description for batched injection.
 //
 typedef struct {
+  //
+  // Kext bundle path (e.g. /L/E/mykext.kext).
+  //
+  CONST CHAR8              *BundlePath;
+  //
+  // Kext Info.plist.
+  //
+  CONST CHAR8              *InfoPlist;
+  //
+  // Kext Info.plist size.
+  //
+  UINT32                   InfoPlistSize;
+  //
+  // Kext executable path (e.g. Contents/MacOS/mykext), optional.
+  //
+  CONST CHAR8              *ExecutablePath;
+  //
+  // Kext executable, optional.
+  //
+  CONST UINT8              *Executable;
+  //
+  // Kext executable size, optional.
+  //
+  UINT32                   ExecutableSize;
+  //
+  // Injection result, set by PrelinkedInjectKexts.
+  //
+  RETURN_STATUS            Status;
+} PRELINKED_INJECT_KEXT;
+
+//
+// Kernel and kext patching context.
+//
+typedef struct PATCHER_CONTEXT_ {
   //
   // Mach-O context for patched binary.
   //
@@ -146,6 +196,20 @@ typedef struct {
   // Virtual kmod_info_t address.
   //
   UINT64                   VirtualKmod;
+  //
+  // Symbol name hash table built on first symbol lookup, holds symbol
+  // indices plus one.  Freed by PatcherFreeContext.
+  //
+  UINT32                   *SymbolHash;
+  //
+  // Symbol name hash table mask (slot count minus one).
+  //
+  UINT32                   SymbolHashMask;
+  //
+  // Context owning the symbol name hash table, set for contexts initialized
+  // from prelinked kexts.
+  //
+  struct PATCHER_CONTEXT_  *SymbolHashOwner;
 } PATCHER_CONTEXT;
 
 //
@@ -321,6 +385,62 @@ PrelinkedInjectKext (
   IN     UINT32             ExecutableSize OPTIONAL
   );
 
+/**
+  Perform batched kext injection. Kexts are injected in dependency order,
+  so that kexts within the batch may depend on each other, and Info.plist
+  entries are appended in the same order. Failing kexts are skipped.
+
+  @param[in,out] Context    Prelinked context.
+  @param[in,out] Kexts      Kexts to inject, Status is updated for each.
+  @param[in]     KextCount  Number of kexts to inject.
+
+  @return  RETURN_SUCCESS when all kexts were injected.
+**/
+RETURN_STATUS
+PrelinkedInjectKexts (
+  IN OUT PRELINKED_CONTEXT      *Context,
+  IN OUT PRELINKED_INJECT_KEXT  *Kexts,
+  IN     UINT32                 KextCount
+  );
+
+/**
+  Export linked symbols and vtables of kernel and KPI kexts, so that they
+  need not be rebuilt on next boot with the same kernel.
+  Must be called before prelinkedkernel is modified by kext injection.
+
+  @param[in,out] Context    Prelinked context.
+  @param[out]    Cache      Pool allocated linked cache.
+  @param[out]    CacheSize  Linked cache size.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+PrelinkedExportLinkedCache (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    VOID               **Cache,
+  OUT    UINT32             *CacheSize
+  );
+
+/**
+  Import linked symbols and vtables previously exported with
+  PrelinkedExportLinkedCache. The cache is used in place and on success
+  becomes owned by prelinked context. Kexts not matching the cache are
+  skipped and rebuilt on demand.
+  Must be called before prelinkedkernel is modified by kext injection.
+
+  @param[in,out] Context    Prelinked context.
+  @param[in,out] Cache      Pool allocated linked cache.
+  @param[in]     CacheSize  Linked cache size.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+PrelinkedImportLinkedCache (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     VOID               *Cache,
+  IN     UINT32             CacheSize
+  );
+
 /**
   Initialize patcher from prelinked context for kext patching.
 
@@ -339,6 +459,9 @@ PatcherInitContextFromPrelinked (
 
 /**
   Initialize patcher from buffer for e.g. kernel patching.
+  Symbol lookups allocate a symbol name hash table and Mach-O lookup indices
+  owned by the context, so on success it must be released with
+  PatcherFreeContext once patching is done.
 
   @param[in,out] Context         Patcher context.
   @param[in,out] Buffer          Kernel buffer (could be prelinked).
@@ -353,8 +476,24 @@ PatcherInitContextFromBuffer (
   IN     UINT32             BufferSize
   );
 
+/**
+  Free resources cached by patcher context.  Must be called for contexts
+  initialized from buffer, even when no symbol was looked up.  Calling it
+  more than once is harmless.  Contexts initialized from prelinked kexts use
+  the symbol name hash table of the kext and own no resources, unless
+  Mach-O lookup indices were built through their MachContext.
+
+  @param[in,out] Context         Patcher context.
+**/
+VOID
+PatcherFreeContext (
+  IN OUT PATCHER_CONTEXT    *Context
+  );
+
 /**
   Get local symbol address.
+  A symbol name hash table is built on first use and shared by all lookups
+  in the same image.
 
   @param[in,out] Context         Patcher context.
   @param[in]     Name            Symbol name.
@@ -369,6 +508,26 @@ PatcherGetSymbolAddress (
   IN OUT UINT8              **Address
   );
 
+/**
+  Get multiple local symbol addresses.  When no symbol name hash table
+  exists yet, all names are resolved with a single symbol table pass.
+
+  @param[in,out] Context         Patcher context.
+  @param[in]     Names           Symbol names.
+  @param[in]     NameCount       Number of symbol names.
+  @param[out]    Addresses       Returned symbol addresses in file,
+                                 NULL for unresolved symbols.
+
+  @return  RETURN_SUCCESS when all symbols were resolved.
+**/
+RETURN_STATUS
+PatcherGetSymbolAddresses (
+  IN OUT PATCHER_CONTEXT    *Context,
+  IN     CONST CHAR8        **Names,
+  IN     UINT32             NameCount,
+  OUT    UINT8              **Addresses
+  );
+
 /**
   Apply generic patch.
 
@@ -383,6 +542,28 @@ PatcherApplyGenericPatch (
   IN     PATCHER_GENERIC_PATCH  *Patch
   );
 
+/**
+  Apply multiple generic patches in order with a single search pass.
+  The result is the same as of calling PatcherApplyGenericPatch
+  for every patch, including the effects of earlier patches on later ones.
+  Symbol bases are resolved before applying any patch, so patches must
+  not modify Mach-O header or symbol table.
+
+  @param[in,out] Context         Patcher context.
+  @param[in]     Patches         Patch descriptions.
+  @param[in]     PatchCount      Number of patches.
+  @param[out]    Statuses        Per patch results, optional.
+
+  @return  RETURN_SUCCESS when all patches were applied.
+**/
+RETURN_STATUS
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 PatchCount,
+  OUT    RETURN_STATUS          *Statuses OPTIONAL
+  );
+
 /**
   Block kext from loading.
 
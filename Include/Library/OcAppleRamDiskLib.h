@@ -68,6 +68,23 @@ OcAppleRamDiskWrite (
   IN CONST VOID                         *Buffer
   );
 
+/**
+  Get direct pointer to RAM disk data without copying.
+
+  @param[in]     ExtentTable Allocated extent table.
+  @param[in]     Offset      Offset in RAM disk.
+  @param[in,out] Size        Amount of data to access, on return reduced to
+                             the amount available in the containing extent.
+
+  @retval Pointer to data or NULL when Offset is out of range.
+**/
+VOID *
+OcAppleRamDiskGetSpan (
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     UINT64                             Offset,
+  IN OUT UINTN                              *Size
+  );
+
 /**
   Load file into RAM disk as it is.
 
@@ -84,6 +101,44 @@ OcAppleRamDiskLoadFile (
   IN     UINTN                              FileSize
   );
 
+/**
+  Callback for data loaded into RAM disk, called once per piece in file order.
+
+  @param[in]  Context  Handler context.
+  @param[in]  Data     Loaded data in RAM disk.
+  @param[in]  Size     Loaded data size.
+**/
+typedef
+VOID
+(*OC_APPLE_RAM_DISK_LOAD_HANDLER) (
+  IN VOID        *Context,
+  IN CONST VOID  *Data,
+  IN UINTN       Size
+  );
+
+/**
+  Load file into RAM disk as it is, passing loaded data to Handler.
+  When the file supports asynchronous reads, the next piece is read
+  while Handler processes the previous one. Otherwise each piece is
+  passed to Handler right after being read.
+
+  @param[in]  ExtentTable     Allocated extent table.
+  @param[in]  File            File protocol open for reading.
+  @param[in]  FileSize        Amount of data to write.
+  @param[in]  Handler         Loaded data handler, optional.
+  @param[in]  HandlerContext  Loaded data handler context, optional.
+
+  @retval TRUE on success.
+**/
+BOOLEAN
+OcAppleRamDiskLoadFileEx (
+  IN OUT CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     EFI_FILE_PROTOCOL                  *File,
+  IN     UINTN                              FileSize,
+  IN     OC_APPLE_RAM_DISK_LOAD_HANDLER     Handler  OPTIONAL,
+  IN     VOID                               *HandlerContext  OPTIONAL
+  );
+
 /**
   Free RAM disk.
 
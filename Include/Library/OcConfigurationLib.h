@@ -441,7 +441,7 @@
   Initialize configuration with plist data.
 
   @param[out]  Config   Configuration structure.
-  @param[in]   Buffer   Configuration buffer in plist format.
+  @param[in]   Buffer   Configuration buffer in XML or binary plist format.
   @param[in]   Size     Configuration buffer size.
 
   @retval  EFI_SUCCESS on success
@@ -41,6 +41,20 @@ typedef struct {
   MACH_NLIST_64         *IndirectSymbolTable;
   MACH_RELOCATION_INFO  *LocalRelocations;
   MACH_RELOCATION_INFO  *ExternRelocations;
+  ///
+  /// Address-sorted Relocation indices, built on first lookup.
+  /// Released by MachoFreeIndices.
+  ///
+  UINT32                *ExternRelocationIndex;
+  UINT32                NumExternRelocationIndex;
+  UINT32                *LocalRelocationIndex;
+  UINT32                NumLocalRelocationIndex;
+  ///
+  /// Value-sorted Symbol Table indices, built on first lookup by value.
+  /// Released by MachoFreeIndices.
+  ///
+  UINT32                *SymbolValueIndex;
+  UINT32                NumSymbolValueIndex;
 } OC_MACHO_CONTEXT;
 
 /**
@@ -60,6 +74,21 @@ MachoInitializeContext (
   IN  UINT32            FileSize
   );
 
+/**
+  Frees the lookup indices cached within a Mach-O Context.  The Context stays
+  valid and the indices are rebuilt on demand.  This must be called before
+  modifying the Symbol Table or Relocations of a Mach-O that has been queried,
+  unless done through MachoSetSymbolValue64 or MachoRelocateSymbol64, and
+  before the Context is discarded or reinitialized.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+**/
+VOID
+MachoFreeIndices (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  );
+
 /**
   Returns the Mach-O Header structure.
 
@@ -376,6 +405,42 @@ MachoGetSymbolByExternRelocationOffset64 (
   OUT    MACH_NLIST_64     **Symbol
   );
 
+/**
+  Retrieves the section-based symbol with the highest value not above
+  Address, e.g. to symbolise a code address.  The first such symbol in the
+  Symbol Table is returned when several share a value.
+
+  @param[in,out] Context  Context of the Mach-O.
+  @param[in]     Address  Address to search for.
+  @param[out]    Offset   Distance of Address from the symbol's value.
+                          May be NULL.
+
+  @retval NULL  NULL is returned on failure.
+
+**/
+MACH_NLIST_64 *
+MachoGetNearestSymbolByValue64 (
+  IN OUT OC_MACHO_CONTEXT  *Context,
+  IN     UINT64            Address,
+  OUT    UINT64            *Offset  OPTIONAL
+  );
+
+/**
+  Sets the value of Symbol.  The value-sorted symbol index is kept sorted, so
+  lookups by value stay valid without rebuilding it.
+
+  @param[in,out] Context  Context of the Mach-O.
+  @param[in,out] Symbol   Symbol from the Symbol Table of Context.
+  @param[in]     Value    The new value of Symbol.
+
+**/
+VOID
+MachoSetSymbolValue64 (
+  IN OUT OC_MACHO_CONTEXT  *Context,
+  IN OUT MACH_NLIST_64     *Symbol,
+  IN     UINT64            Value
+  );
+
 /**
   Relocate Symbol to be against LinkAddress.
 
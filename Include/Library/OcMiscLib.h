@@ -33,6 +33,8 @@
   @param[in] DecodedData        A pointer to location to store the decoded data.
   @param[in] DecodedSize        A pointer to location to store the decoded size.
 
+  DecodedData may be equal to EncodedData to decode in place.
+
   @retval  TRUE on success.
 **/
 RETURN_STATUS
@@ -36,6 +36,30 @@ VOID
   OC_SCHEMA_INFO  *Info
   );
 
+//
+// Precomputed perfect hash dispatch for a sorted schema list.
+// Tables are generated ahead of time, for example by
+// OcConfigurationLib/GenerateSchemaDispatch.py.
+//
+typedef struct {
+  //
+  // Schema list size the table was generated for.
+  //
+  UINT32            SchemaSize;
+  //
+  // Hash seed giving every schema name a distinct slot.
+  //
+  UINT32            Seed;
+  //
+  // Slot count minus one, slot count is a power of two.
+  //
+  UINT32            Mask;
+  //
+  // Schema indices plus one, zero for empty slots.
+  //
+  CONST UINT8       *Slots;
+} OC_SCHEMA_DISPATCH;
+
 //
 // OC_SCHEMA_INFO for nested dictionaries
 //
@@ -48,6 +72,10 @@ typedef struct {
   // Nested schema list size.
   //
   UINT32            SchemaSize;
+  //
+  // Nested schema list dispatch, NULL to use binary search.
+  //
+  CONST OC_SCHEMA_DISPATCH  *Dispatch;
 } OC_SCHEMA_DICT;
 
 //
@@ -155,6 +183,16 @@ LookupConfigSchema (
   CONST CHAR8    *Name
   );
 
+//
+// Find schema in a dictionary schema.
+// Lookup costs one probe, when the dictionary has a dispatch table.
+//
+OC_SCHEMA *
+LookupConfigSchemaDict (
+  OC_SCHEMA_DICT  *Dict,
+  CONST CHAR8     *Name
+  );
+
 //
 // Apply interface to parse serialized dictionaries
 //
@@ -208,6 +246,10 @@ ParseSerializedMap (
 
 //
 // Main interface for parsing serialized data.
+// PlistBuffer may be an XML or a binary plist.
+// PlistBuffer is streamed without building a node tree, builtin dict,
+// map, and array appliers are emulated, other appliers only receive
+// nodes without children.
 // PlistBuffer will be modified during the execution.
 //
 BOOLEAN
@@ -250,6 +292,13 @@ ParseSerialized (
   {(Name), PLIST_NODE_TYPE_DICT, ParseSerializedDict,                    \
     {.Dict = {(Schema), ARRAY_SIZE (Schema)}}}
 
+//
+// Dictionary dispatched through the Schema##Dispatch table, see OC_SCHEMA_DISPATCH.
+//
+#define OC_SCHEMA_DICT_HASH(Name, Schema)                                \
+  {(Name), PLIST_NODE_TYPE_DICT, ParseSerializedDict,                    \
+    {.Dict = {(Schema), ARRAY_SIZE (Schema), &Schema##Dispatch}}}
+
 #define OC_SCHEMA_BOOLEAN(Name)                                          \
   OC_SCHEMA_VALUE (Name, 0, BOOLEAN, OC_SCHEMA_VALUE_BOOLEAN)
 
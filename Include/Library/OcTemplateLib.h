@@ -126,7 +126,7 @@ VOID
 #define OC_BLOB(Type, Count, Default, _, __) \
   _(UINT32       , Size      ,       , 0                   , OcZeroField   ) \
   _(UINT32       , MaxSize   ,       , sizeof (Type Count) , OcZeroField   ) \
-  _(Type *       , DynValue  ,       , NULL                , OcFreePointer ) \
+  _(Type *       , DynValue  ,       , NULL                , OcFreeBlob    ) \
   _(Type         , Value     , Count , __(Default)         , ()            )
 
 #define OC_BLOB_STRUCTORS(Name) \
@@ -152,6 +152,7 @@ VOID
   _(OC_STRUCTOR , Destruct      , , Type ## _DESTRUCT     , () ) \
   _(Type **     , Values        , , NULL                  , () ) \
   _(UINT32      , ValueSize     , , sizeof (Type)         , () ) \
+  _(VOID *      , Chunks        , , NULL                  , () ) \
   _(UINT32      , KeySize       , , sizeof (KeyType)      , () ) \
   _(OC_STRUCTOR , KeyConstruct  , , KeyType ## _CONSTRUCT , () ) \
   _(OC_STRUCTOR , KeyDestruct   , , KeyType ## _DESTRUCT  , () ) \
@@ -176,7 +177,8 @@ VOID
   _(OC_STRUCTOR , Construct     , , Type ## _CONSTRUCT    , () ) \
   _(OC_STRUCTOR , Destruct      , , Type ## _DESTRUCT     , () ) \
   _(Type **     , Values        , , NULL                  , () ) \
-  _(UINT32      , ValueSize     , , sizeof (Type)         , () )
+  _(UINT32      , ValueSize     , , sizeof (Type)         , () ) \
+  _(VOID *      , Chunks        , , NULL                  , () )
 
 #define OC_ARRAY_STRUCTORS(Name) \
   OC_STRUCTORS(Name, OcFreeArray)
@@ -191,6 +193,16 @@ OcFreePointer (
   UINT32  Size
   );
 
+//
+// Free dynamically allocated blob value if non NULL.
+// Note, that the first argument is actually VOID **.
+//
+VOID
+OcFreeBlob (
+  VOID    *Pointer,
+  UINT32  Size
+  );
+
 //
 // Zero field memory.
 //
@@ -232,6 +244,7 @@ OcFreeArray (
 // Assignable size may be returned via OutSize.
 // This method guarantees not to overwrite "Default" value,
 // but may destroy the previous value.
+// Small dynamic values are carved from shared slabs.
 // NULL is returned on allocation failure.
 //
 VOID *
@@ -248,7 +261,8 @@ OcBlobAllocate (
 
 //
 // Insert new empty element into the OC_MAP or OC_ARRAY, depending
-// on Key value.
+// on Key value.  Elements are carved from chunks owned by the list
+// and freed with it.
 //
 BOOLEAN
 OcListEntryAllocate (
@@ -134,6 +134,22 @@ XmlDocumentParse (
   BOOLEAN  WithRefs
   );
 
+//
+// Same as XmlDocumentParse, but children of a node are only skipped and
+// parsed on its first XmlNodeChildren, XmlNodeChild, or XmlNodeAppend
+// call.  Unvisited nodes are exported as is.
+//
+// @warning Text content of skipped nodes is validated on first access.
+//     Malformed nodes then have no children, fail PlistNodeCast and
+//     XmlNodeAppend, and make XmlDocumentExport fail.
+//
+XML_DOCUMENT *
+XmlDocumentParseLazy (
+  CHAR8    *Buffer,
+  UINT32   Length,
+  BOOLEAN  WithRefs
+  );
+
 //
 // Exports parsed document into the buffer.
 //
@@ -141,7 +157,8 @@ XmlDocumentParse (
 // @param Length   Resulting length of the buffer without trailing \0 (optional)
 // @param Skip     N root levels before exporting, normally 0.
 //
-// @return Exported buffer allocated from pool or NULL.
+// @return Exported buffer allocated from pool or NULL, also when lazily
+//     parsed children were found malformed.
 //
 CHAR8 *
 XmlDocumentExport (
@@ -290,6 +307,18 @@ PlistDictChild (
   XML_NODE     **Value OPTIONAL
   );
 
+//
+// Finds the value of the first dictionary entry with the given key.
+// Keys of large dictionaries are hashed on first use.
+//
+// @return Value node or NULL if there is no such key.
+//
+XML_NODE *
+PlistDictFind (
+  XML_NODE     *Node,
+  CONST CHAR8  *Key
+  );
+
 //
 // @return key value for valid type or NULL.
 //
@@ -321,6 +350,28 @@ PlistDataValue (
   UINT32    *Size
   );
 
+//
+// Decodes data content in place on first use and caches its size.
+// Later PlistDataValue, PlistMetaDataValue, and size calls on the node
+// copy the decoded bytes instead of decoding again, and size calls
+// return the exact size.
+//
+// @param Data  Decoded data, NULL for empty data (optional).
+// @param Size  Decoded data size (optional).
+//
+// @return FALSE for invalid type or content, or nodes not parsed
+//     from a buffer.  Content is partially overwritten when decoding
+//     fails, so later data calls on the node return FALSE as well.
+// @warning XmlNodeContent returns raw data for decoded nodes, and
+//     documents with decoded nodes are not to be exported.
+//
+BOOLEAN
+PlistDataDecode (
+  XML_NODE     *Node,
+  CONST UINT8  **Data  OPTIONAL,
+  UINT32       *Size   OPTIONAL
+  );
+
 //
 // @return boolean value for valid type or FALSE.
 //
@@ -385,4 +436,316 @@ PlistMetaDataSize (
   UINT32    *Size
   );
 
+//
+// Opaque structure holding the streaming plist reader state.
+//
+struct PLIST_READER_;
+typedef struct PLIST_READER_ PLIST_READER;
+
+//
+// Streaming plist reader events.
+//
+typedef enum PLIST_EVENT_ {
+  //
+  // Malformed document, no further events follow.
+  //
+  PLIST_EVENT_ERROR,
+  //
+  // Root plist node was closed, no further events follow.
+  //
+  PLIST_EVENT_END,
+  //
+  // Dictionary key node.
+  //
+  PLIST_EVENT_KEY,
+  //
+  // Node without children.
+  //
+  PLIST_EVENT_VALUE,
+  //
+  // Node with children or dictionary or array, followed by its children
+  // and a matching PLIST_EVENT_CLOSE.
+  //
+  PLIST_EVENT_OPEN,
+  //
+  // Last opened node was closed.
+  //
+  PLIST_EVENT_CLOSE
+} PLIST_EVENT;
+
+//
+// Creates a reader returning the contents of a plist document without
+// building a node tree.  Memory usage only depends on the nesting level.
+// References are not supported.
+// Binary plists are read through their offset tables, with string and
+// integer contents converted to text as in XML documents.
+//
+// @param Buffer  Chunk to parse
+// @param Length  Size of the buffer
+//
+// @warning `Buffer` contents are permanently modified during parsing
+// @warning You have to call PlistReaderFree after you finished reading
+//
+// @return Reader or NULL.
+//
+PLIST_READER *
+PlistReaderCreate (
+  CHAR8    *Buffer,
+  UINT32   Length
+  );
+
+//
+// Reads next plist document node, starting with plist root.
+//
+// @param Reader  Plist reader.
+// @param Node    Node describing the event, valid till the next call.
+//                Nodes never report children, and may be passed to
+//                PlistNodeCast and Plist*Value functions.
+//                Key and content strings stay valid as long as `Buffer`
+//                and the reader.  Strings and integers converted from
+//                binary plists stay valid until the next key of their
+//                dictionary or the next element of their array is read,
+//                so keys may be used while reading their values.
+//
+// @return Read event.
+//
+PLIST_EVENT
+PlistReaderNext (
+  PLIST_READER  *Reader,
+  XML_NODE      **Node
+  );
+
+//
+// Skips the remaining children of the last opened node including its
+// closing event.
+//
+// @return TRUE on success.
+//
+BOOLEAN
+PlistReaderSkip (
+  PLIST_READER  *Reader
+  );
+
+//
+// Frees plist reader.
+//
+VOID
+PlistReaderFree (
+  PLIST_READER  *Reader
+  );
+
+//
+// Opaque structure holding a binary plist document.
+//
+struct BPLIST_DOCUMENT_;
+typedef struct BPLIST_DOCUMENT_ BPLIST_DOCUMENT;
+
+//
+// Binary plist object reference.
+//
+typedef UINT32 BPLIST_NODE;
+
+//
+// Invalid or missing binary plist object.
+//
+#define BPLIST_NODE_INVALID  MAX_UINT32
+
+//
+// @return TRUE if Buffer starts with binary plist magic.
+//
+BOOLEAN
+BplistIsBinary (
+  CONST VOID  *Buffer,
+  UINT32      Length
+  );
+
+//
+// Validates bplist00 header and trailer in Buffer.  Objects are only
+// decoded when accessed through the offset table, so access costs do not
+// depend on document size.
+//
+// @param Buffer  Binary plist.
+// @param Length  Size of the buffer.
+//
+// @warning `Buffer` will be referenced by the document, you may not free it
+//     until you free the BPLIST_DOCUMENT
+// @warning You have to call BplistDocumentFree after you finished using the
+//     document
+//
+// @return Document or NULL.
+//
+BPLIST_DOCUMENT *
+BplistDocumentParse (
+  CONST UINT8  *Buffer,
+  UINT32       Length
+  );
+
+//
+// Frees binary plist document.  Buffer is not freed.
+//
+VOID
+BplistDocumentFree (
+  BPLIST_DOCUMENT  *Document
+  );
+
+//
+// @return Top object of the document.
+//
+BPLIST_NODE
+BplistDocumentRoot (
+  BPLIST_DOCUMENT  *Document
+  );
+
+//
+// @return Node type or PLIST_NODE_TYPE_MAX for invalid and unsupported
+//     objects.  Strings are reported as PLIST_NODE_TYPE_STRING.
+//
+PLIST_NODE_TYPE
+BplistNodeType (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  );
+
+//
+// Performs basic type casting similar to PlistNodeCast.
+// Keys may be cast to both PLIST_NODE_TYPE_KEY and PLIST_NODE_TYPE_STRING.
+//
+// @return Node if it represents passed Type or BPLIST_NODE_INVALID.
+//
+BPLIST_NODE
+BplistNodeCast (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  PLIST_NODE_TYPE  Type
+  );
+
+//
+// @return Number of array elements or 0.
+//
+UINT32
+BplistNodeChildren (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  );
+
+//
+// @return The n-th array element or BPLIST_NODE_INVALID.
+//
+BPLIST_NODE
+BplistNodeChild (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           Child
+  );
+
+//
+// @return Number of dictionary entries or 0.
+//
+UINT32
+BplistDictChildren (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  );
+
+//
+// @return The n-th dictionary key or BPLIST_NODE_INVALID.
+//
+BPLIST_NODE
+BplistDictChild (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           Child,
+  BPLIST_NODE      *Value OPTIONAL
+  );
+
+//
+// Finds the value of the first dictionary entry with the given key.
+// Keys are compared without being copied.
+//
+// @return Value or BPLIST_NODE_INVALID.
+//
+BPLIST_NODE
+BplistDictFind (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CONST CHAR8      *Key
+  );
+
+//
+// Stores string or key value as UTF-8, truncating it to fit Size.
+//
+// @param Value output buffer, at least 1 byte.
+// @param Size  size of buffer, set to copied size including '\0'.
+//
+// @return FALSE for invalid type or empty buffer.
+//
+BOOLEAN
+BplistStringValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CHAR8            *Value,
+  UINT32           *Size
+  );
+
+//
+// Calculates UTF-8 string or key value size including '\0'.
+//
+BOOLEAN
+BplistStringSize (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           *Size
+  );
+
+//
+// Returns data value referenced in document buffer.
+//
+// @param Data  Data pointer, NULL for empty data (optional).
+// @param Size  Data size.
+//
+BOOLEAN
+BplistDataValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CONST UINT8      **Data  OPTIONAL,
+  UINT32           *Size
+  );
+
+//
+// @return boolean value for valid type or FALSE.
+//
+BOOLEAN
+BplistBooleanValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  BOOLEAN          *Value
+  );
+
+//
+// Stores integer value truncated to Size bytes.
+// Negative values are stored in two's complement.
+//
+BOOLEAN
+BplistIntegerValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  VOID             *Value,
+  UINT32           Size
+  );
+
+//
+// Exports plist node and its children as a bplist00 document.
+// Strings are exported as is, dates and reals are not supported.
+//
+// @param Node    Plist node, normally from PlistDocumentRoot.
+// @param Length  Resulting length of the buffer.
+//
+// @return Exported buffer allocated from pool or NULL.
+//
+UINT8 *
+BplistExport (
+  XML_NODE  *Node,
+  UINT32    *Length
+  );
+
 #endif // OC_XML_LIB_H
@@ -14,7 +14,6 @@
 
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
-#include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleChunklistLib.h>
 #include <Library/OcAppleRamDiskLib.h>
 #include <Library/OcCryptoLib.h>
@@ -118,70 +117,188 @@ OcAppleChunklistVerifySignature (
 }
 
 BOOLEAN
-OcAppleChunklistVerifyData (
-  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
-  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
+OcAppleChunklistVerifyChunk (
+  IN CONST OC_APPLE_CHUNKLIST_CONTEXT   *Context,
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN UINT64                             Index,
+  IN UINT64                             Offset
   )
 {
-  BOOLEAN                     Result;
-
-  UINT64                      Index;
+  CONST APPLE_CHUNKLIST_CHUNK *Chunk;
+  SHA256_CONTEXT              Sha256Context;
   UINT8                       ChunkHash[SHA256_DIGEST_SIZE];
-  CONST APPLE_CHUNKLIST_CHUNK *CurrentChunk;
-  UINT64                      CurrentOffset;
-
-  UINTN                       ChunkDataSize;
-  VOID                        *ChunkData;
+  UINTN                       Remaining;
+  UINTN                       SpanSize;
+  CONST UINT8                 *Span;
 
   ASSERT (Context != NULL);
   ASSERT (Context->Chunks != NULL);
   ASSERT (ExtentTable != NULL);
+  ASSERT (Index < Context->ChunkCount);
 
   DEBUG_CODE (
     ASSERT (Context->Signature == NULL);
     );
 
-  ChunkDataSize = 0;
-  for (Index = 0; Index < Context->ChunkCount; ++Index) {
-    CurrentChunk = &Context->Chunks[Index];
-    if (ChunkDataSize < CurrentChunk->Length) {
-      ChunkDataSize = CurrentChunk->Length;
+  Chunk = &Context->Chunks[Index];
+
+  DEBUG ((DEBUG_VERBOSE, "AppleChunklistVerifyData(): Validating chunk %lu of %lu\n",
+    Index, Context->ChunkCount));
+
+  //
+  // Hash straight from extent memory, a chunk may span several extents.
+  //
+  Sha256Init (&Sha256Context);
+
+  Remaining = Chunk->Length;
+  while (Remaining > 0) {
+    SpanSize = Remaining;
+    Span     = OcAppleRamDiskGetSpan (ExtentTable, Offset, &SpanSize);
+    if (Span == NULL) {
+      return FALSE;
     }
-  }
 
-  ChunkData = AllocatePool (ChunkDataSize);
-  if (ChunkData == NULL) {
-    return FALSE;
+    Sha256Update (&Sha256Context, Span, SpanSize);
+
+    Offset    += SpanSize;
+    Remaining -= SpanSize;
   }
 
+  Sha256Final (&Sha256Context, ChunkHash);
+
+  return CompareMem (ChunkHash, Chunk->Checksum, SHA256_DIGEST_SIZE) == 0;
+}
+
+BOOLEAN
+OcAppleChunklistVerifyData (
+  IN OUT OC_APPLE_CHUNKLIST_CONTEXT         *Context,
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
+  )
+{
+  BOOLEAN Result;
+  UINT64  Index;
+  UINT64  CurrentOffset;
+
+  ASSERT (Context != NULL);
+  ASSERT (Context->Chunks != NULL);
+  ASSERT (ExtentTable != NULL);
+
   CurrentOffset = 0;
   for (Index = 0; Index < Context->ChunkCount; Index++) {
-    CurrentChunk = &Context->Chunks[Index];
-
-    Result = OcAppleRamDiskRead (
+    Result = OcAppleChunklistVerifyChunk (
+               Context,
                ExtentTable,
-               CurrentOffset,
-               CurrentChunk->Length,
-               ChunkData
+               Index,
+               CurrentOffset
                );
     if (!Result) {
-      FreePool (ChunkData);
-      return FALSE;
-    }
-    //
-    // Calculate checksum of data and ensure they match.
-    //
-    DEBUG ((DEBUG_VERBOSE, "AppleChunklistVerifyData(): Validating chunk %lu of %lu\n",
-      Index, Context->ChunkCount));
-    Sha256 (ChunkHash, ChunkData, CurrentChunk->Length);
-    if (CompareMem (ChunkHash, CurrentChunk->Checksum, SHA256_DIGEST_SIZE) != 0) {
-      FreePool (ChunkData);
       return FALSE;
     }
 
-    CurrentOffset += CurrentChunk->Length;
+    CurrentOffset += Context->Chunks[Index].Length;
   }
 
-  FreePool (ChunkData);
   return TRUE;
 }
+
+/**
+  Check completed stream chunk and move to the next one.
+
+  @param[in,out] Stream  The Stream with current chunk fully hashed.
+**/
+STATIC
+VOID
+InternalStreamFinishChunk (
+  IN OUT OC_APPLE_CHUNKLIST_STREAM  *Stream
+  )
+{
+  UINT8 ChunkHash[SHA256_DIGEST_SIZE];
+  INTN  CmpResult;
+
+  Sha256Final (&Stream->Sha256Context, ChunkHash);
+
+  CmpResult = CompareMem (
+                ChunkHash,
+                Stream->Context->Chunks[Stream->ChunkIndex].Checksum,
+                SHA256_DIGEST_SIZE
+                );
+  if (CmpResult != 0) {
+    DEBUG ((DEBUG_VERBOSE, "AppleChunklistStreamUpdate(): Chunk %lu mismatch\n",
+      Stream->ChunkIndex));
+    Stream->Valid = FALSE;
+  }
+
+  ++Stream->ChunkIndex;
+  Stream->ChunkOffset = 0;
+  Sha256Init (&Stream->Sha256Context);
+}
+
+VOID
+OcAppleChunklistStreamInit (
+  OUT OC_APPLE_CHUNKLIST_STREAM         *Stream,
+  IN  CONST OC_APPLE_CHUNKLIST_CONTEXT  *Context
+  )
+{
+  ASSERT (Stream != NULL);
+  ASSERT (Context != NULL);
+  ASSERT (Context->Chunks != NULL);
+
+  Stream->Context     = Context;
+  Stream->ChunkIndex  = 0;
+  Stream->ChunkOffset = 0;
+  Stream->Valid       = TRUE;
+  Sha256Init (&Stream->Sha256Context);
+}
+
+VOID
+OcAppleChunklistStreamUpdate (
+  IN OUT OC_APPLE_CHUNKLIST_STREAM  *Stream,
+  IN     CONST VOID                 *Data,
+  IN     UINTN                      Size
+  )
+{
+  CONST UINT8                 *Walker;
+  CONST APPLE_CHUNKLIST_CHUNK *Chunk;
+  UINT32                      PartSize;
+
+  ASSERT (Stream != NULL);
+  ASSERT (Data != NULL || Size == 0);
+
+  Walker = Data;
+
+  while (Size > 0
+    && Stream->Valid
+    && Stream->ChunkIndex < Stream->Context->ChunkCount) {
+    Chunk    = &Stream->Context->Chunks[Stream->ChunkIndex];
+    PartSize = (UINT32) MIN (Size, Chunk->Length - Stream->ChunkOffset);
+
+    Sha256Update (&Stream->Sha256Context, Walker, PartSize);
+
+    Stream->ChunkOffset += PartSize;
+    Walker              += PartSize;
+    Size                -= PartSize;
+
+    if (Stream->ChunkOffset == Chunk->Length) {
+      InternalStreamFinishChunk (Stream);
+    }
+  }
+}
+
+BOOLEAN
+OcAppleChunklistStreamFinal (
+  IN OUT OC_APPLE_CHUNKLIST_STREAM  *Stream
+  )
+{
+  ASSERT (Stream != NULL);
+
+  //
+  // Trailing empty chunks get no data.
+  //
+  while (Stream->Valid
+    && Stream->ChunkIndex < Stream->Context->ChunkCount
+    && Stream->Context->Chunks[Stream->ChunkIndex].Length == 0) {
+    InternalStreamFinishChunk (Stream);
+  }
+
+  return Stream->Valid && Stream->ChunkIndex == Stream->Context->ChunkCount;
+}
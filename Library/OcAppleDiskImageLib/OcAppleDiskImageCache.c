@@ -0,0 +1,254 @@
+/** @file
+  Copyright (C) 2019, vit9696. All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Uefi.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcAppleDiskImageLib.h>
+#include <Library/OcAppleRamDiskLib.h>
+#include <Library/OcCompressionLib.h>
+
+#include "OcAppleDiskImageLibInternal.h"
+
+/**
+  Decompress zlib chunk into a buffer of chunk size.
+
+  @param[in]  Context    Disk image context.
+  @param[in]  Chunk      Chunk to decompress.
+  @param[in]  ChunkSize  Decompressed chunk size.
+  @param[out] Buffer     Decompressed data.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalInflateChunk (
+  IN  OC_APPLE_DISK_IMAGE_CONTEXT   *Context,
+  IN  CONST APPLE_DISK_IMAGE_CHUNK  *Chunk,
+  IN  UINTN                         ChunkSize,
+  OUT UINT8                         *Buffer
+  )
+{
+  BOOLEAN Result;
+  UINT8   *ChunkDataCompressed;
+  UINTN   CompressedSize;
+  UINTN   OutSize;
+
+  Result = InternalVerifyRange (
+             Context,
+             Chunk->CompressedOffset,
+             Chunk->CompressedLength
+             );
+  if (!Result) {
+    return FALSE;
+  }
+
+  //
+  // Inflate straight from RAM disk unless the chunk crosses extents.
+  //
+  CompressedSize      = (UINTN)Chunk->CompressedLength;
+  ChunkDataCompressed = OcAppleRamDiskGetSpan (
+                          Context->ExtentTable,
+                          Chunk->CompressedOffset,
+                          &CompressedSize
+                          );
+  if ((ChunkDataCompressed != NULL)
+   && (CompressedSize == Chunk->CompressedLength)) {
+    OutSize = DecompressZLIB (
+                Buffer,
+                ChunkSize,
+                ChunkDataCompressed,
+                CompressedSize
+                );
+    return OutSize == ChunkSize;
+  }
+
+  ChunkDataCompressed = AllocatePool ((UINTN)Chunk->CompressedLength);
+  if (ChunkDataCompressed == NULL) {
+    return FALSE;
+  }
+
+  Result = OcAppleRamDiskRead (
+             Context->ExtentTable,
+             Chunk->CompressedOffset,
+             (UINTN)Chunk->CompressedLength,
+             ChunkDataCompressed
+             );
+  if (!Result) {
+    FreePool (ChunkDataCompressed);
+    return FALSE;
+  }
+
+  OutSize = DecompressZLIB (
+              Buffer,
+              ChunkSize,
+              ChunkDataCompressed,
+              (UINTN)Chunk->CompressedLength
+              );
+
+  FreePool (ChunkDataCompressed);
+
+  return OutSize == ChunkSize;
+}
+
+/**
+  Evict least recently used chunks until Size more bytes fit the budget.
+
+  @param[in,out] Context  Disk image context.
+  @param[in]     Size     Amount of bytes to make room for.
+**/
+STATIC
+VOID
+InternalEvictChunks (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Size
+  )
+{
+  DMG_CACHED_CHUNK  *CachedChunk;
+
+  while (!IsListEmpty (&Context->CacheChunks)
+    && (Context->CacheSize + Size > Context->CacheBudget)) {
+    CachedChunk = DMG_CACHED_CHUNK_FROM_LINK (
+                    GetFirstNode (&Context->CacheChunks)
+                    );
+    RemoveEntryList (&CachedChunk->Link);
+    Context->CacheSize -= CachedChunk->Size;
+    FreePool (CachedChunk);
+  }
+}
+
+VOID
+InternalInitChunkCache (
+  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  InitializeListHead (&Context->CacheChunks);
+  Context->CacheSize   = 0;
+  Context->CacheBudget = OC_APPLE_DISK_IMAGE_CACHE_BUDGET;
+  Context->CacheHits   = 0;
+  Context->CacheMisses = 0;
+}
+
+VOID
+InternalFreeChunkCache (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  DEBUG ((
+    DEBUG_VERBOSE,
+    "OCDI: Chunk cache %Lu hits %Lu misses\n",
+    Context->CacheHits,
+    Context->CacheMisses
+    ));
+
+  Context->CacheBudget = 0;
+  InternalEvictChunks (Context, 0);
+}
+
+BOOLEAN
+InternalReadZlibChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       BlockIndex,
+  IN     UINT32                       ChunkIndex,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK *Chunk,
+  IN     UINTN                        ChunkSize,
+  IN     UINTN                        Offset,
+  IN     UINTN                        Size,
+  OUT    UINT8                        *Buffer
+  )
+{
+  LIST_ENTRY        *Link;
+  DMG_CACHED_CHUNK  *CachedChunk;
+  UINT8             *ChunkData;
+
+  ASSERT (Offset + Size <= ChunkSize);
+
+  for (
+    Link = GetFirstNode (&Context->CacheChunks);
+    !IsNull (&Context->CacheChunks, Link);
+    Link = GetNextNode (&Context->CacheChunks, Link)) {
+    CachedChunk = DMG_CACHED_CHUNK_FROM_LINK (Link);
+
+    if ((CachedChunk->BlockIndex == BlockIndex)
+     && (CachedChunk->ChunkIndex == ChunkIndex)) {
+      ++Context->CacheHits;
+      //
+      // Move to the most recently used end.
+      //
+      RemoveEntryList (Link);
+      InsertTailList (&Context->CacheChunks, Link);
+      CopyMem (Buffer, &CachedChunk->Data[Offset], Size);
+      return TRUE;
+    }
+  }
+
+  ++Context->CacheMisses;
+
+  //
+  // Whole chunk reads gain nothing from caching, inflate them in place.
+  //
+  if (Size == ChunkSize) {
+    return InternalInflateChunk (Context, Chunk, ChunkSize, Buffer);
+  }
+
+  if (ChunkSize > Context->CacheBudget) {
+    ChunkData = AllocatePool (ChunkSize);
+    if (ChunkData == NULL) {
+      return FALSE;
+    }
+
+    if (!InternalInflateChunk (Context, Chunk, ChunkSize, ChunkData)) {
+      FreePool (ChunkData);
+      return FALSE;
+    }
+
+    CopyMem (Buffer, &ChunkData[Offset], Size);
+    FreePool (ChunkData);
+    return TRUE;
+  }
+
+  InternalEvictChunks (Context, ChunkSize);
+
+  CachedChunk = AllocatePool (sizeof (*CachedChunk) + ChunkSize);
+  if (CachedChunk == NULL) {
+    return FALSE;
+  }
+
+  if (!InternalInflateChunk (Context, Chunk, ChunkSize, CachedChunk->Data)) {
+    FreePool (CachedChunk);
+    return FALSE;
+  }
+
+  CachedChunk->BlockIndex = BlockIndex;
+  CachedChunk->ChunkIndex = ChunkIndex;
+  CachedChunk->Size       = ChunkSize;
+  InsertTailList (&Context->CacheChunks, &CachedChunk->Link);
+  Context->CacheSize += ChunkSize;
+
+  CopyMem (Buffer, &CachedChunk->Data[Offset], Size);
+  return TRUE;
+}
+
+VOID
+OcAppleDiskImageSetCacheBudget (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINTN                        Budget
+  )
+{
+  ASSERT (Context != NULL);
+
+  Context->CacheBudget = Budget;
+  InternalEvictChunks (Context, 0);
+}
@@ -20,7 +20,6 @@
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleChunklistLib.h>
 #include <Library/OcAppleDiskImageLib.h>
-#include <Library/OcCompressionLib.h>
 #include <Library/OcFileLib.h>
 #include <Library/OcGuardLib.h>
 
@@ -168,18 +167,57 @@ OcAppleDiskImageInitializeContext (
     return FALSE;
   }
 
-  Context->ExtentTable = ExtentTable;
-  Context->BlockCount  = DmgBlockCount;
-  Context->Blocks      = DmgBlocks;
-  Context->SectorCount = SectorCount;
+  Context->ExtentTable       = ExtentTable;
+  Context->BlockCount        = DmgBlockCount;
+  Context->Blocks            = DmgBlocks;
+  Context->SectorCount       = SectorCount;
+  Context->MetadataOffset    = XmlOffset;
+  Context->MetadataSize      = FileSize - XmlOffset;
+  Context->Chunklist         = NULL;
+  Context->ChunklistOffsets  = NULL;
+  Context->ChunklistVerified = NULL;
+  Context->ChunklistPending  = 0;
+
+  Result = InternalBuildChunkIndex (Context);
+  if (!Result) {
+    DEBUG ((DEBUG_INFO, "Dmg chunk index error: %u\n", DmgBlockCount));
+
+    while ((DmgBlockCount--) != 0) {
+      FreePool (DmgBlocks[DmgBlockCount]);
+    }
+
+    FreePool (DmgBlocks);
+    return FALSE;
+  }
+
+  InternalInitChunkCache (Context);
 
   return TRUE;
 }
 
+/**
+  Hash DMG data as it is loaded into RAM disk.
+
+  @param[in]  Context  Chunklist stream.
+  @param[in]  Data     Loaded data.
+  @param[in]  Size     Loaded data size.
+**/
+STATIC
+VOID
+InternalHashLoadedData (
+  IN VOID        *Context,
+  IN CONST VOID  *Data,
+  IN UINTN       Size
+  )
+{
+  OcAppleChunklistStreamUpdate (Context, Data, Size);
+}
+
 BOOLEAN
 OcAppleDiskImageInitializeFromFile (
   OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  EFI_FILE_PROTOCOL            *File
+  IN  EFI_FILE_PROTOCOL            *File,
+  IN  OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext  OPTIONAL
   )
 {
   EFI_STATUS                        Status;
@@ -187,6 +225,7 @@ OcAppleDiskImageInitializeFromFile (
 
   UINT32                            FileSize;
   CONST APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable;
+  OC_APPLE_CHUNKLIST_STREAM         Stream;
 
   ASSERT (Context != NULL);
   ASSERT (File != NULL);
@@ -203,7 +242,19 @@ OcAppleDiskImageInitializeFromFile (
     return FALSE;
   }
 
-  Result = OcAppleRamDiskLoadFile (ExtentTable, File, FileSize);
+  if (ChunklistContext != NULL) {
+    OcAppleChunklistStreamInit (&Stream, ChunklistContext);
+    Result = OcAppleRamDiskLoadFileEx (
+               ExtentTable,
+               File,
+               FileSize,
+               InternalHashLoadedData,
+               &Stream
+               );
+  } else {
+    Result = OcAppleRamDiskLoadFile (ExtentTable, File, FileSize);
+  }
+
   if (!Result) {
     DEBUG ((DEBUG_INFO, "OCBD: Failed to load DMG file.\n"));
 
@@ -211,6 +262,13 @@ OcAppleDiskImageInitializeFromFile (
     return FALSE;
   }
 
+  if (ChunklistContext != NULL && !OcAppleChunklistStreamFinal (&Stream)) {
+    DEBUG ((DEBUG_WARN, "OCBD: DMG has been altered.\n"));
+
+    OcAppleRamDiskFree (ExtentTable);
+    return FALSE;
+  }
+
   Result = OcAppleDiskImageInitializeContext (Context, ExtentTable, FileSize);
   if (!Result) {
     DEBUG ((DEBUG_INFO, "OCBD: Failed to initialise DMG context.\n"));
@@ -237,6 +295,177 @@ OcAppleDiskImageVerifyData (
            );
 }
 
+/**
+  Drop chunklist verification state.
+
+  @param[in,out] Context  Disk image context.
+**/
+STATIC
+VOID
+InternalFreeChunklist (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  if (Context->ChunklistOffsets != NULL) {
+    FreePool (Context->ChunklistOffsets);
+    Context->ChunklistOffsets = NULL;
+  }
+
+  if (Context->ChunklistVerified != NULL) {
+    FreePool (Context->ChunklistVerified);
+    Context->ChunklistVerified = NULL;
+  }
+
+  Context->Chunklist = NULL;
+}
+
+BOOLEAN
+InternalVerifyRange (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Offset,
+  IN     UINT64                       Size
+  )
+{
+  BOOLEAN      Result;
+  CONST UINT64 *Offsets;
+  UINT64       ChunkCount;
+  UINT64       Start;
+  UINT64       End;
+  UINT64       Middle;
+
+  if (Context->Chunklist == NULL) {
+    return TRUE;
+  }
+
+  Offsets    = Context->ChunklistOffsets;
+  ChunkCount = Context->Chunklist->ChunkCount;
+
+  if ((Size == 0)
+   || (Size > Offsets[ChunkCount])
+   || (Offset > Offsets[ChunkCount] - Size)) {
+    return FALSE;
+  }
+
+  //
+  // Find the last chunk starting at or below Offset.
+  //
+  Start = 0;
+  End   = ChunkCount;
+  while (End - Start > 1) {
+    Middle = Start + (End - Start) / 2;
+    if (Offsets[Middle] <= Offset) {
+      Start = Middle;
+    } else {
+      End = Middle;
+    }
+  }
+
+  for (; (Start < ChunkCount) && (Offsets[Start] < Offset + Size); ++Start) {
+    if ((Context->ChunklistVerified[Start / 8] & (1U << (Start % 8))) != 0) {
+      continue;
+    }
+
+    Result = OcAppleChunklistVerifyChunk (
+               Context->Chunklist,
+               Context->ExtentTable,
+               Start,
+               Offsets[Start]
+               );
+    if (!Result) {
+      DEBUG ((DEBUG_WARN, "OCDI: Chunk %Lu has been altered.\n", Start));
+      return FALSE;
+    }
+
+    Context->ChunklistVerified[Start / 8] |= (UINT8)(1U << (Start % 8));
+    --Context->ChunklistPending;
+  }
+
+  if (Context->ChunklistPending == 0) {
+    InternalFreeChunklist (Context);
+  }
+
+  return TRUE;
+}
+
+BOOLEAN
+OcAppleDiskImageVerifyDataOnRead (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     OC_APPLE_CHUNKLIST_CONTEXT   *ChunklistContext
+  )
+{
+  BOOLEAN Result;
+  UINT64  ChunkCount;
+  UINTN   OffsetsSize;
+  UINT64  Index;
+
+  ASSERT (Context != NULL);
+  ASSERT (ChunklistContext != NULL);
+  ASSERT (Context->Chunklist == NULL);
+
+  ChunkCount = ChunklistContext->ChunkCount;
+  if ((ChunkCount == 0) || (ChunkCount >= MAX_UINTN)) {
+    return FALSE;
+  }
+
+  Result = OcOverflowMulUN (
+             (UINTN)ChunkCount + 1,
+             sizeof (*Context->ChunklistOffsets),
+             &OffsetsSize
+             );
+  if (Result) {
+    return FALSE;
+  }
+
+  Context->ChunklistOffsets  = AllocatePool (OffsetsSize);
+  Context->ChunklistVerified = AllocateZeroPool ((UINTN)(ChunkCount + 7) / 8);
+  if ((Context->ChunklistOffsets == NULL) || (Context->ChunklistVerified == NULL)) {
+    InternalFreeChunklist (Context);
+    return FALSE;
+  }
+
+  Context->Chunklist        = ChunklistContext;
+  Context->ChunklistPending = ChunkCount;
+
+  Context->ChunklistOffsets[0] = 0;
+  for (Index = 0; Index < ChunkCount; ++Index) {
+    Context->ChunklistOffsets[Index + 1] = Context->ChunklistOffsets[Index]
+      + ChunklistContext->Chunks[Index].Length;
+
+    //
+    // Empty chunks are never reached by reads, check them right away.
+    //
+    if (ChunklistContext->Chunks[Index].Length == 0) {
+      Result = OcAppleChunklistVerifyChunk (
+                 ChunklistContext,
+                 Context->ExtentTable,
+                 Index,
+                 Context->ChunklistOffsets[Index]
+                 );
+      if (!Result) {
+        InternalFreeChunklist (Context);
+        return FALSE;
+      }
+
+      Context->ChunklistVerified[Index / 8] |= (UINT8)(1U << (Index % 8));
+      --Context->ChunklistPending;
+    }
+  }
+
+  //
+  // The plist decides where sectors are read from, trust it right away.
+  //
+  Result = InternalVerifyRange (
+             Context,
+             Context->MetadataOffset,
+             Context->MetadataSize
+             );
+  if (!Result) {
+    InternalFreeChunklist (Context);
+  }
+
+  return Result;
+}
+
 VOID
 OcAppleDiskImageFreeContext (
   IN OC_APPLE_DISK_IMAGE_CONTEXT  *Context
@@ -246,11 +475,15 @@ OcAppleDiskImageFreeContext (
 
   ASSERT (Context != NULL);
 
+  InternalFreeChunkCache (Context);
+  InternalFreeChunklist (Context);
+
   for (Index = 0; Index < Context->BlockCount; ++Index) {
     FreePool (Context->Blocks[Index]);
   }
 
   FreePool (Context->Blocks);
+  FreePool (Context->Chunks);
 }
 
 VOID
@@ -272,22 +505,19 @@ OcAppleDiskImageRead (
 {
   BOOLEAN                     Result;
 
-  APPLE_DISK_IMAGE_BLOCK_DATA *BlockData;
-  APPLE_DISK_IMAGE_CHUNK      *Chunk;
-  UINT64                      ChunkTotalLength;
-  UINT64                      ChunkLength;
-  UINT64                      ChunkOffset;
-  UINT8                       *ChunkData;
-  UINT8                       *ChunkDataCompressed;
-
-  UINT64                      LbaCurrent;
-  UINT64                      LbaOffset;
-  UINT64                      LbaLength;
-  UINTN                       RemainingBufferSize;
-  UINTN                       BufferChunkSize;
-  UINT8                       *BufferCurrent;
+  UINT32                          Index;
+  OC_APPLE_DISK_IMAGE_CHUNK_ENTRY *Entry;
+  APPLE_DISK_IMAGE_CHUNK          *Chunk;
+  UINT64                          ChunkTotalLength;
+  UINT64                          ChunkLength;
+  UINT64                          ChunkOffset;
 
-  UINTN                       OutSize;
+  UINT64                          LbaCurrent;
+  UINT64                          LbaOffset;
+  UINT64                          LbaLength;
+  UINTN                           RemainingBufferSize;
+  UINTN                           BufferChunkSize;
+  UINT8                           *BufferCurrent;
 
   ASSERT (Context != NULL);
   ASSERT (Buffer != NULL);
@@ -296,14 +526,18 @@ OcAppleDiskImageRead (
   LbaCurrent          = Lba;
   RemainingBufferSize = BufferSize;
   BufferCurrent       = Buffer;
+  Index               = 0;
 
   while (RemainingBufferSize > 0) {
-    Result = InternalGetBlockChunk (Context, LbaCurrent, &BlockData, &Chunk);
+    Result = InternalGetChunk (Context, LbaCurrent, &Index);
     if (!Result) {
       return FALSE;
     }
 
-    LbaOffset = (LbaCurrent - DMG_SECTOR_START_ABS (BlockData, Chunk));
+    Entry = &Context->Chunks[Index];
+    Chunk = Entry->Chunk;
+
+    LbaOffset = (LbaCurrent - Entry->SectorNumber);
     LbaLength = (Chunk->SectorCount - LbaOffset);
 
     Result = OcOverflowMulU64 (
@@ -338,6 +572,15 @@ OcAppleDiskImageRead (
 
       case APPLE_DISK_IMAGE_CHUNK_TYPE_RAW:
       {
+        Result = InternalVerifyRange (
+                   Context,
+                   (Chunk->CompressedOffset + ChunkOffset),
+                   BufferChunkSize
+                   );
+        if (!Result) {
+          return FALSE;
+        }
+
         Result = OcAppleRamDiskRead (
                    Context->ExtentTable,
                    (Chunk->CompressedOffset + ChunkOffset),
@@ -353,36 +596,20 @@ OcAppleDiskImageRead (
 
       case APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB:
       {
-        ChunkData = AllocatePool (ChunkTotalLength + Chunk->CompressedLength);
-        if (ChunkData == NULL) {
-          return FALSE;
-        }
-
-        ChunkDataCompressed = (ChunkData + ChunkTotalLength);
-        Result = OcAppleRamDiskRead (
-                   Context->ExtentTable,
-                   Chunk->CompressedOffset,
-                   Chunk->CompressedLength,
-                   ChunkDataCompressed
+        Result = InternalReadZlibChunk (
+                   Context,
+                   Entry->BlockIndex,
+                   Entry->ChunkIndex,
+                   Chunk,
+                   (UINTN)ChunkTotalLength,
+                   (UINTN)ChunkOffset,
+                   BufferChunkSize,
+                   BufferCurrent
                    );
         if (!Result) {
-          FreePool (ChunkData);
-          return FALSE;
-        }
-
-        OutSize = DecompressZLIB (
-                    ChunkData,
-                    ChunkTotalLength,
-                    ChunkDataCompressed,
-                    Chunk->CompressedLength
-                    );
-        if (OutSize != ChunkTotalLength) {
-          FreePool (ChunkData);
           return FALSE;
         }
 
-        CopyMem (BufferCurrent, (ChunkData + ChunkOffset), BufferChunkSize);
-        FreePool (ChunkData);
         break;
       }
 
@@ -402,5 +629,7 @@ OcAppleDiskImageRead (
     LbaCurrent          += LbaLength;
   }
 
+  Context->LastChunk = Index;
+
   return TRUE;
 }
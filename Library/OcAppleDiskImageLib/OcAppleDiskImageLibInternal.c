@@ -13,6 +13,7 @@
 #include <Uefi.h>
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
 #include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleDiskImageLib.h>
@@ -21,48 +22,6 @@
 
 #include "OcAppleDiskImageLibInternal.h"
 
-STATIC
-BOOLEAN
-InternalFindPlistDictChild (
-  IN  XML_NODE  *Node,
-  IN  CHAR8     *KeyName,
-  OUT XML_NODE  **Key,
-  OUT XML_NODE  **Value
-  )
-{
-  UINT32      ChildCount;
-  XML_NODE    *ChildValue;
-  XML_NODE    *ChildKey;
-  CONST CHAR8 *ChildKeyName;
-  UINT32      Index;
-
-  ASSERT (Node != NULL);
-  ASSERT (KeyName != NULL);
-  ASSERT (Key != NULL);
-  ASSERT (Value != NULL);
-
-  ChildCount = PlistDictChildren (Node);
-  for (Index = 0; Index < ChildCount; ++Index) {
-    ChildKey = PlistDictChild (Node, Index, &ChildValue);
-    if (ChildKey == NULL) {
-      break;
-    }
-
-    ChildKeyName = PlistKeyValue (ChildKey);
-    if (ChildKeyName == NULL) {
-      break;
-    }
-
-    if (AsciiStrCmp (ChildKeyName, KeyName) == 0) {
-      *Key   = ChildKey;
-      *Value = ChildValue;
-      return TRUE;
-    }
-  }
-
-  return FALSE;
-}
-
 STATIC
 BOOLEAN
 InternalSwapBlockData (
@@ -172,13 +131,10 @@ InternalParsePlist (
 
   XML_DOCUMENT                *XmlPlistDoc;
   XML_NODE                    *NodeRoot;
-  XML_NODE                    *NodeResourceForkKey;
   XML_NODE                    *NodeResourceForkValue;
-  XML_NODE                    *NodeBlockListKey;
   XML_NODE                    *NodeBlockListValue;
 
   XML_NODE                    *NodeBlockDict;
-  XML_NODE                    *BlockDictChildKey;
   XML_NODE                    *BlockDictChildValue;
   UINT32                      BlockDictChildDataSize;
 
@@ -210,23 +166,15 @@ InternalParsePlist (
     goto DONE_ERROR;
   }
 
-  Result = InternalFindPlistDictChild (
-             NodeRoot,
-             DMG_PLIST_RESOURCE_FORK_KEY,
-             &NodeResourceForkKey,
-             &NodeResourceForkValue
-             );
-  if (!Result) {
+  NodeResourceForkValue = PlistDictFind (NodeRoot, DMG_PLIST_RESOURCE_FORK_KEY);
+  if (NodeResourceForkValue == NULL) {
+    Result = FALSE;
     goto DONE_ERROR;
   }
 
-  Result = InternalFindPlistDictChild (
-             NodeResourceForkValue,
-             DMG_PLIST_BLOCK_LIST_KEY,
-             &NodeBlockListKey,
-             &NodeBlockListValue
-             );
-  if (!Result) {
+  NodeBlockListValue = PlistDictFind (NodeResourceForkValue, DMG_PLIST_BLOCK_LIST_KEY);
+  if (NodeBlockListValue == NULL) {
+    Result = FALSE;
     goto DONE_ERROR;
   }
 
@@ -250,17 +198,13 @@ InternalParsePlist (
   for (Index = 0; Index < NumDmgBlocks; ++Index) {
     NodeBlockDict = XmlNodeChild (NodeBlockListValue, Index);
 
-    Result = InternalFindPlistDictChild (
-               NodeBlockDict,
-               DMG_PLIST_DATA,
-               &BlockDictChildKey,
-               &BlockDictChildValue
-               );
-    if (!Result) {
+    BlockDictChildValue = PlistDictFind (NodeBlockDict, DMG_PLIST_DATA);
+    if (BlockDictChildValue == NULL) {
+      Result = FALSE;
       goto DONE_ERROR;
     }
 
-    Result = PlistDataSize (BlockDictChildValue, &BlockDictChildDataSize);
+    Result = PlistDataDecode (BlockDictChildValue, NULL, &BlockDictChildDataSize);
     if (!Result || (BlockDictChildDataSize < sizeof (*Block))) {
       goto DONE_ERROR;
     }
@@ -310,36 +254,220 @@ DONE_ERROR:
   return Result;
 }
 
+STATIC
+BOOLEAN
+InternalChunkEntryLess (
+  IN CONST OC_APPLE_DISK_IMAGE_CHUNK_ENTRY  *First,
+  IN CONST OC_APPLE_DISK_IMAGE_CHUNK_ENTRY  *Second
+  )
+{
+  return First->SectorNumber < Second->SectorNumber;
+}
+
+STATIC
 BOOLEAN
-InternalGetBlockChunk (
-  IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  UINT64                       Lba,
-  OUT APPLE_DISK_IMAGE_BLOCK_DATA  **Data,
-  OUT APPLE_DISK_IMAGE_CHUNK       **Chunk
+InternalChunkHasLba (
+  IN CONST OC_APPLE_DISK_IMAGE_CONTEXT      *Context,
+  IN CONST OC_APPLE_DISK_IMAGE_CHUNK_ENTRY  *Entry,
+  IN       UINT64                           Lba
+  )
+{
+  CONST APPLE_DISK_IMAGE_BLOCK_DATA *BlockData;
+
+  BlockData = Context->Blocks[Entry->BlockIndex];
+
+  return (Lba >= BlockData->SectorNumber)
+      && (Lba - BlockData->SectorNumber < BlockData->SectorCount)
+      && (Lba >= Entry->SectorNumber)
+      && (Lba - Entry->SectorNumber < Entry->Chunk->SectorCount);
+}
+
+STATIC
+VOID
+InternalSiftChunkIndex (
+  IN OUT OC_APPLE_DISK_IMAGE_CHUNK_ENTRY  *Chunks,
+  IN     UINT32                           Root,
+  IN     UINT32                           NumEntries
   )
 {
-  UINT32                      BlockIndex;
-  UINT32                      ChunkIndex;
-  APPLE_DISK_IMAGE_BLOCK_DATA *BlockData;
-  APPLE_DISK_IMAGE_CHUNK      *BlockChunk;
+  UINT32                          Child;
+  OC_APPLE_DISK_IMAGE_CHUNK_ENTRY Entry;
+
+  CopyMem (&Entry, &Chunks[Root], sizeof (Entry));
+
+  while ((Child = 2 * Root + 1) < NumEntries) {
+    if (Child + 1 < NumEntries
+      && InternalChunkEntryLess (&Chunks[Child], &Chunks[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalChunkEntryLess (&Entry, &Chunks[Child])) {
+      break;
+    }
+
+    CopyMem (&Chunks[Root], &Chunks[Child], sizeof (Entry));
+    Root = Child;
+  }
 
+  CopyMem (&Chunks[Root], &Entry, sizeof (Entry));
+}
+
+BOOLEAN
+InternalBuildChunkIndex (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  )
+{
+  BOOLEAN                         Result;
+  UINT32                          BlockIndex;
+  UINT32                          ChunkIndex;
+  UINT32                          NumChunks;
+  UINT32                          ChunksSize;
+  UINT32                          Index;
+  UINT64                          SectorTop;
+  APPLE_DISK_IMAGE_BLOCK_DATA     *BlockData;
+  APPLE_DISK_IMAGE_CHUNK          *BlockChunk;
+  OC_APPLE_DISK_IMAGE_CHUNK_ENTRY *Chunks;
+  OC_APPLE_DISK_IMAGE_CHUNK_ENTRY Entry;
+
+  NumChunks = 0;
+  for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
+    Result = OcOverflowAddU32 (
+               NumChunks,
+               Context->Blocks[BlockIndex]->ChunkCount,
+               &NumChunks
+               );
+    if (Result) {
+      return FALSE;
+    }
+  }
+
+  Result = OcOverflowMulU32 (NumChunks, sizeof (*Chunks), &ChunksSize);
+  if (Result || (NumChunks == 0)) {
+    return FALSE;
+  }
+
+  Chunks = AllocatePool (ChunksSize);
+  if (Chunks == NULL) {
+    return FALSE;
+  }
+
+  //
+  // Only chunks covering sectors take part in lookup.
+  //
+  NumChunks = 0;
   for (BlockIndex = 0; BlockIndex < Context->BlockCount; ++BlockIndex) {
     BlockData = Context->Blocks[BlockIndex];
 
-    if ((Lba >= BlockData->SectorNumber)
-     && (Lba < (BlockData->SectorNumber + BlockData->SectorCount))) {
-      for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
-        BlockChunk = &BlockData->Chunks[ChunkIndex];
-
-        if ((Lba >= DMG_SECTOR_START_ABS (BlockData, BlockChunk))
-         && (Lba < (DMG_SECTOR_START_ABS (BlockData, BlockChunk) + BlockChunk->SectorCount))) {
-          *Data  = BlockData;
-          *Chunk = BlockChunk;
-          return TRUE;
-        }
+    for (ChunkIndex = 0; ChunkIndex < BlockData->ChunkCount; ++ChunkIndex) {
+      BlockChunk = &BlockData->Chunks[ChunkIndex];
+      if (BlockChunk->SectorCount == 0) {
+        continue;
+      }
+
+      Result = OcOverflowAddU64 (
+                 BlockData->SectorNumber,
+                 BlockChunk->SectorNumber,
+                 &Chunks[NumChunks].SectorNumber
+                 );
+      Result |= OcOverflowAddU64 (
+                  Chunks[NumChunks].SectorNumber,
+                  BlockChunk->SectorCount,
+                  &SectorTop
+                  );
+      if (Result) {
+        FreePool (Chunks);
+        return FALSE;
       }
+
+      Chunks[NumChunks].Chunk      = BlockChunk;
+      Chunks[NumChunks].BlockIndex = BlockIndex;
+      Chunks[NumChunks].ChunkIndex = ChunkIndex;
+      ++NumChunks;
     }
   }
 
-  return FALSE;
+  for (Index = NumChunks / 2; Index > 0; --Index) {
+    InternalSiftChunkIndex (Chunks, Index - 1, NumChunks);
+  }
+
+  for (Index = NumChunks; Index > 1; --Index) {
+    CopyMem (&Entry, &Chunks[0], sizeof (Entry));
+    CopyMem (&Chunks[0], &Chunks[Index - 1], sizeof (Entry));
+    CopyMem (&Chunks[Index - 1], &Entry, sizeof (Entry));
+    InternalSiftChunkIndex (Chunks, 0, Index - 1);
+  }
+
+  //
+  // Overlapping chunks would make the lookup depend on sort order.
+  //
+  for (Index = 1; Index < NumChunks; ++Index) {
+    if (Chunks[Index].SectorNumber - Chunks[Index - 1].SectorNumber
+      < Chunks[Index - 1].Chunk->SectorCount) {
+      FreePool (Chunks);
+      return FALSE;
+    }
+  }
+
+  Context->ChunkCount = NumChunks;
+  Context->Chunks     = Chunks;
+  Context->LastChunk  = 0;
+
+  return TRUE;
+}
+
+BOOLEAN
+InternalGetChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Lba,
+  OUT    UINT32                       *Index
+  )
+{
+  OC_APPLE_DISK_IMAGE_CHUNK_ENTRY *Chunks;
+  UINT32                          Start;
+  UINT32                          End;
+  UINT32                          Middle;
+
+  Chunks = Context->Chunks;
+
+  //
+  // Sequential reads hit the last chunk or the one right after it.
+  //
+  for (
+    Start = Context->LastChunk;
+    Start < MIN (Context->LastChunk + 2, Context->ChunkCount);
+    ++Start) {
+    if (InternalChunkHasLba (Context, &Chunks[Start], Lba)) {
+      Context->LastChunk = Start;
+      *Index             = Start;
+      return TRUE;
+    }
+  }
+
+  //
+  // Find the last chunk starting at or below Lba.
+  //
+  Start = 0;
+  End   = Context->ChunkCount;
+  while (Start < End) {
+    Middle = Start + (End - Start) / 2;
+    if (Chunks[Middle].SectorNumber <= Lba) {
+      Start = Middle + 1;
+    } else {
+      End = Middle;
+    }
+  }
+
+  if (Start == 0) {
+    return FALSE;
+  }
+
+  --Start;
+
+  if (!InternalChunkHasLba (Context, &Chunks[Start], Lba)) {
+    return FALSE;
+  }
+
+  Context->LastChunk = Start;
+  *Index             = Start;
+  return TRUE;
 }
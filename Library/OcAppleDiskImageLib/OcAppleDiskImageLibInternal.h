@@ -16,7 +16,19 @@
 #define BASE_256B  0x0100U
 #define SIZE_512B  0x0200U
 
-#define DMG_SECTOR_START_ABS(b, c) (((b)->SectorNumber) + ((c)->SectorNumber))
+//
+// Decompressed chunk cache entry.
+//
+typedef struct {
+  LIST_ENTRY  Link;
+  UINT32      BlockIndex;
+  UINT32      ChunkIndex;
+  UINTN       Size;
+  UINT8       Data[];
+} DMG_CACHED_CHUNK;
+
+#define DMG_CACHED_CHUNK_FROM_LINK(This)  \
+  BASE_CR ((This), DMG_CACHED_CHUNK, Link)
 
 #define DMG_PLIST_RESOURCE_FORK_KEY  "resource-fork"
 #define DMG_PLIST_BLOCK_LIST_KEY     "blkx"
@@ -37,11 +49,44 @@ InternalParsePlist (
   );
 
 BOOLEAN
-InternalGetBlockChunk (
-  IN  OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
-  IN  UINT64                       Lba,
-  OUT APPLE_DISK_IMAGE_BLOCK_DATA  **Data,
-  OUT APPLE_DISK_IMAGE_CHUNK       **Chunk
+InternalBuildChunkIndex (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
+BOOLEAN
+InternalGetChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Lba,
+  OUT    UINT32                       *Index
+  );
+
+BOOLEAN
+InternalVerifyRange (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT64                       Offset,
+  IN     UINT64                       Size
+  );
+
+VOID
+InternalInitChunkCache (
+  OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
+VOID
+InternalFreeChunkCache (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context
+  );
+
+BOOLEAN
+InternalReadZlibChunk (
+  IN OUT OC_APPLE_DISK_IMAGE_CONTEXT  *Context,
+  IN     UINT32                       BlockIndex,
+  IN     UINT32                       ChunkIndex,
+  IN     CONST APPLE_DISK_IMAGE_CHUNK *Chunk,
+  IN     UINTN                        ChunkSize,
+  IN     UINTN                        Offset,
+  IN     UINTN                        Size,
+  OUT    UINT8                        *Buffer
   );
 
 #endif // APPLE_DISK_IMAGE_LIB_INTERNAL_H
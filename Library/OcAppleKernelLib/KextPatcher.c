@@ -19,6 +19,7 @@
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleKernelLib.h>
 #include <Library/OcMachoLib.h>
 #include <Library/OcMiscLib.h>
@@ -40,7 +41,24 @@ PatcherInitContextFromPrelinked (
     return RETURN_NOT_FOUND;
   }
 
-  CopyMem (Context, &Kext->Context, sizeof (*Context));
+  //
+  // Do not copy Mach-O context of the kext, as lookup indices are owned by
+  // the kext and may be rebuilt or freed by it. Symbol name hash table is
+  // shared with the kext, which owns it, so this context owns nothing.
+  //
+  if (!MachoInitializeContext (
+    &Context->MachContext,
+    MachoGetMachHeader64 (&Kext->Context.MachContext),
+    MachoGetFileSize (&Kext->Context.MachContext)
+    )) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  Context->VirtualBase     = Kext->Context.VirtualBase;
+  Context->VirtualKmod     = Kext->Context.VirtualKmod;
+  Context->SymbolHash      = NULL;
+  Context->SymbolHashMask  = 0;
+  Context->SymbolHashOwner = &Kext->Context;
   return RETURN_SUCCESS;
 }
 
@@ -64,6 +82,10 @@ PatcherInitContextFromBuffer (
   // and request PRELINK_KERNEL_IDENTIFIER.
   //
 
+  Context->SymbolHash      = NULL;
+  Context->SymbolHashMask  = 0;
+  Context->SymbolHashOwner = NULL;
+
   if (!MachoInitializeContext (&Context->MachContext, Buffer, BufferSize)) {
     return RETURN_INVALID_PARAMETER;
   }
@@ -82,33 +104,142 @@ PatcherInitContextFromBuffer (
   return RETURN_SUCCESS;
 }
 
-RETURN_STATUS
-PatcherGetSymbolAddress (
-  IN OUT PATCHER_CONTEXT    *Context,
-  IN     CONST CHAR8        *Name,
-  IN OUT UINT8              **Address
+VOID
+PatcherFreeContext (
+  IN OUT PATCHER_CONTEXT    *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  if (Context->SymbolHash != NULL) {
+    FreePool (Context->SymbolHash);
+    Context->SymbolHash     = NULL;
+    Context->SymbolHashMask = 0;
+  }
+
+  MachoFreeIndices (&Context->MachContext);
+}
+
+STATIC
+VOID
+InternalPatcherBuildSymbolHash (
+  IN OUT PATCHER_CONTEXT    *Context
   )
 {
   MACH_NLIST_64  *Symbol;
   CONST CHAR8    *SymbolName;
-  UINT32         Offset;
+  UINT32         *SymbolHash;
+  UINT32         NumSlots;
   UINT32         Index;
+  UINT32         Slot;
+
+  //
+  // The first symbol lookup also retrieves the symbol table.
+  //
+  Symbol = MachoGetSymbolByIndex64 (&Context->MachContext, 0);
+  if (Symbol == NULL) {
+    return;
+  }
+
+  //
+  // Keep load factor at or below 50% to have short probe sequences.
+  //
+  NumSlots = 16;
+  while (NumSlots < Context->MachContext.Symtab->NumSymbols * 2ULL) {
+    if (NumSlots > MAX_UINT32 / 2) {
+      return;
+    }
+    NumSlots *= 2;
+  }
+
+  SymbolHash = AllocateZeroPool (NumSlots * sizeof (*SymbolHash));
+  if (SymbolHash == NULL) {
+    return;
+  }
+
+  //
+  // Insertion must happen in table order for duplicate names to resolve
+  // to the same entry as with the linear lookup, which also stops at the
+  // first invalid symbol.
+  //
+  Index = 0;
+  do {
+    SymbolName = MachoGetSymbolName64 (&Context->MachContext, Symbol);
+    if (SymbolName != NULL) {
+      Slot = InternalGetSymbolNameHash (SymbolName, (UINT32) AsciiStrLen (SymbolName)) & (NumSlots - 1);
+      while (SymbolHash[Slot] != 0) {
+        Slot = (Slot + 1) & (NumSlots - 1);
+      }
+      SymbolHash[Slot] = Index + 1;
+    }
+
+    ++Index;
+    Symbol = MachoGetSymbolByIndex64 (&Context->MachContext, Index);
+  } while (Symbol != NULL);
+
+  Context->SymbolHash     = SymbolHash;
+  Context->SymbolHashMask = NumSlots - 1;
+}
+
+STATIC
+MACH_NLIST_64 *
+InternalPatcherFindSymbol (
+  IN OUT PATCHER_CONTEXT    *Context,
+  IN     CONST CHAR8        *Name
+  )
+{
+  PATCHER_CONTEXT  *Owner;
+  MACH_NLIST_64    *Symbol;
+  CONST CHAR8      *SymbolName;
+  UINT32           Index;
+  UINT32           Slot;
+
+  Owner = Context->SymbolHashOwner != NULL ? Context->SymbolHashOwner : Context;
+
+  if (Owner->SymbolHash == NULL) {
+    InternalPatcherBuildSymbolHash (Owner);
+  }
+
+  if (Owner->SymbolHash != NULL) {
+    Slot = InternalGetSymbolNameHash (Name, (UINT32) AsciiStrLen (Name)) & Owner->SymbolHashMask;
+    while (Owner->SymbolHash[Slot] != 0) {
+      Symbol     = MachoGetSymbolByIndex64 (&Owner->MachContext, Owner->SymbolHash[Slot] - 1);
+      SymbolName = MachoGetSymbolName64 (&Owner->MachContext, Symbol);
+      if (AsciiStrCmp (Name, SymbolName) == 0) {
+        return Symbol;
+      }
+      Slot = (Slot + 1) & Owner->SymbolHashMask;
+    }
+
+    return NULL;
+  }
 
   Index = 0;
   while (TRUE) {
     Symbol = MachoGetSymbolByIndex64 (&Context->MachContext, Index);
     if (Symbol == NULL) {
-      return RETURN_NOT_FOUND;
+      return NULL;
     }
 
     SymbolName = MachoGetSymbolName64 (&Context->MachContext, Symbol);
 
     if (SymbolName && AsciiStrCmp (Name, SymbolName) == 0) {
-      break;
+      return Symbol;
     }
 
     Index++;
   }
+}
+
+STATIC
+RETURN_STATUS
+InternalPatcherGetSymbolFileAddress (
+  IN OUT PATCHER_CONTEXT    *Context,
+  IN     MACH_NLIST_64      *Symbol,
+  OUT    UINT8              **Address
+  )
+{
+  UINT32  Offset;
 
   if (!MachoSymbolGetFileOffset64 (&Context->MachContext, Symbol, &Offset, NULL)) {
     return RETURN_INVALID_PARAMETER;
@@ -118,6 +249,112 @@ PatcherGetSymbolAddress (
   return RETURN_SUCCESS;
 }
 
+RETURN_STATUS
+PatcherGetSymbolAddress (
+  IN OUT PATCHER_CONTEXT    *Context,
+  IN     CONST CHAR8        *Name,
+  IN OUT UINT8              **Address
+  )
+{
+  MACH_NLIST_64  *Symbol;
+
+  Symbol = InternalPatcherFindSymbol (Context, Name);
+  if (Symbol == NULL) {
+    return RETURN_NOT_FOUND;
+  }
+
+  return InternalPatcherGetSymbolFileAddress (Context, Symbol, Address);
+}
+
+RETURN_STATUS
+PatcherGetSymbolAddresses (
+  IN OUT PATCHER_CONTEXT    *Context,
+  IN     CONST CHAR8        **Names,
+  IN     UINT32             NameCount,
+  OUT    UINT8              **Addresses
+  )
+{
+  RETURN_STATUS    Status;
+  RETURN_STATUS    CurrentStatus;
+  PATCHER_CONTEXT  *Owner;
+  MACH_NLIST_64    **Symbols;
+  MACH_NLIST_64    *Symbol;
+  CONST CHAR8      *SymbolName;
+  UINT32           Remaining;
+  UINT32           Index;
+  UINT32           NameIndex;
+
+  ASSERT (Context != NULL);
+  ASSERT (Names != NULL || NameCount == 0);
+  ASSERT (Addresses != NULL || NameCount == 0);
+
+  Status = RETURN_SUCCESS;
+
+  for (NameIndex = 0; NameIndex < NameCount; ++NameIndex) {
+    Addresses[NameIndex] = NULL;
+  }
+
+  Owner   = Context->SymbolHashOwner != NULL ? Context->SymbolHashOwner : Context;
+  Symbols = NULL;
+  if (Owner->SymbolHash == NULL && NameCount > 1) {
+    Symbols = AllocateZeroPool (NameCount * sizeof (*Symbols));
+  }
+
+  if (Symbols == NULL) {
+    for (NameIndex = 0; NameIndex < NameCount; ++NameIndex) {
+      CurrentStatus = PatcherGetSymbolAddress (Context, Names[NameIndex], &Addresses[NameIndex]);
+      if (RETURN_ERROR (CurrentStatus) && !RETURN_ERROR (Status)) {
+        Status = CurrentStatus;
+      }
+    }
+
+    return Status;
+  }
+
+  //
+  // Resolve every name with the first matching symbol in a single pass.
+  //
+  Remaining = NameCount;
+  Index     = 0;
+  while (Remaining > 0) {
+    Symbol = MachoGetSymbolByIndex64 (&Context->MachContext, Index);
+    if (Symbol == NULL) {
+      break;
+    }
+
+    SymbolName = MachoGetSymbolName64 (&Context->MachContext, Symbol);
+    if (SymbolName != NULL) {
+      for (NameIndex = 0; NameIndex < NameCount; ++NameIndex) {
+        if (Symbols[NameIndex] == NULL && AsciiStrCmp (Names[NameIndex], SymbolName) == 0) {
+          Symbols[NameIndex] = Symbol;
+          --Remaining;
+        }
+      }
+    }
+
+    Index++;
+  }
+
+  for (NameIndex = 0; NameIndex < NameCount; ++NameIndex) {
+    if (Symbols[NameIndex] == NULL) {
+      CurrentStatus = RETURN_NOT_FOUND;
+    } else {
+      CurrentStatus = InternalPatcherGetSymbolFileAddress (
+        Context,
+        Symbols[NameIndex],
+        &Addresses[NameIndex]
+        );
+    }
+
+    if (RETURN_ERROR (CurrentStatus) && !RETURN_ERROR (Status)) {
+      Status = CurrentStatus;
+    }
+  }
+
+  FreePool (Symbols);
+  return Status;
+}
+
 RETURN_STATUS
 PatcherApplyGenericPatch (
   IN OUT PATCHER_CONTEXT        *Context,
@@ -184,6 +421,650 @@ PatcherApplyGenericPatch (
   return RETURN_NOT_FOUND;
 }
 
+//
+// Generic patch state during batched application.
+//
+typedef struct {
+  //
+  // Patch window start offset within the image.
+  //
+  UINT32         Start;
+  //
+  // Patch window end offset within the image (excluding Limit).
+  //
+  UINT32         End;
+  //
+  // Positions below Last may match, same as in FindPattern.
+  //
+  UINT32         Last;
+  //
+  // Pattern byte index without mask used for bucketing.
+  //
+  UINT32         Anchor;
+  //
+  // Next patch index + 1 in the same anchor bucket or 0.
+  //
+  UINT32         NextInBucket;
+  //
+  // Ascending match offsets found in the original image.
+  //
+  UINT32         *Candidates;
+  UINT32         NumCandidates;
+  UINT32         MaxCandidates;
+  //
+  // Matches at or above this offset were not recorded due to Candidates overflow.
+  //
+  UINT32         CandidatesEnd;
+  RETURN_STATUS  Status;
+} PATCHER_PATCH_STATE;
+
+//
+// Image range modified by previously applied patches.
+//
+typedef struct {
+  UINT32  Start;
+  UINT32  End;
+} PATCHER_DIRTY_RANGE;
+
+//
+// Matches recorded per patch in the single image pass. Patches with more
+// matches continue with a regular search past the last recorded one.
+//
+#define PATCHER_MIN_CANDIDATES  16U
+#define PATCHER_MAX_CANDIDATES  256U
+
+//
+// Initial number of dirty ranges.
+//
+#define PATCHER_DIRTY_RANGES    64U
+
+STATIC
+BOOLEAN
+InternalPatchMatches (
+  IN CONST PATCHER_GENERIC_PATCH  *Patch,
+  IN CONST UINT8                  *Data
+  )
+{
+  UINT32  Index;
+
+  if (Patch->Mask == NULL) {
+    return CompareMem (Data, Patch->Find, Patch->Size) == 0;
+  }
+
+  for (Index = 0; Index < Patch->Size; ++Index) {
+    if ((Data[Index] & Patch->Mask[Index]) != Patch->Find[Index]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+/**
+  Choose pattern byte for bucketing. Fully specified bytes other than
+  the common 0x00 and 0xFF are preferred.
+
+  @return  Anchor index or MAX_UINT32 when every byte is masked.
+**/
+STATIC
+UINT32
+InternalChoosePatchAnchor (
+  IN CONST PATCHER_GENERIC_PATCH  *Patch
+  )
+{
+  UINT32  Index;
+  UINT32  Anchor;
+
+  Anchor = MAX_UINT32;
+
+  for (Index = 0; Index < Patch->Size; ++Index) {
+    if (Patch->Mask != NULL && Patch->Mask[Index] != 0xFF) {
+      continue;
+    }
+
+    if (Patch->Find[Index] != 0x00 && Patch->Find[Index] != 0xFF) {
+      return Index;
+    }
+
+    if (Anchor == MAX_UINT32) {
+      Anchor = Index;
+    }
+  }
+
+  return Anchor;
+}
+
+STATIC
+VOID
+InternalRecordPatchCandidate (
+  IN OUT PATCHER_PATCH_STATE  *State,
+  IN     UINT32               Offset
+  )
+{
+  if (State->CandidatesEnd != MAX_UINT32) {
+    return;
+  }
+
+  if (State->NumCandidates == State->MaxCandidates) {
+    State->CandidatesEnd = Offset;
+    return;
+  }
+
+  State->Candidates[State->NumCandidates++] = Offset;
+}
+
+/**
+  Append dirty range growing the range list if needed.
+
+  @return  FALSE on allocation failure.
+**/
+STATIC
+BOOLEAN
+InternalAddDirtyRange (
+  IN OUT PATCHER_DIRTY_RANGE  **Ranges,
+  IN OUT UINT32               *NumRanges,
+  IN OUT UINT32               *MaxRanges,
+  IN     UINT32               Start,
+  IN     UINT32               End
+  )
+{
+  PATCHER_DIRTY_RANGE  *NewRanges;
+
+  if (*NumRanges == *MaxRanges) {
+    if (*MaxRanges > MAX_UINT32 / 2 / sizeof (**Ranges)) {
+      return FALSE;
+    }
+
+    NewRanges = ReallocatePool (
+      *MaxRanges * sizeof (**Ranges),
+      *MaxRanges * 2 * sizeof (**Ranges),
+      *Ranges
+      );
+    if (NewRanges == NULL) {
+      return FALSE;
+    }
+
+    *Ranges     = NewRanges;
+    *MaxRanges *= 2;
+  }
+
+  (*Ranges)[*NumRanges].Start = Start;
+  (*Ranges)[*NumRanges].End   = End;
+  ++(*NumRanges);
+  return TRUE;
+}
+
+/**
+  Sort dirty ranges by start and merge the overlapping ones.
+  Ranges are few and mostly sorted, so insertion sort is used.
+**/
+STATIC
+UINT32
+InternalMergeDirtyRanges (
+  IN OUT PATCHER_DIRTY_RANGE  *Ranges,
+  IN     UINT32               NumRanges
+  )
+{
+  UINT32               Index;
+  UINT32               Index2;
+  UINT32               NumMerged;
+  PATCHER_DIRTY_RANGE  Range;
+
+  for (Index = 1; Index < NumRanges; ++Index) {
+    Range  = Ranges[Index];
+    Index2 = Index;
+    while (Index2 > 0 && Ranges[Index2 - 1].Start > Range.Start) {
+      Ranges[Index2] = Ranges[Index2 - 1];
+      --Index2;
+    }
+    Ranges[Index2] = Range;
+  }
+
+  NumMerged = 0;
+  for (Index = 0; Index < NumRanges; ++Index) {
+    if (NumMerged > 0 && Ranges[Index].Start <= Ranges[NumMerged - 1].End) {
+      Ranges[NumMerged - 1].End = MAX (Ranges[NumMerged - 1].End, Ranges[Index].End);
+    } else {
+      Ranges[NumMerged++] = Ranges[Index];
+    }
+  }
+
+  return NumMerged;
+}
+
+/**
+  Find next patch match in the current image. Recorded candidates are only
+  valid for unmodified data, so positions overlapping dirty ranges are
+  checked directly.
+
+  @return  Match offset or MAX_UINT32.
+**/
+STATIC
+UINT32
+InternalFindNextPatchMatch (
+  IN     CONST PATCHER_GENERIC_PATCH  *Patch,
+  IN     PATCHER_PATCH_STATE          *State,
+  IN     CONST UINT8                  *Image,
+  IN     UINT32                       DataOff,
+  IN     CONST PATCHER_DIRTY_RANGE    *Ranges,
+  IN     UINT32                       NumRanges,
+  IN OUT UINT32                       *CandidateIndex,
+  IN OUT UINT32                       *RangeIndex
+  )
+{
+  UINT32  Next;
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Index;
+  INT32   Found;
+
+  while (DataOff < State->Last) {
+    while (*CandidateIndex < State->NumCandidates && State->Candidates[*CandidateIndex] < DataOff) {
+      ++(*CandidateIndex);
+    }
+
+    if (*CandidateIndex < State->NumCandidates) {
+      Next = State->Candidates[*CandidateIndex];
+    } else {
+      Next = MIN (State->CandidatesEnd, State->Last);
+    }
+
+    while (*RangeIndex < NumRanges && Ranges[*RangeIndex].End <= DataOff) {
+      ++(*RangeIndex);
+    }
+
+    for (Index = *RangeIndex; Index < NumRanges; ++Index) {
+      Low = Ranges[Index].Start >= Patch->Size ? Ranges[Index].Start - Patch->Size + 1 : 0;
+      if (Low >= Next) {
+        break;
+      }
+
+      Low  = MAX (Low, DataOff);
+      High = MIN (Ranges[Index].End, Next);
+      while (Low < High) {
+        if (InternalPatchMatches (Patch, &Image[Low])) {
+          return Low;
+        }
+        ++Low;
+      }
+    }
+
+    if (Next >= State->Last) {
+      return MAX_UINT32;
+    }
+
+    if (*CandidateIndex < State->NumCandidates) {
+      if (InternalPatchMatches (Patch, &Image[Next])) {
+        return Next;
+      }
+      DataOff = Next + 1;
+      continue;
+    }
+
+    //
+    // Candidates overflowed, search the rest as usual.
+    //
+    Found = FindPattern (
+      Patch->Find,
+      Patch->Mask,
+      Patch->Size,
+      Image,
+      State->End,
+      (INT32) MAX (Next, DataOff)
+      );
+    return Found >= 0 ? (UINT32) Found : MAX_UINT32;
+  }
+
+  return MAX_UINT32;
+}
+
+/**
+  Apply generic patch using matches recorded in the single image pass.
+  Mirrors ApplyPatch Count and Skip handling.
+**/
+STATIC
+UINT32
+InternalApplyPatchCandidates (
+  IN     CONST PATCHER_GENERIC_PATCH  *Patch,
+  IN     PATCHER_PATCH_STATE          *State,
+  IN OUT UINT8                        *Image,
+  IN OUT PATCHER_DIRTY_RANGE          **Ranges,
+  IN OUT UINT32                       *NumRanges,
+  IN OUT UINT32                       *MaxRanges,
+  OUT    BOOLEAN                      *Untracked
+  )
+{
+  UINT32  ReplaceCount;
+  UINT32  Count;
+  UINT32  Skip;
+  UINT32  DataOff;
+  UINT32  CandidateIndex;
+  UINT32  RangeIndex;
+  UINT32  Index;
+  UINT32  NumMerged;
+
+  ReplaceCount   = 0;
+  Count          = Patch->Count;
+  Skip           = Patch->Skip;
+  DataOff        = State->Start;
+  CandidateIndex = 0;
+  RangeIndex     = 0;
+  NumMerged      = *NumRanges;
+
+  //
+  // Own replacements never precede the search offset, so only ranges
+  // of the previous patches are checked.
+  //
+  while (TRUE) {
+    DataOff = InternalFindNextPatchMatch (
+      Patch,
+      State,
+      Image,
+      DataOff,
+      *Ranges,
+      NumMerged,
+      &CandidateIndex,
+      &RangeIndex
+      );
+    if (DataOff == MAX_UINT32) {
+      break;
+    }
+
+    //
+    // Skip this finding if requested.
+    //
+    if (Skip > 0) {
+      --Skip;
+      DataOff += Patch->Size;
+      continue;
+    }
+
+    //
+    // Perform replacement.
+    //
+    if (Patch->ReplaceMask == NULL) {
+      CopyMem (&Image[DataOff], Patch->Replace, Patch->Size);
+    } else {
+      for (Index = 0; Index < Patch->Size; ++Index) {
+        Image[DataOff + Index] = (Image[DataOff + Index] & ~Patch->ReplaceMask[Index])
+          | (Patch->Replace[Index] & Patch->ReplaceMask[Index]);
+      }
+    }
+
+    if (!InternalAddDirtyRange (Ranges, NumRanges, MaxRanges, DataOff, DataOff + Patch->Size)) {
+      *Untracked = TRUE;
+    }
+    ++ReplaceCount;
+    DataOff += Patch->Size;
+
+    //
+    // Check replace count if requested.
+    //
+    if (Count > 0) {
+      --Count;
+      if (Count == 0) {
+        break;
+      }
+    }
+  }
+
+  return ReplaceCount;
+}
+
+RETURN_STATUS
+PatcherApplyGenericPatches (
+  IN OUT PATCHER_CONTEXT        *Context,
+  IN     PATCHER_GENERIC_PATCH  *Patches,
+  IN     UINT32                 PatchCount,
+  OUT    RETURN_STATUS          *Statuses OPTIONAL
+  )
+{
+  RETURN_STATUS          Status;
+  UINT8                  *Image;
+  UINT32                 ImageSize;
+  UINT8                  *Base;
+  PATCHER_PATCH_STATE    *States;
+  UINT32                 *Candidates;
+  UINT32                 NumCandidates;
+  PATCHER_DIRTY_RANGE    *Ranges;
+  UINT32                 NumRanges;
+  UINT32                 MaxRanges;
+  BOOLEAN                Untracked;
+  UINT32                 Buckets[256];
+  UINT32                 ScanStart;
+  UINT32                 ScanEnd;
+  UINT32                 Offset;
+  UINT32                 Index;
+  UINT32                 ReplaceCount;
+  PATCHER_GENERIC_PATCH  *Patch;
+  PATCHER_PATCH_STATE    *State;
+  INT32                  Found;
+
+  ASSERT (Context != NULL);
+  ASSERT (Patches != NULL || PatchCount == 0);
+
+  if (PatchCount == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  Image     = (UINT8 *)MachoGetMachHeader64 (&Context->MachContext);
+  ImageSize = MachoGetFileSize (&Context->MachContext);
+
+  States = AllocateZeroPool (PatchCount * sizeof (*States));
+  Ranges = AllocatePool (PATCHER_DIRTY_RANGES * sizeof (*Ranges));
+  if (States == NULL || Ranges == NULL) {
+    if (States != NULL) {
+      FreePool (States);
+    }
+    if (Ranges != NULL) {
+      FreePool (Ranges);
+    }
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  ZeroMem (Buckets, sizeof (Buckets));
+  NumCandidates = 0;
+  ScanStart     = MAX_UINT32;
+  ScanEnd       = 0;
+
+  //
+  // Resolve patch windows the same way PatcherApplyGenericPatch does.
+  //
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Patch = &Patches[Index];
+    State = &States[Index];
+
+    Base                 = Image;
+    State->End           = ImageSize;
+    State->CandidatesEnd = MAX_UINT32;
+
+    if (Patch->Base != NULL) {
+      State->Status = PatcherGetSymbolAddress (Context, Patch->Base, &Base);
+      if (RETURN_ERROR (State->Status)) {
+        DEBUG ((DEBUG_INFO, "Base lookup failure %r\n", State->Status));
+        continue;
+      }
+
+      State->Start = MIN ((UINT32)(Base - Image), ImageSize);
+    }
+
+    if (Patch->Find == NULL) {
+      continue;
+    }
+
+    if (Patch->Limit > 0 && Patch->Limit < State->End - State->Start) {
+      State->End = State->Start + Patch->Limit;
+    }
+
+    //
+    // FindPattern never matches the pattern ending exactly at the window end.
+    //
+    if (Patch->Size == 0 || State->End - State->Start <= Patch->Size) {
+      continue;
+    }
+
+    State->Last = State->End - Patch->Size;
+    if (Patch->Count > 0 && Patch->Count <= PATCHER_MAX_CANDIDATES
+      && Patch->Skip <= PATCHER_MAX_CANDIDATES - Patch->Count) {
+      State->MaxCandidates = MAX (Patch->Count + Patch->Skip, PATCHER_MIN_CANDIDATES);
+    } else {
+      State->MaxCandidates = PATCHER_MAX_CANDIDATES;
+    }
+
+    NumCandidates += State->MaxCandidates;
+
+    State->Anchor = InternalChoosePatchAnchor (Patch);
+    if (State->Anchor != MAX_UINT32) {
+      State->NextInBucket = Buckets[Patch->Find[State->Anchor]];
+      Buckets[Patch->Find[State->Anchor]] = Index + 1;
+      ScanStart = MIN (ScanStart, State->Start + State->Anchor);
+      ScanEnd   = MAX (ScanEnd, State->Last + State->Anchor);
+    }
+  }
+
+  Candidates = AllocatePool (MAX (NumCandidates, 1) * sizeof (*Candidates));
+  if (Candidates == NULL) {
+    FreePool (Ranges);
+    FreePool (States);
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  NumCandidates = 0;
+  for (Index = 0; Index < PatchCount; ++Index) {
+    States[Index].Candidates = &Candidates[NumCandidates];
+    NumCandidates           += States[Index].MaxCandidates;
+  }
+
+  //
+  // Single pass over the original image recording matches of all patches.
+  //
+  for (Offset = ScanStart; Offset < ScanEnd; ++Offset) {
+    Index = Buckets[Image[Offset]];
+    while (Index != 0) {
+      Patch = &Patches[Index - 1];
+      State = &States[Index - 1];
+      Index = State->NextInBucket;
+
+      if (Offset >= State->Start + State->Anchor && Offset - State->Anchor < State->Last
+        && InternalPatchMatches (Patch, &Image[Offset - State->Anchor])) {
+        InternalRecordPatchCandidate (State, Offset - State->Anchor);
+      }
+    }
+  }
+
+  //
+  // Fully masked patches cannot be bucketed, search them separately.
+  //
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Patch = &Patches[Index];
+    State = &States[Index];
+    if (State->Last == 0 || State->Anchor != MAX_UINT32) {
+      continue;
+    }
+
+    Found = (INT32) State->Start;
+    while (State->CandidatesEnd == MAX_UINT32) {
+      Found = FindPattern (Patch->Find, Patch->Mask, Patch->Size, Image, State->End, Found);
+      if (Found < 0) {
+        break;
+      }
+      InternalRecordPatchCandidate (State, (UINT32) Found);
+      ++Found;
+    }
+  }
+
+  //
+  // Apply patches in order, so that later patches see changes of earlier ones.
+  //
+  Status    = RETURN_SUCCESS;
+  NumRanges = 0;
+  MaxRanges = PATCHER_DIRTY_RANGES;
+  Untracked = FALSE;
+
+  for (Index = 0; Index < PatchCount; ++Index) {
+    Patch = &Patches[Index];
+    State = &States[Index];
+
+    if (RETURN_ERROR (State->Status)) {
+      //
+      // Base lookup failure was already reported.
+      //
+    } else if (Patch->Find == NULL) {
+      if (ImageSize - State->Start < Patch->Size) {
+        DEBUG ((DEBUG_INFO, "Patch is borked  - n/f\n"));
+        State->Status = RETURN_NOT_FOUND;
+      } else {
+        CopyMem (&Image[State->Start], Patch->Replace, Patch->Size);
+        if (!InternalAddDirtyRange (&Ranges, &NumRanges, &MaxRanges, State->Start, State->Start + Patch->Size)) {
+          Untracked = TRUE;
+        }
+      }
+    } else {
+      if (Untracked) {
+        //
+        // Modified ranges are unknown, so recorded matches cannot be trusted.
+        //
+        ReplaceCount = ApplyPatch (
+          Patch->Find,
+          Patch->Mask,
+          Patch->Size,
+          Patch->Replace,
+          Patch->ReplaceMask,
+          &Image[State->Start],
+          State->End - State->Start,
+          Patch->Count,
+          Patch->Skip
+          );
+      } else if (State->Last != 0) {
+        ReplaceCount = InternalApplyPatchCandidates (
+          Patch,
+          State,
+          Image,
+          &Ranges,
+          &NumRanges,
+          &MaxRanges,
+          &Untracked
+          );
+      } else {
+        ReplaceCount = 0;
+      }
+
+      DEBUG ((DEBUG_INFO, "ReplaceCount - %u\n", ReplaceCount));
+
+      if (ReplaceCount > 0 && Patch->Count > 0 && ReplaceCount != Patch->Count) {
+        DEBUG ((
+          DEBUG_INFO,
+          "Performed only %u replacements out of %u\n",
+          ReplaceCount,
+          Patch->Count
+          ));
+      }
+
+      if (ReplaceCount == 0) {
+        State->Status = RETURN_NOT_FOUND;
+      }
+    }
+
+    if (!Untracked) {
+      NumRanges = InternalMergeDirtyRanges (Ranges, NumRanges);
+    }
+
+    if (Statuses != NULL) {
+      Statuses[Index] = State->Status;
+    }
+
+    if (RETURN_ERROR (State->Status) && !RETURN_ERROR (Status)) {
+      Status = State->Status;
+    }
+  }
+
+  FreePool (Candidates);
+  FreePool (Ranges);
+  FreePool (States);
+
+  return Status;
+}
+
 RETURN_STATUS
 PatcherBlockKext (
   IN OUT PATCHER_CONTEXT        *Context
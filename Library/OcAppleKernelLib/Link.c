@@ -21,6 +21,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcAppleKernelLib.h>
 #include <Library/OcGuardLib.h>
 #include <Library/OcMachoLib.h>
@@ -34,12 +35,35 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 // Symbols
 //
 
+UINT32
+InternalGetSymbolNameHash (
+  IN CONST CHAR8  *Name,
+  IN UINT32       Length
+  )
+{
+  UINT32  Hash;
+  UINT32  Index;
+
+  //
+  // 32-bit FNV-1a, which is sufficiently good for mangled symbol names.
+  //
+  Hash = 2166136261U;
+  for (Index = 0; Index < Length; ++Index) {
+    Hash ^= (UINT8) Name[Index];
+    Hash *= 16777619U;
+  }
+
+  return Hash;
+}
+
 STATIC
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolWorkerName (
+  IN PRELINKED_CONTEXT                *Context,
   IN PRELINKED_KEXT                   *Kext,
   IN CONST CHAR8                      *LookupValue,
   IN UINT32                           LookupValueLength,
+  IN UINT32                           LookupValueHash,
   IN OC_GET_SYMBOL_LEVEL              SymbolLevel
   )
 {
@@ -48,41 +72,63 @@ InternalOcGetSymbolWorkerName (
   CONST PRELINKED_KEXT_SYMBOL *SymbolsEnd;
   UINT32                      Index;
   UINT32                      NumSymbols;
+  UINT32                      FirstSymbol;
+  UINT32                      Slot;
+  UINT32                      Entry;
 
   //
   // Block any 1+ level dependencies.
   //
-  Kext->Processed = TRUE;
+  Kext->Processed = Context->KextWalkGeneration;
 
-  NumSymbols = Kext->NumberOfSymbols;
-  Symbols    = Kext->LinkedSymbolTable;
+  FirstSymbol = 0;
+  NumSymbols  = Kext->NumberOfSymbols;
 
   if (SymbolLevel == OcGetSymbolOnlyCxx) {
-    NumSymbols = Kext->NumberOfCxxSymbols;
-    Symbols    = &Kext->LinkedSymbolTable[Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols];
+    FirstSymbol = Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols;
+    NumSymbols  = Kext->NumberOfCxxSymbols;
   }
 
-  SymbolsEnd = &Symbols[NumSymbols];
-  while (Symbols < SymbolsEnd) {
+  if (Kext->LinkedSymbolHash != NULL) {
     //
-    // Symbol names often start and end similarly due to C++ mangling (e.g. __ZN).
-    // To optimise the lookup we compare their length check in the middle.
-    // Please do not change this without careful profiling.
+    // Slots are filled in LinkedSymbolTable order with linear probing, so the
+    // first match in the probe sequence is the same symbol the linear walk
+    // below would have returned.
     //
-    if (Symbols->Length == LookupValueLength) {
-      if (Symbols->Name[LookupValueLength / 2] == LookupValue[LookupValueLength / 2]
-        && Symbols->Name[(LookupValueLength / 2) + 1] == LookupValue[(LookupValueLength / 2) + 1]) {
-        for (Index = 0; Index < LookupValueLength; ++Index) {
-          if (Symbols->Name[Index] != LookupValue[Index]) {
-            break;
+    Slot = LookupValueHash & Kext->LinkedSymbolHashMask;
+    while ((Entry = Kext->LinkedSymbolHash[Slot]) != 0) {
+      Symbols = &Kext->LinkedSymbolTable[Entry - 1];
+      if (Entry - 1 >= FirstSymbol
+        && Symbols->Length == LookupValueLength
+        && CompareMem (Symbols->Name, LookupValue, LookupValueLength) == 0) {
+        return Symbols;
+      }
+      Slot = (Slot + 1) & Kext->LinkedSymbolHashMask;
+    }
+  } else {
+    Symbols    = &Kext->LinkedSymbolTable[FirstSymbol];
+    SymbolsEnd = &Symbols[NumSymbols];
+    while (Symbols < SymbolsEnd) {
+      //
+      // Symbol names often start and end similarly due to C++ mangling (e.g. __ZN).
+      // To optimise the lookup we compare their length check in the middle.
+      // Please do not change this without careful profiling.
+      //
+      if (Symbols->Length == LookupValueLength) {
+        if (Symbols->Name[LookupValueLength / 2] == LookupValue[LookupValueLength / 2]
+          && Symbols->Name[(LookupValueLength / 2) + 1] == LookupValue[(LookupValueLength / 2) + 1]) {
+          for (Index = 0; Index < LookupValueLength; ++Index) {
+            if (Symbols->Name[Index] != LookupValue[Index]) {
+              break;
+            }
+          }
+          if (Index == LookupValueLength) {
+            return Symbols;
           }
-        }
-        if (Index == LookupValueLength) {
-          return Symbols;
         }
       }
+      Symbols++;
     }
-    Symbols++;
   }
 
   if (SymbolLevel != OcGetSymbolFirstLevel) {
@@ -92,14 +138,16 @@ InternalOcGetSymbolWorkerName (
         return NULL;
       }
 
-      if (Dependency->Processed) {
+      if (Dependency->Processed == Context->KextWalkGeneration) {
         continue;
       }
 
       Symbols = InternalOcGetSymbolWorkerName (
+                 Context,
                  Dependency,
                  LookupValue,
                  LookupValueLength,
+                 LookupValueHash,
                  OcGetSymbolOnlyCxx
                  );
       if (Symbols != NULL) {
@@ -111,9 +159,97 @@ InternalOcGetSymbolWorkerName (
   return NULL;
 }
 
+STATIC
+BOOLEAN
+InternalSymbolValueOrderLess (
+  IN CONST PRELINKED_KEXT_SYMBOL  *SymbolTable,
+  IN UINT32                       First,
+  IN UINT32                       Second
+  )
+{
+  //
+  // Tie by table index to resolve duplicate values like the linear lookup.
+  //
+  if (SymbolTable[First].Value != SymbolTable[Second].Value) {
+    return SymbolTable[First].Value < SymbolTable[Second].Value;
+  }
+
+  return First < Second;
+}
+
+STATIC
+VOID
+InternalSiftSymbolValueOrder (
+  IN     CONST PRELINKED_KEXT_SYMBOL  *SymbolTable,
+  IN OUT UINT32                       *Order,
+  IN     UINT32                       Root,
+  IN     UINT32                       NumEntries
+  )
+{
+  UINT32  Child;
+  UINT32  Entry;
+
+  Entry = Order[Root];
+
+  while ((Child = 2 * Root + 1) < NumEntries) {
+    if (Child + 1 < NumEntries
+      && InternalSymbolValueOrderLess (SymbolTable, Order[Child], Order[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalSymbolValueOrderLess (SymbolTable, Entry, Order[Child])) {
+      break;
+    }
+
+    Order[Root] = Order[Child];
+    Root        = Child;
+  }
+
+  Order[Root] = Entry;
+}
+
+VOID
+InternalBuildLinkedSymbolValueOrder (
+  IN OUT PRELINKED_KEXT  *Kext
+  )
+{
+  UINT32  *Order;
+  UINT32  NumSymbols;
+  UINT32  Index;
+  UINT32  Entry;
+
+  NumSymbols = Kext->NumberOfSymbols;
+  if (NumSymbols == 0) {
+    return;
+  }
+
+  Order = AllocatePool (NumSymbols * sizeof (*Order));
+  if (Order == NULL) {
+    return;
+  }
+
+  for (Index = 0; Index < NumSymbols; ++Index) {
+    Order[Index] = Index;
+  }
+
+  for (Index = NumSymbols / 2; Index > 0; --Index) {
+    InternalSiftSymbolValueOrder (Kext->LinkedSymbolTable, Order, Index - 1, NumSymbols);
+  }
+
+  for (Index = NumSymbols - 1; Index > 0; --Index) {
+    Entry        = Order[0];
+    Order[0]     = Order[Index];
+    Order[Index] = Entry;
+    InternalSiftSymbolValueOrder (Kext->LinkedSymbolTable, Order, 0, Index);
+  }
+
+  Kext->LinkedSymbolValueOrder = Order;
+}
+
 STATIC
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolWorkerValue (
+  IN PRELINKED_CONTEXT                *Context,
   IN PRELINKED_KEXT                   *Kext,
   IN UINT64                           LookupValue,
   IN OC_GET_SYMBOL_LEVEL              SymbolLevel
@@ -124,33 +260,68 @@ InternalOcGetSymbolWorkerValue (
   CONST PRELINKED_KEXT_SYMBOL *SymbolsEnd;
   UINT32                      Index;
   UINT32                      NumSymbols;
+  UINT32                      FirstSymbol;
+  UINT32                      Low;
+  UINT32                      High;
+  UINT32                      Middle;
 
   //
   // Block any 1+ level dependencies.
   //
-  Kext->Processed = TRUE;
+  Kext->Processed = Context->KextWalkGeneration;
 
-  NumSymbols = Kext->NumberOfSymbols;
-  Symbols    = Kext->LinkedSymbolTable;
-
-  if (SymbolLevel == OcGetSymbolOnlyCxx) {
-    NumSymbols = Kext->NumberOfCxxSymbols;
-    Symbols    = &Kext->LinkedSymbolTable[(Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols) & ~15ULL];
+  if (Kext->LinkedSymbolValueOrder == NULL) {
+    InternalBuildLinkedSymbolValueOrder (Kext);
   }
-  //
-  // WARN! Hot path! Do not change this code unless you have decent profiling data.
-  // We are not allowed to use SIMD in UEFI, but we can still do better with larger iteration.
-  // Up to 15 C symbols extra may get parsed, but it is fine, as they will not match.
-  // Increasing the iteration block to more than 16 no longer pays off.
-  // Note, lower loop is not on hot path.
-  //
-  SymbolsEnd = &Symbols[NumSymbols & ~15ULL];
-  while (Symbols < SymbolsEnd) {
-    #define MATCH(X) if (Symbols[X].Value == LookupValue) { return &Symbols[X]; }
-    MATCH (0) MATCH (1) MATCH (2)  MATCH (3)  MATCH (4)  MATCH (5)  MATCH (6)  MATCH (7)
-    MATCH (8) MATCH (9) MATCH (10) MATCH (11) MATCH (12) MATCH (13) MATCH (14) MATCH (15)
-    #undef MATCH
-    Symbols += 16;
+
+  if (Kext->LinkedSymbolValueOrder != NULL) {
+    FirstSymbol = 0;
+    if (SymbolLevel == OcGetSymbolOnlyCxx) {
+      FirstSymbol = Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols;
+    }
+
+    Symbols = Kext->LinkedSymbolTable;
+    Low     = 0;
+    High    = Kext->NumberOfSymbols;
+    while (Low < High) {
+      Middle = Low + (High - Low) / 2;
+      if (Symbols[Kext->LinkedSymbolValueOrder[Middle]].Value < LookupValue) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    while (Low < Kext->NumberOfSymbols
+      && Symbols[Kext->LinkedSymbolValueOrder[Low]].Value == LookupValue) {
+      if (Kext->LinkedSymbolValueOrder[Low] >= FirstSymbol) {
+        return &Symbols[Kext->LinkedSymbolValueOrder[Low]];
+      }
+      ++Low;
+    }
+  } else {
+    NumSymbols = Kext->NumberOfSymbols;
+    Symbols    = Kext->LinkedSymbolTable;
+
+    if (SymbolLevel == OcGetSymbolOnlyCxx) {
+      NumSymbols = Kext->NumberOfCxxSymbols;
+      Symbols    = &Kext->LinkedSymbolTable[(Kext->NumberOfSymbols - Kext->NumberOfCxxSymbols) & ~15ULL];
+    }
+    //
+    // WARN! Hot path! Do not change this code unless you have decent profiling data.
+    // We are not allowed to use SIMD in UEFI, but we can still do better with larger iteration.
+    // Up to 15 C symbols extra may get parsed, but it is fine, as they will not match.
+    // Increasing the iteration block to more than 16 no longer pays off.
+    // Note, lower loop is not on hot path.
+    //
+    SymbolsEnd = &Symbols[NumSymbols & ~15ULL];
+    while (Symbols < SymbolsEnd) {
+      #define MATCH(X) if (Symbols[X].Value == LookupValue) { return &Symbols[X]; }
+      MATCH (0) MATCH (1) MATCH (2)  MATCH (3)  MATCH (4)  MATCH (5)  MATCH (6)  MATCH (7)
+      MATCH (8) MATCH (9) MATCH (10) MATCH (11) MATCH (12) MATCH (13) MATCH (14) MATCH (15)
+      #undef MATCH
+      Symbols += 16;
+    }
   }
 
   if (SymbolLevel != OcGetSymbolFirstLevel) {
@@ -160,11 +331,12 @@ InternalOcGetSymbolWorkerValue (
         return NULL;
       }
 
-      if (Dependency->Processed) {
+      if (Dependency->Processed == Context->KextWalkGeneration) {
         continue;
       }
 
       Symbols = InternalOcGetSymbolWorkerValue (
+                 Context,
                  Dependency,
                  LookupValue,
                  OcGetSymbolOnlyCxx
@@ -191,6 +363,7 @@ InternalOcGetSymbolName (
   PRELINKED_KEXT              *Dependency;
   UINT32                      Index;
   UINT32                      LookupValueLength;
+  UINT32                      LookupValueHash;
 
   Symbol = NULL;
   LookupValueLength = (UINT32)AsciiStrLen (LookupValue);
@@ -202,11 +375,15 @@ InternalOcGetSymbolName (
     return NULL;
   }
 
+  LookupValueHash = InternalGetSymbolNameHash (LookupValue, LookupValueLength);
+
   if ((SymbolLevel == OcGetSymbolOnlyCxx) && (Kext->LinkedSymbolTable != NULL)) {
     Symbol = InternalOcGetSymbolWorkerName (
+      Context,
       Kext,
       LookupValue,
       LookupValueLength,
+      LookupValueHash,
       SymbolLevel
       );
   } else {
@@ -217,9 +394,11 @@ InternalOcGetSymbolName (
       }
 
       Symbol = InternalOcGetSymbolWorkerName (
+                 Context,
                  Dependency,
                  LookupValue,
                  LookupValueLength,
+                 LookupValueHash,
                  SymbolLevel
                  );
       if (Symbol != NULL) {
@@ -249,7 +428,7 @@ InternalOcGetSymbolValue (
   Symbol = NULL;
 
   if ((SymbolLevel == OcGetSymbolOnlyCxx) && (Kext->LinkedSymbolTable != NULL)) {
-    Symbol = InternalOcGetSymbolWorkerValue (Kext, LookupValue, SymbolLevel);
+    Symbol = InternalOcGetSymbolWorkerValue (Context, Kext, LookupValue, SymbolLevel);
   } else {
     for (Index = 0; Index < ARRAY_SIZE (Kext->Dependencies); ++Index) {
       Dependency = Kext->Dependencies[Index];
@@ -258,6 +437,7 @@ InternalOcGetSymbolValue (
       }
 
       Symbol = InternalOcGetSymbolWorkerValue (
+                 Context,
                  Dependency,
                  LookupValue,
                  SymbolLevel
@@ -276,17 +456,19 @@ InternalOcGetSymbolValue (
 /**
   Patches Symbol with Value and marks it as solved.
 
-  @param[in]  Value   The value to solve Symbol with.
-  @param[out] Symbol  The symbol to solve.
+  @param[in,out] MachoContext  Context of the Mach-O owning Symbol.
+  @param[in]     Value         The value to solve Symbol with.
+  @param[out]    Symbol        The symbol to solve.
 
 **/
 VOID
 InternalSolveSymbolValue64 (
-  IN  UINT64         Value,
-  OUT MACH_NLIST_64  *Symbol
+  IN OUT OC_MACHO_CONTEXT  *MachoContext,
+  IN     UINT64            Value,
+  OUT    MACH_NLIST_64     *Symbol
   )
 {
-  Symbol->Value   = Value;
+  MachoSetSymbolValue64 (MachoContext, Symbol, Value);
   Symbol->Type    = (MACH_N_TYPE_ABS | MACH_N_TYPE_EXT);
   Symbol->Section = NO_SECT;
 }
@@ -353,7 +535,7 @@ InternalSolveSymbolNonWeak64 (
                     OcGetSymbolFirstLevel
                     );
   if (ResolveSymbol != NULL) {
-    InternalSolveSymbolValue64 (ResolveSymbol->Value, Symbol);
+    InternalSolveSymbolValue64 (&Kext->Context.MachContext, ResolveSymbol->Value, Symbol);
   }
 
   return TRUE;
@@ -453,7 +635,7 @@ InternalSolveSymbol64 (
     }
 
     if (Value != 0) {
-      InternalSolveSymbolValue64 (Value, Symbol);
+      InternalSolveSymbolValue64 (&Kext->Context.MachContext, Value, Symbol);
       return TRUE;
     }
   }
@@ -1413,6 +1595,7 @@ InternalPrelinkKext64 (
   // Create and patch the KEXT's VTables.
   //
   Result = InternalPatchByVtables64 (Context, Kext);
+  MachoFreeIndices (MachoContext);
   if (!Result) {
     DEBUG ((DEBUG_INFO, "Vtable patching failed for kext %a\n", Kext->Identifier));
     return RETURN_LOAD_ERROR;
@@ -1633,6 +1816,7 @@ InternalPrelinkKext64 (
   // Reinitialize the Mach-O context to account for the changed __LINKEDIT
   // segment and file size.
   //
+  MachoFreeIndices (MachoContext);
   if (!MachoInitializeContext (MachoContext, MachHeader, (SegmentOffset + SegmentSize))) {
     //
     // This should never failed under normal and abnormal conditions.
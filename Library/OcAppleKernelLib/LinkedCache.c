@@ -0,0 +1,642 @@
+/** @file
+  Persistent linked symbol cache for kernel and KPI kexts.
+
+  Copyright (C) 2019, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Base.h>
+
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcAppleKernelLib.h>
+#include <Library/OcGuardLib.h>
+#include <Library/OcMachoLib.h>
+#include <Library/OcStringLib.h>
+
+#include "PrelinkedInternal.h"
+
+STATIC
+BOOLEAN
+InternalLinkedCacheGetUuid (
+  IN OUT OC_MACHO_CONTEXT  *MachContext,
+  OUT    UINT8             *Uuid
+  )
+{
+  MACH_UUID_COMMAND  *UuidCommand;
+
+  UuidCommand = MachoGetUuid64 (MachContext);
+  if (UuidCommand == NULL) {
+    ZeroMem (Uuid, sizeof (UuidCommand->Uuid));
+    return FALSE;
+  }
+
+  CopyMem (Uuid, UuidCommand->Uuid, sizeof (UuidCommand->Uuid));
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+InternalLinkedCacheNameToOffset (
+  IN  PRELINKED_CONTEXT  *Context,
+  IN  CONST CHAR8        *Name,
+  OUT UINT64             *NameOffset
+  )
+{
+  if (Name == NULL) {
+    *NameOffset = 0;
+    return TRUE;
+  }
+
+  if ((CONST UINT8 *) Name <= Context->Prelinked
+    || (CONST UINT8 *) Name >= Context->Prelinked + Context->PrelinkedSize) {
+    return FALSE;
+  }
+
+  *NameOffset = (UINT64) ((CONST UINT8 *) Name - Context->Prelinked);
+  return TRUE;
+}
+
+STATIC
+BOOLEAN
+InternalLinkedCacheNameIsValid (
+  IN PRELINKED_CONTEXT  *Context,
+  IN UINT64             NameOffset,
+  IN UINT64             Length
+  )
+{
+  //
+  // Names are only validated to be terminated within prelinkedkernel.
+  //
+  return NameOffset < Context->PrelinkedSize
+    && Length < Context->PrelinkedSize - NameOffset
+    && Context->Prelinked[NameOffset + Length] == '\0';
+}
+
+STATIC
+UINT32
+InternalLinkedCacheVtablesSize (
+  IN PRELINKED_KEXT  *Kext
+  )
+{
+  PRELINKED_VTABLE  *Vtable;
+  UINT32            Index;
+
+  Vtable = Kext->LinkedVtables;
+  for (Index = 0; Index < Kext->NumberOfVtables; ++Index) {
+    Vtable = GET_NEXT_PRELINKED_VTABLE (Vtable);
+  }
+
+  return (UINT32) ((UINTN) Vtable - (UINTN) Kext->LinkedVtables);
+}
+
+/**
+  Collect kernel and KPI kexts for linked cache with linked data built.
+**/
+STATIC
+RETURN_STATUS
+InternalLinkedCacheCollectKexts (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    PRELINKED_KEXT     **Kexts,
+  OUT    UINT32             *NumberOfKexts
+  )
+{
+  RETURN_STATUS   Status;
+  PRELINKED_KEXT  *Kext;
+  UINT32          Index;
+
+  *NumberOfKexts = 0;
+
+  Kext = InternalCachedPrelinkedKernel (Context);
+  if (Kext == NULL) {
+    return RETURN_NOT_FOUND;
+  }
+
+  Status = InternalScanPrelinkedKext (Kext, Context, TRUE);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Kexts[(*NumberOfKexts)++] = Kext;
+
+  for (Index = 0; Index < Context->KextIndexSize; ++Index) {
+    if (Context->KextIndex[Index].KextPlist == NULL
+      || AsciiStrnCmp (
+        Context->KextIndex[Index].Identifier,
+        PRELINK_KPI_IDENTIFIER_PREFIX,
+        L_STR_LEN (PRELINK_KPI_IDENTIFIER_PREFIX)
+        ) != 0) {
+      continue;
+    }
+
+    Kext = InternalCachedPrelinkedKext (Context, Context->KextIndex[Index].Identifier);
+    if (Kext == NULL) {
+      continue;
+    }
+
+    Status = InternalScanPrelinkedKext (Kext, Context, TRUE);
+    if (RETURN_ERROR (Status)) {
+      return Status;
+    }
+
+    //
+    // KPIs with no __LINKEDIT have nothing to cache.
+    //
+    if (Kext->LinkedSymbolTable != NULL && Kext->LinkedVtables != NULL) {
+      Kexts[(*NumberOfKexts)++] = Kext;
+    }
+  }
+
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+PrelinkedExportLinkedCache (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  OUT    VOID               **Cache,
+  OUT    UINT32             *CacheSize
+  )
+{
+  RETURN_STATUS                  Status;
+  PRELINKED_KEXT                 **Kexts;
+  UINT32                         NumberOfKexts;
+  PRELINKED_KEXT                 *Kext;
+  UINT32                         Index;
+  UINT32                         SymbolIndex;
+  UINT32                         EntryIndex;
+  UINTN                          Size;
+  UINT8                          *Buffer;
+  PRELINKED_LINKED_CACHE_HEADER  *Header;
+  PRELINKED_LINKED_CACHE_KEXT    *CacheKext;
+  PRELINKED_LINKED_CACHE_SYMBOL  *CacheSymbol;
+  PRELINKED_LINKED_CACHE_VTABLE  *CacheVtable;
+  PRELINKED_VTABLE               *Vtable;
+  UINT32                         VtablesSize;
+  BOOLEAN                        Result;
+
+  ASSERT (Context != NULL);
+  ASSERT (Cache != NULL);
+  ASSERT (CacheSize != NULL);
+
+  Kexts = AllocatePool ((Context->KextIndexCount + 1) * sizeof (*Kexts));
+  if (Kexts == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  Status = InternalLinkedCacheCollectKexts (Context, Kexts, &NumberOfKexts);
+  if (RETURN_ERROR (Status)) {
+    FreePool (Kexts);
+    return Status;
+  }
+
+  //
+  // Cached value order is optional, yet it is cheaper to store than to sort.
+  //
+  Size = sizeof (*Header) + NumberOfKexts * sizeof (*CacheKext);
+  for (Index = 0; Index < NumberOfKexts; ++Index) {
+    Kext = Kexts[Index];
+    if (Kext->LinkedSymbolValueOrder == NULL) {
+      InternalBuildLinkedSymbolValueOrder (Kext);
+    }
+
+    Size += ALIGN_VALUE (AsciiStrSize (Kext->Identifier), sizeof (UINT64));
+    Size += Kext->NumberOfSymbols * sizeof (PRELINKED_LINKED_CACHE_SYMBOL);
+    if (Kext->LinkedSymbolHash != NULL) {
+      Size += ALIGN_VALUE ((Kext->LinkedSymbolHashMask + 1) * sizeof (UINT32), sizeof (UINT64));
+    }
+    if (Kext->LinkedSymbolValueOrder != NULL) {
+      Size += ALIGN_VALUE (Kext->NumberOfSymbols * sizeof (UINT32), sizeof (UINT64));
+    }
+    Size += ALIGN_VALUE (InternalLinkedCacheVtablesSize (Kext), sizeof (UINT64));
+  }
+
+  if (Size > MAX_UINT32) {
+    FreePool (Kexts);
+    return RETURN_UNSUPPORTED;
+  }
+
+  Buffer = AllocateZeroPool (Size);
+  if (Buffer == NULL) {
+    FreePool (Kexts);
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  Header                = (PRELINKED_LINKED_CACHE_HEADER *) Buffer;
+  Header->Signature     = PRELINKED_LINKED_CACHE_SIGNATURE;
+  Header->Version       = PRELINKED_LINKED_CACHE_VERSION;
+  Header->CacheSize     = (UINT32) Size;
+  Header->NumberOfKexts = NumberOfKexts;
+  InternalLinkedCacheGetUuid (&Context->PrelinkedMachContext, Header->KernelUuid);
+
+  Result    = TRUE;
+  CacheKext = (PRELINKED_LINKED_CACHE_KEXT *) (Header + 1);
+  Size      = sizeof (*Header) + NumberOfKexts * sizeof (*CacheKext);
+
+  for (Index = 0; Index < NumberOfKexts && Result; ++Index, ++CacheKext) {
+    Kext = Kexts[Index];
+
+    CacheKext->ImageOffset          = (UINT32) ((UINT8 *) Kext->Context.MachContext.MachHeader - Context->Prelinked);
+    CacheKext->NumberOfSymbols      = Kext->NumberOfSymbols;
+    CacheKext->NumberOfCxxSymbols   = Kext->NumberOfCxxSymbols;
+    CacheKext->LinkedSymbolHashMask = Kext->LinkedSymbolHash != NULL ? Kext->LinkedSymbolHashMask : 0;
+    CacheKext->NumberOfVtables      = Kext->NumberOfVtables;
+    InternalLinkedCacheGetUuid (&Kext->Context.MachContext, CacheKext->Uuid);
+
+    CacheKext->IdentifierOffset = (UINT32) Size;
+    CopyMem (&Buffer[Size], Kext->Identifier, AsciiStrSize (Kext->Identifier));
+    Size += ALIGN_VALUE (AsciiStrSize (Kext->Identifier), sizeof (UINT64));
+
+    CacheKext->SymbolsOffset = (UINT32) Size;
+    CacheSymbol = (PRELINKED_LINKED_CACHE_SYMBOL *) &Buffer[Size];
+    for (SymbolIndex = 0; SymbolIndex < Kext->NumberOfSymbols; ++SymbolIndex) {
+      CacheSymbol[SymbolIndex].Value  = Kext->LinkedSymbolTable[SymbolIndex].Value;
+      CacheSymbol[SymbolIndex].Length = Kext->LinkedSymbolTable[SymbolIndex].Length;
+      Result &= InternalLinkedCacheNameToOffset (
+        Context,
+        Kext->LinkedSymbolTable[SymbolIndex].Name,
+        &CacheSymbol[SymbolIndex].NameOffset
+        );
+    }
+    Size += Kext->NumberOfSymbols * sizeof (*CacheSymbol);
+
+    if (Kext->LinkedSymbolHash != NULL) {
+      CacheKext->HashOffset = (UINT32) Size;
+      CopyMem (&Buffer[Size], Kext->LinkedSymbolHash, (Kext->LinkedSymbolHashMask + 1) * sizeof (UINT32));
+      Size += ALIGN_VALUE ((Kext->LinkedSymbolHashMask + 1) * sizeof (UINT32), sizeof (UINT64));
+    }
+
+    if (Kext->LinkedSymbolValueOrder != NULL) {
+      CacheKext->ValueOrderOffset = (UINT32) Size;
+      CopyMem (&Buffer[Size], Kext->LinkedSymbolValueOrder, Kext->NumberOfSymbols * sizeof (UINT32));
+      Size += ALIGN_VALUE (Kext->NumberOfSymbols * sizeof (UINT32), sizeof (UINT64));
+    }
+
+    VtablesSize            = InternalLinkedCacheVtablesSize (Kext);
+    CacheKext->VtablesOffset = (UINT32) Size;
+    CacheKext->VtablesSize   = VtablesSize;
+
+    Vtable      = Kext->LinkedVtables;
+    CacheVtable = (PRELINKED_LINKED_CACHE_VTABLE *) &Buffer[Size];
+    for (SymbolIndex = 0; SymbolIndex < Kext->NumberOfVtables; ++SymbolIndex) {
+      CacheVtable->NumEntries = Vtable->NumEntries;
+      Result &= InternalLinkedCacheNameToOffset (Context, Vtable->Name, &CacheVtable->NameOffset);
+      for (EntryIndex = 0; EntryIndex < Vtable->NumEntries; ++EntryIndex) {
+        CacheVtable->Entries[EntryIndex].Address = Vtable->Entries[EntryIndex].Address;
+        Result &= InternalLinkedCacheNameToOffset (
+          Context,
+          Vtable->Entries[EntryIndex].Name,
+          &CacheVtable->Entries[EntryIndex].NameOffset
+          );
+      }
+
+      Vtable      = GET_NEXT_PRELINKED_VTABLE (Vtable);
+      CacheVtable = (PRELINKED_LINKED_CACHE_VTABLE *) &CacheVtable->Entries[CacheVtable->NumEntries];
+    }
+    Size += ALIGN_VALUE (VtablesSize, sizeof (UINT64));
+  }
+
+  FreePool (Kexts);
+
+  //
+  // Names outside of prelinkedkernel cannot be persisted.
+  //
+  if (!Result) {
+    FreePool (Buffer);
+    return RETURN_UNSUPPORTED;
+  }
+
+  ASSERT (Size == Header->CacheSize);
+
+  *Cache     = Buffer;
+  *CacheSize = Header->CacheSize;
+
+  return RETURN_SUCCESS;
+}
+
+STATIC
+BOOLEAN
+InternalLinkedCacheRangeIsValid (
+  IN UINT32  CacheSize,
+  IN UINT32  Offset,
+  IN UINT64  Size,
+  IN UINT32  Alignment
+  )
+{
+  return (Offset % Alignment) == 0
+    && Offset <= CacheSize
+    && Size <= CacheSize - Offset;
+}
+
+/**
+  Validate linked cache kext and find matching PRELINKED_KEXT.
+
+  @return  matching kext or NULL.
+**/
+STATIC
+PRELINKED_KEXT *
+InternalLinkedCacheValidateKext (
+  IN OUT PRELINKED_CONTEXT            *Context,
+  IN     UINT8                        *Cache,
+  IN     UINT32                       CacheSize,
+  IN     PRELINKED_LINKED_CACHE_KEXT  *CacheKext
+  )
+{
+  PRELINKED_KEXT                 *Kext;
+  CONST CHAR8                    *Identifier;
+  UINT32                         Index;
+  UINT32                         EntryIndex;
+  UINT32                         *Indices;
+  PRELINKED_LINKED_CACHE_SYMBOL  *CacheSymbol;
+  PRELINKED_LINKED_CACHE_VTABLE  *CacheVtable;
+  UINT32                         VtablesSize;
+  UINT32                         NumberOfEntries;
+  UINT8                          Uuid[16];
+
+  if (CacheKext->IdentifierOffset >= CacheSize
+    || AsciiStrnLenS ((CHAR8 *) &Cache[CacheKext->IdentifierOffset], CacheSize - CacheKext->IdentifierOffset)
+      == CacheSize - CacheKext->IdentifierOffset) {
+    return NULL;
+  }
+
+  Identifier = (CONST CHAR8 *) &Cache[CacheKext->IdentifierOffset];
+  if (AsciiStrCmp (Identifier, PRELINK_KERNEL_IDENTIFIER) == 0) {
+    Kext = InternalCachedPrelinkedKernel (Context);
+  } else {
+    Kext = InternalCachedPrelinkedKext (Context, Identifier);
+  }
+
+  //
+  // Kexts, which were already linked against, are left as is.
+  //
+  if (Kext == NULL || Kext->LinkedSymbolTable != NULL || Kext->LinkedVtables != NULL) {
+    return NULL;
+  }
+
+  //
+  // Same kernel may come with a different set of kexts, so ensure this
+  // kext was not moved or replaced.
+  //
+  InternalLinkedCacheGetUuid (&Kext->Context.MachContext, Uuid);
+  if ((UINT8 *) Kext->Context.MachContext.MachHeader - Context->Prelinked != CacheKext->ImageOffset
+    || CompareMem (Uuid, CacheKext->Uuid, sizeof (Uuid)) != 0) {
+    return NULL;
+  }
+
+  if (CacheKext->NumberOfCxxSymbols > CacheKext->NumberOfSymbols
+    || (CacheKext->HashOffset != 0
+      && (((CacheKext->LinkedSymbolHashMask + 1) & CacheKext->LinkedSymbolHashMask) != 0
+      || CacheKext->NumberOfSymbols >= (UINT64) CacheKext->LinkedSymbolHashMask + 1))
+    || !InternalLinkedCacheRangeIsValid (
+      CacheSize,
+      CacheKext->SymbolsOffset,
+      (UINT64) CacheKext->NumberOfSymbols * sizeof (PRELINKED_LINKED_CACHE_SYMBOL),
+      sizeof (UINT64)
+      )
+    || (CacheKext->HashOffset != 0 && !InternalLinkedCacheRangeIsValid (
+      CacheSize,
+      CacheKext->HashOffset,
+      ((UINT64) CacheKext->LinkedSymbolHashMask + 1) * sizeof (UINT32),
+      sizeof (UINT32)
+      ))
+    || (CacheKext->ValueOrderOffset != 0 && !InternalLinkedCacheRangeIsValid (
+      CacheSize,
+      CacheKext->ValueOrderOffset,
+      (UINT64) CacheKext->NumberOfSymbols * sizeof (UINT32),
+      sizeof (UINT32)
+      ))
+    || !InternalLinkedCacheRangeIsValid (
+      CacheSize,
+      CacheKext->VtablesOffset,
+      CacheKext->VtablesSize,
+      sizeof (UINT64)
+      )) {
+    return NULL;
+  }
+
+  CacheSymbol = (PRELINKED_LINKED_CACHE_SYMBOL *) &Cache[CacheKext->SymbolsOffset];
+  for (Index = 0; Index < CacheKext->NumberOfSymbols; ++Index) {
+    if (CacheSymbol[Index].NameOffset == 0
+      || !InternalLinkedCacheNameIsValid (Context, CacheSymbol[Index].NameOffset, CacheSymbol[Index].Length)) {
+      return NULL;
+    }
+  }
+
+  //
+  // Every symbol takes exactly one hash slot. As there are more slots than
+  // symbols, this leaves an empty slot to terminate each probe sequence.
+  //
+  if (CacheKext->HashOffset != 0) {
+    Indices         = (UINT32 *) &Cache[CacheKext->HashOffset];
+    NumberOfEntries = 0;
+    for (Index = 0; Index <= CacheKext->LinkedSymbolHashMask; ++Index) {
+      if (Indices[Index] > CacheKext->NumberOfSymbols) {
+        return NULL;
+      }
+      if (Indices[Index] != 0) {
+        ++NumberOfEntries;
+      }
+    }
+
+    if (NumberOfEntries != CacheKext->NumberOfSymbols) {
+      return NULL;
+    }
+  }
+
+  //
+  // Value order must be sorted by value and then by index exactly like
+  // InternalBuildLinkedSymbolValueOrder does. Strict ordering also makes
+  // in-range indices a permutation.
+  //
+  if (CacheKext->ValueOrderOffset != 0) {
+    Indices = (UINT32 *) &Cache[CacheKext->ValueOrderOffset];
+    for (Index = 0; Index < CacheKext->NumberOfSymbols; ++Index) {
+      if (Indices[Index] >= CacheKext->NumberOfSymbols) {
+        return NULL;
+      }
+
+      if (Index > 0
+        && (CacheSymbol[Indices[Index - 1]].Value > CacheSymbol[Indices[Index]].Value
+        || (CacheSymbol[Indices[Index - 1]].Value == CacheSymbol[Indices[Index]].Value
+        && Indices[Index - 1] >= Indices[Index]))) {
+        return NULL;
+      }
+    }
+  }
+
+  VtablesSize = CacheKext->VtablesSize;
+  CacheVtable = (PRELINKED_LINKED_CACHE_VTABLE *) &Cache[CacheKext->VtablesOffset];
+  for (Index = 0; Index < CacheKext->NumberOfVtables; ++Index) {
+    if (VtablesSize < sizeof (*CacheVtable)
+      || (VtablesSize - sizeof (*CacheVtable)) / sizeof (CacheVtable->Entries[0]) < CacheVtable->NumEntries
+      || CacheVtable->NameOffset == 0
+      || !InternalLinkedCacheNameIsValid (Context, CacheVtable->NameOffset, 0)) {
+      return NULL;
+    }
+
+    for (EntryIndex = 0; EntryIndex < CacheVtable->NumEntries; ++EntryIndex) {
+      if (CacheVtable->Entries[EntryIndex].NameOffset != 0
+        && !InternalLinkedCacheNameIsValid (Context, CacheVtable->Entries[EntryIndex].NameOffset, 0)) {
+        return NULL;
+      }
+    }
+
+    VtablesSize -= sizeof (*CacheVtable) + CacheVtable->NumEntries * sizeof (CacheVtable->Entries[0]);
+    CacheVtable  = (PRELINKED_LINKED_CACHE_VTABLE *) &CacheVtable->Entries[CacheVtable->NumEntries];
+  }
+
+  return Kext;
+}
+
+/**
+  Rebase validated linked cache kext in place and attach it to PRELINKED_KEXT.
+**/
+STATIC
+RETURN_STATUS
+InternalLinkedCacheAttachKext (
+  IN OUT PRELINKED_CONTEXT            *Context,
+  IN OUT PRELINKED_KEXT               *Kext,
+  IN     UINT8                        *Cache,
+  IN     PRELINKED_LINKED_CACHE_KEXT  *CacheKext
+  )
+{
+  RETURN_STATUS                  Status;
+  UINT32                         Index;
+  UINT32                         EntryIndex;
+  PRELINKED_KEXT_SYMBOL          *Symbol;
+  PRELINKED_LINKED_CACHE_VTABLE  *CacheVtable;
+  PRELINKED_VTABLE               *Vtable;
+  UINT64                         NameOffset;
+
+  //
+  // Symbol table is still needed for dependency scanning. The call
+  // overrides NumberOfSymbols, so it must precede the assignment below.
+  //
+  Status = InternalScanCurrentPrelinkedKextLinkedEdit (Kext);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Symbol = (PRELINKED_KEXT_SYMBOL *) &Cache[CacheKext->SymbolsOffset];
+  for (Index = 0; Index < CacheKext->NumberOfSymbols; ++Index) {
+    NameOffset           = ((PRELINKED_LINKED_CACHE_SYMBOL *) &Symbol[Index])->NameOffset;
+    Symbol[Index].Name   = (CONST CHAR8 *) &Context->Prelinked[NameOffset];
+  }
+
+  CacheVtable = (PRELINKED_LINKED_CACHE_VTABLE *) &Cache[CacheKext->VtablesOffset];
+  for (Index = 0; Index < CacheKext->NumberOfVtables; ++Index) {
+    Vtable       = (PRELINKED_VTABLE *) CacheVtable;
+    NameOffset   = CacheVtable->NameOffset;
+    Vtable->Name = (CONST CHAR8 *) &Context->Prelinked[NameOffset];
+
+    for (EntryIndex = 0; EntryIndex < CacheVtable->NumEntries; ++EntryIndex) {
+      NameOffset = CacheVtable->Entries[EntryIndex].NameOffset;
+      Vtable->Entries[EntryIndex].Name = NameOffset != 0 ? (CONST CHAR8 *) &Context->Prelinked[NameOffset] : NULL;
+    }
+
+    CacheVtable = (PRELINKED_LINKED_CACHE_VTABLE *) &CacheVtable->Entries[CacheVtable->NumEntries];
+  }
+
+  Kext->NumberOfSymbols        = CacheKext->NumberOfSymbols;
+  Kext->NumberOfCxxSymbols     = CacheKext->NumberOfCxxSymbols;
+  Kext->LinkedSymbolTable      = (PRELINKED_KEXT_SYMBOL *) &Cache[CacheKext->SymbolsOffset];
+  Kext->LinkedSymbolHash       = CacheKext->HashOffset != 0 ? (UINT32 *) &Cache[CacheKext->HashOffset] : NULL;
+  Kext->LinkedSymbolHashMask   = CacheKext->LinkedSymbolHashMask;
+  Kext->LinkedSymbolValueOrder = CacheKext->ValueOrderOffset != 0 ? (UINT32 *) &Cache[CacheKext->ValueOrderOffset] : NULL;
+  Kext->NumberOfVtables        = CacheKext->NumberOfVtables;
+  Kext->LinkedVtables          = (PRELINKED_VTABLE *) &Cache[CacheKext->VtablesOffset];
+  Kext->LinkedCached           = TRUE;
+  Kext->LinkedValueOrderCached = Kext->LinkedSymbolValueOrder != NULL;
+
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+PrelinkedImportLinkedCache (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     VOID               *Cache,
+  IN     UINT32             CacheSize
+  )
+{
+  RETURN_STATUS                  Status;
+  PRELINKED_LINKED_CACHE_HEADER  *Header;
+  PRELINKED_LINKED_CACHE_KEXT    *CacheKexts;
+  PRELINKED_KEXT                 **Kexts;
+  UINT32                         Index;
+  UINT8                          KernelUuid[16];
+
+  ASSERT (Context != NULL);
+  ASSERT (Cache != NULL);
+
+  Header = (PRELINKED_LINKED_CACHE_HEADER *) Cache;
+
+  if (CacheSize < sizeof (*Header)
+    || !OC_ALIGNED (Header)
+    || Header->Signature != PRELINKED_LINKED_CACHE_SIGNATURE
+    || Header->Version != PRELINKED_LINKED_CACHE_VERSION
+    || Header->CacheSize != CacheSize
+    || Header->NumberOfKexts == 0
+    || (CacheSize - sizeof (*Header)) / sizeof (*CacheKexts) < Header->NumberOfKexts) {
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  if (!InternalLinkedCacheGetUuid (&Context->PrelinkedMachContext, KernelUuid)
+    || CompareMem (KernelUuid, Header->KernelUuid, sizeof (KernelUuid)) != 0) {
+    return RETURN_NOT_FOUND;
+  }
+
+  Kexts = AllocatePool (Header->NumberOfKexts * sizeof (*Kexts));
+  if (Kexts == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  //
+  // Validate everything prior to rebasing, the cache is modified in place.
+  // Invalid entries are skipped and later rebuilt as usual.
+  //
+  CacheKexts = (PRELINKED_LINKED_CACHE_KEXT *) (Header + 1);
+  for (Index = 0; Index < Header->NumberOfKexts; ++Index) {
+    Kexts[Index] = InternalLinkedCacheValidateKext (Context, Cache, CacheSize, &CacheKexts[Index]);
+    DEBUG_CODE_BEGIN ();
+    if (Kexts[Index] == NULL) {
+      DEBUG ((DEBUG_INFO, "OCK: Linked cache kext %u is outdated\n", Index));
+    }
+    DEBUG_CODE_END ();
+  }
+
+  //
+  // The cache is to be referenced by kexts, so let the context own it.
+  //
+  Status = PrelinkedDependencyInsert (Context, Cache);
+  if (RETURN_ERROR (Status)) {
+    FreePool (Kexts);
+    return Status;
+  }
+
+  //
+  // Attaching fails before the cache entry is rebased, so a kext that cannot
+  // be attached is simply left to be rebuilt as usual.
+  //
+  for (Index = 0; Index < Header->NumberOfKexts; ++Index) {
+    if (Kexts[Index] != NULL) {
+      Status = InternalLinkedCacheAttachKext (Context, Kexts[Index], Cache, &CacheKexts[Index]);
+      if (RETURN_ERROR (Status)) {
+        DEBUG ((DEBUG_INFO, "OCK: Linked cache kext %u is not attached - %r\n", Index, Status));
+      }
+    }
+  }
+
+  FreePool (Kexts);
+
+  return RETURN_SUCCESS;
+}
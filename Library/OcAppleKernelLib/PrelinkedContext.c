@@ -142,10 +142,8 @@ PrelinkedContextInit (
   IN      UINT32             PrelinkedAllocSize
   )
 {
-  XML_NODE     *PrelinkedInfoRoot;
-  CONST CHAR8  *PrelinkedInfoRootKey;
-  UINT32       PrelinkedInfoRootIndex;
-  UINT32       PrelinkedInfoRootCount;
+  RETURN_STATUS  Status;
+  XML_NODE       *PrelinkedInfoRoot;
 
   ASSERT (Context != NULL);
   ASSERT (Prelinked != NULL);
@@ -154,6 +152,11 @@ PrelinkedContextInit (
 
   ZeroMem (Context, sizeof (*Context));
 
+  //
+  // Newly created kexts are never processed in the current generation.
+  //
+  Context->KextWalkGeneration = 1;
+
   Context->Prelinked          = Prelinked;
   Context->PrelinkedSize      = MACHO_ALIGN (PrelinkedSize);
   Context->PrelinkedAllocSize = PrelinkedAllocSize;
@@ -234,7 +237,7 @@ PrelinkedContextInit (
     return RETURN_OUT_OF_RESOURCES;
   }
 
-  Context->PrelinkedInfoDocument = XmlDocumentParse (Context->PrelinkedInfo, (UINT32)Context->PrelinkedInfoSection->Size, TRUE);
+  Context->PrelinkedInfoDocument = XmlDocumentParseLazy (Context->PrelinkedInfo, (UINT32)Context->PrelinkedInfoSection->Size, TRUE);
   if (Context->PrelinkedInfoDocument == NULL) {
     PrelinkedContextFree (Context);
     return RETURN_INVALID_PARAMETER;
@@ -246,21 +249,17 @@ PrelinkedContextInit (
     return RETURN_INVALID_PARAMETER;
   }
 
-  PrelinkedInfoRootCount = PlistDictChildren (PrelinkedInfoRoot);
-  for (PrelinkedInfoRootIndex = 0; PrelinkedInfoRootIndex < PrelinkedInfoRootCount; ++PrelinkedInfoRootIndex) {
-    PrelinkedInfoRootKey = PlistKeyValue (PlistDictChild (PrelinkedInfoRoot, PrelinkedInfoRootIndex, &Context->KextList));
-    if (PrelinkedInfoRootKey == NULL) {
-      continue;
-    }
-
-    if (AsciiStrCmp (PrelinkedInfoRootKey, PRELINK_INFO_DICTIONARY_KEY) == 0) {
-      if (PlistNodeCast (Context->KextList, PLIST_NODE_TYPE_ARRAY) != NULL) {
-        Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context->KextList);
-        if (Context->PrelinkedLastLoadAddress != 0) {
-          return RETURN_SUCCESS;
-        }
+  Context->KextList = PlistDictFind (PrelinkedInfoRoot, PRELINK_INFO_DICTIONARY_KEY);
+  if (PlistNodeCast (Context->KextList, PLIST_NODE_TYPE_ARRAY) != NULL) {
+    Context->PrelinkedLastLoadAddress = PrelinkedFindLastLoadAddress (Context->KextList);
+    if (Context->PrelinkedLastLoadAddress != 0) {
+      Status = InternalBuildPrelinkedKextIndex (Context);
+      if (!RETURN_ERROR (Status)) {
+        return RETURN_SUCCESS;
       }
-      break;
+
+      PrelinkedContextFree (Context);
+      return Status;
     }
   }
 
@@ -277,6 +276,8 @@ PrelinkedContextFree (
   LIST_ENTRY      *Link;
   PRELINKED_KEXT  *Kext;
 
+  MachoFreeIndices (&Context->PrelinkedMachContext);
+
   if (Context->PrelinkedInfoDocument != NULL) {
     XmlDocumentFree (Context->PrelinkedInfoDocument);
     Context->PrelinkedInfoDocument = NULL;
@@ -309,6 +310,13 @@ PrelinkedContextFree (
   }
 
   ZeroMem (&Context->PrelinkedKexts, sizeof (Context->PrelinkedKexts));
+
+  if (Context->KextIndex != NULL) {
+    FreePool (Context->KextIndex);
+    Context->KextIndex      = NULL;
+    Context->KextIndexSize  = 0;
+    Context->KextIndexCount = 0;
+  }
 }
 
 RETURN_STATUS
@@ -483,23 +491,89 @@ PrelinkedReserveKextSize (
   return RETURN_SUCCESS;
 }
 
+/**
+  Parse Info.plist of the kext to be injected.
+
+  @param[in]  InfoPlist      Kext Info.plist.
+  @param[in]  InfoPlistSize  Kext Info.plist size.
+  @param[out] TmpInfoPlist   Info.plist copy referenced by Document.
+  @param[out] Document       Parsed Info.plist.
+  @param[out] Root           Info.plist root dictionary.
+
+  @return  RETURN_SUCCESS on success.
+**/
+STATIC
 RETURN_STATUS
-PrelinkedInjectKext (
+InternalParseInjectedInfoPlist (
+  IN  CONST CHAR8   *InfoPlist,
+  IN  UINT32        InfoPlistSize,
+  OUT CHAR8         **TmpInfoPlist,
+  OUT XML_DOCUMENT  **Document,
+  OUT XML_NODE      **Root
+  )
+{
+  ASSERT (InfoPlistSize > 0);
+
+  //
+  // Allocate Info.plist copy for XML_DOCUMENT.
+  //
+  *TmpInfoPlist = AllocateCopyPool (InfoPlistSize, InfoPlist);
+  if (*TmpInfoPlist == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  *Document = XmlDocumentParse (*TmpInfoPlist, InfoPlistSize, FALSE);
+  if (*Document == NULL) {
+    FreePool (*TmpInfoPlist);
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  *Root = PlistNodeCast (PlistDocumentRoot (*Document), PLIST_NODE_TYPE_DICT);
+  if (*Root == NULL) {
+    XmlDocumentFree (*Document);
+    FreePool (*TmpInfoPlist);
+    return RETURN_INVALID_PARAMETER;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Copy kext executable to prelinkedkernel, link it, and produce its
+  Info.plist entry. Info.plist document is consumed in any case.
+  The executable is placed right after PrelinkedSize, which is only
+  updated by InternalCommitInjectedKext, so failures leave no traces.
+
+  @param[in,out] Context            Prelinked context.
+  @param[in]     BundlePath         Kext bundle path.
+  @param[in]     TmpInfoPlist       Info.plist copy referenced by InfoPlistDocument.
+  @param[in]     InfoPlistDocument  Parsed Info.plist.
+  @param[in,out] InfoPlistRoot      Info.plist root dictionary.
+  @param[in]     ExecutablePath     Kext executable path, optional.
+  @param[in]     Executable         Kext executable, optional.
+  @param[in]     ExecutableSize     Kext executable size, optional.
+  @param[out]    NewInfoPlist       Pool allocated Info.plist entry for KextList.
+  @param[out]    PrelinkedKext      Linked kext or NULL for plist-only kexts.
+  @param[out]    AlignedSize        Space taken by the executable in prelinkedkernel.
+
+  @return  RETURN_SUCCESS on success.
+**/
+STATIC
+RETURN_STATUS
+InternalInjectKext (
   IN OUT PRELINKED_CONTEXT  *Context,
   IN     CONST CHAR8        *BundlePath,
-  IN     CONST CHAR8        *InfoPlist,
-  IN     UINT32             InfoPlistSize,
+  IN     CHAR8              *TmpInfoPlist,
+  IN     XML_DOCUMENT       *InfoPlistDocument,
+  IN OUT XML_NODE           *InfoPlistRoot,
   IN     CONST CHAR8        *ExecutablePath OPTIONAL,
   IN     CONST UINT8        *Executable OPTIONAL,
-  IN     UINT32             ExecutableSize OPTIONAL
+  IN     UINT32             ExecutableSize OPTIONAL,
+  OUT    CHAR8              **NewInfoPlist,
+  OUT    PRELINKED_KEXT     **PrelinkedKext,
+  OUT    UINT32             *AlignedSize
   )
 {
-  RETURN_STATUS     Status;
-
-  XML_DOCUMENT      *InfoPlistDocument;
-  XML_NODE          *InfoPlistRoot;
-  CHAR8             *TmpInfoPlist;
-  CHAR8             *NewInfoPlist;
   OC_MACHO_CONTEXT  ExecutableContext;
   CONST CHAR8       *TmpKeyValue;
   UINT32            FieldCount;
@@ -509,15 +583,13 @@ PrelinkedInjectKext (
   UINT32            AlignedExecutableSize;
   BOOLEAN           Failed;
   UINT64            KmodAddress;
-  PRELINKED_KEXT    *PrelinkedKext;
   CHAR8             ExecutableSourceAddrStr[24];
   CHAR8             ExecutableSizeStr[24];
   CHAR8             ExecutableLoadAddrStr[24];
   CHAR8             KmodInfoStr[24];
 
-  PrelinkedKext = NULL;
-
-  ASSERT (InfoPlistSize > 0);
+  *PrelinkedKext = NULL;
+  *AlignedSize   = 0;
 
   //
   // Copy executable to prelinkedkernel.
@@ -526,6 +598,8 @@ PrelinkedInjectKext (
     ASSERT (ExecutableSize > 0);
     if (!MachoInitializeContext (&ExecutableContext, (UINT8 *)Executable, ExecutableSize)) {
       DEBUG ((DEBUG_INFO, "OCK: Injected kext %a/%a is not a supported executable\n", BundlePath, ExecutablePath));
+      XmlDocumentFree (InfoPlistDocument);
+      FreePool (TmpInfoPlist);
       return RETURN_INVALID_PARAMETER;
     }
 
@@ -541,6 +615,8 @@ PrelinkedInjectKext (
     if (OcOverflowAddU32 (Context->PrelinkedSize, AlignedExecutableSize, &NewPrelinkedSize)
       || NewPrelinkedSize > Context->PrelinkedAllocSize
       || ExecutableSize == 0) {
+      XmlDocumentFree (InfoPlistDocument);
+      FreePool (TmpInfoPlist);
       return RETURN_BUFFER_TOO_SMALL;
     }
 
@@ -550,36 +626,19 @@ PrelinkedInjectKext (
       );
 
     if (!MachoInitializeContext (&ExecutableContext, &Context->Prelinked[Context->PrelinkedSize], ExecutableSize)) {
+      XmlDocumentFree (InfoPlistDocument);
+      FreePool (TmpInfoPlist);
       return RETURN_INVALID_PARAMETER;
     }
 
     KmodAddress = PrelinkedFindKmodAddress (&ExecutableContext, Context->PrelinkedLastLoadAddress, ExecutableSize);
     if (KmodAddress == 0) {
+      XmlDocumentFree (InfoPlistDocument);
+      FreePool (TmpInfoPlist);
       return RETURN_INVALID_PARAMETER;
     }
   }
 
-  //
-  // Allocate Info.plist copy for XML_DOCUMENT.
-  //
-  TmpInfoPlist = AllocateCopyPool (InfoPlistSize, InfoPlist);
-  if (TmpInfoPlist == NULL) {
-    return RETURN_OUT_OF_RESOURCES;
-  }
-
-  InfoPlistDocument = XmlDocumentParse (TmpInfoPlist, InfoPlistSize, FALSE);
-  if (InfoPlistDocument == NULL) {
-    FreePool (TmpInfoPlist);
-    return RETURN_INVALID_PARAMETER;
-  }
-
-  InfoPlistRoot = PlistNodeCast (PlistDocumentRoot (InfoPlistDocument), PLIST_NODE_TYPE_DICT);
-  if (InfoPlistRoot == NULL) {
-    XmlDocumentFree (InfoPlistDocument);
-    FreePool (TmpInfoPlist);
-    return RETURN_INVALID_PARAMETER;
-  }
-
   //
   // We are not supposed to check for this, it is XNU responsibility, which reliably panics.
   // However, to avoid certain users making this kind of mistake, we still provide some
@@ -630,7 +689,7 @@ PrelinkedInjectKext (
   }
 
   if (Executable != NULL) {
-    PrelinkedKext = InternalLinkPrelinkedKext (
+    *PrelinkedKext = InternalLinkPrelinkedKext (
       Context,
       &ExecutableContext,
       InfoPlistRoot,
@@ -638,61 +697,402 @@ PrelinkedInjectKext (
       KmodAddress
       );
 
-    if (PrelinkedKext == NULL) {
+    if (*PrelinkedKext == NULL) {
       XmlDocumentFree (InfoPlistDocument);
       FreePool (TmpInfoPlist);
       return RETURN_INVALID_PARAMETER;
     }
 
-    //
-    // XNU assumes that load size and source size are same, so we should append
-    // whatever is bigger to all sizes.
-    //
-    Context->PrelinkedSize                  += AlignedExecutableSize;
-    Context->PrelinkedLastAddress           += AlignedExecutableSize;
-    Context->PrelinkedLastLoadAddress       += AlignedExecutableSize;
-    Context->PrelinkedTextSegment->Size     += AlignedExecutableSize;
-    Context->PrelinkedTextSegment->FileSize += AlignedExecutableSize;
-    Context->PrelinkedTextSection->Size     += AlignedExecutableSize;
+    *AlignedSize = AlignedExecutableSize;
   }
 
   //
   // Strip outer plist & dict.
   //
-  NewInfoPlist = XmlDocumentExport (InfoPlistDocument, &NewInfoPlistSize, 2);
+  *NewInfoPlist = XmlDocumentExport (InfoPlistDocument, &NewInfoPlistSize, 2);
 
   XmlDocumentFree (InfoPlistDocument);
   FreePool (TmpInfoPlist);
 
-  if (NewInfoPlist == NULL) {
-    if (PrelinkedKext != NULL) {
-      InternalFreePrelinkedKext (PrelinkedKext);
+  if (*NewInfoPlist == NULL) {
+    if (*PrelinkedKext != NULL) {
+      InternalFreePrelinkedKext (*PrelinkedKext);
+      *PrelinkedKext = NULL;
     }
     return RETURN_OUT_OF_RESOURCES;
   }
 
+  return RETURN_SUCCESS;
+}
+
+/**
+  Append Info.plist entry produced by InternalInjectKext to KextList.
+  NewInfoPlist is owned by prelinked context afterwards.
+
+  @param[in,out] Context       Prelinked context.
+  @param[in]     NewInfoPlist  Pool allocated Info.plist entry.
+
+  @return  RETURN_SUCCESS on success.
+**/
+STATIC
+RETURN_STATUS
+InternalAppendInjectedInfoPlist (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CHAR8              *NewInfoPlist
+  )
+{
+  RETURN_STATUS  Status;
+
   Status = PrelinkedDependencyInsert (Context, NewInfoPlist);
   if (RETURN_ERROR (Status)) {
     FreePool (NewInfoPlist);
-    if (PrelinkedKext != NULL) {
-      InternalFreePrelinkedKext (PrelinkedKext);
-    }
     return Status;
   }
 
   if (XmlNodeAppend (Context->KextList, "dict", NULL, NewInfoPlist) == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  return RETURN_SUCCESS;
+}
+
+/**
+  Make injected kext part of prelinkedkernel. Append its Info.plist entry
+  and index the kext first, as these are the steps that may fail, then
+  account the executable in prelinkedkernel sizes and let other kexts
+  depend on it. Index space is normally reserved by the caller with
+  InternalReservePrelinkedKextIndex, so that indexing cannot fail.
+
+  @param[in,out] Context        Prelinked context.
+  @param[in]     NewInfoPlist   Pool allocated Info.plist entry.
+  @param[in]     PrelinkedKext  Linked kext or NULL, freed on failure.
+  @param[in]     AlignedSize    Space taken by the executable in prelinkedkernel.
+
+  @return  RETURN_SUCCESS on success.
+**/
+STATIC
+RETURN_STATUS
+InternalCommitInjectedKext (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CHAR8              *NewInfoPlist,
+  IN     PRELINKED_KEXT     *PrelinkedKext OPTIONAL,
+  IN     UINT32             AlignedSize
+  )
+{
+  RETURN_STATUS  Status;
+
+  if (PrelinkedKext != NULL) {
+    Status = InternalReservePrelinkedKextIndex (Context, 1);
+    if (RETURN_ERROR (Status)) {
+      FreePool (NewInfoPlist);
+      InternalFreePrelinkedKext (PrelinkedKext);
+      return Status;
+    }
+  }
+
+  Status = InternalAppendInjectedInfoPlist (Context, NewInfoPlist);
+  if (RETURN_ERROR (Status)) {
     if (PrelinkedKext != NULL) {
       InternalFreePrelinkedKext (PrelinkedKext);
     }
+    return Status;
+  }
+
+  if (PrelinkedKext == NULL) {
+    return RETURN_SUCCESS;
+  }
+
+  Status = InternalIndexPrelinkedKext (Context, PrelinkedKext->Identifier, NULL, PrelinkedKext);
+  if (RETURN_ERROR (Status)) {
+    InternalFreePrelinkedKext (PrelinkedKext);
+    return Status;
+  }
+
+  //
+  // XNU assumes that load size and source size are same, so we should append
+  // whatever is bigger to all sizes.
+  //
+  Context->PrelinkedSize                  += AlignedSize;
+  Context->PrelinkedLastAddress           += AlignedSize;
+  Context->PrelinkedLastLoadAddress       += AlignedSize;
+  Context->PrelinkedTextSegment->Size     += AlignedSize;
+  Context->PrelinkedTextSegment->FileSize += AlignedSize;
+  Context->PrelinkedTextSection->Size     += AlignedSize;
+
+  InsertTailList (&Context->PrelinkedKexts, &PrelinkedKext->Link);
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+PrelinkedInjectKext (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST CHAR8        *BundlePath,
+  IN     CONST CHAR8        *InfoPlist,
+  IN     UINT32             InfoPlistSize,
+  IN     CONST CHAR8        *ExecutablePath OPTIONAL,
+  IN     CONST UINT8        *Executable OPTIONAL,
+  IN     UINT32             ExecutableSize OPTIONAL
+  )
+{
+  RETURN_STATUS     Status;
+  CHAR8             *TmpInfoPlist;
+  XML_DOCUMENT      *InfoPlistDocument;
+  XML_NODE          *InfoPlistRoot;
+  CHAR8             *NewInfoPlist;
+  PRELINKED_KEXT    *PrelinkedKext;
+  UINT32            AlignedSize;
+
+  //
+  // Reserve index slot beforehand, injected kext cannot be taken back.
+  //
+  Status = InternalReservePrelinkedKextIndex (Context, 1);
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = InternalParseInjectedInfoPlist (
+    InfoPlist,
+    InfoPlistSize,
+    &TmpInfoPlist,
+    &InfoPlistDocument,
+    &InfoPlistRoot
+    );
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  Status = InternalInjectKext (
+    Context,
+    BundlePath,
+    TmpInfoPlist,
+    InfoPlistDocument,
+    InfoPlistRoot,
+    ExecutablePath,
+    Executable,
+    ExecutableSize,
+    &NewInfoPlist,
+    &PrelinkedKext,
+    &AlignedSize
+    );
+  if (RETURN_ERROR (Status)) {
+    return Status;
+  }
+
+  return InternalCommitInjectedKext (Context, NewInfoPlist, PrelinkedKext, AlignedSize);
+}
+
+//
+// Batched injection state of a single kext.
+//
+typedef struct {
+  CHAR8         *TmpInfoPlist;
+  XML_DOCUMENT  *InfoPlistDocument;
+  XML_NODE      *InfoPlistRoot;
+  CONST CHAR8   *Identifier;
+  UINT8         SortState;
+} PRELINKED_INJECT_STATE;
+
+#define PRELINKED_INJECT_UNSORTED 0U
+#define PRELINKED_INJECT_SORTING  1U
+#define PRELINKED_INJECT_SORTED   2U
+
+/**
+  Append kext to injection order after the kexts from the same batch it depends on.
+  Dependency cycles are broken arbitrarily and left for the linker to report.
+**/
+STATIC
+VOID
+InternalSortInjectedKext (
+  IN OUT PRELINKED_INJECT_STATE  *States,
+  IN     UINT32                  KextCount,
+  IN     UINT32                  KextIndex,
+  IN OUT UINT32                  *Order,
+  IN OUT UINT32                  *OrderCount
+  )
+{
+  UINT32       FieldIndex;
+  UINT32       FieldCount;
+  UINT32       LibraryIndex;
+  UINT32       LibraryCount;
+  UINT32       Index;
+  CONST CHAR8  *Key;
+  XML_NODE     *Value;
+  CONST CHAR8  *DependencyId;
+
+  States[KextIndex].SortState = PRELINKED_INJECT_SORTING;
+
+  //
+  // Both 32-bit and 64-bit library lists are considered, as only ordering matters here.
+  //
+  FieldCount = PlistDictChildren (States[KextIndex].InfoPlistRoot);
+  for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
+    Key = PlistKeyValue (PlistDictChild (States[KextIndex].InfoPlistRoot, FieldIndex, &Value));
+    if (Key == NULL
+      || (AsciiStrCmp (Key, INFO_BUNDLE_LIBRARIES_KEY) != 0 && AsciiStrCmp (Key, INFO_BUNDLE_LIBRARIES_64_KEY) != 0)
+      || PlistNodeCast (Value, PLIST_NODE_TYPE_DICT) == NULL) {
+      continue;
+    }
+
+    LibraryCount = PlistDictChildren (Value);
+    for (LibraryIndex = 0; LibraryIndex < LibraryCount; ++LibraryIndex) {
+      DependencyId = PlistKeyValue (PlistDictChild (Value, LibraryIndex, NULL));
+      if (DependencyId == NULL) {
+        continue;
+      }
+
+      for (Index = 0; Index < KextCount; ++Index) {
+        if (States[Index].SortState == PRELINKED_INJECT_UNSORTED
+          && States[Index].InfoPlistRoot != NULL
+          && States[Index].Identifier != NULL
+          && AsciiStrCmp (States[Index].Identifier, DependencyId) == 0) {
+          InternalSortInjectedKext (States, KextCount, Index, Order, OrderCount);
+        }
+      }
+    }
+  }
+
+  States[KextIndex].SortState = PRELINKED_INJECT_SORTED;
+  Order[(*OrderCount)++]      = KextIndex;
+}
+
+RETURN_STATUS
+PrelinkedInjectKexts (
+  IN OUT PRELINKED_CONTEXT      *Context,
+  IN OUT PRELINKED_INJECT_KEXT  *Kexts,
+  IN     UINT32                 KextCount
+  )
+{
+  RETURN_STATUS           Status;
+  PRELINKED_INJECT_STATE  *States;
+  UINT32                  *Order;
+  UINT32                  OrderCount;
+  UINT32                  Index;
+  UINT32                  FieldIndex;
+  UINT32                  FieldCount;
+  CONST CHAR8             *Key;
+  XML_NODE                *Value;
+  OC_MACHO_CONTEXT        ExecutableContext;
+  MACH_SEGMENT_COMMAND_64 *LinkEditSegment;
+  UINT64                  LinkEditSize;
+  CHAR8                   *NewInfoPlist;
+  PRELINKED_KEXT          *PrelinkedKext;
+  UINT32                  AlignedSize;
+
+  ASSERT (Context != NULL);
+  ASSERT (Kexts != NULL || KextCount == 0);
+
+  if (KextCount == 0) {
+    return RETURN_SUCCESS;
+  }
+
+  //
+  // Reserve index slots beforehand, injected kexts cannot be taken back.
+  //
+  Status = InternalReservePrelinkedKextIndex (Context, KextCount);
+  if (RETURN_ERROR (Status)) {
+    States = NULL;
+  } else {
+    States = AllocateZeroPool (KextCount * (sizeof (*States) + sizeof (*Order)));
+  }
+
+  if (States == NULL) {
+    for (Index = 0; Index < KextCount; ++Index) {
+      Kexts[Index].Status = RETURN_OUT_OF_RESOURCES;
+    }
     return RETURN_OUT_OF_RESOURCES;
   }
 
+  Order = (UINT32 *) &States[KextCount];
+
   //
-  // Let other kexts depend on this one.
+  // Parse all plists first to learn identifiers and the largest __LINKEDIT.
   //
-  if (PrelinkedKext != NULL) {
-    InsertTailList (&Context->PrelinkedKexts, &PrelinkedKext->Link);
+  LinkEditSize = 0;
+  for (Index = 0; Index < KextCount; ++Index) {
+    Kexts[Index].Status = InternalParseInjectedInfoPlist (
+      Kexts[Index].InfoPlist,
+      Kexts[Index].InfoPlistSize,
+      &States[Index].TmpInfoPlist,
+      &States[Index].InfoPlistDocument,
+      &States[Index].InfoPlistRoot
+      );
+    if (RETURN_ERROR (Kexts[Index].Status)) {
+      continue;
+    }
+
+    FieldCount = PlistDictChildren (States[Index].InfoPlistRoot);
+    for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
+      Key = PlistKeyValue (PlistDictChild (States[Index].InfoPlistRoot, FieldIndex, &Value));
+      if (Key != NULL && AsciiStrCmp (Key, INFO_BUNDLE_IDENTIFIER_KEY) == 0) {
+        States[Index].Identifier = XmlNodeContent (Value);
+        break;
+      }
+    }
+
+    if (Kexts[Index].Executable != NULL
+      && MachoInitializeContext (&ExecutableContext, (UINT8 *) Kexts[Index].Executable, Kexts[Index].ExecutableSize)) {
+      LinkEditSegment = MachoGetSegmentByName64 (&ExecutableContext, "__LINKEDIT");
+      if (LinkEditSegment != NULL && LinkEditSegment->FileSize > LinkEditSize) {
+        LinkEditSize = LinkEditSegment->FileSize;
+      }
+    }
   }
 
-  return RETURN_SUCCESS;
+  //
+  // Size LinkBuffer once for the whole batch instead of growing it per kext.
+  //
+  if (LinkEditSize > Context->LinkBufferSize && LinkEditSize <= MAX_UINT32) {
+    if (Context->LinkBuffer != NULL) {
+      FreePool (Context->LinkBuffer);
+      Context->LinkBuffer = NULL;
+    }
+    Context->LinkBufferSize = (UINT32) LinkEditSize;
+  }
+
+  OrderCount = 0;
+  for (Index = 0; Index < KextCount; ++Index) {
+    if (States[Index].InfoPlistRoot != NULL && States[Index].SortState == PRELINKED_INJECT_UNSORTED) {
+      InternalSortInjectedKext (States, KextCount, Index, Order, &OrderCount);
+    }
+  }
+
+  for (Index = 0; Index < OrderCount; ++Index) {
+    Kexts[Order[Index]].Status = InternalInjectKext (
+      Context,
+      Kexts[Order[Index]].BundlePath,
+      States[Order[Index]].TmpInfoPlist,
+      States[Order[Index]].InfoPlistDocument,
+      States[Order[Index]].InfoPlistRoot,
+      Kexts[Order[Index]].ExecutablePath,
+      Kexts[Order[Index]].Executable,
+      Kexts[Order[Index]].ExecutableSize,
+      &NewInfoPlist,
+      &PrelinkedKext,
+      &AlignedSize
+      );
+    if (RETURN_ERROR (Kexts[Order[Index]].Status)) {
+      continue;
+    }
+
+    //
+    // Commit immediately, later kexts in the batch may depend on this one
+    // and are placed right after it. This also keeps Info.plist entries
+    // in ascending load address order.
+    //
+    Kexts[Order[Index]].Status = InternalCommitInjectedKext (Context, NewInfoPlist, PrelinkedKext, AlignedSize);
+  }
+
+  FreePool (States);
+
+  Status = RETURN_SUCCESS;
+  for (Index = 0; Index < KextCount; ++Index) {
+    if (RETURN_ERROR (Kexts[Index].Status)) {
+      DEBUG ((DEBUG_INFO, "OCK: Batched kext %a injection failed - %r\n", Kexts[Index].BundlePath, Kexts[Index].Status));
+      if (!RETURN_ERROR (Status)) {
+        Status = Kexts[Index].Status;
+      }
+    }
+  }
+
+  return Status;
 }
@@ -110,9 +110,25 @@ struct PRELINKED_KEXT_ {
   //
   PRELINKED_KEXT_SYMBOL    *LinkedSymbolTable;
   //
-  // A flag set during dependency walk BFS to avoid going through the same path.
+  // Open addressing name index over LinkedSymbolTable with linear probing.
+  // Each slot contains LinkedSymbolTable index + 1, or 0 for an empty slot.
   //
-  BOOLEAN                  Processed;
+  UINT32                   *LinkedSymbolHash;
+  //
+  // Number of LinkedSymbolHash slots - 1. Slot count is a power of two.
+  //
+  UINT32                   LinkedSymbolHashMask;
+  //
+  // LinkedSymbolTable indices sorted by symbol value for value lookups.
+  // Built on first value lookup, may be NULL.
+  //
+  UINT32                   *LinkedSymbolValueOrder;
+  //
+  // Dependency walk generation, in which this kext was last visited, to avoid
+  // going through the same path. Kext is processed when this equals
+  // PRELINKED_CONTEXT KextWalkGeneration.
+  //
+  UINT32                   Processed;
   //
   // Number of vtables in this kext.
   //
@@ -121,8 +137,39 @@ struct PRELINKED_KEXT_ {
   // Scanned vtable buffer. Iterated with GET_NEXT_PRELINKED_VTABLE.
   //
   PRELINKED_VTABLE         *LinkedVtables;
+  //
+  // Linked symbols and vtables reference linked cache memory and must not be freed.
+  //
+  BOOLEAN                  LinkedCached;
+  //
+  // LinkedSymbolValueOrder references linked cache memory and must not be freed.
+  // Value order built on lookup after attaching is owned by the kext.
+  //
+  BOOLEAN                  LinkedValueOrderCached;
 };
 
+//
+// PRELINKED_CONTEXT kext index entry. Empty entries have NULL Identifier.
+//
+typedef struct PRELINKED_KEXT_INDEX_ENTRY_ {
+  //
+  // Kext CFBundleIdentifier.
+  //
+  CONST CHAR8              *Identifier;
+  //
+  // Identifier hash to avoid string comparison on collisions.
+  //
+  UINT32                   Hash;
+  //
+  // Kext plist in KextList, NULL for injected kexts.
+  //
+  XML_NODE                 *KextPlist;
+  //
+  // Cached kext from PrelinkedKexts, NULL until first use.
+  //
+  PRELINKED_KEXT           *Kext;
+} PRELINKED_KEXT_INDEX_ENTRY;
+
 //
 // PRELINKED_KEXT signature for list identification.
 //
@@ -167,6 +214,52 @@ InternalCachedPrelinkedKext (
   IN     CONST CHAR8        *Identifier
   );
 
+/**
+  Index all KextList CFBundleIdentifier values in PRELINKED_CONTEXT.
+
+  @param[in,out] Context  Prelinked context with KextList.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+InternalBuildPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context
+  );
+
+/**
+  Make room for Count more kexts in PRELINKED_CONTEXT identifier index,
+  so that inserting them afterwards cannot fail.
+
+  @param[in,out] Context  Prelinked context.
+  @param[in]     Count    Number of kexts to be inserted.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+InternalReservePrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Count
+  );
+
+/**
+  Insert kext into PRELINKED_CONTEXT identifier index.
+  The first inserted kext plist for an identifier is preserved.
+
+  @param[in,out] Context     Prelinked context.
+  @param[in]     Identifier  Kext CFBundleIdentifier.
+  @param[in]     KextPlist   Kext plist in KextList, optional.
+  @param[in]     Kext        Cached kext in PrelinkedKexts, optional.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+InternalIndexPrelinkedKext (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST CHAR8        *Identifier,
+  IN     XML_NODE           *KextPlist OPTIONAL,
+  IN     PRELINKED_KEXT     *Kext OPTIONAL
+  );
+
 /**
   Gets cached kernel PRELINKED_KEXT from PRELINKED_CONTEXT.
 **/
@@ -186,7 +279,20 @@ InternalScanPrelinkedKext (
   );
 
 /**
-  Unlock all context dependency kexts by unsetting Processed flag.
+  Locate __LINKEDIT segment and symbol table of PRELINKED_KEXT if not done yet.
+
+  @param[in,out] Kext  Prelinked kext.
+
+  @return  RETURN_SUCCESS on success.
+**/
+RETURN_STATUS
+InternalScanCurrentPrelinkedKextLinkedEdit (
+  IN OUT PRELINKED_KEXT  *Kext
+  );
+
+/**
+  Unlock all context dependency kexts by starting a new dependency walk
+  generation. Processed flags are only reset on generation wraparound.
 
   @param[in] Context      Prelinked context.
 **/
@@ -342,6 +448,32 @@ typedef enum {
   OcGetSymbolOnlyCxx
 } OC_GET_SYMBOL_LEVEL;
 
+/**
+  Calculate symbol name hash used for LinkedSymbolHash lookup.
+
+  @param[in] Name    Symbol name.
+  @param[in] Length  Symbol name length.
+
+  @return  symbol name hash.
+**/
+UINT32
+InternalGetSymbolNameHash (
+  IN CONST CHAR8  *Name,
+  IN UINT32       Length
+  );
+
+/**
+  Build LinkedSymbolTable index permutation sorted by symbol value.
+  Heap sort is used as it needs no extra memory and has no bad cases.
+  LinkedSymbolValueOrder remains NULL on allocation failure.
+
+  @param[in,out] Kext  Kext with LinkedSymbolTable.
+**/
+VOID
+InternalBuildLinkedSymbolValueOrder (
+  IN OUT PRELINKED_KEXT  *Kext
+  );
+
 CONST PRELINKED_KEXT_SYMBOL *
 InternalOcGetSymbolName (
   IN PRELINKED_CONTEXT    *Context,
@@ -360,8 +492,9 @@ InternalOcGetSymbolValue (
 
 VOID
 InternalSolveSymbolValue64 (
-  IN  UINT64         Value,
-  OUT MACH_NLIST_64  *Symbol
+  IN OUT OC_MACHO_CONTEXT  *MachoContext,
+  IN     UINT64            Value,
+  OUT    MACH_NLIST_64     *Symbol
   );
 
 /**
@@ -383,4 +516,79 @@ InternalPrelinkKext64 (
   IN     UINT64             LoadAddress
   );
 
+//
+// Linked cache
+//
+
+#define PRELINKED_LINKED_CACHE_SIGNATURE  SIGNATURE_32 ('O', 'C', 'L', 'C')
+
+//
+// Must be bumped whenever linked data layout or its construction changes.
+//
+#define PRELINKED_LINKED_CACHE_VERSION    2
+
+//
+// Linked cache data layout. All offsets are from the cache start, and name
+// offsets are from the prelinkedkernel start, 0 stands for no name.
+// Symbol hash and value order are optional with 0 offset.
+//
+typedef struct {
+  UINT32  Signature;
+  UINT32  Version;
+  UINT32  CacheSize;
+  UINT32  NumberOfKexts;
+  UINT8   KernelUuid[16];
+} PRELINKED_LINKED_CACHE_HEADER;
+
+typedef struct {
+  UINT32  IdentifierOffset;
+  UINT32  ImageOffset;
+  UINT8   Uuid[16];
+  UINT32  NumberOfSymbols;
+  UINT32  NumberOfCxxSymbols;
+  UINT32  LinkedSymbolHashMask;
+  UINT32  NumberOfVtables;
+  UINT32  SymbolsOffset;
+  UINT32  HashOffset;
+  UINT32  ValueOrderOffset;
+  UINT32  VtablesOffset;
+  UINT32  VtablesSize;
+  UINT32  Reserved;
+} PRELINKED_LINKED_CACHE_KEXT;
+
+//
+// Cached symbols and vtables are rebased in place to PRELINKED_KEXT_SYMBOL
+// and PRELINKED_VTABLE, so they must share the layout.
+//
+typedef struct {
+  UINT64  Value;
+  UINT64  NameOffset;
+  UINT32  Length;
+} PRELINKED_LINKED_CACHE_SYMBOL;
+
+typedef struct {
+  UINT64  NameOffset;
+  UINT64  Address;
+} PRELINKED_LINKED_CACHE_VTABLE_ENTRY;
+
+typedef struct {
+  UINT64                               NameOffset;
+  UINT32                               NumEntries;
+  PRELINKED_LINKED_CACHE_VTABLE_ENTRY  Entries[];
+} PRELINKED_LINKED_CACHE_VTABLE;
+
+OC_GLOBAL_STATIC_ASSERT (
+  sizeof (PRELINKED_LINKED_CACHE_SYMBOL) == sizeof (PRELINKED_KEXT_SYMBOL)
+    && OFFSET_OF (PRELINKED_LINKED_CACHE_SYMBOL, NameOffset) == OFFSET_OF (PRELINKED_KEXT_SYMBOL, Name)
+    && OFFSET_OF (PRELINKED_LINKED_CACHE_SYMBOL, Length) == OFFSET_OF (PRELINKED_KEXT_SYMBOL, Length),
+  "Linked cache symbol layout mismatch"
+  );
+
+OC_GLOBAL_STATIC_ASSERT (
+  sizeof (PRELINKED_LINKED_CACHE_VTABLE) == sizeof (PRELINKED_VTABLE)
+    && sizeof (PRELINKED_LINKED_CACHE_VTABLE_ENTRY) == sizeof (PRELINKED_VTABLE_ENTRY)
+    && OFFSET_OF (PRELINKED_LINKED_CACHE_VTABLE, Entries) == OFFSET_OF (PRELINKED_VTABLE, Entries),
+  "Linked cache vtable layout mismatch"
+  );
+
 #endif // PRELINKED_INTERNAL_H
@@ -166,7 +166,6 @@ InternalCreatePrelinkedKext (
   return NewKext;
 }
 
-STATIC
 RETURN_STATUS
 InternalScanCurrentPrelinkedKextLinkedEdit (
   IN OUT PRELINKED_KEXT  *Kext
@@ -203,6 +202,51 @@ InternalScanCurrentPrelinkedKextLinkedEdit (
   return RETURN_SUCCESS;
 }
 
+STATIC
+UINT32 *
+InternalScanBuildLinkedSymbolHash (
+  IN  CONST PRELINKED_KEXT_SYMBOL  *SymbolTable,
+  IN  UINT32                       NumSymbols,
+  OUT UINT32                       *HashMask
+  )
+{
+  UINT32  *SymbolHash;
+  UINT32  NumSlots;
+  UINT32  Index;
+  UINT32  Slot;
+
+  //
+  // Keep load factor at or below 50% to have short probe sequences.
+  //
+  NumSlots = 16;
+  while (NumSlots < NumSymbols * 2U) {
+    if (NumSlots > MAX_UINT32 / 2) {
+      return NULL;
+    }
+    NumSlots *= 2;
+  }
+
+  SymbolHash = AllocateZeroPool (NumSlots * sizeof (*SymbolHash));
+  if (SymbolHash == NULL) {
+    return NULL;
+  }
+
+  //
+  // Insertion must happen in table order for duplicate names to resolve
+  // to the same entry as with the linear lookup.
+  //
+  for (Index = 0; Index < NumSymbols; ++Index) {
+    Slot = InternalGetSymbolNameHash (SymbolTable[Index].Name, SymbolTable[Index].Length) & (NumSlots - 1);
+    while (SymbolHash[Slot] != 0) {
+      Slot = (Slot + 1) & (NumSlots - 1);
+    }
+    SymbolHash[Slot] = Index + 1;
+  }
+
+  *HashMask = NumSlots - 1;
+  return SymbolHash;
+}
+
 STATIC
 RETURN_STATUS
 InternalScanBuildLinkedSymbolTable (
@@ -315,9 +359,18 @@ InternalScanBuildLinkedSymbolTable (
       &SymbolTable[Kext->NumberOfSymbols - NumCxxSymbols],
       (NumCxxSymbols * sizeof (*SymbolTable))
       );
-    Kext->NumberOfSymbols -= NumDiscardedSyms;
   }
 
+  //
+  // Symbol lookup falls back to the linear walk when the index is missing.
+  //
+  Kext->LinkedSymbolHash = InternalScanBuildLinkedSymbolHash (
+                             SymbolTable,
+                             Kext->NumberOfSymbols - NumDiscardedSyms,
+                             &Kext->LinkedSymbolHashMask
+                             );
+
+  Kext->NumberOfSymbols   -= NumDiscardedSyms;
   Kext->NumberOfCxxSymbols = NumCxxSymbols;
   Kext->LinkedSymbolTable  = SymbolTable;
 
@@ -488,66 +541,274 @@ InternalFreePrelinkedKext (
   IN PRELINKED_KEXT  *Kext
   )
 {
-  if (Kext->LinkedSymbolTable != NULL) {
-    FreePool (Kext->LinkedSymbolTable);
-    Kext->LinkedSymbolTable = NULL;
+  PatcherFreeContext (&Kext->Context);
+
+  //
+  // Linked data loaded from linked cache is owned by PRELINKED_CONTEXT,
+  // anything built afterwards is still owned by the kext.
+  //
+  if (Kext->LinkedSymbolValueOrder != NULL && !Kext->LinkedValueOrderCached) {
+    FreePool (Kext->LinkedSymbolValueOrder);
+    Kext->LinkedSymbolValueOrder = NULL;
   }
 
-  if (Kext->LinkedVtables != NULL) {
-    FreePool (Kext->LinkedVtables);
-    Kext->LinkedVtables = NULL;
+  if (!Kext->LinkedCached) {
+    if (Kext->LinkedSymbolTable != NULL) {
+      FreePool (Kext->LinkedSymbolTable);
+      Kext->LinkedSymbolTable = NULL;
+    }
+
+    if (Kext->LinkedSymbolHash != NULL) {
+      FreePool (Kext->LinkedSymbolHash);
+      Kext->LinkedSymbolHash = NULL;
+    }
+
+    if (Kext->LinkedVtables != NULL) {
+      FreePool (Kext->LinkedVtables);
+      Kext->LinkedVtables = NULL;
+    }
   }
 
   FreePool (Kext);
 }
 
-PRELINKED_KEXT *
-InternalCachedPrelinkedKext (
-  IN OUT PRELINKED_CONTEXT  *Prelinked,
-  IN     CONST CHAR8        *Identifier
+STATIC
+PRELINKED_KEXT_INDEX_ENTRY *
+InternalFindPrelinkedKextIndexSlot (
+  IN PRELINKED_KEXT_INDEX_ENTRY  *KextIndex,
+  IN UINT32                      KextIndexSize,
+  IN CONST CHAR8                 *Identifier,
+  IN UINT32                      Hash
   )
 {
-  PRELINKED_KEXT  *NewKext;
-  LIST_ENTRY      *Kext;
-  UINT32          Index;
-  UINT32          KextCount;
-  XML_NODE        *KextPlist;
+  UINT32  Slot;
+
+  Slot = Hash & (KextIndexSize - 1);
+  while (KextIndex[Slot].Identifier != NULL) {
+    if (KextIndex[Slot].Hash == Hash && AsciiStrCmp (KextIndex[Slot].Identifier, Identifier) == 0) {
+      break;
+    }
+    Slot = (Slot + 1) & (KextIndexSize - 1);
+  }
+
+  return &KextIndex[Slot];
+}
+
+STATIC
+RETURN_STATUS
+InternalResizePrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             KextIndexSize
+  )
+{
+  PRELINKED_KEXT_INDEX_ENTRY  *KextIndex;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+  UINT32                      Index;
+
+  ASSERT (KextIndexSize > Context->KextIndexCount);
+
+  KextIndex = AllocateZeroPool (KextIndexSize * sizeof (*KextIndex));
+  if (KextIndex == NULL) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  for (Index = 0; Index < Context->KextIndexSize; ++Index) {
+    if (Context->KextIndex[Index].Identifier != NULL) {
+      Entry = InternalFindPrelinkedKextIndexSlot (
+        KextIndex,
+        KextIndexSize,
+        Context->KextIndex[Index].Identifier,
+        Context->KextIndex[Index].Hash
+        );
+      CopyMem (Entry, &Context->KextIndex[Index], sizeof (*Entry));
+    }
+  }
+
+  if (Context->KextIndex != NULL) {
+    FreePool (Context->KextIndex);
+  }
+
+  Context->KextIndex     = KextIndex;
+  Context->KextIndexSize = KextIndexSize;
+
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+InternalReservePrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     UINT32             Count
+  )
+{
+  UINT32  KextIndexSize;
+
+  if (Context->KextIndexCount > MAX_UINT32 / 2 - Count) {
+    return RETURN_OUT_OF_RESOURCES;
+  }
+
+  KextIndexSize = MAX (Context->KextIndexSize, 64);
+  while ((Context->KextIndexCount + Count) * 2 > KextIndexSize) {
+    KextIndexSize *= 2;
+  }
+
+  if (KextIndexSize > Context->KextIndexSize) {
+    return InternalResizePrelinkedKextIndex (Context, KextIndexSize);
+  }
+
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+InternalIndexPrelinkedKext (
+  IN OUT PRELINKED_CONTEXT  *Context,
+  IN     CONST CHAR8        *Identifier,
+  IN     XML_NODE           *KextPlist OPTIONAL,
+  IN     PRELINKED_KEXT     *Kext OPTIONAL
+  )
+{
+  RETURN_STATUS               Status;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+  UINT32                      Hash;
 
   //
-  // Find cached entry if any.
+  // Keep load factor at or below 50%. Should growing fail, we can still
+  // continue with longer probe sequences until the index is full.
   //
-  Kext = GetFirstNode (&Prelinked->PrelinkedKexts);
-  while (!IsNull (&Prelinked->PrelinkedKexts, Kext)) {
-    if (AsciiStrCmp (Identifier, GET_PRELINKED_KEXT_FROM_LINK (Kext)->Identifier) == 0) {
-      return GET_PRELINKED_KEXT_FROM_LINK (Kext);
+  if ((Context->KextIndexCount + 1) * 2 > Context->KextIndexSize) {
+    Status = InternalResizePrelinkedKextIndex (
+      Context,
+      MAX (Context->KextIndexSize * 2, 64)
+      );
+    if (RETURN_ERROR (Status) && Context->KextIndexCount + 1 >= Context->KextIndexSize) {
+      return Status;
     }
+  }
+
+  Hash  = InternalGetSymbolNameHash (Identifier, (UINT32) AsciiStrLen (Identifier));
+  Entry = InternalFindPrelinkedKextIndexSlot (
+    Context->KextIndex,
+    Context->KextIndexSize,
+    Identifier,
+    Hash
+    );
+
+  if (Entry->Identifier == NULL) {
+    Entry->Identifier = Identifier;
+    Entry->Hash       = Hash;
+    Entry->KextPlist  = KextPlist;
+    ++Context->KextIndexCount;
+  }
 
-    Kext = GetNextNode (&Prelinked->PrelinkedKexts, Kext);
+  if (Entry->Kext == NULL) {
+    Entry->Kext = Kext;
   }
 
+  return RETURN_SUCCESS;
+}
+
+RETURN_STATUS
+InternalBuildPrelinkedKextIndex (
+  IN OUT PRELINKED_CONTEXT  *Context
+  )
+{
+  RETURN_STATUS  Status;
+  UINT32         KextIndexSize;
+  UINT32         Index;
+  UINT32         KextCount;
+  XML_NODE       *KextPlist;
+  UINT32         FieldIndex;
+  UINT32         FieldCount;
+  CONST CHAR8    *KextPlistKey;
+  XML_NODE       *KextPlistValue;
+  CONST CHAR8    *KextIdentifier;
+
+  KextCount = XmlNodeChildren (Context->KextList);
+
   //
-  // Try with real entry.
+  // Reserve some space for injected kexts to avoid growing the index.
   //
-  NewKext   = NULL;
-  KextCount = XmlNodeChildren (Prelinked->KextList);
-  for (Index = 0; Index < KextCount; ++Index) {
-    KextPlist = PlistNodeCast (XmlNodeChild (Prelinked->KextList, Index), PLIST_NODE_TYPE_DICT);
+  KextIndexSize = 64;
+  while (KextIndexSize < (KextCount + 64) * 2) {
+    KextIndexSize *= 2;
+  }
 
+  if (KextIndexSize > Context->KextIndexSize) {
+    Status = InternalResizePrelinkedKextIndex (Context, KextIndexSize);
+    if (RETURN_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  for (Index = 0; Index < KextCount; ++Index) {
+    KextPlist = PlistNodeCast (XmlNodeChild (Context->KextList, Index), PLIST_NODE_TYPE_DICT);
     if (KextPlist == NULL) {
       continue;
     }
 
-    NewKext = InternalCreatePrelinkedKext (Prelinked, KextPlist, Identifier);
-    if (NewKext != NULL) {
-      break;
+    KextIdentifier = NULL;
+    FieldCount     = PlistDictChildren (KextPlist);
+    for (FieldIndex = 0; FieldIndex < FieldCount; ++FieldIndex) {
+      KextPlistKey = PlistKeyValue (PlistDictChild (KextPlist, FieldIndex, &KextPlistValue));
+      if (KextPlistKey != NULL && AsciiStrCmp (KextPlistKey, INFO_BUNDLE_IDENTIFIER_KEY) == 0) {
+        if (PlistNodeCast (KextPlistValue, PLIST_NODE_TYPE_STRING) != NULL) {
+          KextIdentifier = XmlNodeContent (KextPlistValue);
+        }
+        break;
+      }
+    }
+
+    if (KextIdentifier != NULL) {
+      Status = InternalIndexPrelinkedKext (Context, KextIdentifier, KextPlist, NULL);
+      if (RETURN_ERROR (Status)) {
+        return Status;
+      }
     }
   }
 
+  return RETURN_SUCCESS;
+}
+
+PRELINKED_KEXT *
+InternalCachedPrelinkedKext (
+  IN OUT PRELINKED_CONTEXT  *Prelinked,
+  IN     CONST CHAR8        *Identifier
+  )
+{
+  PRELINKED_KEXT              *NewKext;
+  PRELINKED_KEXT_INDEX_ENTRY  *Entry;
+
+  if (Prelinked->KextIndex == NULL) {
+    return NULL;
+  }
+
+  Entry = InternalFindPrelinkedKextIndexSlot (
+    Prelinked->KextIndex,
+    Prelinked->KextIndexSize,
+    Identifier,
+    InternalGetSymbolNameHash (Identifier, (UINT32) AsciiStrLen (Identifier))
+    );
+
+  //
+  // Find cached entry if any.
+  //
+  if (Entry->Kext != NULL) {
+    return Entry->Kext;
+  }
+
+  //
+  // Try with real entry.
+  //
+  if (Entry->KextPlist == NULL) {
+    return NULL;
+  }
+
+  NewKext = InternalCreatePrelinkedKext (Prelinked, Entry->KextPlist, Identifier);
   if (NewKext == NULL) {
     return NULL;
   }
 
   InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
+  Entry->Kext = NewKext;
 
   return NewKext;
 }
@@ -598,6 +859,11 @@ InternalCachedPrelinkedKernel (
   NewKext->Context.VirtualBase  = Segment->VirtualAddress - Segment->FileOffset;
   NewKext->Context.VirtualKmod  = 0;
 
+  if (RETURN_ERROR (InternalIndexPrelinkedKext (Prelinked, NewKext->Identifier, NULL, NewKext))) {
+    FreePool (NewKext);
+    return NULL;
+  }
+
   InsertTailList (&Prelinked->PrelinkedKexts, &NewKext->Link);
 
   return NewKext;
@@ -735,11 +1001,21 @@ InternalUnlockContextKexts (
 {
   LIST_ENTRY  *Kext;
 
+  ++Context->KextWalkGeneration;
+  if (Context->KextWalkGeneration != 0) {
+    return;
+  }
+
+  //
+  // Generation wrapped around, so stale values may match again.
+  //
   Kext = GetFirstNode (&Context->PrelinkedKexts);
   while (!IsNull (&Context->PrelinkedKexts, Kext)) {
-    GET_PRELINKED_KEXT_FROM_LINK (Kext)->Processed = FALSE;
+    GET_PRELINKED_KEXT_FROM_LINK (Kext)->Processed = 0;
     Kext = GetNextNode (&Context->PrelinkedKexts, Kext);
   }
+
+  Context->KextWalkGeneration = 1;
 }
 
 PRELINKED_KEXT *
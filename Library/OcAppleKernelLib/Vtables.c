@@ -39,7 +39,7 @@ InternalGetOcVtableByNameWorker (
   PRELINKED_KEXT         *Dependency;
   INTN                   Result;
 
-  Kext->Processed = TRUE;
+  Kext->Processed = Context->KextWalkGeneration;
 
   for (
     Index = 0, Vtable = Kext->LinkedVtables;
@@ -58,7 +58,7 @@ InternalGetOcVtableByNameWorker (
       break;
     }
 
-    if (Dependency->Processed) {
+    if (Dependency->Processed == Context->KextWalkGeneration) {
       continue;
     }
 
@@ -344,7 +344,7 @@ InternalPatchVtableSymbol (
   //       changed for the symbol value is already resolved and nothing but a
   //       VTable Relocation should reference it.
   //
-  InternalSolveSymbolValue64 (ParentEntry->Address, Symbol);
+  InternalSolveSymbolValue64 (MachoContext, ParentEntry->Address, Symbol);
   //
   // The C++ ABI requires that functions be aligned on a 2-byte boundary:
   // http://www.codesourcery.com/public/cxx-abi/abi.html#member-pointers
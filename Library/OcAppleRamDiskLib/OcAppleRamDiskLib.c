@@ -34,11 +34,35 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
   ASSERT ((ExtentTable)->ExtentCount > 0);                                     \
   ASSERT ((ExtentTable)->ExtentCount <= ARRAY_SIZE ((ExtentTable)->Extents))
 
+//
+// Piece size for loading files with a data handler. Pieces are small enough
+// to stay in cache while handled and large enough for efficient file IO.
+//
+#define INTERNAL_LOAD_PIECE_SIZE  BASE_2MB
+
+//
+// Allocation details and cumulative extent offsets of an allocated RAM disk.
+// They are kept in library memory to leave the extent table layout intact.
+// TablePages covers the first extent too when it shares the table allocation.
+//
+typedef struct INTERNAL_EXTENT_INDEX_ INTERNAL_EXTENT_INDEX;
+
+struct INTERNAL_EXTENT_INDEX_ {
+  INTERNAL_EXTENT_INDEX              *Next;
+  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable;
+  UINTN                              TablePages;
+  UINT64                             Offsets[];
+};
+
+STATIC INTERNAL_EXTENT_INDEX *mExtentIndices;
+
 /**
   Insert allocated area into extent list. If no extent list
   was created, then it gets allocated.
 
   @param[in,out]  ExtentTable        Extent table, potentially pointing to NULL.
+  @param[out]     TablePages         Pages allocated with extent table, set
+                                     when the extent table gets allocated.
   @param[in]      AllocatedArea      Allocated area of 1 or more pages.
   @paran[in]      AllocatedAreaSize  Actual size of allocated area in bytes.
 **/
@@ -46,6 +70,7 @@ STATIC
 VOID
 InternalAddAllocatedArea (
   IN OUT APPLE_RAM_DISK_EXTENT_TABLE  **ExtentTable,
+  OUT    UINTN                        *TablePages,
   IN     EFI_PHYSICAL_ADDRESS         AllocatedArea,
   IN     UINTN                        AllocatedAreaSize
   )
@@ -66,6 +91,7 @@ InternalAddAllocatedArea (
     (*ExtentTable)->Version     = APPLE_RAM_DISK_EXTENT_VERSION;
     (*ExtentTable)->Signature2  = APPLE_RAM_DISK_EXTENT_SIGNATURE;
 
+    *TablePages        = EFI_SIZE_TO_PAGES (AllocatedAreaSize);
     AllocatedArea     += EFI_PAGE_SIZE;
     AllocatedAreaSize -= EFI_PAGE_SIZE;
 
@@ -97,6 +123,7 @@ InternalAddAllocatedArea (
   @param[in]     DescriptorSize Current memory map descriptor size.
   @param[in]     RemainingSize  Remaining size to allocate.
   @param[in,out] ExtentTable    Updated pointer to allocated area.
+  @param[in,out] TablePages     Pages allocated with extent table.
 
   @retval Size of allocated data.
 **/
@@ -109,7 +136,8 @@ InternalAllocateRemainingSize (
   IN     UINTN                        MemoryMapSize,
   IN     UINTN                        DescriptorSize,
   IN     UINTN                        RemainingSize,
-  IN OUT APPLE_RAM_DISK_EXTENT_TABLE  **ExtentTable
+  IN OUT APPLE_RAM_DISK_EXTENT_TABLE  **ExtentTable,
+  IN OUT UINTN                        *TablePages
   )
 {
   EFI_STATUS             Status;
@@ -155,7 +183,7 @@ InternalAllocateRemainingSize (
       return FALSE;
     }
 
-    InternalAddAllocatedArea (ExtentTable, AllocatedArea, UsedSize);
+    InternalAddAllocatedArea (ExtentTable, TablePages, AllocatedArea, UsedSize);
 
     RemainingSize -= UsedSize;
 
@@ -166,6 +194,37 @@ InternalAllocateRemainingSize (
   return RemainingSize;
 }
 
+/**
+  Free pages of an allocated extent table and its extents.
+
+  @param[in] ExtentTable  Allocated extent table.
+  @param[in] TablePages   Pages allocated with extent table.
+**/
+STATIC
+VOID
+InternalAppleRamDiskFreePages (
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN UINTN                              TablePages
+  )
+{
+  UINT32 Index;
+
+  //
+  // The first extent was freed with the table when they were allocated
+  // together.
+  //
+  Index = TablePages > 1 ? 1 : 0;
+
+  for (; Index < ExtentTable->ExtentCount; ++Index) {
+    gBS->FreePages (
+      ExtentTable->Extents[Index].Start,
+      EFI_SIZE_TO_PAGES (ExtentTable->Extents[Index].Length)
+      );
+  }
+
+  gBS->FreePages ((UINTN) ExtentTable, TablePages);
+}
+
 /**
   Request allocation of Size bytes in extents table.
   Extents are put to the first allocated page.
@@ -174,18 +233,20 @@ InternalAllocateRemainingSize (
   2. Do allocation at BASE_4GB if requested.
   3. Do additional allocation at any address if still have pages to allocate.
 
-  @param[in] Size           Requested memory size.
-  @param[in] MemoryType     Requested memory type.
-  @param[in] PreferHighMem  Try to allocate in upper 4GB first.
+  @param[in]  Size           Requested memory size.
+  @param[in]  MemoryType     Requested memory type.
+  @param[in]  PreferHighMem  Try to allocate in upper 4GB first.
+  @param[out] TablePages     Pages allocated with extent table.
 
   @retval Allocated extent table.
 **/
 STATIC
 CONST APPLE_RAM_DISK_EXTENT_TABLE *
 InternalAppleRamDiskAllocate (
-  IN UINTN            Size,
-  IN EFI_MEMORY_TYPE  MemoryType,
-  IN BOOLEAN          PreferHighMem
+  IN  UINTN            Size,
+  IN  EFI_MEMORY_TYPE  MemoryType,
+  IN  BOOLEAN          PreferHighMem,
+  OUT UINTN            *TablePages
   )
 {
   UINTN                        MemoryMapSize;
@@ -206,6 +267,7 @@ InternalAppleRamDiskAllocate (
 
   RemainingSize  = Size + EFI_PAGE_SIZE;
   ExtentTable    = NULL;
+  *TablePages    = 0;
 
   //
   // We implement PreferHighMem to avoid colliding with the kernel, which sits
@@ -220,7 +282,8 @@ InternalAppleRamDiskAllocate (
       MemoryMapSize,
       DescriptorSize,
       RemainingSize,
-      &ExtentTable
+      &ExtentTable,
+      TablePages
       );
   }
 
@@ -247,11 +310,12 @@ InternalAppleRamDiskAllocate (
     MemoryMapSize,
     DescriptorSize,
     RemainingSize,
-    &ExtentTable
+    &ExtentTable,
+    TablePages
     );
 
   if (RemainingSize > 0 && ExtentTable != NULL) {
-    OcAppleRamDiskFree (ExtentTable);
+    InternalAppleRamDiskFreePages (ExtentTable, *TablePages);
 
     ExtentTable = NULL;
   }
@@ -259,6 +323,221 @@ InternalAppleRamDiskAllocate (
   return ExtentTable;
 }
 
+/**
+  Register allocation details and cumulative extent offsets of an allocated
+  extent table.
+
+  @param[in] ExtentTable  Allocated extent table.
+  @param[in] TablePages   Pages allocated with extent table.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalRegisterExtentIndex (
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN UINTN                              TablePages
+  )
+{
+  INTERNAL_EXTENT_INDEX  *ExtentIndex;
+  UINT32                 Index;
+
+  ExtentIndex = AllocatePool (
+    sizeof (*ExtentIndex)
+    + (ExtentTable->ExtentCount + 1) * sizeof (ExtentIndex->Offsets[0])
+    );
+  if (ExtentIndex == NULL) {
+    return FALSE;
+  }
+
+  ExtentIndex->ExtentTable = ExtentTable;
+  ExtentIndex->TablePages  = TablePages;
+  ExtentIndex->Offsets[0]  = 0;
+  for (Index = 0; Index < ExtentTable->ExtentCount; ++Index) {
+    ExtentIndex->Offsets[Index + 1] = ExtentIndex->Offsets[Index]
+      + ExtentTable->Extents[Index].Length;
+  }
+
+  ExtentIndex->Next = mExtentIndices;
+  mExtentIndices    = ExtentIndex;
+  return TRUE;
+}
+
+/**
+  Unregister allocation details and cumulative extent offsets of an extent
+  table.
+
+  @param[in]  ExtentTable  Allocated extent table.
+  @param[out] TablePages   Pages allocated with extent table.
+
+  @retval TRUE when the extent table was registered.
+**/
+STATIC
+BOOLEAN
+InternalUnregisterExtentIndex (
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  OUT UINTN                              *TablePages
+  )
+{
+  INTERNAL_EXTENT_INDEX  **Walker;
+  INTERNAL_EXTENT_INDEX  *ExtentIndex;
+
+  for (Walker = &mExtentIndices; *Walker != NULL; Walker = &(*Walker)->Next) {
+    ExtentIndex = *Walker;
+    if (ExtentIndex->ExtentTable == ExtentTable) {
+      *Walker     = ExtentIndex->Next;
+      *TablePages = ExtentIndex->TablePages;
+      FreePool (ExtentIndex);
+      return TRUE;
+    }
+  }
+
+  return FALSE;
+}
+
+/**
+  Get cumulative extent offsets of an extent table. Offsets of tables not
+  allocated by this library are calculated into Scratch.
+
+  @param[in]  ExtentTable  Extent table.
+  @param[out] Scratch      Buffer for ExtentCount + 1 offsets.
+
+  @retval Cumulative extent offsets, ending with RAM disk size.
+  @retval NULL for malformed extent tables.
+**/
+STATIC
+CONST UINT64 *
+InternalGetExtentOffsets (
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  OUT UINT64                             *Scratch
+  )
+{
+  INTERNAL_EXTENT_INDEX  *ExtentIndex;
+  UINT32                 Index;
+
+  for (ExtentIndex = mExtentIndices; ExtentIndex != NULL; ExtentIndex = ExtentIndex->Next) {
+    if (ExtentIndex->ExtentTable == ExtentTable) {
+      return ExtentIndex->Offsets;
+    }
+  }
+
+  if (ExtentTable->ExtentCount > ARRAY_SIZE (ExtentTable->Extents)) {
+    return NULL;
+  }
+
+  Scratch[0] = 0;
+  for (Index = 0; Index < ExtentTable->ExtentCount; ++Index) {
+    Scratch[Index + 1] = Scratch[Index] + ExtentTable->Extents[Index].Length;
+  }
+
+  return Scratch;
+}
+
+/**
+  Find the extent containing Offset by binary search.
+
+  @param[in]  ExtentTable  Extent table.
+  @param[in]  Offsets      Cumulative extent offsets.
+  @param[in]  Offset       Offset in RAM disk.
+  @param[out] Index        Extent index.
+
+  @retval TRUE when Offset is within RAM disk.
+**/
+STATIC
+BOOLEAN
+InternalFindExtent (
+  IN  CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN  CONST UINT64                       *Offsets,
+  IN  UINT64                             Offset,
+  OUT UINT32                             *Index
+  )
+{
+  UINT32  Start;
+  UINT32  End;
+  UINT32  Middle;
+
+  if (Offset >= Offsets[ExtentTable->ExtentCount]) {
+    return FALSE;
+  }
+
+  //
+  // Find the last extent starting at or below Offset, this skips empty extents.
+  //
+  Start = 0;
+  End   = ExtentTable->ExtentCount;
+  while (End - Start > 1) {
+    Middle = Start + (End - Start) / 2;
+    if (Offsets[Middle] <= Offset) {
+      Start = Middle;
+    } else {
+      End = Middle;
+    }
+  }
+
+  *Index = Start;
+  return TRUE;
+}
+
+/**
+  Copy data between RAM disk and Buffer.
+
+  @param[in]     ExtentTable  Allocated extent table.
+  @param[in]     Offset       Offset in RAM disk.
+  @param[in]     Size         Amount of data to copy.
+  @param[in,out] Buffer       Data buffer.
+  @param[in]     Write        Copy from Buffer to RAM disk.
+
+  @retval TRUE on success.
+**/
+STATIC
+BOOLEAN
+InternalCopyRamDisk (
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     UINT64                             Offset,
+  IN     UINTN                              Size,
+  IN OUT UINT8                              *Buffer,
+  IN     BOOLEAN                            Write
+  )
+{
+  UINT64                      Scratch[ARRAY_SIZE (ExtentTable->Extents) + 1];
+  CONST UINT64                *Offsets;
+  UINT32                      Index;
+  CONST APPLE_RAM_DISK_EXTENT *Extent;
+  UINT64                      LocalOffset;
+  UINTN                       LocalSize;
+
+  Offsets = InternalGetExtentOffsets (ExtentTable, Scratch);
+
+  if ((Offsets == NULL)
+    || !InternalFindExtent (ExtentTable, Offsets, Offset, &Index)) {
+    return FALSE;
+  }
+
+  LocalOffset = Offset - Offsets[Index];
+
+  while (Index < ExtentTable->ExtentCount) {
+    Extent    = &ExtentTable->Extents[Index];
+    LocalSize = (UINTN)MIN ((Extent->Length - LocalOffset), Size);
+
+    if (Write) {
+      CopyMem ((VOID *)((UINTN)Extent->Start + LocalOffset), Buffer, LocalSize);
+    } else {
+      CopyMem (Buffer, (VOID *)((UINTN)Extent->Start + LocalOffset), LocalSize);
+    }
+
+    Size -= LocalSize;
+    if (Size == 0) {
+      return TRUE;
+    }
+
+    Buffer     += LocalSize;
+    LocalOffset = 0;
+    ++Index;
+  }
+
+  return FALSE;
+}
+
 CONST APPLE_RAM_DISK_EXTENT_TABLE *
 OcAppleRamDiskAllocate (
   IN UINTN            Size,
@@ -266,17 +545,23 @@ OcAppleRamDiskAllocate (
   )
 {
   CONST APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable;
+  UINTN                             TablePages;
 
   //
   // Try to allocate preferrably above BASE_4GB to avoid colliding with the kernel.
   //
-  ExtentTable = InternalAppleRamDiskAllocate (Size, MemoryType, TRUE);
+  ExtentTable = InternalAppleRamDiskAllocate (Size, MemoryType, TRUE, &TablePages);
   if (ExtentTable == NULL) {
     //
     // Being here means that we exceeded entry amount in the extent table.
     // Retry with any addresses. Should never happen in reality.
     //
-    ExtentTable = InternalAppleRamDiskAllocate (Size, MemoryType, FALSE);
+    ExtentTable = InternalAppleRamDiskAllocate (Size, MemoryType, FALSE, &TablePages);
+  }
+
+  if (ExtentTable != NULL && !InternalRegisterExtentIndex (ExtentTable, TablePages)) {
+    InternalAppleRamDiskFreePages (ExtentTable, TablePages);
+    ExtentTable = NULL;
   }
 
   return ExtentTable;
@@ -290,49 +575,12 @@ OcAppleRamDiskRead (
   OUT VOID                               *Buffer
   )
 {
-  UINT8                       *BufferBytes;
-
-  UINT32                      Index;
-  CONST APPLE_RAM_DISK_EXTENT *Extent;
-
-  UINT64                      CurrentOffset;
-  UINT64                      LocalOffset;
-  UINTN                       LocalSize;
-
   ASSERT (ExtentTable != NULL);
   INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
   ASSERT (Size > 0);
   ASSERT (Buffer != NULL);
 
-  BufferBytes = Buffer;
-
-  for (
-    Index = 0, CurrentOffset = 0;
-    Index < ExtentTable->ExtentCount;
-    ++Index, CurrentOffset += Extent->Length
-    ) {
-    Extent = &ExtentTable->Extents[Index];
-
-    if (Offset >= CurrentOffset) {
-      LocalOffset = (Offset - CurrentOffset);
-      LocalSize   = (UINTN)MIN ((Extent->Length - LocalOffset), Size);
-      CopyMem (
-        BufferBytes,
-        (VOID *)((UINTN)Extent->Start + LocalOffset),
-        LocalSize
-        );
-
-      Size -= LocalSize;
-      if (Size == 0) {
-        return TRUE;
-      }
-
-      BufferBytes += LocalSize;
-      Offset      += LocalSize;
-    }
-  }
-
-  return FALSE;
+  return InternalCopyRamDisk (ExtentTable, Offset, Size, Buffer, FALSE);
 }
 
 BOOLEAN
@@ -343,93 +591,247 @@ OcAppleRamDiskWrite (
   IN CONST VOID                         *Buffer
   )
 {
-  CONST UINT8                 *BufferBytes;
+  ASSERT (ExtentTable != NULL);
+  INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
+  ASSERT (Size > 0);
+  ASSERT (Buffer != NULL);
+
+  return InternalCopyRamDisk (ExtentTable, Offset, Size, (UINT8 *) Buffer, TRUE);
+}
 
+VOID *
+OcAppleRamDiskGetSpan (
+  IN     CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN     UINT64                             Offset,
+  IN OUT UINTN                              *Size
+  )
+{
+  UINT64                      Scratch[ARRAY_SIZE (ExtentTable->Extents) + 1];
+  CONST UINT64                *Offsets;
   UINT32                      Index;
   CONST APPLE_RAM_DISK_EXTENT *Extent;
-
-  UINT64                      CurrentOffset;
   UINT64                      LocalOffset;
-  UINTN                       LocalSize;
 
   ASSERT (ExtentTable != NULL);
   INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
-  ASSERT (Size > 0);
-  ASSERT (Buffer != NULL);
+  ASSERT (Size != NULL);
+  ASSERT (*Size > 0);
 
-  BufferBytes = Buffer;
-
-  for (
-    Index = 0, CurrentOffset = 0;
-    Index < ExtentTable->ExtentCount;
-    ++Index, CurrentOffset += Extent->Length
-    ) {
-    Extent = &ExtentTable->Extents[Index];
-
-    if (Offset >= CurrentOffset) {
-      LocalOffset = (Offset - CurrentOffset);
-      LocalSize   = (UINTN)MIN ((Extent->Length - LocalOffset), Size);
-      CopyMem (
-        (VOID *)((UINTN)Extent->Start + LocalOffset),
-        BufferBytes,
-        LocalSize
-        );
+  Offsets = InternalGetExtentOffsets (ExtentTable, Scratch);
 
-      Size -= LocalSize;
-      if (Size == 0) {
-        return TRUE;
-      }
+  if ((Offsets == NULL)
+    || !InternalFindExtent (ExtentTable, Offsets, Offset, &Index)) {
+    return NULL;
+  }
+
+  Extent      = &ExtentTable->Extents[Index];
+  LocalOffset = Offset - Offsets[Index];
+  *Size       = (UINTN)MIN ((Extent->Length - LocalOffset), *Size);
+
+  return (VOID *)((UINTN)Extent->Start + LocalOffset);
+}
+
+/**
+  Start reading the next piece of file into Token buffer. The read is queued
+  when Token has an event, and completes immediately otherwise.
+
+  @param[in]     File    File protocol open for reading.
+  @param[in,out] Token   File IO token.
+  @param[in]     Buffer  Destination buffer.
+  @param[in]     Size    Amount of data to read.
+
+  @retval EFI_SUCCESS when the read was started or completed.
+**/
+STATIC
+EFI_STATUS
+InternalStartRead (
+  IN     EFI_FILE_PROTOCOL  *File,
+  IN OUT EFI_FILE_IO_TOKEN  *Token,
+  IN     VOID               *Buffer,
+  IN     UINTN              Size
+  )
+{
+  EFI_STATUS  Status;
+
+  Token->Status     = EFI_NOT_READY;
+  Token->BufferSize = Size;
+  Token->Buffer     = Buffer;
 
-      BufferBytes += LocalSize;
-      Offset      += LocalSize;
+  if (Token->Event != NULL) {
+    Status = File->ReadEx (File, Token);
+    if (Status != EFI_UNSUPPORTED) {
+      return Status;
     }
+
+    //
+    // Some file systems report revision 2 without implementing ReadEx.
+    //
+    gBS->CloseEvent (Token->Event);
+    Token->Event = NULL;
   }
 
-  return FALSE;
+  Token->Status = File->Read (File, &Token->BufferSize, Buffer);
+  return EFI_SUCCESS;
+}
+
+/**
+  Wait for the read started by InternalStartRead to complete.
+
+  @param[in,out] Token   File IO token.
+
+  @retval Read status.
+**/
+STATIC
+EFI_STATUS
+InternalFinishRead (
+  IN OUT EFI_FILE_IO_TOKEN  *Token
+  )
+{
+  EFI_STATUS  Status;
+  UINTN       EventIndex;
+
+  if (Token->Event != NULL) {
+    Status = gBS->WaitForEvent (1, &Token->Event, &EventIndex);
+    if (EFI_ERROR (Status)) {
+      return Status;
+    }
+  }
+
+  return Token->Status;
 }
 
 BOOLEAN
-OcAppleRamDiskLoadFile (
+OcAppleRamDiskLoadFileEx (
   IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
   IN EFI_FILE_PROTOCOL                  *File,
-  IN UINTN                              FileSize
+  IN UINTN                              FileSize,
+  IN OC_APPLE_RAM_DISK_LOAD_HANDLER     Handler  OPTIONAL,
+  IN VOID                               *HandlerContext  OPTIONAL
   )
 {
-  EFI_STATUS Status;
-  UINT64     FilePosition;
-  UINT32     Index;
-  UINTN      RequestedSize;
-  UINTN      ReadSize;
+  EFI_STATUS        Status;
+  BOOLEAN           Result;
+  EFI_FILE_IO_TOKEN Token;
+  UINT32            Index;
+  UINTN             ExtentOffset;
+  UINTN             PieceSize;
+  UINTN             ReadSize;
+  UINT8             *ReadBuffer;
+  UINTN             LoadedSize;
+  UINT8             *LoadedBuffer;
 
   ASSERT (ExtentTable != NULL);
   INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
   ASSERT (File != NULL);
   ASSERT (FileSize > 0);
 
-  FilePosition = 0;
-
-  Status = File->SetPosition (File, FilePosition);
+  Status = File->SetPosition (File, 0);
   if (EFI_ERROR (Status)) {
     return FALSE;
   }
 
-  for (Index = 0; FileSize > 0 && Index < ExtentTable->ExtentCount; ++Index) {
-    RequestedSize = ReadSize = MIN (FileSize, ExtentTable->Extents[Index].Length);
+  //
+  // Without a handler there is nothing to overlap, read whole extents.
+  //
+  PieceSize   = MAX_UINTN;
+  Token.Event = NULL;
+
+  if (Handler != NULL) {
+    PieceSize = INTERNAL_LOAD_PIECE_SIZE;
+
+    if (File->Revision >= EFI_FILE_PROTOCOL_REVISION2) {
+      Status = gBS->CreateEvent (0, TPL_CALLBACK, NULL, NULL, &Token.Event);
+      if (EFI_ERROR (Status)) {
+        Token.Event = NULL;
+      }
+    }
+  }
+
+  Result       = TRUE;
+  Index        = 0;
+  ExtentOffset = 0;
+  LoadedSize   = 0;
+  LoadedBuffer = NULL;
+  ReadSize     = 0;
+  ReadBuffer   = NULL;
+
+  while (FileSize > 0 || LoadedSize > 0) {
+    if (FileSize > 0) {
+      while (Index < ExtentTable->ExtentCount
+        && ExtentOffset == ExtentTable->Extents[Index].Length) {
+        ++Index;
+        ExtentOffset = 0;
+      }
 
-    Status = File->Read (
-      File,
-      &RequestedSize,
-      (VOID *) ExtentTable->Extents[Index].Start
-      );
+      if (Index == ExtentTable->ExtentCount) {
+        Result = FALSE;
+        break;
+      }
 
-    if (EFI_ERROR (Status) || RequestedSize != ReadSize) {
-      return FALSE;
+      ReadSize   = (UINTN) MIN (
+        ExtentTable->Extents[Index].Length - ExtentOffset,
+        MIN (FileSize, PieceSize)
+        );
+      ReadBuffer = (UINT8 *)(UINTN) ExtentTable->Extents[Index].Start
+        + ExtentOffset;
+
+      Status = InternalStartRead (File, &Token, ReadBuffer, ReadSize);
+      if (EFI_ERROR (Status)) {
+        Result = FALSE;
+        break;
+      }
+    }
+
+    //
+    // Process previous piece while the next one is being read.
+    //
+    if (LoadedSize > 0) {
+      Handler (HandlerContext, LoadedBuffer, LoadedSize);
+      LoadedSize = 0;
+    }
+
+    if (FileSize == 0) {
+      break;
+    }
+
+    Status = InternalFinishRead (&Token);
+    if (EFI_ERROR (Status) || Token.BufferSize != ReadSize) {
+      Result = FALSE;
+      break;
     }
 
-    FileSize -= RequestedSize;
+    FileSize     -= ReadSize;
+    ExtentOffset += ReadSize;
+
+    //
+    // Synchronous reads have nothing to overlap with, so handle the piece
+    // while it is still in cache.
+    //
+    if (Handler != NULL) {
+      if (Token.Event == NULL) {
+        Handler (HandlerContext, ReadBuffer, ReadSize);
+      } else {
+        LoadedBuffer = ReadBuffer;
+        LoadedSize   = ReadSize;
+      }
+    }
   }
 
-  return TRUE;
+  if (Token.Event != NULL) {
+    gBS->CloseEvent (Token.Event);
+  }
+
+  return Result;
+}
+
+BOOLEAN
+OcAppleRamDiskLoadFile (
+  IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable,
+  IN EFI_FILE_PROTOCOL                  *File,
+  IN UINTN                              FileSize
+  )
+{
+  return OcAppleRamDiskLoadFileEx (ExtentTable, File, FileSize, NULL, NULL);
 }
 
 VOID
@@ -437,23 +839,20 @@ OcAppleRamDiskFree (
   IN CONST APPLE_RAM_DISK_EXTENT_TABLE  *ExtentTable
   )
 {
-  UINT32 Index;
+  BOOLEAN Result;
+  UINTN   TablePages;
 
   ASSERT (ExtentTable != NULL);
   INTERNAL_ASSERT_EXTENT_TABLE_VALID (ExtentTable);
 
   //
-  // Extents are allocated in the first page.
+  // Only tables allocated by this library can be freed.
   //
-  for (Index = 1; Index < ExtentTable->ExtentCount; ++Index) {
-    gBS->FreePages (
-      ExtentTable->Extents[Index].Start,
-      EFI_SIZE_TO_PAGES (ExtentTable->Extents[Index].Length)
-      );
+  Result = InternalUnregisterExtentIndex (ExtentTable, &TablePages);
+  ASSERT (Result);
+  if (!Result) {
+    return;
   }
 
-  gBS->FreePages (
-    (UINTN) ExtentTable,
-    EFI_SIZE_TO_PAGES (ExtentTable->Extents[Index].Length) + 1
-    );
+  InternalAppleRamDiskFreePages (ExtentTable, TablePages);
 }
@@ -67,6 +67,65 @@ InternalGetAppleDiskLabel (
   return UnicodeDiskLabel;
 }
 
+STATIC
+CHAR16 *
+GetAppleRecoveryNameFromVersion (
+  IN CONST CHAR8  *Version
+  )
+{
+  CHAR16              *RecoveryName;
+  UINTN               RecoveryNameSize;
+
+  RecoveryNameSize = L_STR_SIZE(L"Recovery ") + AsciiStrLen (Version) * sizeof (CHAR16);
+  RecoveryName = AllocatePool (RecoveryNameSize);
+  if (RecoveryName != NULL) {
+    UnicodeSPrint (RecoveryName, RecoveryNameSize, L"Recovery %a", Version);
+    UnicodeFilterString (RecoveryName, TRUE);
+  }
+
+  return RecoveryName;
+}
+
+STATIC
+CHAR16 *
+GetAppleRecoveryNameFromBplist (
+  IN CONST UINT8  *SystemVersionData,
+  IN UINT32       SystemVersionDataSize
+  )
+{
+  BPLIST_DOCUMENT     *Document;
+  BPLIST_NODE         CurrentValue;
+  CHAR8               *Version;
+  UINT32              VersionSize;
+  CHAR16              *RecoveryName;
+
+  Document = BplistDocumentParse (SystemVersionData, SystemVersionDataSize);
+
+  if (Document == NULL) {
+    return NULL;
+  }
+
+  RecoveryName = NULL;
+
+  CurrentValue = BplistDictFind (
+    Document,
+    BplistNodeCast (Document, BplistDocumentRoot (Document), PLIST_NODE_TYPE_DICT),
+    "ProductUserVisibleVersion"
+    );
+
+  if (BplistStringSize (Document, CurrentValue, &VersionSize)) {
+    Version = AllocatePool (VersionSize);
+    if (Version != NULL) {
+      BplistStringValue (Document, CurrentValue, Version, &VersionSize);
+      RecoveryName = GetAppleRecoveryNameFromVersion (Version);
+      FreePool (Version);
+    }
+  }
+
+  BplistDocumentFree (Document);
+  return RecoveryName;
+}
+
 STATIC
 CHAR16 *
 GetAppleRecoveryNameFromPlist (
@@ -76,13 +135,13 @@ GetAppleRecoveryNameFromPlist (
 {
   XML_DOCUMENT        *Document;
   XML_NODE            *RootDict;
-  UINT32              DictSize;
-  UINT32              Index;
-  CONST CHAR8         *CurrentKey;
   XML_NODE            *CurrentValue;
   CONST CHAR8         *Version;
   CHAR16              *RecoveryName;
-  UINTN               RecoveryNameSize;
+
+  if (BplistIsBinary (SystemVersionData, SystemVersionDataSize)) {
+    return GetAppleRecoveryNameFromBplist ((CONST UINT8 *) SystemVersionData, SystemVersionDataSize);
+  }
 
   Document = XmlDocumentParse (SystemVersionData, SystemVersionDataSize, FALSE);
 
@@ -99,27 +158,13 @@ GetAppleRecoveryNameFromPlist (
 
   RecoveryName = NULL;
 
-  DictSize = PlistDictChildren (RootDict);
-  for (Index = 0; Index < DictSize; Index++) {
-    CurrentKey = PlistKeyValue (PlistDictChild (RootDict, Index, &CurrentValue));
+  CurrentValue = PlistDictFind (RootDict, "ProductUserVisibleVersion");
 
-    if (CurrentKey == NULL || AsciiStrCmp (CurrentKey, "ProductUserVisibleVersion") != 0) {
-      continue;
+  if (PlistNodeCast (CurrentValue, PLIST_NODE_TYPE_STRING) != NULL) {
+    Version = XmlNodeContent (CurrentValue);
+    if (Version != NULL) {
+      RecoveryName = GetAppleRecoveryNameFromVersion (Version);
     }
-
-    if (PlistNodeCast (CurrentValue, PLIST_NODE_TYPE_STRING) != NULL) {
-      Version = XmlNodeContent (CurrentValue);
-      if (Version != NULL) {
-        RecoveryNameSize = L_STR_SIZE(L"Recovery ") + AsciiStrLen (Version) * sizeof (CHAR16);
-        RecoveryName = AllocatePool (RecoveryNameSize);
-        if (RecoveryName != NULL) {
-          UnicodeSPrint (RecoveryName, RecoveryNameSize, L"Recovery %a", Version);
-          UnicodeFilterString (RecoveryName, TRUE);
-        }
-      }
-    }
-
-    break;
   }
 
   XmlDocumentFree (Document);
@@ -108,38 +108,32 @@ InternalGetFirstDeviceBootFilePath (
 }
 
 STATIC
-EFI_DEVICE_PATH_PROTOCOL *
-InternalGetDiskImageBootFile (
-  OUT INTERNAL_DMG_LOAD_CONTEXT   *Context,
-  IN  APPLE_BOOT_POLICY_PROTOCOL  *BootPolicy,
+BOOLEAN
+InternalInitDmgChunklist (
   IN  UINT32                      Policy,
-  IN  UINTN                       DmgFileSize,
   IN  VOID                        *ChunklistBuffer OPTIONAL,
-  IN  UINT32                      ChunklistBufferSize OPTIONAL
+  IN  UINT32                      ChunklistBufferSize OPTIONAL,
+  OUT OC_APPLE_CHUNKLIST_CONTEXT  *ChunklistContext,
+  OUT BOOLEAN                     *VerifyData
   )
 {
-  EFI_DEVICE_PATH_PROTOCOL       *DevPath;
-
   BOOLEAN                        Result;
-  OC_APPLE_CHUNKLIST_CONTEXT     ChunklistContext;
 
-  CONST EFI_DEVICE_PATH_PROTOCOL *DmgDevicePath;
-  UINTN                          DmgDevicePathSize;
+  ASSERT (ChunklistContext != NULL);
+  ASSERT (VerifyData != NULL);
 
-  ASSERT (Context != NULL);
-  ASSERT (BootPolicy != NULL);
-  ASSERT (DmgFileSize > 0);
+  *VerifyData = FALSE;
 
   if (ChunklistBuffer == NULL) {
     if ((Policy & OC_LOAD_REQUIRE_APPLE_SIGN) != 0) {
       DEBUG ((DEBUG_WARN, "Missing DMG signature, aborting.\n"));
-      return NULL;
+      return FALSE;
     }
   } else if ((Policy & (OC_LOAD_VERIFY_APPLE_SIGN | OC_LOAD_REQUIRE_TRUSTED_KEY)) != 0) {
     ASSERT (ChunklistBufferSize > 0);
 
     Result = OcAppleChunklistInitializeContext (
-                &ChunklistContext,
+                ChunklistContext,
                 ChunklistBuffer,
                 ChunklistBufferSize
                 );
@@ -148,7 +142,7 @@ InternalGetDiskImageBootFile (
         DEBUG_INFO,
         "OCB: Failed to initialise DMG Chunklist context.\n"
         ));
-      return NULL;
+      return FALSE;
     }
 
     if ((Policy & OC_LOAD_REQUIRE_TRUSTED_KEY) != 0) {
@@ -158,38 +152,47 @@ InternalGetDiskImageBootFile (
       //
       if ((Policy & OC_LOAD_TRUST_APPLE_V1_KEY) != 0) {
         Result = OcAppleChunklistVerifySignature (
-                   &ChunklistContext,
+                   ChunklistContext,
                    (RSA_PUBLIC_KEY *)&PkDataBase[0].PublicKey
                    );
       }
 
       if (!Result && ((Policy & OC_LOAD_TRUST_APPLE_V2_KEY) != 0)) {
         Result = OcAppleChunklistVerifySignature (
-                   &ChunklistContext,
+                   ChunklistContext,
                    (RSA_PUBLIC_KEY *)&PkDataBase[1].PublicKey
                    );
       }
 
       if (!Result) {
         DEBUG ((DEBUG_WARN, "DMG is not trusted, aborting.\n"));
-        return NULL;
+        return FALSE;
       }
     }
 
-    Result = OcAppleDiskImageVerifyData (
-               Context->DmgContext,
-               &ChunklistContext
-               );
-    if (!Result) {
-      DEBUG ((DEBUG_WARN, "DMG has been altered.\n"));
-      //
-      // FIXME: Warn user instead of aborting when OC_LOAD_REQUIRE_TRUSTED_KEY
-      //        is not set.
-      //
-      return NULL;
-    }
+    *VerifyData = TRUE;
   }
 
+  return TRUE;
+}
+
+STATIC
+EFI_DEVICE_PATH_PROTOCOL *
+InternalGetDiskImageBootFile (
+  OUT INTERNAL_DMG_LOAD_CONTEXT   *Context,
+  IN  APPLE_BOOT_POLICY_PROTOCOL  *BootPolicy,
+  IN  UINTN                       DmgFileSize
+  )
+{
+  EFI_DEVICE_PATH_PROTOCOL       *DevPath;
+
+  CONST EFI_DEVICE_PATH_PROTOCOL *DmgDevicePath;
+  UINTN                          DmgDevicePathSize;
+
+  ASSERT (Context != NULL);
+  ASSERT (BootPolicy != NULL);
+  ASSERT (DmgFileSize > 0);
+
   Context->BlockIoHandle = OcAppleDiskImageInstallBlockIo (
                              Context->DmgContext,
                              DmgFileSize,
@@ -323,22 +326,24 @@ InternalLoadDmg (
   IN     UINT32                      Policy
   )
 {
-  EFI_DEVICE_PATH_PROTOCOL *DevPath;
+  EFI_DEVICE_PATH_PROTOCOL   *DevPath;
 
-  EFI_STATUS               Status;
-  BOOLEAN                  Result;
+  EFI_STATUS                 Status;
+  BOOLEAN                    Result;
 
-  EFI_FILE_PROTOCOL        *DmgDir;
+  EFI_FILE_PROTOCOL          *DmgDir;
 
-  UINTN                    DmgFileNameLen;
-  EFI_FILE_INFO            *DmgFileInfo;
-  EFI_FILE_PROTOCOL        *DmgFile;
-  UINT32                   DmgFileSize;
+  UINTN                      DmgFileNameLen;
+  EFI_FILE_INFO              *DmgFileInfo;
+  EFI_FILE_PROTOCOL          *DmgFile;
+  UINT32                     DmgFileSize;
 
-  EFI_FILE_INFO            *ChunklistFileInfo;
-  EFI_FILE_PROTOCOL        *ChunklistFile;
-  UINT32                   ChunklistFileSize;
-  VOID                     *ChunklistBuffer;
+  EFI_FILE_INFO              *ChunklistFileInfo;
+  EFI_FILE_PROTOCOL          *ChunklistFile;
+  UINT32                     ChunklistFileSize;
+  VOID                       *ChunklistBuffer;
+  OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
+  BOOLEAN                    VerifyData;
 
   CHAR16 *DevPathText;
 
@@ -374,6 +379,65 @@ InternalLoadDmg (
     return NULL;
   }
 
+  //
+  // Chunklist is read first so that the DMG is verified while being loaded.
+  //
+  ChunklistBuffer   = NULL;
+  ChunklistFileSize = 0;
+
+  ChunklistFileInfo = InternalFindDmgChunklist (
+                        DmgDir,
+                        DmgFileInfo->FileName,
+                        DmgFileNameLen
+                        );
+  if (ChunklistFileInfo != NULL) {
+    Status = DmgDir->Open (
+                       DmgDir,
+                       &ChunklistFile,
+                       ChunklistFileInfo->FileName,
+                       EFI_FILE_MODE_READ,
+                       0
+                       );
+    if (!EFI_ERROR (Status)) {
+      Status = GetFileSize (ChunklistFile, &ChunklistFileSize);
+      if (Status == EFI_SUCCESS) {
+        ChunklistBuffer = AllocatePool (ChunklistFileSize);
+
+        if (ChunklistBuffer == NULL) {
+          ChunklistFileSize = 0;
+        } else {
+          Status = GetFileData (ChunklistFile, 0, ChunklistFileSize, ChunklistBuffer);
+          if (EFI_ERROR (Status)) {
+            FreePool (ChunklistBuffer);
+            ChunklistBuffer   = NULL;
+            ChunklistFileSize = 0;
+          }
+        }
+      }
+
+      ChunklistFile->Close (ChunklistFile);
+    }
+
+    FreePool (ChunklistFileInfo);
+  }
+
+  Result = InternalInitDmgChunklist (
+             Policy,
+             ChunklistBuffer,
+             ChunklistFileSize,
+             &ChunklistContext,
+             &VerifyData
+             );
+  if (!Result) {
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
+
+    FreePool (DmgFileInfo);
+    DmgDir->Close (DmgDir);
+    return NULL;
+  }
+
   Status = DmgDir->Open (
                      DmgDir,
                      &DmgFile,
@@ -388,9 +452,16 @@ InternalLoadDmg (
       DmgFileInfo->FileName,
       Status
       ));
+  }
+
+  FreePool (DmgFileInfo);
+  DmgDir->Close (DmgDir);
+
+  if (EFI_ERROR (Status)) {
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
 
-    FreePool (DmgFileInfo);
-    DmgDir->Close (DmgDir);
     return NULL;
   }
 
@@ -402,8 +473,10 @@ InternalLoadDmg (
       Status
       ));
 
-    FreePool (DmgFileInfo);
-    DmgDir->Close (DmgDir);
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
+
     DmgFile->Close (DmgFile);
     return NULL;
   }
@@ -411,72 +484,42 @@ InternalLoadDmg (
   Context->DmgContext = AllocatePool (sizeof (*Context->DmgContext));
   if (Context->DmgContext == NULL) {
     DEBUG ((DEBUG_INFO, "OCB: Failed to allocate DMG context.\n"));
+
+    if (ChunklistBuffer != NULL) {
+      FreePool (ChunklistBuffer);
+    }
+
+    DmgFile->Close (DmgFile);
     return NULL;
   }
 
-  Result = OcAppleDiskImageInitializeFromFile (Context->DmgContext, DmgFile);
+  //
+  // FIXME: Warn user instead of aborting on altered DMG when
+  //        OC_LOAD_REQUIRE_TRUSTED_KEY is not set.
+  //
+  Result = OcAppleDiskImageInitializeFromFile (
+             Context->DmgContext,
+             DmgFile,
+             VerifyData ? &ChunklistContext : NULL
+             );
 
   DmgFile->Close (DmgFile);
 
+  if (ChunklistBuffer != NULL) {
+    FreePool (ChunklistBuffer);
+  }
+
   if (!Result) {
     DEBUG ((DEBUG_INFO, "OCB: Failed to initialise DMG from file.\n"));
 
-    FreePool (DmgFileInfo);
     FreePool (Context->DmgContext);
-    DmgDir->Close (DmgDir);
     return NULL;
   }
 
-  ChunklistBuffer   = NULL;
-  ChunklistFileSize = 0;
-
-  ChunklistFileInfo = InternalFindDmgChunklist (
-                        DmgDir,
-                        DmgFileInfo->FileName,
-                        DmgFileNameLen
-                        );
-  if (ChunklistFileInfo != NULL) {
-    Status = DmgDir->Open (
-                       DmgDir,
-                       &ChunklistFile,
-                       ChunklistFileInfo->FileName,
-                       EFI_FILE_MODE_READ,
-                       0
-                       );
-    if (!EFI_ERROR (Status)) {
-      Status = GetFileSize (ChunklistFile, &ChunklistFileSize);
-      if (Status == EFI_SUCCESS) {
-        ChunklistBuffer = AllocatePool (ChunklistFileSize);
-
-        if (ChunklistBuffer == NULL) {
-          ChunklistFileSize = 0;
-        } else {
-          Status = GetFileData (ChunklistFile, 0, ChunklistFileSize, ChunklistBuffer);
-          if (EFI_ERROR (Status)) {
-            FreePool (ChunklistBuffer);
-            ChunklistBuffer   = NULL;
-            ChunklistFileSize = 0;
-          }
-        }
-      }
-
-      ChunklistFile->Close (ChunklistFile);
-    }
-
-    FreePool (ChunklistFileInfo);
-  }
-
-  FreePool (DmgFileInfo);
-
-  DmgDir->Close (DmgDir);
-
   DevPath = InternalGetDiskImageBootFile (
               Context,
               BootPolicy,
-              Policy,
-              DmgFileSize,
-              ChunklistBuffer,
-              ChunklistFileSize
+              DmgFileSize
               );
   Context->DevicePath = DevPath;
 
@@ -487,10 +530,6 @@ InternalLoadDmg (
     FreePool (Context->DmgContext);
   }
 
-  if (ChunklistBuffer != NULL) {
-    FreePool (ChunklistBuffer);
-  }
-
   return DevPath;
 }
 
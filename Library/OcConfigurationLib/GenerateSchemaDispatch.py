@@ -0,0 +1,97 @@
+#!/usr/bin/env python3
+
+#
+# Copyright (C) 2019, vit9696. All rights reserved.
+#
+# This program and the accompanying materials
+# are licensed and made available under the terms and conditions of the BSD License
+# which accompanies this distribution.  The full text of the license may be found at
+# http://opensource.org/licenses/bsd-license.php
+#
+# THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+# WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+#
+
+"""
+Generates OC_SCHEMA_DISPATCH perfect hash tables for every dictionary schema
+list in OcConfigurationLib.c.  Rerun after changing schema names:
+
+  ./GenerateSchemaDispatch.py > OcConfigurationDispatch.h
+"""
+
+import os
+import re
+import sys
+
+MAX_BITS = 10
+MAX_SEED = 0x10000
+MASK32 = 0xFFFFFFFF
+
+
+def schema_hash(name, seed):
+    """Must match InternalSchemaHash in OcSerializeLib.c."""
+    value = 2166136261 ^ ((seed * 0x9E3779B9) & MASK32)
+    for char in name.encode('ascii'):
+        value ^= char
+        value = (value * 16777619) & MASK32
+    return value ^ (value >> 16)
+
+
+def build_dispatch(names):
+    bits = 2
+    while (1 << bits) < len(names) * 2:
+        bits += 1
+
+    for bits in range(bits, MAX_BITS + 1):
+        mask = (1 << bits) - 1
+        for seed in range(MAX_SEED):
+            slots = [0] * (mask + 1)
+            for index, name in enumerate(names):
+                slot = schema_hash(name, seed) & mask
+                if slots[slot] != 0:
+                    break
+                slots[slot] = index + 1
+            else:
+                return seed, mask, slots
+
+    raise RuntimeError('no perfect hash for {}'.format(names))
+
+
+def main():
+    source = os.path.join(os.path.dirname(os.path.abspath(__file__)), 'OcConfigurationLib.c')
+    with open(source) as handle:
+        text = handle.read()
+
+    lists = re.findall(r'^(m\w+)\[\] = \{\n(.*?)^\};', text, re.MULTILINE | re.DOTALL)
+
+    out = sys.stdout
+    out.write('/** @file\n')
+    out.write('  Generated by GenerateSchemaDispatch.py from OcConfigurationLib.c, do not edit.\n')
+    out.write('**/\n\n')
+    out.write('#ifndef OC_CONFIGURATION_DISPATCH_H\n')
+    out.write('#define OC_CONFIGURATION_DISPATCH_H\n')
+
+    for list_name, body in lists:
+        names = re.findall(r'^\s*OC_SCHEMA_\w+\s*\("([^"]+)"', body, re.MULTILINE)
+        if len(names) == 0:
+            continue
+
+        if names != sorted(names):
+            raise RuntimeError('{} is not sorted'.format(list_name))
+
+        seed, mask, slots = build_dispatch(names)
+
+        out.write('\nSTATIC\nCONST UINT8\n{}Slots[] = {{\n'.format(list_name))
+        for start in range(0, len(slots), 16):
+            out.write('  {},\n'.format(', '.join('{:2d}'.format(s) for s in slots[start:start + 16])))
+        out.write('};\n')
+
+        out.write('\nSTATIC\nCONST OC_SCHEMA_DISPATCH\n{}Dispatch = {{\n'.format(list_name))
+        out.write('  {}, {}, {}, {}Slots\n'.format(len(names), seed, mask, list_name))
+        out.write('};\n')
+
+    out.write('\n#endif // OC_CONFIGURATION_DISPATCH_H\n')
+
+
+if __name__ == '__main__':
+    main()
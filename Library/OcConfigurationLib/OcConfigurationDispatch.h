@@ -0,0 +1,341 @@
+/** @file
+  Generated by GenerateSchemaDispatch.py from OcConfigurationLib.c, do not edit.
+**/
+
+#ifndef OC_CONFIGURATION_DISPATCH_H
+#define OC_CONFIGURATION_DISPATCH_H
+
+STATIC
+CONST UINT8
+mAcpiAddSchemaEntrySlots[] = {
+   1,  0,  0,  0,  3,  0,  2,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mAcpiAddSchemaEntryDispatch = {
+  3, 1, 7, mAcpiAddSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mAcpiBlockSchemaEntrySlots[] = {
+   0,  2,  4,  0,  0,  0,  0,  0,  3,  0,  0,  1,  5,  0,  6,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mAcpiBlockSchemaEntryDispatch = {
+  6, 0, 15, mAcpiBlockSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mAcpiPatchSchemaEntrySlots[] = {
+   5, 11,  0,  0,  0,  9,  0,  0, 10,  0,  7,  0,  0,  0,  0,  0,
+   0,  1,  2,  4,  0,  0,  8,  0,  0, 12,  6,  0,  0,  0,  3,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mAcpiPatchSchemaEntryDispatch = {
+  12, 3, 31, mAcpiPatchSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mAcpiQuirksSchemaSlots[] = {
+   2,  0,  0,  1,  4,  0,  0,  0,  0,  3,  0,  5,  0,  0,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mAcpiQuirksSchemaDispatch = {
+  5, 0, 15, mAcpiQuirksSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mAcpiConfigurationSchemaSlots[] = {
+   0,  3,  2,  0,  4,  1,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mAcpiConfigurationSchemaDispatch = {
+  4, 3, 7, mAcpiConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mDevicePropertiesSchemaSlots[] = {
+   0,  2,  0,  1,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mDevicePropertiesSchemaDispatch = {
+  2, 0, 3, mDevicePropertiesSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mKernelAddSchemaEntrySlots[] = {
+   0,  0,  0,  5,  0,  1,  0,  0,  2,  0,  6,  0,  4,  0,  3,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelAddSchemaEntryDispatch = {
+  6, 1, 15, mKernelAddSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mKernelBlockSchemaEntrySlots[] = {
+   1,  0,  0,  4,  3,  0,  2,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelBlockSchemaEntryDispatch = {
+  4, 1, 7, mKernelBlockSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mKernelEmulateSchemaSlots[] = {
+   0,  1,  2,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelEmulateSchemaDispatch = {
+  2, 0, 3, mKernelEmulateSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mKernelPatchSchemaEntrySlots[] = {
+   7,  0,  0,  0,  0, 11,  0,  0, 12,  0,  0,  0,  0,  0,  0,  0,
+   0,  2,  3,  5,  0,  0, 10,  1,  6,  0,  8,  0,  9,  0,  4,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelPatchSchemaEntryDispatch = {
+  12, 3, 31, mKernelPatchSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mKernelQuirksSchemaSlots[] = {
+   0,  2,  0,  0,  4,  8,  0,  0,  3,  0,  7, 10,  0,  0,  0,  0,
+   0,  9,  0,  0,  0,  0,  0,  0,  0,  0,  5,  6,  1,  0,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelQuirksSchemaDispatch = {
+  10, 4, 31, mKernelQuirksSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mKernelConfigurationSchemaSlots[] = {
+   0,  0,  0,  0,  0,  2,  0,  3,  1,  0,  0,  0,  0,  4,  5,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mKernelConfigurationSchemaDispatch = {
+  5, 2, 15, mKernelConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mMiscConfigurationBootSchemaSlots[] = {
+   0,  0,  0,  0,  0,  0,  0,  0,  0,  2,  0,  0,  5,  0,  0,  0,
+   0,  0,  1,  7,  0,  9,  3,  0,  8,  0,  0,  4,  6,  0,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mMiscConfigurationBootSchemaDispatch = {
+  9, 2, 31, mMiscConfigurationBootSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mMiscConfigurationDebugSchemaSlots[] = {
+   3,  4,  2,  0,  0,  1,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mMiscConfigurationDebugSchemaDispatch = {
+  4, 1, 7, mMiscConfigurationDebugSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mMiscConfigurationSecuritySchemaSlots[] = {
+   0,  0,  1,  0,  2,  0,  4,  0,  0,  0,  3,  0,  0,  5,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mMiscConfigurationSecuritySchemaDispatch = {
+  5, 0, 15, mMiscConfigurationSecuritySchemaSlots
+};
+
+STATIC
+CONST UINT8
+mMiscToolsSchemaEntrySlots[] = {
+   1,  0,  0,  0,  4,  0,  2,  3,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mMiscToolsSchemaEntryDispatch = {
+  4, 1, 7, mMiscToolsSchemaEntrySlots
+};
+
+STATIC
+CONST UINT8
+mMiscConfigurationSchemaSlots[] = {
+   0,  1,  2,  0,  3,  0,  4,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mMiscConfigurationSchemaDispatch = {
+  4, 2, 7, mMiscConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mNvramConfigurationSchemaSlots[] = {
+   0,  0,  3,  1,  2,  0,  0,  4,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mNvramConfigurationSchemaDispatch = {
+  4, 1, 7, mNvramConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mPlatformConfigurationDataHubSchemaSlots[] = {
+   0,  0, 12,  0,  0,  4,  8,  2,  0,  0,  0,  0, 14, 13,  1,  0,
+  10,  0,  7,  0,  6,  0,  9,  0,  3,  0,  0,  0, 11,  0,  0,  5,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mPlatformConfigurationDataHubSchemaDispatch = {
+  14, 7, 31, mPlatformConfigurationDataHubSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mPlatformConfigurationGenericSchemaSlots[] = {
+   0,  2,  0,  0,  5,  0,  0,  1,  4,  0,  0,  0,  6,  0,  0,  3,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mPlatformConfigurationGenericSchemaDispatch = {
+  6, 0, 15, mPlatformConfigurationGenericSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mPlatformConfigurationNvramSchemaSlots[] = {
+   1,  3,  0,  0,  0,  0,  0,  4,  0,  2,  0,  0,  5,  0,  0,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mPlatformConfigurationNvramSchemaDispatch = {
+  5, 2, 15, mPlatformConfigurationNvramSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mPlatformConfigurationSmbiosSchemaSlots[] = {
+  20, 11,  4,  0,  0,  0, 23,  2,  0, 19,  3,  0,  7, 17,  0,  0,
+   0, 25,  0, 24, 28, 26,  6,  0,  1,  0, 22,  0,  0,  0,  0,  0,
+   0,  0, 18,  8,  0, 15,  0, 16,  0,  0,  0, 27,  0,  0,  0,  0,
+  10,  0,  9,  0, 21,  0,  0,  0,  0,  0, 14,  0,  5, 12,  0, 13,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mPlatformConfigurationSmbiosSchemaDispatch = {
+  28, 1051, 63, mPlatformConfigurationSmbiosSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mPlatformConfigurationSchemaSlots[] = {
+   0,  0,  0,  9,  0,  0,  0,  0,  0,  0,  0,  0,  0,  6,  1,  3,
+   0,  0,  7,  0,  0,  8,  0,  0,  5,  0,  0,  4,  0,  0,  0,  2,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mPlatformConfigurationSchemaDispatch = {
+  9, 0, 31, mPlatformConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mUefiQuirksSchemaSlots[] = {
+   0,  4,  0,  7,  6,  0,  0,  0,  0,  2,  0,  0,  5,  0,  1,  3,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mUefiQuirksSchemaDispatch = {
+  7, 0, 15, mUefiQuirksSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mUefiProtocolsSchemaSlots[] = {
+   0,  1,  4,  0,  2,  0,  0,  3,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mUefiProtocolsSchemaDispatch = {
+  4, 0, 7, mUefiProtocolsSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mUefiConfigurationSchemaSlots[] = {
+   1,  2,  0,  0,  4,  0,  3,  0,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mUefiConfigurationSchemaDispatch = {
+  4, 3, 7, mUefiConfigurationSchemaSlots
+};
+
+STATIC
+CONST UINT8
+mRootConfigurationNodesSlots[] = {
+   0,  0,  1,  0,  3,  0,  6,  0,  0,  0,  5,  7,  0,  4,  0,  2,
+};
+
+STATIC
+CONST OC_SCHEMA_DISPATCH
+mRootConfigurationNodesDispatch = {
+  7, 2, 15, mRootConfigurationNodesSlots
+};
+
+#endif // OC_CONFIGURATION_DISPATCH_H
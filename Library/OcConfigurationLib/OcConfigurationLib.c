@@ -14,6 +14,8 @@
 
 #include <Library/OcConfigurationLib.h>
 
+#include "OcConfigurationDispatch.h"
+
 OC_STRUCTORS       (OC_ACPI_ADD_ENTRY, ())
 OC_ARRAY_STRUCTORS (OC_ACPI_ADD_ARRAY)
 OC_STRUCTORS       (OC_ACPI_BLOCK_ENTRY, ())
@@ -79,7 +81,7 @@ mAcpiAddSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mAcpiAddSchema = OC_SCHEMA_DICT (NULL, mAcpiAddSchemaEntry);
+mAcpiAddSchema = OC_SCHEMA_DICT_HASH (NULL, mAcpiAddSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -94,7 +96,7 @@ mAcpiBlockSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mAcpiBlockSchema = OC_SCHEMA_DICT (NULL, mAcpiBlockSchemaEntry);
+mAcpiBlockSchema = OC_SCHEMA_DICT_HASH (NULL, mAcpiBlockSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -115,7 +117,7 @@ mAcpiPatchSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mAcpiPatchSchema = OC_SCHEMA_DICT (NULL, mAcpiPatchSchemaEntry);
+mAcpiPatchSchema = OC_SCHEMA_DICT_HASH (NULL, mAcpiPatchSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -133,7 +135,7 @@ mAcpiConfigurationSchema[] = {
   OC_SCHEMA_ARRAY_IN   ("Add",    OC_GLOBAL_CONFIG, Acpi.Add,    &mAcpiAddSchema),
   OC_SCHEMA_ARRAY_IN   ("Block",  OC_GLOBAL_CONFIG, Acpi.Block,  &mAcpiBlockSchema),
   OC_SCHEMA_ARRAY_IN   ("Patch",  OC_GLOBAL_CONFIG, Acpi.Patch,  &mAcpiPatchSchema),
-  OC_SCHEMA_DICT       ("Quirks", mAcpiQuirksSchema),
+  OC_SCHEMA_DICT_HASH  ("Quirks", mAcpiQuirksSchema),
 };
 
 
@@ -183,7 +185,7 @@ mKernelAddSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mKernelAddSchema = OC_SCHEMA_DICT (NULL, mKernelAddSchemaEntry);
+mKernelAddSchema = OC_SCHEMA_DICT_HASH (NULL, mKernelAddSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -196,7 +198,7 @@ mKernelBlockSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mKernelBlockSchema = OC_SCHEMA_DICT (NULL, mKernelBlockSchemaEntry);
+mKernelBlockSchema = OC_SCHEMA_DICT_HASH (NULL, mKernelBlockSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -224,7 +226,7 @@ mKernelPatchSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mKernelPatchSchema = OC_SCHEMA_DICT (NULL, mKernelPatchSchemaEntry);
+mKernelPatchSchema = OC_SCHEMA_DICT_HASH (NULL, mKernelPatchSchemaEntry);
 
 STATIC
 OC_SCHEMA
@@ -246,9 +248,9 @@ OC_SCHEMA
 mKernelConfigurationSchema[] = {
   OC_SCHEMA_ARRAY_IN   ("Add",     OC_GLOBAL_CONFIG, Kernel.Add, &mKernelAddSchema),
   OC_SCHEMA_ARRAY_IN   ("Block",   OC_GLOBAL_CONFIG, Kernel.Block, &mKernelBlockSchema),
-  OC_SCHEMA_DICT       ("Emulate", mKernelEmulateSchema),
+  OC_SCHEMA_DICT_HASH  ("Emulate", mKernelEmulateSchema),
   OC_SCHEMA_ARRAY_IN   ("Patch",   OC_GLOBAL_CONFIG, Kernel.Patch, &mKernelPatchSchema),
-  OC_SCHEMA_DICT       ("Quirks",  mKernelQuirksSchema),
+  OC_SCHEMA_DICT_HASH  ("Quirks",  mKernelQuirksSchema),
 };
 
 //
@@ -299,14 +301,14 @@ mMiscToolsSchemaEntry[] = {
 
 STATIC
 OC_SCHEMA
-mMiscToolsSchema = OC_SCHEMA_DICT (NULL, mMiscToolsSchemaEntry);
+mMiscToolsSchema = OC_SCHEMA_DICT_HASH (NULL, mMiscToolsSchemaEntry);
 
 STATIC
 OC_SCHEMA
 mMiscConfigurationSchema[] = {
-  OC_SCHEMA_DICT       ("Boot",             mMiscConfigurationBootSchema),
-  OC_SCHEMA_DICT       ("Debug",            mMiscConfigurationDebugSchema),
-  OC_SCHEMA_DICT       ("Security",         mMiscConfigurationSecuritySchema),
+  OC_SCHEMA_DICT_HASH  ("Boot",             mMiscConfigurationBootSchema),
+  OC_SCHEMA_DICT_HASH  ("Debug",            mMiscConfigurationDebugSchema),
+  OC_SCHEMA_DICT_HASH  ("Security",         mMiscConfigurationSecuritySchema),
   OC_SCHEMA_ARRAY_IN   ("Tools",            OC_GLOBAL_CONFIG, Misc.Tools, &mMiscToolsSchema),
 };
 
@@ -427,10 +429,10 @@ STATIC
 OC_SCHEMA
 mPlatformConfigurationSchema[] = {
   OC_SCHEMA_BOOLEAN_IN ("Automatic",        OC_GLOBAL_CONFIG, PlatformInfo.Automatic),
-  OC_SCHEMA_DICT       ("DataHub",          mPlatformConfigurationDataHubSchema),
-  OC_SCHEMA_DICT       ("Generic",          mPlatformConfigurationGenericSchema),
-  OC_SCHEMA_DICT       ("PlatformNVRAM",    mPlatformConfigurationNvramSchema),
-  OC_SCHEMA_DICT       ("SMBIOS",           mPlatformConfigurationSmbiosSchema),
+  OC_SCHEMA_DICT_HASH  ("DataHub",          mPlatformConfigurationDataHubSchema),
+  OC_SCHEMA_DICT_HASH  ("Generic",          mPlatformConfigurationGenericSchema),
+  OC_SCHEMA_DICT_HASH  ("PlatformNVRAM",    mPlatformConfigurationNvramSchema),
+  OC_SCHEMA_DICT_HASH  ("SMBIOS",           mPlatformConfigurationSmbiosSchema),
   OC_SCHEMA_BOOLEAN_IN ("UpdateDataHub",    OC_GLOBAL_CONFIG, PlatformInfo.UpdateDataHub),
   OC_SCHEMA_BOOLEAN_IN ("UpdateNVRAM",      OC_GLOBAL_CONFIG, PlatformInfo.UpdateNvram),
   OC_SCHEMA_BOOLEAN_IN ("UpdateSMBIOS",     OC_GLOBAL_CONFIG, PlatformInfo.UpdateSmbios),
@@ -471,8 +473,8 @@ OC_SCHEMA
 mUefiConfigurationSchema[] = {
   OC_SCHEMA_BOOLEAN_IN ("ConnectDrivers", OC_GLOBAL_CONFIG, Uefi.ConnectDrivers),
   OC_SCHEMA_ARRAY_IN   ("Drivers",        OC_GLOBAL_CONFIG, Uefi.Drivers, &mUefiDriversSchema),
-  OC_SCHEMA_DICT       ("Protocols",      mUefiProtocolsSchema),
-  OC_SCHEMA_DICT       ("Quirks",         mUefiQuirksSchema)
+  OC_SCHEMA_DICT_HASH  ("Protocols",      mUefiProtocolsSchema),
+  OC_SCHEMA_DICT_HASH  ("Quirks",         mUefiQuirksSchema)
 };
 
 //
@@ -482,19 +484,19 @@ mUefiConfigurationSchema[] = {
 STATIC
 OC_SCHEMA
 mRootConfigurationNodes[] = {
-  OC_SCHEMA_DICT    ("ACPI",             mAcpiConfigurationSchema),
-  OC_SCHEMA_DICT    ("DeviceProperties", mDevicePropertiesSchema),
-  OC_SCHEMA_DICT    ("Kernel",           mKernelConfigurationSchema),
-  OC_SCHEMA_DICT    ("Misc",             mMiscConfigurationSchema),
-  OC_SCHEMA_DICT    ("NVRAM",            mNvramConfigurationSchema),
-  OC_SCHEMA_DICT    ("PlatformInfo",     mPlatformConfigurationSchema),
-  OC_SCHEMA_DICT    ("UEFI",             mUefiConfigurationSchema)
+  OC_SCHEMA_DICT_HASH ("ACPI",             mAcpiConfigurationSchema),
+  OC_SCHEMA_DICT_HASH ("DeviceProperties", mDevicePropertiesSchema),
+  OC_SCHEMA_DICT_HASH ("Kernel",           mKernelConfigurationSchema),
+  OC_SCHEMA_DICT_HASH ("Misc",             mMiscConfigurationSchema),
+  OC_SCHEMA_DICT_HASH ("NVRAM",            mNvramConfigurationSchema),
+  OC_SCHEMA_DICT_HASH ("PlatformInfo",     mPlatformConfigurationSchema),
+  OC_SCHEMA_DICT_HASH ("UEFI",             mUefiConfigurationSchema)
 };
 
 STATIC
 OC_SCHEMA_INFO
 mRootConfigurationInfo = {
-  .Dict = {mRootConfigurationNodes, ARRAY_SIZE (mRootConfigurationNodes)}
+  .Dict = {mRootConfigurationNodes, ARRAY_SIZE (mRootConfigurationNodes), &mRootConfigurationNodesDispatch}
 };
 
 EFI_STATUS
@@ -20,6 +20,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <Library/BaseLib.h>
 #include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcGuardLib.h>
 #include <Library/OcMachoLib.h>
 
@@ -276,6 +277,38 @@ MachoInitializeContext (
   return TRUE;
 }
 
+/**
+  Frees the lookup indices cached within a Mach-O Context.  The Context stays
+  valid and the indices are rebuilt on demand.  This must be called before
+  modifying the Symbol Table or Relocations of a Mach-O that has been queried,
+  unless done through MachoSetSymbolValue64 or MachoRelocateSymbol64, and
+  before the Context is discarded or reinitialized.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+**/
+VOID
+MachoFreeIndices (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  )
+{
+  ASSERT (Context != NULL);
+
+  if (Context->ExternRelocationIndex != NULL) {
+    FreePool (Context->ExternRelocationIndex);
+    Context->ExternRelocationIndex    = NULL;
+    Context->NumExternRelocationIndex = 0;
+  }
+
+  if (Context->LocalRelocationIndex != NULL) {
+    FreePool (Context->LocalRelocationIndex);
+    Context->LocalRelocationIndex    = NULL;
+    Context->NumLocalRelocationIndex = 0;
+  }
+
+  InternalFreeSymbolValueIndex (Context);
+}
+
 /**
   Returns the last virtual address of a Mach-O.
 
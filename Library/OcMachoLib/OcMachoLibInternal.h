@@ -60,6 +60,18 @@ InternalGetLocalRelocationByOffset (
   IN     UINT64            Address
   );
 
+/**
+  Frees the value-sorted symbol index of a Mach-O.  It is rebuilt on the next
+  lookup by value.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+**/
+VOID
+InternalFreeSymbolValueIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  );
+
 /**
   Check symbol validity.
 
@@ -17,6 +17,7 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <IndustryStandard/AppleMachoImage.h>
 
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcMachoLib.h>
 
 #include "OcMachoLibInternal.h"
@@ -65,10 +66,127 @@ MachoPreserveRelocationIntel64 (
   return (Type == MachX8664RelocUnsigned);
 }
 
+STATIC
+BOOLEAN
+InternalRelocationIndexLess (
+  IN CONST MACH_RELOCATION_INFO  *Relocs,
+  IN UINT32                      First,
+  IN UINT32                      Second
+  )
+{
+  //
+  // Tie by table index to return the same Relocation as the table walk.
+  //
+  if (Relocs[First].Address != Relocs[Second].Address) {
+    return (UINT64)Relocs[First].Address < (UINT64)Relocs[Second].Address;
+  }
+
+  return First < Second;
+}
+
+STATIC
+VOID
+InternalSiftRelocationIndex (
+  IN     CONST MACH_RELOCATION_INFO  *Relocs,
+  IN OUT UINT32                      *RelocIndex,
+  IN     UINT32                      Root,
+  IN     UINT32                      NumEntries
+  )
+{
+  UINT32  Child;
+  UINT32  Entry;
+
+  Entry = RelocIndex[Root];
+
+  while ((Child = 2 * Root + 1) < NumEntries) {
+    if (Child + 1 < NumEntries
+      && InternalRelocationIndexLess (Relocs, RelocIndex[Child], RelocIndex[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalRelocationIndexLess (Relocs, Entry, RelocIndex[Child])) {
+      break;
+    }
+
+    RelocIndex[Root] = RelocIndex[Child];
+    Root             = Child;
+  }
+
+  RelocIndex[Root] = Entry;
+}
+
+/**
+  Builds the address-sorted index of Relocations, which may be returned by
+  InternalLookupRelocationByOffset.  Absolute section-based Relocations and
+  the second entries of Relocation Pairs are left out.
+
+  @param[in]  NumRelocs   Number of Relocations in Relocs.
+  @param[in]  Relocs      Relocation table.
+  @param[out] NumEntries  Number of index entries.
+
+  @retval NULL  NULL is returned on failure.
+
+**/
+STATIC
+UINT32 *
+InternalBuildRelocationIndex (
+  IN  UINT32                      NumRelocs,
+  IN  CONST MACH_RELOCATION_INFO  *Relocs,
+  OUT UINT32                      *NumEntries
+  )
+{
+  UINT32                     *RelocIndex;
+  UINT32                     Index;
+  UINT32                     Count;
+  UINT32                     Entry;
+  CONST MACH_RELOCATION_INFO *Relocation;
+
+  RelocIndex = AllocatePool (NumRelocs * sizeof (*RelocIndex));
+  if (RelocIndex == NULL) {
+    return NULL;
+  }
+
+  Count = 0;
+  for (Index = 0; Index < NumRelocs; ++Index) {
+    Relocation = &Relocs[Index];
+    if ((Relocation->Extern == 0)
+     && (Relocation->SymbolNumber == MACH_RELOC_ABSOLUTE)) {
+      continue;
+    }
+
+    RelocIndex[Count++] = Index;
+
+    if (MachoRelocationIsPairIntel64 ((UINT8)Relocation->Type)) {
+      if (Index == (MAX_UINT32 - 1)) {
+        break;
+      }
+      ++Index;
+    }
+  }
+
+  for (Index = Count / 2; Index > 0; --Index) {
+    InternalSiftRelocationIndex (Relocs, RelocIndex, Index - 1, Count);
+  }
+
+  for (Index = Count; Index > 1; --Index) {
+    Entry                 = RelocIndex[0];
+    RelocIndex[0]         = RelocIndex[Index - 1];
+    RelocIndex[Index - 1] = Entry;
+    InternalSiftRelocationIndex (Relocs, RelocIndex, 0, Index - 1);
+  }
+
+  *NumEntries = Count;
+  return RelocIndex;
+}
+
 /**
   Retrieves an extern Relocation by the address it targets.
 
-  @param[in]     Address  The address to search for.
+  @param[in]     Address     The address to search for.
+  @param[in]     NumRelocs   Number of Relocations in Relocs.
+  @param[in]     Relocs      Relocation table.
+  @param[in,out] RelocIndex  Address-sorted index of Relocs, built on first use.
+  @param[in,out] NumEntries  Number of RelocIndex entries.
 
   @retval NULL  NULL is returned on failure.
 
@@ -78,11 +196,43 @@ MACH_RELOCATION_INFO *
 InternalLookupRelocationByOffset (
   IN     UINT64                Address,
   IN     UINT32                NumRelocs,
-  IN     MACH_RELOCATION_INFO  *Relocs
+  IN     MACH_RELOCATION_INFO  *Relocs,
+  IN OUT UINT32                **RelocIndex,
+  IN OUT UINT32                *NumEntries
   )
 {
   UINT32               Index;
   MACH_RELOCATION_INFO *Relocation;
+  UINT32               Low;
+  UINT32               High;
+  UINT32               Middle;
+
+  if (NumRelocs == 0) {
+    return NULL;
+  }
+
+  if (*RelocIndex == NULL) {
+    *RelocIndex = InternalBuildRelocationIndex (NumRelocs, Relocs, NumEntries);
+  }
+
+  if (*RelocIndex != NULL) {
+    Low  = 0;
+    High = *NumEntries;
+    while (Low < High) {
+      Middle = Low + (High - Low) / 2;
+      if ((UINT64)Relocs[(*RelocIndex)[Middle]].Address < Address) {
+        Low = Middle + 1;
+      } else {
+        High = Middle;
+      }
+    }
+
+    if (Low < *NumEntries && (UINT64)Relocs[(*RelocIndex)[Low]].Address == Address) {
+      return &Relocs[(*RelocIndex)[Low]];
+    }
+
+    return NULL;
+  }
 
   for (Index = 0; Index < NumRelocs; ++Index) {
     Relocation = &Relocs[Index];
@@ -131,7 +281,9 @@ InternalGetExternRelocationByOffset (
   return InternalLookupRelocationByOffset (
            Address,
            Context->DySymtab->NumExternalRelocations,
-           Context->ExternRelocations
+           Context->ExternRelocations,
+           &Context->ExternRelocationIndex,
+           &Context->NumExternRelocationIndex
            );
 }
 
@@ -153,6 +305,8 @@ InternalGetLocalRelocationByOffset (
   return InternalLookupRelocationByOffset (
            Address,
            Context->DySymtab->NumOfLocalRelocations,
-           Context->LocalRelocations
+           Context->LocalRelocations,
+           &Context->LocalRelocationIndex,
+           &Context->NumLocalRelocationIndex
            );
 }
@@ -17,7 +17,9 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 #include <IndustryStandard/AppleMachoImage.h>
 
 #include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
 #include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
 #include <Library/OcGuardLib.h>
 #include <Library/OcMachoLib.h>
 
@@ -312,6 +314,297 @@ MachoGetIndirectSymbolName64 (
   return (Context->StringTable + Symbol->Value);
 }
 
+STATIC
+BOOLEAN
+InternalSymbolValueIndexLess (
+  IN CONST MACH_NLIST_64  *SymbolTable,
+  IN UINT32               First,
+  IN UINT32               Second
+  )
+{
+  //
+  // Tie by table index to return the same symbol as the table walk.
+  //
+  if (SymbolTable[First].Value != SymbolTable[Second].Value) {
+    return SymbolTable[First].Value < SymbolTable[Second].Value;
+  }
+
+  return First < Second;
+}
+
+STATIC
+VOID
+InternalSiftSymbolValueIndex (
+  IN     CONST MACH_NLIST_64  *SymbolTable,
+  IN OUT UINT32               *SymbolIndex,
+  IN     UINT32               Root,
+  IN     UINT32               NumEntries
+  )
+{
+  UINT32  Child;
+  UINT32  Entry;
+
+  Entry = SymbolIndex[Root];
+
+  while ((Child = 2 * Root + 1) < NumEntries) {
+    if (Child + 1 < NumEntries
+      && InternalSymbolValueIndexLess (SymbolTable, SymbolIndex[Child], SymbolIndex[Child + 1])) {
+      ++Child;
+    }
+
+    if (!InternalSymbolValueIndexLess (SymbolTable, Entry, SymbolIndex[Child])) {
+      break;
+    }
+
+    SymbolIndex[Root] = SymbolIndex[Child];
+    Root              = Child;
+  }
+
+  SymbolIndex[Root] = Entry;
+}
+
+/**
+  Retrieves the value-sorted symbol index of a Mach-O, building it on first
+  use.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+  @retval NULL  NULL is returned on failure.
+
+**/
+STATIC
+CONST UINT32 *
+InternalGetSymbolValueIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  )
+{
+  UINT32  *SymbolIndex;
+  UINT32  NumSymbols;
+  UINT32  Index;
+  UINT32  Entry;
+
+  ASSERT (Context->SymbolTable != NULL);
+  ASSERT (Context->Symtab != NULL);
+
+  if (Context->SymbolValueIndex != NULL) {
+    return Context->SymbolValueIndex;
+  }
+
+  NumSymbols = Context->Symtab->NumSymbols;
+  if (NumSymbols == 0) {
+    return NULL;
+  }
+
+  SymbolIndex = AllocatePool (NumSymbols * sizeof (*SymbolIndex));
+  if (SymbolIndex == NULL) {
+    return NULL;
+  }
+
+  for (Index = 0; Index < NumSymbols; ++Index) {
+    SymbolIndex[Index] = Index;
+  }
+
+  for (Index = NumSymbols / 2; Index > 0; --Index) {
+    InternalSiftSymbolValueIndex (Context->SymbolTable, SymbolIndex, Index - 1, NumSymbols);
+  }
+
+  for (Index = NumSymbols; Index > 1; --Index) {
+    Entry                  = SymbolIndex[0];
+    SymbolIndex[0]         = SymbolIndex[Index - 1];
+    SymbolIndex[Index - 1] = Entry;
+    InternalSiftSymbolValueIndex (Context->SymbolTable, SymbolIndex, 0, Index - 1);
+  }
+
+  Context->SymbolValueIndex    = SymbolIndex;
+  Context->NumSymbolValueIndex = NumSymbols;
+
+  return SymbolIndex;
+}
+
+/**
+  Returns the position of the first symbol value index entry whose value is
+  above or equal to Value.
+
+  @param[in] SymbolTable  Symbol Table of the Mach-O.
+  @param[in] SymbolIndex  Value-sorted index of SymbolTable.
+  @param[in] NumEntries   Number of SymbolIndex entries.
+  @param[in] Value        Value to search for.
+
+**/
+STATIC
+UINT32
+InternalSymbolValueLowerBound (
+  IN CONST MACH_NLIST_64  *SymbolTable,
+  IN CONST UINT32         *SymbolIndex,
+  IN UINT32               NumEntries,
+  IN UINT64               Value
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Low  = 0;
+  High = NumEntries;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (SymbolTable[SymbolIndex[Middle]].Value < Value) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  Returns the position of SymbolNumber within the value-sorted symbol index,
+  or the position to insert it at when it is not indexed.
+
+  @param[in] SymbolTable   Symbol Table of the Mach-O.
+  @param[in] SymbolIndex   Value-sorted index of SymbolTable.
+  @param[in] NumEntries    Number of SymbolIndex entries.
+  @param[in] SymbolNumber  Symbol Table index of the symbol to search for.
+
+**/
+STATIC
+UINT32
+InternalSymbolValueIndexPosition (
+  IN CONST MACH_NLIST_64  *SymbolTable,
+  IN CONST UINT32         *SymbolIndex,
+  IN UINT32               NumEntries,
+  IN UINT32               SymbolNumber
+  )
+{
+  UINT32  Low;
+  UINT32  High;
+  UINT32  Middle;
+
+  Low  = 0;
+  High = NumEntries;
+  while (Low < High) {
+    Middle = Low + (High - Low) / 2;
+    if (InternalSymbolValueIndexLess (SymbolTable, SymbolIndex[Middle], SymbolNumber)) {
+      Low = Middle + 1;
+    } else {
+      High = Middle;
+    }
+  }
+
+  return Low;
+}
+
+/**
+  Frees the value-sorted symbol index of a Mach-O.  It is rebuilt on the next
+  lookup by value.
+
+  @param[in,out] Context  Context of the Mach-O.
+
+**/
+VOID
+InternalFreeSymbolValueIndex (
+  IN OUT OC_MACHO_CONTEXT  *Context
+  )
+{
+  if (Context->SymbolValueIndex != NULL) {
+    FreePool (Context->SymbolValueIndex);
+    Context->SymbolValueIndex    = NULL;
+    Context->NumSymbolValueIndex = 0;
+  }
+}
+
+/**
+  Returns whether Symbol is an entry of the Symbol Table of Context, and
+  thus covered by its value-sorted symbol index.
+
+  @param[in] Context  Context of the Mach-O.
+  @param[in] Symbol   Symbol to check.
+
+**/
+STATIC
+BOOLEAN
+InternalSymbolIsIndexed (
+  IN CONST OC_MACHO_CONTEXT  *Context,
+  IN CONST MACH_NLIST_64     *Symbol
+  )
+{
+  return Context->SymbolValueIndex != NULL
+    && Symbol >= Context->SymbolTable
+    && Symbol < &Context->SymbolTable[Context->NumSymbolValueIndex];
+}
+
+/**
+  Sets the value of Symbol.  The value-sorted symbol index is kept sorted, so
+  lookups by value stay valid without rebuilding it.
+
+  @param[in,out] Context  Context of the Mach-O.
+  @param[in,out] Symbol   Symbol from the Symbol Table of Context.
+  @param[in]     Value    The new value of Symbol.
+
+**/
+VOID
+MachoSetSymbolValue64 (
+  IN OUT OC_MACHO_CONTEXT  *Context,
+  IN OUT MACH_NLIST_64     *Symbol,
+  IN     UINT64            Value
+  )
+{
+  UINT32  *SymbolIndex;
+  UINT32  NumEntries;
+  UINT32  SymbolNumber;
+  UINT32  Position;
+
+  ASSERT (Context != NULL);
+  ASSERT (Symbol != NULL);
+
+  if (Symbol->Value == Value || !InternalSymbolIsIndexed (Context, Symbol)) {
+    Symbol->Value = Value;
+    return;
+  }
+
+  SymbolIndex  = Context->SymbolValueIndex;
+  NumEntries   = Context->NumSymbolValueIndex;
+  SymbolNumber = (UINT32) (Symbol - Context->SymbolTable);
+
+  Position = InternalSymbolValueIndexPosition (
+               Context->SymbolTable,
+               SymbolIndex,
+               NumEntries,
+               SymbolNumber
+               );
+  if (Position >= NumEntries || SymbolIndex[Position] != SymbolNumber) {
+    //
+    // The index does not match the table, let it be rebuilt.
+    //
+    ASSERT (FALSE);
+    InternalFreeSymbolValueIndex (Context);
+    Symbol->Value = Value;
+    return;
+  }
+
+  CopyMem (
+    &SymbolIndex[Position],
+    &SymbolIndex[Position + 1],
+    (NumEntries - Position - 1) * sizeof (*SymbolIndex)
+    );
+
+  Symbol->Value = Value;
+
+  Position = InternalSymbolValueIndexPosition (
+               Context->SymbolTable,
+               SymbolIndex,
+               NumEntries - 1,
+               SymbolNumber
+               );
+  CopyMem (
+    &SymbolIndex[Position + 1],
+    &SymbolIndex[Position],
+    (NumEntries - Position - 1) * sizeof (*SymbolIndex)
+    );
+  SymbolIndex[Position] = SymbolNumber;
+}
+
 /**
   Retrieves a symbol by its value.
 
@@ -328,11 +621,28 @@ InternalGetSymbolByValue (
   IN     UINT64            Value
   )
 {
-  UINT32 Index;
+  UINT32       Index;
+  CONST UINT32 *SymbolIndex;
 
   ASSERT (Context->SymbolTable != NULL);
   ASSERT (Context->Symtab != NULL);
 
+  SymbolIndex = InternalGetSymbolValueIndex (Context);
+  if (SymbolIndex != NULL) {
+    Index = InternalSymbolValueLowerBound (
+              Context->SymbolTable,
+              SymbolIndex,
+              Context->NumSymbolValueIndex,
+              Value
+              );
+    if ((Index < Context->NumSymbolValueIndex)
+     && (Context->SymbolTable[SymbolIndex[Index]].Value == Value)) {
+      return &Context->SymbolTable[SymbolIndex[Index]];
+    }
+
+    return NULL;
+  }
+
   for (Index = 0; Index < Context->Symtab->NumSymbols; ++Index) {
     if (Context->SymbolTable[Index].Value == Value) {
       return &Context->SymbolTable[Index];
@@ -342,6 +652,83 @@ InternalGetSymbolByValue (
   return NULL;
 }
 
+/**
+  Retrieves the section-based symbol with the highest value not above
+  Address, e.g. to symbolise a code address.  The first such symbol in the
+  Symbol Table is returned when several share a value.
+
+  @param[in,out] Context  Context of the Mach-O.
+  @param[in]     Address  Address to search for.
+  @param[out]    Offset   Distance of Address from the symbol's value.
+                          May be NULL.
+
+  @retval NULL  NULL is returned on failure.
+
+**/
+MACH_NLIST_64 *
+MachoGetNearestSymbolByValue64 (
+  IN OUT OC_MACHO_CONTEXT  *Context,
+  IN     UINT64            Address,
+  OUT    UINT64            *Offset  OPTIONAL
+  )
+{
+  CONST UINT32  *SymbolIndex;
+  UINT32        Index;
+  MACH_NLIST_64 *Symbol;
+  MACH_NLIST_64 *Nearest;
+
+  ASSERT (Context != NULL);
+
+  if (!InternalRetrieveSymtabs64 (Context)) {
+    return NULL;
+  }
+
+  SymbolIndex = InternalGetSymbolValueIndex (Context);
+  if (SymbolIndex == NULL) {
+    return NULL;
+  }
+
+  Index = InternalSymbolValueLowerBound (
+            Context->SymbolTable,
+            SymbolIndex,
+            Context->NumSymbolValueIndex,
+            Address
+            );
+  //
+  // Step over the symbols matching Address to reach the first one above it.
+  //
+  while ((Index < Context->NumSymbolValueIndex)
+      && (Context->SymbolTable[SymbolIndex[Index]].Value == Address)) {
+    ++Index;
+  }
+
+  Nearest = NULL;
+
+  while (Index > 0) {
+    --Index;
+    Symbol = &Context->SymbolTable[SymbolIndex[Index]];
+
+    if ((Nearest != NULL) && (Symbol->Value != Nearest->Value)) {
+      break;
+    }
+
+    if (((Symbol->Type & MACH_N_TYPE_STAB) == 0)
+     && InternalSymbolIsSectionType (Symbol)
+     && InternalSymbolIsSane (Context, Symbol)) {
+      //
+      // Keep walking back to the first symbol sharing this value.
+      //
+      Nearest = Symbol;
+    }
+  }
+
+  if ((Nearest != NULL) && (Offset != NULL)) {
+    *Offset = Address - Nearest->Value;
+  }
+
+  return Nearest;
+}
+
 /**
   Retrieves the symbol referenced by the extern Relocation targeting Address.
 
@@ -579,6 +966,13 @@ MachoRelocateSymbol64 (
     if (Result) {
       return FALSE;
     }
+    //
+    // Relocation moves every section symbol, so drop the value index once
+    // instead of repairing it for each of them.
+    //
+    if (InternalSymbolIsIndexed (Context, Symbol)) {
+      InternalFreeSymbolValueIndex (Context);
+    }
 
     Symbol->Value = Value;
   }
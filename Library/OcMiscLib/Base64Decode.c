@@ -65,6 +65,36 @@ OcBase64Decode (
   UINTN Len = 0;
 
   while (EncodedData < End) {
+    //
+    // Decode whole quantums without whitespace or padding four characters
+    // at a time.  Output never overtakes input, so in place decoding works.
+    //
+    if (Iter == 0) {
+      while (End - EncodedData >= 4) {
+        UINT32 C0 = D[(UINT8)EncodedData[0]];
+        UINT32 C1 = D[(UINT8)EncodedData[1]];
+        UINT32 C2 = D[(UINT8)EncodedData[2]];
+        UINT32 C3 = D[(UINT8)EncodedData[3]];
+
+        if (((C0 | C1 | C2 | C3) & 0xC0U) != 0) {
+          break;
+        }
+
+        if ((Len += 3) > *DecodedLength) return RETURN_BUFFER_TOO_SMALL; /* buffer overflow */
+        Buf = C0 << 18U | C1 << 12U | C2 << 6U | C3;
+        *(DecodedData++) = (Buf >> 16U) & 255U;
+        *(DecodedData++) = (Buf >> 8U) & 255U;
+        *(DecodedData++) = Buf & 255U;
+        EncodedData += 4;
+      }
+
+      Buf = 0;
+
+      if (EncodedData >= End) {
+        break;
+      }
+    }
+
     UINT8 C = D[(UINT8)(*EncodedData++)];
 
     switch (C) {
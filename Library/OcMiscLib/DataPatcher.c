@@ -17,6 +17,142 @@
 #include <Library/DebugLib.h>
 #include <Library/OcMiscLib.h>
 
+//
+// Bytes most commonly seen in x86 code and ACPI tables, most common first.
+// Pattern search anchors on the least common fully specified byte.
+//
+STATIC CONST UINT8 mCommonPatternBytes[] = {
+  0x00, 0xFF, 0x48, 0x8B, 0x89, 0x0F, 0x01, 0xE8,
+  0x4C, 0x24, 0x85, 0x45, 0xC0, 0x08, 0x10, 0x20
+};
+
+//
+// Byte-wise SWAR constants: 0x0101...01 and 0x8080...80.
+//
+#define PATTERN_WORD_LOW   ((UINTN) -1 / 0xFF)
+#define PATTERN_WORD_HIGH  (PATTERN_WORD_LOW * 0x80)
+
+STATIC
+UINT32
+InternalPatternByteWeight (
+  IN UINT8  Byte
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < ARRAY_SIZE (mCommonPatternBytes); ++Index) {
+    if (mCommonPatternBytes[Index] == Byte) {
+      return ARRAY_SIZE (mCommonPatternBytes) - Index;
+    }
+  }
+
+  return 0;
+}
+
+/**
+  Choose the least common fully specified pattern byte.
+
+  @return  Anchor index or MAX_UINT32 when all bytes are masked.
+**/
+STATIC
+UINT32
+InternalFindPatternAnchor (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN UINT32        PatternSize
+  )
+{
+  UINT32  Index;
+  UINT32  Anchor;
+  UINT32  Weight;
+  UINT32  AnchorWeight;
+
+  Anchor       = MAX_UINT32;
+  AnchorWeight = MAX_UINT32;
+
+  for (Index = 0; Index < PatternSize; ++Index) {
+    if (PatternMask != NULL && PatternMask[Index] != 0xFF) {
+      continue;
+    }
+
+    Weight = InternalPatternByteWeight (Pattern[Index]);
+    if (Weight < AnchorWeight) {
+      Anchor       = Index;
+      AnchorWeight = Weight;
+      if (Weight == 0) {
+        break;
+      }
+    }
+  }
+
+  return Anchor;
+}
+
+/**
+  Find first Value byte in [Current, End) checking a machine word at a time.
+
+  @return  Found byte or NULL.
+**/
+STATIC
+CONST UINT8 *
+InternalFindPatternByte (
+  IN CONST UINT8  *Current,
+  IN CONST UINT8  *End,
+  IN UINT8        Value
+  )
+{
+  UINTN  Repeated;
+  UINTN  Word;
+
+  while (Current < End && ((UINTN) Current & (sizeof (UINTN) - 1)) != 0) {
+    if (*Current == Value) {
+      return Current;
+    }
+    ++Current;
+  }
+
+  //
+  // A byte of Word is zero exactly where Current matches Value.
+  //
+  Repeated = PATTERN_WORD_LOW * Value;
+  while ((UINTN) (End - Current) >= sizeof (UINTN)) {
+    Word = *(CONST UINTN *) Current ^ Repeated;
+    if (((Word - PATTERN_WORD_LOW) & ~Word & PATTERN_WORD_HIGH) != 0) {
+      break;
+    }
+    Current += sizeof (UINTN);
+  }
+
+  while (Current < End) {
+    if (*Current == Value) {
+      return Current;
+    }
+    ++Current;
+  }
+
+  return NULL;
+}
+
+STATIC
+BOOLEAN
+InternalMaskedPatternMatches (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask,
+  IN UINT32        PatternSize,
+  IN CONST UINT8   *Data
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < PatternSize; ++Index) {
+    if ((Data[Index] & PatternMask[Index]) != Pattern[Index]) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
 INT32
 FindPattern (
   IN CONST UINT8   *Pattern,
@@ -27,8 +163,10 @@ FindPattern (
   IN INT32         DataOff
   )
 {
-  BOOLEAN  Matches;
-  UINT32   Index;
+  UINT32       Anchor;
+  UINT32       LastOff;
+  CONST UINT8  *Current;
+  CONST UINT8  *End;
 
   ASSERT (DataOff >= 0);
 
@@ -36,20 +174,43 @@ FindPattern (
     return -1;
   }
 
-  while (DataOff + PatternSize < DataSize) {
-    Matches = TRUE;
-    for (Index = 0; Index < PatternSize; ++Index) {
-      if ((PatternMask == NULL && Data[DataOff + Index] != Pattern[Index])
-      || (PatternMask != NULL && (Data[DataOff + Index] & PatternMask[Index]) != Pattern[Index])) {
-        Matches = FALSE;
-        break;
+  //
+  // Pattern ending at the very end of Data is not matched.
+  //
+  LastOff = DataSize - PatternSize;
+
+  Anchor = InternalFindPatternAnchor (Pattern, PatternMask, PatternSize);
+  if (Anchor == MAX_UINT32) {
+    while ((UINT32) DataOff < LastOff) {
+      if (InternalMaskedPatternMatches (Pattern, PatternMask, PatternSize, &Data[DataOff])) {
+        return DataOff;
       }
+      ++DataOff;
+    }
+
+    return -1;
+  }
+
+  Current = &Data[DataOff + Anchor];
+  End     = &Data[LastOff + Anchor];
+
+  while (Current < End) {
+    Current = InternalFindPatternByte (Current, End, Pattern[Anchor]);
+    if (Current == NULL) {
+      break;
     }
 
-    if (Matches) {
+    DataOff = (INT32) (Current - Data - Anchor);
+
+    if (PatternMask == NULL) {
+      if (CompareMem (&Data[DataOff], Pattern, PatternSize) == 0) {
+        return DataOff;
+      }
+    } else if (InternalMaskedPatternMatches (Pattern, PatternMask, PatternSize, &Data[DataOff])) {
       return DataOff;
     }
-    ++DataOff;
+
+    ++Current;
   }
 
   return -1;
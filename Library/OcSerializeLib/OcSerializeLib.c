@@ -63,6 +63,91 @@ LookupConfigSchema (
   return NULL;
 }
 
+//
+// Seeded FNV-1a schema name hash, generated dispatch tables depend on it.
+//
+STATIC
+UINT32
+InternalSchemaHash (
+  CONST CHAR8  *Name,
+  UINT32       Seed
+  )
+{
+  UINT32  Hash;
+
+  Hash = 2166136261U ^ (Seed * 0x9E3779B9U);
+  while (*Name != '\0') {
+    Hash ^= (UINT8) *Name++;
+    Hash *= 16777619U;
+  }
+
+  return Hash ^ (Hash >> 16);
+}
+
+//
+// Looks up schema by name with a single dispatch table probe.
+//
+STATIC
+OC_SCHEMA *
+InternalLookupSchemaDispatch (
+  OC_SCHEMA_DICT  *Dict,
+  CONST CHAR8     *Name
+  )
+{
+  UINT32     Index;
+  OC_SCHEMA  *Schema;
+
+  Index = Dict->Dispatch->Slots[InternalSchemaHash (Name, Dict->Dispatch->Seed) & Dict->Dispatch->Mask];
+  if (Index == 0 || Index > Dict->SchemaSize) {
+    return NULL;
+  }
+
+  Schema = &Dict->Schema[Index - 1];
+  if (AsciiStrCmp (Schema->Name, Name) != 0) {
+    return NULL;
+  }
+
+  return Schema;
+}
+
+OC_SCHEMA *
+LookupConfigSchemaDict (
+  OC_SCHEMA_DICT  *Dict,
+  CONST CHAR8     *Name
+  )
+{
+  UINT32  Index;
+
+  if (Dict->Dispatch == NULL) {
+    return LookupConfigSchema (Dict->Schema, Dict->SchemaSize, Name);
+  }
+
+  //
+  // Dispatch tables are generated separately from the schema lists,
+  // so make sure they still agree with binary search.
+  //
+  DEBUG_CODE_BEGIN ();
+  ASSERT (Dict->Dispatch->SchemaSize == Dict->SchemaSize);
+  for (Index = 0; Index < Dict->SchemaSize; ++Index) {
+    ASSERT (Index == 0
+      || AsciiStrCmp (Dict->Schema[Index - 1].Name, Dict->Schema[Index].Name) < 0);
+    ASSERT (InternalLookupSchemaDispatch (Dict, Dict->Schema[Index].Name)
+      == &Dict->Schema[Index]);
+  }
+  ASSERT (InternalLookupSchemaDispatch (Dict, Name)
+    == LookupConfigSchema (Dict->Schema, Dict->SchemaSize, Name));
+  DEBUG_CODE_END ();
+
+  //
+  // Stale table, use binary search.
+  //
+  if (Dict->Dispatch->SchemaSize != Dict->SchemaSize) {
+    return LookupConfigSchema (Dict->Schema, Dict->SchemaSize, Name);
+  }
+
+  return InternalLookupSchemaDispatch (Dict, Name);
+}
+
 VOID
 ParseSerializedDict (
   VOID            *Serialized,
@@ -98,7 +183,7 @@ ParseSerializedDict (
     //
     // We do not protect from duplicating serialized entries.
     //
-    NewSchema = LookupConfigSchema (Info->Dict.Schema, Info->Dict.SchemaSize, CurrentKey);
+    NewSchema = LookupConfigSchemaDict (&Info->Dict, CurrentKey);
 
     if (NewSchema == NULL) {
       DEBUG ((DEBUG_WARN, "OCS: No schema for %a at %u index!\n", CurrentKey, Index));
@@ -168,6 +253,14 @@ ParseSerializedBlob (
 
   Result = FALSE;
 
+  //
+  // Decode data in place first to allocate blobs of exact size.
+  // Failures are reported by the value calls below.
+  //
+  if (Info->Blob.Type != OC_SCHEMA_BLOB_STRING) {
+    PlistDataDecode (Node, NULL, NULL);
+  }
+
   switch (Info->Blob.Type) {
     case OC_SCHEMA_BLOB_DATA:
       Result = PlistDataSize (Node, &Size);
@@ -314,6 +407,323 @@ ParseSerializedArray (
   }
 }
 
+//
+// Skips the node just read unless it was a closing event.
+//
+STATIC
+BOOLEAN
+InternalSkipSerialized (
+  PLIST_READER  *Reader,
+  PLIST_EVENT   Event
+  )
+{
+  switch (Event) {
+    case PLIST_EVENT_OPEN:
+      return PlistReaderSkip (Reader);
+    case PLIST_EVENT_KEY:
+    case PLIST_EVENT_VALUE:
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+STATIC
+BOOLEAN
+InternalStreamSerializedDict (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  );
+
+STATIC
+BOOLEAN
+InternalStreamSerializedMap (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  );
+
+STATIC
+BOOLEAN
+InternalStreamSerializedArray (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  );
+
+//
+// Applies the node just read to the schema.  Nodes without children are
+// passed to the usual appliers, other nodes are streamed into builtin
+// dict, map, and array appliers.
+//
+STATIC
+BOOLEAN
+InternalApplySerialized (
+  VOID          *Serialized,
+  PLIST_READER  *Reader,
+  PLIST_EVENT   Event,
+  XML_NODE      *Node,
+  OC_SCHEMA     *Schema
+  )
+{
+  if (Event != PLIST_EVENT_OPEN) {
+    Schema->Apply (Serialized, Node, &Schema->Info);
+    return TRUE;
+  }
+
+  if (Schema->Apply == ParseSerializedDict) {
+    return InternalStreamSerializedDict (Serialized, Reader, &Schema->Info);
+  }
+
+  if (Schema->Apply == ParseSerializedMap) {
+    return InternalStreamSerializedMap (Serialized, Reader, &Schema->Info);
+  }
+
+  if (Schema->Apply == ParseSerializedArray) {
+    return InternalStreamSerializedArray (Serialized, Reader, &Schema->Info);
+  }
+
+  DEBUG ((DEBUG_WARN, "OCS: Failed to parse %a field with children\n", XmlNodeName (Node)));
+  return PlistReaderSkip (Reader);
+}
+
+//
+// Streaming counterpart of ParseSerializedDict.
+//
+STATIC
+BOOLEAN
+InternalStreamSerializedDict (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  )
+{
+  UINT32         Index;
+  PLIST_EVENT    Event;
+  CONST CHAR8    *CurrentKey;
+  XML_NODE       *CurrentValue;
+  OC_SCHEMA      *NewSchema;
+
+  for (Index = 0; ; Index++) {
+    Event = PlistReaderNext (Reader, &CurrentValue);
+    if (Event == PLIST_EVENT_CLOSE) {
+      return TRUE;
+    }
+
+    CurrentKey = Event == PLIST_EVENT_KEY ? PlistKeyValue (CurrentValue) : NULL;
+    if (!InternalSkipSerialized (Reader, Event)) {
+      return FALSE;
+    }
+
+    Event = PlistReaderNext (Reader, &CurrentValue);
+    if (Event == PLIST_EVENT_CLOSE) {
+      DEBUG ((DEBUG_WARN, "OCS: No serialized value at %u index!\n", Index));
+      return TRUE;
+    }
+
+    if (Event == PLIST_EVENT_ERROR || Event == PLIST_EVENT_END) {
+      return FALSE;
+    }
+
+    if (CurrentKey == NULL) {
+      DEBUG ((DEBUG_WARN, "OCS: No serialized key at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    //
+    // Skip comments.
+    //
+    if (CurrentKey[0] == '#') {
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    DEBUG ((DEBUG_VERBOSE, "OCS: Parsing serialized at %a at %u index!\n", CurrentKey, Index));
+
+    //
+    // We do not protect from duplicating serialized entries.
+    //
+    NewSchema = LookupConfigSchemaDict (&Info->Dict, CurrentKey);
+
+    if (NewSchema == NULL) {
+      DEBUG ((DEBUG_WARN, "OCS: No schema for %a at %u index!\n", CurrentKey, Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    if (PlistNodeCast (CurrentValue, NewSchema->Type) == NULL) {
+      DEBUG ((DEBUG_WARN, "OCS: No match for %a at %u index!\n", CurrentKey, Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    if (!InternalApplySerialized (Serialized, Reader, Event, CurrentValue, NewSchema)) {
+      return FALSE;
+    }
+  }
+}
+
+//
+// Streaming counterpart of ParseSerializedMap.
+//
+STATIC
+BOOLEAN
+InternalStreamSerializedMap (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  )
+{
+  UINT32       Index;
+  PLIST_EVENT  Event;
+  CONST CHAR8  *CurrentKey;
+  UINT32       CurrentKeyLen;
+  XML_NODE     *ChildNode;
+  VOID         *NewValue;
+  VOID         *NewKey;
+  VOID         *NewKeyValue;
+  BOOLEAN      Success;
+
+  for (Index = 0; ; Index++) {
+    Event = PlistReaderNext (Reader, &ChildNode);
+    if (Event == PLIST_EVENT_CLOSE) {
+      return TRUE;
+    }
+
+    CurrentKey = Event == PLIST_EVENT_KEY ? PlistKeyValue (ChildNode) : NULL;
+    CurrentKeyLen = CurrentKey != NULL ? (UINT32) (AsciiStrLen (CurrentKey) + 1) : 0;
+    if (!InternalSkipSerialized (Reader, Event)) {
+      return FALSE;
+    }
+
+    Event = PlistReaderNext (Reader, &ChildNode);
+    if (Event == PLIST_EVENT_CLOSE) {
+      DEBUG ((DEBUG_INFO, "OCS: No serialized value at %u index!\n", Index));
+      return TRUE;
+    }
+
+    if (Event == PLIST_EVENT_ERROR || Event == PLIST_EVENT_END) {
+      return FALSE;
+    }
+
+    if (CurrentKeyLen == 0) {
+      DEBUG ((DEBUG_INFO, "OCS: No get serialized key at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    //
+    // Skip comments.
+    //
+    if (CurrentKey[0] == '#') {
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    if (PlistNodeCast (ChildNode, Info->List.Schema->Type) == NULL) {
+      DEBUG ((DEBUG_INFO, "OCS: No valid serialized value at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    Success = OcListEntryAllocate (
+      OC_SCHEMA_FIELD (Serialized, VOID, Info->List.Field),
+      &NewValue,
+      &NewKey
+      );
+    if (Success == FALSE) {
+      DEBUG ((DEBUG_INFO, "OCS: Couldn't insert dict serialized at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    NewKeyValue = OcBlobAllocate (NewKey, CurrentKeyLen, NULL);
+    if (NewKeyValue != NULL) {
+      AsciiStrnCpyS ((CHAR8 *) NewKeyValue, CurrentKeyLen, CurrentKey, CurrentKeyLen - 1);
+    } else {
+      DEBUG ((DEBUG_INFO, "OCS: Couldn't allocate key name at %u index!\n", Index));
+    }
+
+    if (!InternalApplySerialized (NewValue, Reader, Event, ChildNode, Info->List.Schema)) {
+      return FALSE;
+    }
+  }
+}
+
+//
+// Streaming counterpart of ParseSerializedArray.
+//
+STATIC
+BOOLEAN
+InternalStreamSerializedArray (
+  VOID            *Serialized,
+  PLIST_READER    *Reader,
+  OC_SCHEMA_INFO  *Info
+  )
+{
+  UINT32       Index;
+  PLIST_EVENT  Event;
+  XML_NODE     *ChildNode;
+  VOID         *NewValue;
+  BOOLEAN      Success;
+
+  for (Index = 0; ; Index++) {
+    Event = PlistReaderNext (Reader, &ChildNode);
+    if (Event == PLIST_EVENT_CLOSE) {
+      return TRUE;
+    }
+
+    if (Event == PLIST_EVENT_ERROR || Event == PLIST_EVENT_END) {
+      return FALSE;
+    }
+
+    DEBUG ((DEBUG_VERBOSE, "OCS: Processing array %u element\n", Index + 1));
+
+    if (PlistNodeCast (ChildNode, Info->List.Schema->Type) == NULL) {
+      DEBUG ((DEBUG_INFO, "OCS: Couldn't get array serialized at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    Success = OcListEntryAllocate (
+      OC_SCHEMA_FIELD (Serialized, VOID, Info->List.Field),
+      &NewValue,
+      NULL
+      );
+    if (Success == FALSE) {
+      DEBUG ((DEBUG_INFO, "OCS: Couldn't insert array serialized at %u index!\n", Index));
+      if (!InternalSkipSerialized (Reader, Event)) {
+        return FALSE;
+      }
+      continue;
+    }
+
+    if (!InternalApplySerialized (NewValue, Reader, Event, ChildNode, Info->List.Schema)) {
+      return FALSE;
+    }
+  }
+}
+
 BOOLEAN
 ParseSerialized (
   VOID            *Serialized,
@@ -322,30 +732,37 @@ ParseSerialized (
   UINT32          PlistSize
   )
 {
-  XML_DOCUMENT        *Document;
+  PLIST_READER        *Reader;
+  PLIST_EVENT         Event;
   XML_NODE            *RootDict;
+  BOOLEAN             Result;
 
-  Document = XmlDocumentParse (PlistBuffer, PlistSize, FALSE);
+  Reader = PlistReaderCreate (PlistBuffer, PlistSize);
 
-  if (Document == NULL) {
+  if (Reader == NULL) {
     DEBUG ((DEBUG_INFO, "OCS: Couldn't parse serialized file!\n"));
     return FALSE;
   }
 
-  RootDict = PlistNodeCast (PlistDocumentRoot (Document), PLIST_NODE_TYPE_DICT);
+  Event = PlistReaderNext (Reader, &RootDict);
 
-  if (RootDict == NULL) {
+  if (Event != PLIST_EVENT_OPEN || PlistNodeCast (RootDict, PLIST_NODE_TYPE_DICT) == NULL) {
     DEBUG ((DEBUG_INFO, "OCS: Couldn't get serialized root!\n"));
-    XmlDocumentFree (Document);
+    PlistReaderFree (Reader);
     return FALSE;
   }
 
-  ParseSerializedDict (
-    Serialized,
-    RootDict,
-    RootSchema
-    );
+  //
+  // Values are applied while reading, so a malformed document may leave
+  // Serialized partially filled.
+  //
+  Result = InternalStreamSerializedDict (Serialized, Reader, RootSchema)
+    && PlistReaderNext (Reader, &RootDict) == PLIST_EVENT_END;
+
+  if (!Result) {
+    DEBUG ((DEBUG_INFO, "OCS: Couldn't parse serialized file!\n"));
+  }
 
-  XmlDocumentFree (Document);
-  return TRUE;
+  PlistReaderFree (Reader);
+  return Result;
 }
@@ -40,6 +40,60 @@ typedef union PRIV_OC_LIST_ {
   PRIV_OC_ARRAY  Array;
 } PRIV_OC_LIST;
 
+//
+// List entries are carved from chunks, the first chunk holds this many
+// entries and every next chunk doubles up to the maximum size.
+//
+#define OC_LIST_CHUNK_MIN_ENTRIES  8
+#define OC_LIST_CHUNK_MAX_SIZE     BASE_64KB
+
+//
+// Dynamic blob values up to 1 KB are carved from slabs of
+// OC_BLOB_SLAB_ENTRIES values of the same power of two size.
+//
+#define OC_BLOB_SLAB_SIZE(Class)   (128U << (Class))
+#define OC_BLOB_SLAB_CLASSES       4
+#define OC_BLOB_SLAB_ENTRIES       32
+
+typedef struct OC_LIST_CHUNK_ OC_LIST_CHUNK;
+typedef struct OC_BLOB_SLAB_ OC_BLOB_SLAB;
+
+//
+// Chunk of list entries, freed with the list.
+//
+struct OC_LIST_CHUNK_ {
+  OC_LIST_CHUNK  *Next;
+  UINT32         Size;
+  UINT32         Used;
+  UINT64         Data[];
+};
+
+//
+// Header preceding every dynamic blob value.  Slab is NULL for values
+// allocated from pool directly, and Next links free slab values.
+//
+typedef union OC_BLOB_HEADER_ {
+  OC_BLOB_SLAB           *Slab;
+  union OC_BLOB_HEADER_  *Next;
+  UINT64                 Align;
+} OC_BLOB_HEADER;
+
+//
+// Slab of same sized blob values.  Slabs with free values are linked
+// in mBlobSlabs, and slabs are freed once their last value is freed.
+// mBlobSlabs is thus empty whenever no slab value is in use.
+//
+struct OC_BLOB_SLAB_ {
+  OC_BLOB_SLAB    *Next;
+  OC_BLOB_SLAB    *Prev;
+  OC_BLOB_HEADER  *Free;
+  UINT32          Class;
+  UINT32          Used;
+  UINT64          Data[];
+};
+
+STATIC OC_BLOB_SLAB  *mBlobSlabs[OC_BLOB_SLAB_CLASSES];
+
 //
 // We have to be a bit careful about this hack, so assert that type layouts match at the very least.
 //
@@ -50,6 +104,7 @@ OC_GLOBAL_STATIC_ASSERT(__builtin_offsetof (PRIV_OC_ARRAY, Construct)  == __buil
 OC_GLOBAL_STATIC_ASSERT(__builtin_offsetof (PRIV_OC_ARRAY, Destruct)   == __builtin_offsetof (PRIV_OC_MAP, Destruct), "PRIV_OC_ARRAY vs PRIV_OC_MAP");
 OC_GLOBAL_STATIC_ASSERT(__builtin_offsetof (PRIV_OC_ARRAY, Values)     == __builtin_offsetof (PRIV_OC_MAP, Values), "PRIV_OC_ARRAY vs PRIV_OC_MAP");
 OC_GLOBAL_STATIC_ASSERT(__builtin_offsetof (PRIV_OC_ARRAY, ValueSize)  == __builtin_offsetof (PRIV_OC_MAP, ValueSize), "PRIV_OC_ARRAY vs PRIV_OC_MAP");
+OC_GLOBAL_STATIC_ASSERT(__builtin_offsetof (PRIV_OC_ARRAY, Chunks)     == __builtin_offsetof (PRIV_OC_MAP, Chunks), "PRIV_OC_ARRAY vs PRIV_OC_MAP");
 #endif
 
 VOID
@@ -65,6 +120,180 @@ OcFreePointer (
   }
 }
 
+//
+// Carves Size bytes out of the list chunks.
+//
+STATIC
+VOID *
+OcListChunkAllocate (
+  PRIV_OC_LIST  *List,
+  UINT32        Size
+  )
+{
+  OC_LIST_CHUNK  *Chunk;
+  UINT32         ChunkSize;
+  VOID           *Memory;
+
+  Size  = ALIGN_VALUE (Size, sizeof (UINT64));
+  Chunk = List->Array.Chunks;
+
+  if (Chunk == NULL || Chunk->Size - Chunk->Used < Size) {
+    if (Chunk == NULL) {
+      ChunkSize = Size * OC_LIST_CHUNK_MIN_ENTRIES;
+    } else {
+      ChunkSize = MIN (Chunk->Size * 2, OC_LIST_CHUNK_MAX_SIZE);
+    }
+
+    ChunkSize = MAX (ChunkSize, Size);
+    Chunk     = AllocatePool (sizeof (OC_LIST_CHUNK) + ChunkSize);
+    if (Chunk == NULL) {
+      return NULL;
+    }
+
+    Chunk->Next        = List->Array.Chunks;
+    Chunk->Size        = ChunkSize;
+    Chunk->Used        = 0;
+    List->Array.Chunks = Chunk;
+  }
+
+  Memory       = (UINT8 *) Chunk->Data + Chunk->Used;
+  Chunk->Used += Size;
+  return Memory;
+}
+
+//
+// Allocates dynamic blob value, small values are carved from slabs.
+//
+STATIC
+VOID *
+OcBlobValueAllocate (
+  UINT32  Size
+  )
+{
+  OC_BLOB_HEADER  *Header;
+  OC_BLOB_SLAB    *Slab;
+  UINT32          Class;
+  UINT32          Stride;
+  UINT32          Index;
+
+  for (Class = 0; Class < OC_BLOB_SLAB_CLASSES; ++Class) {
+    if (Size <= OC_BLOB_SLAB_SIZE (Class)) {
+      break;
+    }
+  }
+
+  if (Class == OC_BLOB_SLAB_CLASSES) {
+    if (OcOverflowAddU32 (Size, sizeof (OC_BLOB_HEADER), &Size)) {
+      return NULL;
+    }
+
+    Header = AllocatePool (Size);
+    if (Header == NULL) {
+      return NULL;
+    }
+
+    Header->Slab = NULL;
+    return Header + 1;
+  }
+
+  Slab = mBlobSlabs[Class];
+  if (Slab == NULL || Slab->Free == NULL) {
+    Stride = sizeof (OC_BLOB_HEADER) + OC_BLOB_SLAB_SIZE (Class);
+    Slab   = AllocatePool (sizeof (OC_BLOB_SLAB) + Stride * OC_BLOB_SLAB_ENTRIES);
+    if (Slab == NULL) {
+      return NULL;
+    }
+
+    Slab->Free = NULL;
+    for (Index = OC_BLOB_SLAB_ENTRIES; Index > 0; --Index) {
+      Header       = (OC_BLOB_HEADER *) ((UINT8 *) Slab->Data + Stride * (Index - 1));
+      Header->Next = Slab->Free;
+      Slab->Free   = Header;
+    }
+
+    Slab->Class = Class;
+    Slab->Used  = 0;
+    Slab->Prev  = NULL;
+    Slab->Next  = mBlobSlabs[Class];
+    if (Slab->Next != NULL) {
+      Slab->Next->Prev = Slab;
+    }
+    mBlobSlabs[Class] = Slab;
+  }
+
+  Header       = Slab->Free;
+  Slab->Free   = Header->Next;
+  Header->Slab = Slab;
+  Slab->Used++;
+
+  //
+  // Full slabs are only reachable from their values.
+  //
+  if (Slab->Free == NULL) {
+    mBlobSlabs[Class] = Slab->Next;
+    if (Slab->Next != NULL) {
+      Slab->Next->Prev = NULL;
+    }
+  }
+
+  return Header + 1;
+}
+
+VOID
+OcFreeBlob (
+  VOID    *Pointer,
+  UINT32  Size
+  )
+{
+  VOID            **Field;
+  OC_BLOB_HEADER  *Header;
+  OC_BLOB_SLAB    *Slab;
+
+  Field = (VOID **) Pointer;
+  if (*Field == NULL) {
+    return;
+  }
+
+  Header = (OC_BLOB_HEADER *) *Field - 1;
+  Slab   = Header->Slab;
+  *Field = NULL;
+
+  if (Slab == NULL) {
+    FreePool (Header);
+    return;
+  }
+
+  //
+  // Slabs with free values are linked again.
+  //
+  if (Slab->Free == NULL) {
+    Slab->Prev = NULL;
+    Slab->Next = mBlobSlabs[Slab->Class];
+    if (Slab->Next != NULL) {
+      Slab->Next->Prev = Slab;
+    }
+    mBlobSlabs[Slab->Class] = Slab;
+  }
+
+  Header->Next = Slab->Free;
+  Slab->Free   = Header;
+  Slab->Used--;
+
+  if (Slab->Used == 0) {
+    if (Slab->Prev != NULL) {
+      Slab->Prev->Next = Slab->Next;
+    } else {
+      mBlobSlabs[Slab->Class] = Slab->Next;
+    }
+
+    if (Slab->Next != NULL) {
+      Slab->Next->Prev = Slab->Prev;
+    }
+
+    FreePool (Slab);
+  }
+}
+
 VOID
 OcZeroField (
   VOID    *Pointer,
@@ -93,19 +322,24 @@ OcFreeList (
 {
   UINT32              Index;
   PRIV_OC_LIST        *List;
+  OC_LIST_CHUNK       *Chunk;
 
   List = (PRIV_OC_LIST *) Pointer;
 
   for (Index = 0; Index < List->Array.Count; Index++) {
     List->Array.Destruct (List->Array.Values[Index], List->Array.ValueSize);
-    FreePool (List->Array.Values[Index]);
 
     if (HasKeys) {
       List->Map.KeyDestruct (List->Map.Keys[Index], List->Map.KeySize);
-      FreePool (List->Map.Keys[Index]);
     }
   }
 
+  while (List->Array.Chunks != NULL) {
+    Chunk              = List->Array.Chunks;
+    List->Array.Chunks = Chunk->Next;
+    FreePool (Chunk);
+  }
+
   OcFreePointer (&List->Array.Values, List->Array.AllocCount * List->Array.ValueSize);
   if (HasKeys) {
     OcFreePointer (&List->Map.Keys, List->Array.AllocCount * List->Map.KeySize);
@@ -153,7 +387,7 @@ OcBlobAllocate (
   // We fit into static space
   //
   if (Size <= Blob->MaxSize) {
-    OcFreePointer (&Blob->DynValue, Blob->Size);
+    OcFreeBlob (&Blob->DynValue, Blob->Size);
     Blob->Size = Size;
     if (OutSize != NULL) {
       *OutSize = &Blob->Size;
@@ -165,8 +399,8 @@ OcBlobAllocate (
   // We do not fit into dynamic space
   //
   if (Size > Blob->Size) {
-    OcFreePointer (&Blob->DynValue, Blob->Size);
-    DynValue = AllocatePool (Size);
+    OcFreeBlob (&Blob->DynValue, Blob->Size);
+    DynValue = OcBlobValueAllocate (Size);
     if (DynValue == NULL) {
       DEBUG ((DEBUG_VERBOSE, "Failed to fit %u bytes in OC_BLOB\n", Size));
       return NULL;
@@ -202,17 +436,16 @@ OcListEntryAllocate (
   List = (PRIV_OC_LIST *) Pointer;
 
   //
-  // Prepare new pair.
+  // Prepare new pair, memory of a failed insertion is left in the chunk.
   //
-  *Value = AllocatePool (List->Array.ValueSize);
+  *Value = OcListChunkAllocate (List, List->Array.ValueSize);
   if (*Value == NULL) {
     return FALSE;
   }
 
   if (Key != NULL) {
-    *Key = AllocatePool (List->Map.KeySize);
+    *Key = OcListChunkAllocate (List, List->Map.KeySize);
     if (*Key == NULL) {
-      FreePool (*Value);
       return FALSE;
     }
   }
@@ -256,10 +489,8 @@ OcListEntryAllocate (
 
   if (NewValues == NULL) {
     List->Array.Destruct (*Value, List->Array.ValueSize);
-    FreePool (*Value);
     if (Key != NULL) {
       List->Map.KeyDestruct (*Key, List->Map.KeySize);
-      FreePool (*Key);
     }
     return FALSE;
   }
@@ -273,8 +504,6 @@ OcListEntryAllocate (
       List->Array.Destruct (*Value, List->Array.ValueSize);
       List->Map.KeyDestruct (*Key, List->Map.KeySize);
       FreePool (NewValues);
-      FreePool (*Value);
-      FreePool (*Key);
       return FALSE;
     }
   } else {
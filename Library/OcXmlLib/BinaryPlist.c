@@ -0,0 +1,1327 @@
+/** @file
+
+OcXmlLib binary plist support
+
+Copyright (c) 2019, vit9696
+
+All rights reserved.
+
+This program and the accompanying materials
+are licensed and made available under the terms and conditions of the BSD License
+which accompanies this distribution.  The full text of the license may be found at
+http://opensource.org/licenses/bsd-license.php
+
+THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+
+**/
+
+#include <Library/OcXmlLib.h>
+#include <Library/BaseLib.h>
+#include <Library/BaseMemoryLib.h>
+#include <Library/DebugLib.h>
+#include <Library/MemoryAllocationLib.h>
+#include <Library/OcGuardLib.h>
+
+//
+// Binary plist magic and version.
+//
+#define BPLIST_MAGIC       "bplist00"
+#define BPLIST_MAGIC_SIZE  (sizeof (BPLIST_MAGIC) - 1)
+
+//
+// Object marker types, stored in the upper nibble.
+//
+#define BPLIST_TYPE_SIMPLE   0x0
+#define BPLIST_TYPE_INTEGER  0x1
+#define BPLIST_TYPE_REAL     0x2
+#define BPLIST_TYPE_DATE     0x3
+#define BPLIST_TYPE_DATA     0x4
+#define BPLIST_TYPE_ASCII    0x5
+#define BPLIST_TYPE_UTF16    0x6
+#define BPLIST_TYPE_ARRAY    0xA
+#define BPLIST_TYPE_DICT     0xD
+
+//
+// Simple object values, stored in the lower nibble.
+//
+#define BPLIST_SIMPLE_FALSE  0x8
+#define BPLIST_SIMPLE_TRUE   0x9
+
+//
+// Lower nibble value indicating that an integer object with the count
+// follows the marker.
+//
+#define BPLIST_COUNT_EXTENDED  0xF
+
+//
+// Maximum size of a string character encoded as UTF-8.
+//
+#define BPLIST_UTF8_CHAR_MAX_SIZE  4
+
+//
+// Minimal extra allocation size during export.
+//
+#define BPLIST_EXPORT_MIN_ALLOCATION_SIZE 4096
+
+//
+// Conditionally enable error printing.
+//
+#ifdef XML_PRINT_ERRORS
+#define BPLIST_USAGE_ERROR(Message) \
+  DEBUG ((DEBUG_VERBOSE, "%a\n", Message));
+#else
+#define BPLIST_USAGE_ERROR(X) do {} while (0)
+#endif
+
+#pragma pack(push, 1)
+
+//
+// Binary plist trailer, located at the end of the document.
+// Multibyte integers are stored in big endian.
+//
+typedef struct {
+  UINT8  Unused[5];
+  UINT8  SortVersion;
+  UINT8  OffsetSize;
+  UINT8  RefSize;
+  UINT8  NumObjects[8];
+  UINT8  TopObject[8];
+  UINT8  OffsetTableOffset[8];
+} BPLIST_TRAILER;
+
+#pragma pack(pop)
+
+//
+// A BPLIST_DOCUMENT references the buffer and the decoded trailer.
+//
+struct BPLIST_DOCUMENT_ {
+  CONST UINT8  *Buffer;
+  //
+  // Offset table offset, objects are located before it.
+  //
+  UINT32       ObjectsEnd;
+  UINT32       NumObjects;
+  BPLIST_NODE  Root;
+  UINT8        OffsetSize;
+  UINT8        RefSize;
+};
+
+//
+// Decoded object marker.
+//
+typedef struct {
+  UINT8   Type;
+  UINT8   Info;
+  //
+  // Element count for data, strings, arrays, and dictionaries.
+  //
+  UINT32  Count;
+  //
+  // Offset of the object contents following the marker.
+  //
+  UINT32  Payload;
+} BPLIST_OBJECT;
+
+//
+// Binary plist writer context.
+//
+typedef struct {
+  UINT8   *Buffer;
+  UINT32  Size;
+  UINT32  AllocSize;
+  //
+  // Object offsets, objects are numbered in the order they are written.
+  //
+  UINT32  *Offsets;
+  UINT32  NumObjects;
+  UINT8   RefSize;
+} BPLIST_WRITER;
+
+STATIC
+UINT64
+BplistReadBe (
+  CONST UINT8  *Data,
+  UINT32       Size
+  )
+{
+  UINT64  Value;
+
+  Value = 0;
+  while (Size-- > 0) {
+    Value = LShiftU64 (Value, 8) | *Data++;
+  }
+
+  return Value;
+}
+
+//
+// Decodes the marker and validates the extents of the object.
+//
+STATIC
+BOOLEAN
+BplistObject (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  BPLIST_OBJECT    *Object
+  )
+{
+  UINT64  Offset;
+  UINT64  Count;
+  UINT64  Size;
+  UINT8   Marker;
+  UINT32  CountSize;
+
+  if (Node >= Document->NumObjects) {
+    return FALSE;
+  }
+
+  Offset = BplistReadBe (
+    &Document->Buffer[Document->ObjectsEnd + Node * Document->OffsetSize],
+    Document->OffsetSize
+    );
+  if (Offset < BPLIST_MAGIC_SIZE || Offset >= Document->ObjectsEnd) {
+    return FALSE;
+  }
+
+  Marker          = Document->Buffer[Offset];
+  Object->Type    = Marker >> 4U;
+  Object->Info    = Marker & 0xFU;
+  Object->Count   = Object->Info;
+  Object->Payload = (UINT32) Offset + 1;
+
+  switch (Object->Type) {
+    case BPLIST_TYPE_SIMPLE:
+      return Object->Info == BPLIST_SIMPLE_FALSE || Object->Info == BPLIST_SIMPLE_TRUE;
+    case BPLIST_TYPE_INTEGER:
+    case BPLIST_TYPE_REAL:
+    case BPLIST_TYPE_DATE:
+      //
+      // 128-bit integers are not supported.
+      //
+      if (Object->Info > 3) {
+        return FALSE;
+      }
+      Size = 1U << Object->Info;
+      return Object->Payload + Size <= Document->ObjectsEnd;
+    case BPLIST_TYPE_DATA:
+    case BPLIST_TYPE_ASCII:
+    case BPLIST_TYPE_UTF16:
+    case BPLIST_TYPE_ARRAY:
+    case BPLIST_TYPE_DICT:
+      break;
+    default:
+      return FALSE;
+  }
+
+  if (Object->Info == BPLIST_COUNT_EXTENDED) {
+    if (Object->Payload >= Document->ObjectsEnd) {
+      return FALSE;
+    }
+
+    Marker = Document->Buffer[Object->Payload];
+    if ((Marker >> 4U) != BPLIST_TYPE_INTEGER || (Marker & 0xFU) > 3) {
+      return FALSE;
+    }
+
+    CountSize = 1U << (Marker & 0xFU);
+    if (Object->Payload + 1 + CountSize > Document->ObjectsEnd) {
+      return FALSE;
+    }
+
+    Count = BplistReadBe (&Document->Buffer[Object->Payload + 1], CountSize);
+    if (Count > Document->ObjectsEnd) {
+      return FALSE;
+    }
+
+    Object->Count    = (UINT32) Count;
+    Object->Payload += 1 + CountSize;
+  }
+
+  Size = Object->Count;
+  if (Object->Type == BPLIST_TYPE_UTF16) {
+    Size *= sizeof (CHAR16);
+  } else if (Object->Type == BPLIST_TYPE_ARRAY) {
+    Size *= Document->RefSize;
+  } else if (Object->Type == BPLIST_TYPE_DICT) {
+    Size *= 2U * Document->RefSize;
+  }
+
+  return Object->Payload + Size <= Document->ObjectsEnd;
+}
+
+//
+// Returns Index-th reference of an array or dictionary object.
+//
+STATIC
+BPLIST_NODE
+BplistObjectRef (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_OBJECT    *Object,
+  UINT32           Index
+  )
+{
+  UINT64  Ref;
+
+  Ref = BplistReadBe (
+    &Document->Buffer[Object->Payload + Index * Document->RefSize],
+    Document->RefSize
+    );
+
+  if (Ref >= Document->NumObjects) {
+    return BPLIST_NODE_INVALID;
+  }
+
+  return (BPLIST_NODE) Ref;
+}
+
+//
+// Encodes string character at Index as UTF-8 and advances Index.
+// UTF-16 surrogate pairs are combined, unpaired surrogates are kept.
+// Utf8 must hold BPLIST_UTF8_CHAR_MAX_SIZE bytes and is not terminated.
+//
+// @return Number of bytes stored in Utf8.
+//
+STATIC
+UINT32
+BplistStringChar (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_OBJECT    *Object,
+  UINT32           *Index,
+  CHAR8            *Utf8
+  )
+{
+  CONST UINT8  *Units;
+  UINT32       Char;
+  UINT32       Low;
+
+  if (Object->Type == BPLIST_TYPE_ASCII) {
+    Utf8[0] = (CHAR8) Document->Buffer[Object->Payload + *Index];
+    ++(*Index);
+    return 1;
+  }
+
+  Units = &Document->Buffer[Object->Payload];
+  Char  = (UINT32) BplistReadBe (&Units[*Index * sizeof (CHAR16)], sizeof (CHAR16));
+  ++(*Index);
+
+  if (Char >= 0xD800 && Char < 0xDC00 && *Index < Object->Count) {
+    Low = (UINT32) BplistReadBe (&Units[*Index * sizeof (CHAR16)], sizeof (CHAR16));
+    if (Low >= 0xDC00 && Low < 0xE000) {
+      Char = 0x10000 + ((Char - 0xD800) << 10U) + (Low - 0xDC00);
+      ++(*Index);
+    }
+  }
+
+  if (Char < 0x80) {
+    Utf8[0] = (CHAR8) Char;
+    return 1;
+  }
+
+  if (Char < 0x800) {
+    Utf8[0] = (CHAR8) (0xC0 | (Char >> 6U));
+    Utf8[1] = (CHAR8) (0x80 | (Char & 0x3FU));
+    return 2;
+  }
+
+  if (Char < 0x10000) {
+    Utf8[0] = (CHAR8) (0xE0 | (Char >> 12U));
+    Utf8[1] = (CHAR8) (0x80 | ((Char >> 6U) & 0x3FU));
+    Utf8[2] = (CHAR8) (0x80 | (Char & 0x3FU));
+    return 3;
+  }
+
+  Utf8[0] = (CHAR8) (0xF0 | (Char >> 18U));
+  Utf8[1] = (CHAR8) (0x80 | ((Char >> 12U) & 0x3FU));
+  Utf8[2] = (CHAR8) (0x80 | ((Char >> 6U) & 0x3FU));
+  Utf8[3] = (CHAR8) (0x80 | (Char & 0x3FU));
+  return 4;
+}
+
+//
+// Decodes string or key object.
+//
+STATIC
+BOOLEAN
+BplistStringObject (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  BPLIST_OBJECT    *Object
+  )
+{
+  return BplistObject (Document, Node, Object)
+    && (Object->Type == BPLIST_TYPE_ASCII || Object->Type == BPLIST_TYPE_UTF16);
+}
+
+BOOLEAN
+BplistIsBinary (
+  CONST VOID  *Buffer,
+  UINT32      Length
+  )
+{
+  return Length >= BPLIST_MAGIC_SIZE
+    && CompareMem (Buffer, BPLIST_MAGIC, BPLIST_MAGIC_SIZE) == 0;
+}
+
+BPLIST_DOCUMENT *
+BplistDocumentParse (
+  CONST UINT8  *Buffer,
+  UINT32       Length
+  )
+{
+  BPLIST_DOCUMENT       *Document;
+  CONST BPLIST_TRAILER  *Trailer;
+  UINT64                NumObjects;
+  UINT64                TopObject;
+  UINT64                TableOffset;
+  UINT32                TrailerOffset;
+
+  if (Length < BPLIST_MAGIC_SIZE + sizeof (BPLIST_TRAILER)
+    || Length > XML_PARSER_MAX_SIZE
+    || !BplistIsBinary (Buffer, Length)) {
+    BPLIST_USAGE_ERROR ("BplistDocumentParse::not binary plist");
+    return NULL;
+  }
+
+  TrailerOffset = Length - sizeof (BPLIST_TRAILER);
+  Trailer       = (CONST BPLIST_TRAILER *) &Buffer[TrailerOffset];
+  NumObjects    = BplistReadBe (Trailer->NumObjects, sizeof (Trailer->NumObjects));
+  TopObject     = BplistReadBe (Trailer->TopObject, sizeof (Trailer->TopObject));
+  TableOffset   = BplistReadBe (Trailer->OffsetTableOffset, sizeof (Trailer->OffsetTableOffset));
+
+  if (Trailer->OffsetSize == 0 || Trailer->OffsetSize > sizeof (UINT64)
+    || Trailer->RefSize == 0 || Trailer->RefSize > sizeof (UINT64)
+    || NumObjects == 0 || TopObject >= NumObjects
+    || TableOffset <= BPLIST_MAGIC_SIZE || TableOffset > TrailerOffset
+    || NumObjects > (TrailerOffset - TableOffset) / Trailer->OffsetSize) {
+    BPLIST_USAGE_ERROR ("BplistDocumentParse::invalid trailer");
+    return NULL;
+  }
+
+  Document = AllocatePool (sizeof (*Document));
+  if (Document == NULL) {
+    BPLIST_USAGE_ERROR ("BplistDocumentParse::document allocation failed");
+    return NULL;
+  }
+
+  Document->Buffer     = Buffer;
+  Document->ObjectsEnd = (UINT32) TableOffset;
+  Document->NumObjects = (UINT32) NumObjects;
+  Document->Root       = (BPLIST_NODE) TopObject;
+  Document->OffsetSize = Trailer->OffsetSize;
+  Document->RefSize    = Trailer->RefSize;
+
+  return Document;
+}
+
+VOID
+BplistDocumentFree (
+  BPLIST_DOCUMENT  *Document
+  )
+{
+  FreePool (Document);
+}
+
+BPLIST_NODE
+BplistDocumentRoot (
+  BPLIST_DOCUMENT  *Document
+  )
+{
+  return Document->Root;
+}
+
+PLIST_NODE_TYPE
+BplistNodeType (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object)) {
+    return PLIST_NODE_TYPE_MAX;
+  }
+
+  switch (Object.Type) {
+    case BPLIST_TYPE_SIMPLE:
+      return Object.Info == BPLIST_SIMPLE_TRUE ? PLIST_NODE_TYPE_TRUE : PLIST_NODE_TYPE_FALSE;
+    case BPLIST_TYPE_INTEGER:
+      return PLIST_NODE_TYPE_INTEGER;
+    case BPLIST_TYPE_REAL:
+      return PLIST_NODE_TYPE_REAL;
+    case BPLIST_TYPE_DATE:
+      return PLIST_NODE_TYPE_DATE;
+    case BPLIST_TYPE_DATA:
+      return PLIST_NODE_TYPE_DATA;
+    case BPLIST_TYPE_ASCII:
+    case BPLIST_TYPE_UTF16:
+      return PLIST_NODE_TYPE_STRING;
+    case BPLIST_TYPE_ARRAY:
+      return PLIST_NODE_TYPE_ARRAY;
+    case BPLIST_TYPE_DICT:
+      return PLIST_NODE_TYPE_DICT;
+    default:
+      return PLIST_NODE_TYPE_MAX;
+  }
+}
+
+BPLIST_NODE
+BplistNodeCast (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  PLIST_NODE_TYPE  Type
+  )
+{
+  PLIST_NODE_TYPE  NodeType;
+
+  NodeType = BplistNodeType (Document, Node);
+
+  if (NodeType == PLIST_NODE_TYPE_MAX) {
+    return BPLIST_NODE_INVALID;
+  }
+
+  if (Type == PLIST_NODE_TYPE_ANY || Type == NodeType
+    || (Type == PLIST_NODE_TYPE_KEY && NodeType == PLIST_NODE_TYPE_STRING)) {
+    return Node;
+  }
+
+  return BPLIST_NODE_INVALID;
+}
+
+UINT32
+BplistNodeChildren (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_ARRAY) {
+    return 0;
+  }
+
+  return Object.Count;
+}
+
+BPLIST_NODE
+BplistNodeChild (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           Child
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object)
+    || Object.Type != BPLIST_TYPE_ARRAY
+    || Child >= Object.Count) {
+    return BPLIST_NODE_INVALID;
+  }
+
+  return BplistObjectRef (Document, &Object, Child);
+}
+
+UINT32
+BplistDictChildren (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_DICT) {
+    return 0;
+  }
+
+  return Object.Count;
+}
+
+BPLIST_NODE
+BplistDictChild (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           Child,
+  BPLIST_NODE      *Value OPTIONAL
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object)
+    || Object.Type != BPLIST_TYPE_DICT
+    || Child >= Object.Count) {
+    if (Value != NULL) {
+      *Value = BPLIST_NODE_INVALID;
+    }
+    return BPLIST_NODE_INVALID;
+  }
+
+  //
+  // Dictionary keys are followed by the values in the same order.
+  //
+  if (Value != NULL) {
+    *Value = BplistObjectRef (Document, &Object, Object.Count + Child);
+  }
+
+  return BplistObjectRef (Document, &Object, Child);
+}
+
+BPLIST_NODE
+BplistDictFind (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CONST CHAR8      *Key
+  )
+{
+  BPLIST_OBJECT  Object;
+  BPLIST_OBJECT  KeyObject;
+  UINT32         Index;
+  UINT32         CharIndex;
+  UINT32         KeyIndex;
+  UINT32         CharSize;
+  CHAR8          Utf8[BPLIST_UTF8_CHAR_MAX_SIZE];
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_DICT) {
+    return BPLIST_NODE_INVALID;
+  }
+
+  for (Index = 0; Index < Object.Count; ++Index) {
+    if (!BplistStringObject (Document, BplistObjectRef (Document, &Object, Index), &KeyObject)) {
+      continue;
+    }
+
+    CharIndex = 0;
+    KeyIndex  = 0;
+    while (CharIndex < KeyObject.Count && Key[KeyIndex] != '\0') {
+      CharSize = BplistStringChar (Document, &KeyObject, &CharIndex, Utf8);
+      if (AsciiStrnLenS (&Key[KeyIndex], CharSize) < CharSize
+        || CompareMem (&Key[KeyIndex], Utf8, CharSize) != 0) {
+        break;
+      }
+      KeyIndex += CharSize;
+    }
+
+    if (CharIndex == KeyObject.Count && Key[KeyIndex] == '\0') {
+      return BplistObjectRef (Document, &Object, Object.Count + Index);
+    }
+  }
+
+  return BPLIST_NODE_INVALID;
+}
+
+BOOLEAN
+BplistStringValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CHAR8            *Value,
+  UINT32           *Size
+  )
+{
+  BPLIST_OBJECT  Object;
+  UINT32         CharIndex;
+  UINT32         CharSize;
+  UINT32         Length;
+  CHAR8          Utf8[BPLIST_UTF8_CHAR_MAX_SIZE];
+
+  if (*Size == 0 || !BplistStringObject (Document, Node, &Object)) {
+    return FALSE;
+  }
+
+  CharIndex = 0;
+  Length    = 0;
+  while (CharIndex < Object.Count) {
+    CharSize = BplistStringChar (Document, &Object, &CharIndex, Utf8);
+    if (Length + CharSize >= *Size) {
+      break;
+    }
+
+    CopyMem (&Value[Length], Utf8, CharSize);
+    Length += CharSize;
+  }
+
+  Value[Length] = '\0';
+  *Size = Length + 1;
+  return TRUE;
+}
+
+BOOLEAN
+BplistStringSize (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  UINT32           *Size
+  )
+{
+  BPLIST_OBJECT  Object;
+  UINT32         CharIndex;
+  UINT32         Length;
+  CHAR8          Utf8[BPLIST_UTF8_CHAR_MAX_SIZE];
+
+  if (!BplistStringObject (Document, Node, &Object)) {
+    return FALSE;
+  }
+
+  CharIndex = 0;
+  Length    = 0;
+  if (Object.Type == BPLIST_TYPE_ASCII) {
+    Length = Object.Count;
+  } else {
+    while (CharIndex < Object.Count) {
+      Length += BplistStringChar (Document, &Object, &CharIndex, Utf8);
+    }
+  }
+
+  *Size = Length + 1;
+  return TRUE;
+}
+
+BOOLEAN
+BplistDataValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  CONST UINT8      **Data  OPTIONAL,
+  UINT32           *Size
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_DATA) {
+    return FALSE;
+  }
+
+  if (Data != NULL) {
+    *Data = Object.Count > 0 ? &Document->Buffer[Object.Payload] : NULL;
+  }
+
+  *Size = Object.Count;
+  return TRUE;
+}
+
+BOOLEAN
+BplistBooleanValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  BOOLEAN          *Value
+  )
+{
+  BPLIST_OBJECT  Object;
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_SIMPLE) {
+    return FALSE;
+  }
+
+  *Value = Object.Info == BPLIST_SIMPLE_TRUE;
+  return TRUE;
+}
+
+BOOLEAN
+BplistIntegerValue (
+  BPLIST_DOCUMENT  *Document,
+  BPLIST_NODE      Node,
+  VOID             *Value,
+  UINT32           Size
+  )
+{
+  BPLIST_OBJECT  Object;
+  UINT64         Temp;
+
+  if (!BplistObject (Document, Node, &Object) || Object.Type != BPLIST_TYPE_INTEGER) {
+    return FALSE;
+  }
+
+  //
+  // 8-byte integers are signed, smaller ones are unsigned.
+  //
+  Temp = BplistReadBe (&Document->Buffer[Object.Payload], 1U << Object.Info);
+
+  switch (Size) {
+    case sizeof (UINT64):
+      *(UINT64 *) Value = Temp;
+      return TRUE;
+    case sizeof (UINT32):
+      *(UINT32 *) Value = (UINT32) Temp;
+      return TRUE;
+    case sizeof (UINT16):
+      *(UINT16 *) Value = (UINT16) Temp;
+      return TRUE;
+    case sizeof (UINT8):
+      *(UINT8 *) Value = (UINT8) Temp;
+      return TRUE;
+    default:
+      return FALSE;
+  }
+}
+
+//
+// Reserves Size bytes at the end of the exported buffer.
+//
+// @return Reserved memory or NULL.
+//
+STATIC
+UINT8 *
+BplistWriterReserve (
+  BPLIST_WRITER  *Writer,
+  UINT32         Size
+  )
+{
+  UINT8   *NewBuffer;
+  UINT32  NewSize;
+  UINT8   *Memory;
+
+  if (OcOverflowAddU32 (Writer->Size, Size, &NewSize)) {
+    return NULL;
+  }
+
+  if (NewSize > Writer->AllocSize) {
+    //
+    // Grow geometrically to keep export time linear.
+    //
+    if (OcOverflowAddU32 (NewSize, MAX (NewSize, BPLIST_EXPORT_MIN_ALLOCATION_SIZE), &NewSize)) {
+      NewSize = MAX_UINT32;
+    }
+
+    NewBuffer = ReallocatePool (Writer->AllocSize, NewSize, Writer->Buffer);
+    if (NewBuffer == NULL) {
+      return NULL;
+    }
+
+    Writer->Buffer    = NewBuffer;
+    Writer->AllocSize = NewSize;
+  }
+
+  Memory        = &Writer->Buffer[Writer->Size];
+  Writer->Size += Size;
+  return Memory;
+}
+
+//
+// Appends Value as Size-byte big endian integer.
+//
+STATIC
+BOOLEAN
+BplistWriteBe (
+  BPLIST_WRITER  *Writer,
+  UINT64         Value,
+  UINT32         Size
+  )
+{
+  UINT8  *Memory;
+
+  Memory = BplistWriterReserve (Writer, Size);
+  if (Memory == NULL) {
+    return FALSE;
+  }
+
+  while (Size-- > 0) {
+    Memory[Size] = (UINT8) Value;
+    Value        = RShiftU64 (Value, 8);
+  }
+
+  return TRUE;
+}
+
+//
+// Appends integer object using the shortest encoding.
+//
+STATIC
+BOOLEAN
+BplistWriteInteger (
+  BPLIST_WRITER  *Writer,
+  UINT64         Value
+  )
+{
+  UINT8  Info;
+
+  if (Value <= MAX_UINT8) {
+    Info = 0;
+  } else if (Value <= MAX_UINT16) {
+    Info = 1;
+  } else if (Value <= MAX_UINT32) {
+    Info = 2;
+  } else {
+    Info = 3;
+  }
+
+  return BplistWriteBe (Writer, (BPLIST_TYPE_INTEGER << 4U) | Info, 1)
+    && BplistWriteBe (Writer, Value, 1U << Info);
+}
+
+//
+// Starts a new object and appends its marker with element count.
+//
+STATIC
+BOOLEAN
+BplistWriteMarker (
+  BPLIST_WRITER  *Writer,
+  UINT8          Type,
+  UINT32         Count,
+  UINT32         *Object
+  )
+{
+  *Object = Writer->NumObjects++;
+  Writer->Offsets[*Object] = Writer->Size;
+
+  if (Count < BPLIST_COUNT_EXTENDED) {
+    return BplistWriteBe (Writer, (Type << 4U) | Count, 1);
+  }
+
+  return BplistWriteBe (Writer, (Type << 4U) | BPLIST_COUNT_EXTENDED, 1)
+    && BplistWriteInteger (Writer, Count);
+}
+
+//
+// Appends object references.
+//
+STATIC
+BOOLEAN
+BplistWriteRefs (
+  BPLIST_WRITER  *Writer,
+  UINT32         *Refs,
+  UINT32         Count
+  )
+{
+  UINT32  Index;
+
+  for (Index = 0; Index < Count; ++Index) {
+    if (!BplistWriteBe (Writer, Refs[Index], Writer->RefSize)) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+//
+// Decodes UTF-8 character at *String and advances String.
+//
+// @return Unicode character or MAX_UINT32 for invalid sequences.
+//
+STATIC
+UINT32
+BplistUtf8Char (
+  CONST UINT8  **String
+  )
+{
+  CONST UINT8  *Bytes;
+  UINT32       Char;
+  UINT32       Extra;
+  UINT32       Index;
+
+  Bytes = *String;
+
+  if (Bytes[0] < 0x80) {
+    Char  = Bytes[0];
+    Extra = 0;
+  } else if ((Bytes[0] & 0xE0U) == 0xC0) {
+    Char  = Bytes[0] & 0x1FU;
+    Extra = 1;
+  } else if ((Bytes[0] & 0xF0U) == 0xE0) {
+    Char  = Bytes[0] & 0x0FU;
+    Extra = 2;
+  } else if ((Bytes[0] & 0xF8U) == 0xF0) {
+    Char  = Bytes[0] & 0x07U;
+    Extra = 3;
+  } else {
+    return MAX_UINT32;
+  }
+
+  for (Index = 1; Index <= Extra; ++Index) {
+    //
+    // Also stops at the terminator.
+    //
+    if ((Bytes[Index] & 0xC0U) != 0x80) {
+      return MAX_UINT32;
+    }
+    Char = (Char << 6U) | (Bytes[Index] & 0x3FU);
+  }
+
+  if (Char > 0x10FFFF) {
+    return MAX_UINT32;
+  }
+
+  *String = &Bytes[Extra + 1];
+  return Char;
+}
+
+//
+// Appends string object, as ASCII when possible or as UTF-16 otherwise.
+//
+STATIC
+BOOLEAN
+BplistWriteString (
+  BPLIST_WRITER  *Writer,
+  CONST CHAR8    *String,
+  UINT32         *Object
+  )
+{
+  CONST UINT8  *Walker;
+  UINT32       Char;
+  UINTN        Length;
+  UINT32       Units;
+  BOOLEAN      IsAscii;
+  UINT8        *Memory;
+
+  if (String == NULL) {
+    String = "";
+  }
+
+  IsAscii = TRUE;
+  Units   = 0;
+  Walker  = (CONST UINT8 *) String;
+  while (*Walker != '\0') {
+    Char = BplistUtf8Char (&Walker);
+    if (Char == MAX_UINT32) {
+      BPLIST_USAGE_ERROR ("BplistExport::invalid UTF-8 string");
+      return FALSE;
+    }
+
+    if (Char >= 0x80) {
+      IsAscii = FALSE;
+    }
+    Units   += Char < 0x10000 ? 1 : 2;
+  }
+
+  if (IsAscii) {
+    Length = AsciiStrLen (String);
+    if (!BplistWriteMarker (Writer, BPLIST_TYPE_ASCII, (UINT32) Length, Object)) {
+      return FALSE;
+    }
+
+    Memory = BplistWriterReserve (Writer, (UINT32) Length);
+    if (Memory == NULL) {
+      return FALSE;
+    }
+
+    CopyMem (Memory, String, Length);
+    return TRUE;
+  }
+
+  if (!BplistWriteMarker (Writer, BPLIST_TYPE_UTF16, Units, Object)) {
+    return FALSE;
+  }
+
+  Walker = (CONST UINT8 *) String;
+  while (*Walker != '\0') {
+    Char = BplistUtf8Char (&Walker);
+    if (Char >= 0x10000) {
+      Char -= 0x10000;
+      if (!BplistWriteBe (Writer, 0xD800 + (Char >> 10U), sizeof (CHAR16))) {
+        return FALSE;
+      }
+      Char = 0xDC00 + (Char & 0x3FFU);
+    }
+
+    if (!BplistWriteBe (Writer, Char, sizeof (CHAR16))) {
+      return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+//
+// Appends integer object from plist integer node.
+// Negative values take 8 bytes, as only these are signed.
+//
+STATIC
+BOOLEAN
+BplistWriteIntegerNode (
+  BPLIST_WRITER  *Writer,
+  XML_NODE       *Node,
+  UINT32         *Object
+  )
+{
+  CONST CHAR8  *Content;
+  BOOLEAN      Negative;
+  UINT64       Value;
+
+  Content = XmlNodeContent (Node);
+  if (Content == NULL) {
+    return FALSE;
+  }
+
+  Negative = Content[0] == '-';
+  if (Negative) {
+    ++Content;
+  }
+
+  if (Content[0] == '0' && (Content[1] == 'x' || Content[1] == 'X')) {
+    Value = AsciiStrHexToUint64 (Content);
+  } else {
+    Value = AsciiStrDecimalToUint64 (Content);
+  }
+
+  *Object = Writer->NumObjects++;
+  Writer->Offsets[*Object] = Writer->Size;
+
+  if (Negative) {
+    return BplistWriteBe (Writer, (BPLIST_TYPE_INTEGER << 4U) | 3, 1)
+      && BplistWriteBe (Writer, 0 - Value, sizeof (UINT64));
+  }
+
+  return BplistWriteInteger (Writer, Value);
+}
+
+//
+// Appends data object from plist data node.
+//
+STATIC
+BOOLEAN
+BplistWriteDataNode (
+  BPLIST_WRITER  *Writer,
+  XML_NODE       *Node,
+  UINT32         *Object
+  )
+{
+  UINT8    *Data;
+  UINT32   Size;
+  UINT8    *Memory;
+  BOOLEAN  Result;
+
+  if (!PlistDataSize (Node, &Size)) {
+    return FALSE;
+  }
+
+  Data = NULL;
+  if (Size > 0) {
+    Data = AllocatePool (Size);
+    if (Data == NULL) {
+      return FALSE;
+    }
+
+    if (!PlistDataValue (Node, Data, &Size)) {
+      FreePool (Data);
+      return FALSE;
+    }
+  }
+
+  Result = BplistWriteMarker (Writer, BPLIST_TYPE_DATA, Size, Object);
+  if (Result && Size > 0) {
+    Memory = BplistWriterReserve (Writer, Size);
+    if (Memory != NULL) {
+      CopyMem (Memory, Data, Size);
+    } else {
+      Result = FALSE;
+    }
+  }
+
+  if (Data != NULL) {
+    FreePool (Data);
+  }
+
+  return Result;
+}
+
+//
+// Counts objects needed for the node and its children.
+//
+STATIC
+BOOLEAN
+BplistCountObjects (
+  XML_NODE  *Node,
+  UINT32    *Count
+  )
+{
+  XML_NODE  *Value;
+  UINT32    Index;
+  UINT32    Children;
+
+  if (OcOverflowAddU32 (*Count, 1, Count)) {
+    return FALSE;
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_DICT) != NULL) {
+    Children = PlistDictChildren (Node);
+    for (Index = 0; Index < Children; ++Index) {
+      if (PlistKeyValue (PlistDictChild (Node, Index, &Value)) == NULL
+        || OcOverflowAddU32 (*Count, 1, Count)
+        || !BplistCountObjects (Value, Count)) {
+        return FALSE;
+      }
+    }
+    return TRUE;
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_ARRAY) != NULL) {
+    Children = XmlNodeChildren (Node);
+    for (Index = 0; Index < Children; ++Index) {
+      if (!BplistCountObjects (XmlNodeChild (Node, Index), Count)) {
+        return FALSE;
+      }
+    }
+    return TRUE;
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_STRING) != NULL
+    || PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) != NULL
+    || PlistNodeCast (Node, PLIST_NODE_TYPE_INTEGER) != NULL
+    || PlistNodeCast (Node, PLIST_NODE_TYPE_TRUE) != NULL
+    || PlistNodeCast (Node, PLIST_NODE_TYPE_FALSE) != NULL) {
+    return TRUE;
+  }
+
+  BPLIST_USAGE_ERROR ("BplistExport::unsupported node");
+  return FALSE;
+}
+
+//
+// Appends the node after its children, so that container references
+// are known when the container is written.
+//
+STATIC
+BOOLEAN
+BplistWriteNode (
+  BPLIST_WRITER  *Writer,
+  XML_NODE       *Node,
+  UINT32         *Object
+  )
+{
+  XML_NODE  *Value;
+  UINT32    *Refs;
+  UINT32    Children;
+  UINT32    Index;
+  BOOLEAN   Result;
+  BOOLEAN   IsDict;
+
+  IsDict = PlistNodeCast (Node, PLIST_NODE_TYPE_DICT) != NULL;
+
+  if (IsDict || PlistNodeCast (Node, PLIST_NODE_TYPE_ARRAY) != NULL) {
+    Children = IsDict ? PlistDictChildren (Node) : XmlNodeChildren (Node);
+    Refs     = NULL;
+
+    if (Children > 0) {
+      Refs = AllocatePool ((IsDict ? 2 : 1) * Children * sizeof (*Refs));
+      if (Refs == NULL) {
+        return FALSE;
+      }
+    }
+
+    Result = TRUE;
+    for (Index = 0; Result && Index < Children; ++Index) {
+      if (IsDict) {
+        Result = BplistWriteString (
+                   Writer,
+                   PlistKeyValue (PlistDictChild (Node, Index, &Value)),
+                   &Refs[Index]
+                   )
+          && BplistWriteNode (Writer, Value, &Refs[Children + Index]);
+      } else {
+        Result = BplistWriteNode (Writer, XmlNodeChild (Node, Index), &Refs[Index]);
+      }
+    }
+
+    if (Result) {
+      Result = BplistWriteMarker (
+                 Writer,
+                 IsDict ? BPLIST_TYPE_DICT : BPLIST_TYPE_ARRAY,
+                 Children,
+                 Object
+                 )
+        && BplistWriteRefs (Writer, Refs, (IsDict ? 2 : 1) * Children);
+    }
+
+    if (Refs != NULL) {
+      FreePool (Refs);
+    }
+
+    return Result;
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_STRING) != NULL) {
+    return BplistWriteString (Writer, XmlNodeContent (Node), Object);
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) != NULL) {
+    return BplistWriteDataNode (Writer, Node, Object);
+  }
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_INTEGER) != NULL) {
+    return BplistWriteIntegerNode (Writer, Node, Object);
+  }
+
+  *Object = Writer->NumObjects++;
+  Writer->Offsets[*Object] = Writer->Size;
+
+  return BplistWriteBe (
+    Writer,
+    PlistNodeCast (Node, PLIST_NODE_TYPE_TRUE) != NULL ? BPLIST_SIMPLE_TRUE : BPLIST_SIMPLE_FALSE,
+    1
+    );
+}
+
+UINT8 *
+BplistExport (
+  XML_NODE  *Node,
+  UINT32    *Length
+  )
+{
+  BPLIST_WRITER  Writer;
+  UINT32         NumObjects;
+  UINT32         Root;
+  UINT32         TableOffset;
+  UINT32         Index;
+  UINT8          OffsetSize;
+  BOOLEAN        Result;
+
+  NumObjects = 0;
+  if (!BplistCountObjects (Node, &NumObjects)
+    || NumObjects > MAX_UINT32 / sizeof (*Writer.Offsets)) {
+    return NULL;
+  }
+
+  ZeroMem (&Writer, sizeof (Writer));
+  Writer.Offsets = AllocatePool (NumObjects * sizeof (*Writer.Offsets));
+  if (Writer.Offsets == NULL) {
+    return NULL;
+  }
+
+  if (NumObjects <= MAX_UINT8) {
+    Writer.RefSize = sizeof (UINT8);
+  } else if (NumObjects <= MAX_UINT16) {
+    Writer.RefSize = sizeof (UINT16);
+  } else {
+    Writer.RefSize = sizeof (UINT32);
+  }
+
+  Result = BplistWriterReserve (&Writer, BPLIST_MAGIC_SIZE) != NULL;
+  if (Result) {
+    CopyMem (Writer.Buffer, BPLIST_MAGIC, BPLIST_MAGIC_SIZE);
+    Result = BplistWriteNode (&Writer, Node, &Root);
+  }
+
+  if (Result) {
+    ASSERT (Writer.NumObjects == NumObjects);
+
+    TableOffset = Writer.Size;
+    if (TableOffset <= MAX_UINT8) {
+      OffsetSize = sizeof (UINT8);
+    } else if (TableOffset <= MAX_UINT16) {
+      OffsetSize = sizeof (UINT16);
+    } else {
+      OffsetSize = sizeof (UINT32);
+    }
+
+    for (Index = 0; Result && Index < NumObjects; ++Index) {
+      Result = BplistWriteBe (&Writer, Writer.Offsets[Index], OffsetSize);
+    }
+  }
+
+  if (Result) {
+    Result = BplistWriteBe (&Writer, 0, OFFSET_OF (BPLIST_TRAILER, OffsetSize))
+      && BplistWriteBe (&Writer, OffsetSize, sizeof (UINT8))
+      && BplistWriteBe (&Writer, Writer.RefSize, sizeof (UINT8))
+      && BplistWriteBe (&Writer, NumObjects, sizeof (UINT64))
+      && BplistWriteBe (&Writer, Root, sizeof (UINT64))
+      && BplistWriteBe (&Writer, TableOffset, sizeof (UINT64));
+  }
+
+  FreePool (Writer.Offsets);
+
+  if (!Result) {
+    if (Writer.Buffer != NULL) {
+      FreePool (Writer.Buffer);
+    }
+    return NULL;
+  }
+
+  *Length = Writer.Size;
+  return Writer.Buffer;
+}
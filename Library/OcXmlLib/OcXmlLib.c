@@ -52,11 +52,54 @@ WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
 //
 #define XML_EXPORT_MIN_ALLOCATION_SIZE 4096
 
+//
+// Minimal node arena block size.
+//
+#define XML_ARENA_MIN_BLOCK_SIZE 4096
+
+//
+// Fraction of lazily parsed document size to allocate per arena block.
+//
+#define XML_ARENA_LAZY_FRACTION 8
+
+//
+// Minimal plist dictionary size to index its keys.
+//
+#define XML_KEY_INDEX_MIN_COUNT 16
+
+//
+// Byte-wise SWAR constants: 0x0101...01 and 0x8080...80.
+//
+#define XML_WORD_LOW   ((UINTN) -1 / 0xFF)
+#define XML_WORD_HIGH  (XML_WORD_LOW * 0x80)
+
+//
+// Same as IsAsciiSpace: space, \t, \n, \v, \f or \r.
+//
+#define XML_IS_SPACE(Char) ((Char) == ' ' || (UINT8) ((Char) - '\t') <= (UINT8) ('\r' - '\t'))
+
 struct XML_NODE_LIST_;
 struct XML_PARSER_;
+struct XML_ARENA_BLOCK_;
+struct XML_ARENA_;
+struct XML_KEY_INDEX_;
 
 typedef struct XML_NODE_LIST_ XML_NODE_LIST;
 typedef struct XML_PARSER_ XML_PARSER;
+typedef struct XML_ARENA_BLOCK_ XML_ARENA_BLOCK;
+typedef struct XML_ARENA_ XML_ARENA;
+typedef struct XML_KEY_INDEX_ XML_KEY_INDEX;
+
+//
+// Unparsed children of a lazily parsed node, Start and End delimit their
+// markup in the document buffer, which is left untouched until parsed.
+//
+typedef struct {
+  XML_DOCUMENT  *Document;
+  UINT32        Start;
+  UINT32        End;
+  UINT32        Level;
+} XML_LAZY_CHILDREN;
 
 //
 // An XML_NODE will always contain a tag name and possibly a list of
@@ -68,20 +111,96 @@ struct XML_NODE_ {
   CONST CHAR8    *Content;
   XML_NODE       *Real;
   XML_NODE_LIST  *Children;
+  //
+  // Children are parsed on first access when not NULL.
+  //
+  XML_LAZY_CHILDREN  *Lazy;
+  //
+  // Children failed to parse on first access.
+  //
+  BOOLEAN        Malformed;
+  //
+  // Content points to the parsed buffer and may be modified.
+  //
+  BOOLEAN        InBuffer;
+  //
+  // Document arena the node, its child list, and its key index are
+  // allocated from.  NULL for the standalone plist reader node.
+  //
+  XML_ARENA      *Arena;
+  //
+  // Content was base64 decoded in place to DataSize bytes.
+  //
+  BOOLEAN        DataDecoded;
+  //
+  // Content failed in place decoding and was partially overwritten.
+  //
+  BOOLEAN        DataInvalid;
+  UINT32         DataSize;
 };
 
 struct XML_NODE_LIST_ {
+  UINT32         NodeCount;
+  UINT32         AllocCount;
+  XML_KEY_INDEX  *KeyIndex;
+  XML_NODE       *NodeList[];
+};
+
+//
+// Plist dictionary key hash table built on first PlistDictFind call.
+// Slots contain dictionary entry indices plus one.
+//
+struct XML_KEY_INDEX_ {
   UINT32    NodeCount;
-  UINT32    AllocCount;
-  XML_NODE  *NodeList[];
+  UINT32    Mask;
+  UINT32    Slots[];
 };
 
+typedef struct {
+  UINT32        Start;
+  UINT32        End;
+} XML_SPAN;
+
 typedef struct {
   UINT32        RefCount;
   UINT32        RefAllocCount;
   XML_NODE      **RefList;
+  //
+  // Lazily parsed documents record the markup of skipped references,
+  // which are parsed from a copy when first referenced.
+  //
+  BOOLEAN       Lazy;
+  XML_SPAN      *RefSpans;
 } XML_REFLIST;
 
+//
+// Bump allocator block holding nodes and everything they own.
+//
+struct XML_ARENA_BLOCK_ {
+  XML_ARENA_BLOCK  *Next;
+  UINT32           Size;
+  UINT32           Used;
+  UINT64           Data[];
+};
+
+//
+// Nodes are never freed individually, so they are allocated from an arena
+// released at once.  This includes nodes added after parsing, child lists,
+// and key indices, outgrown ones are left in the arena.
+//
+struct XML_ARENA_ {
+  XML_ARENA_BLOCK  *Blocks;
+  UINT32           BlockSize;
+};
+
+//
+// Arena position memory allocated after may be released to.
+//
+typedef struct {
+  XML_ARENA_BLOCK  *Block;
+  UINT32           Used;
+} XML_ARENA_MARK;
+
 //
 // An XML_DOCUMENT simply contains the root node and the underlying buffer.
 //
@@ -93,16 +212,72 @@ struct XML_DOCUMENT_ {
 
   XML_NODE      *Root;
   XML_REFLIST   References;
+  XML_ARENA     Arena;
+  BOOLEAN       WithRefs;
+  //
+  // Lazily parsed children of a node were malformed.
+  //
+  BOOLEAN       Malformed;
 };
 
 //
 // Parser context.
 //
 struct XML_PARSER_ {
-  CHAR8  *Buffer;
-  UINT32 Position;
-  UINT32 Length;
-  UINT32 Level;
+  CHAR8      *Buffer;
+  UINT32     Position;
+  UINT32     Length;
+  UINT32     Level;
+  XML_ARENA  *Arena;
+  //
+  // Document of the lazily parsed nodes, NULL to parse all children.
+  //
+  XML_DOCUMENT  *Lazy;
+  //
+  // Children of the nodes being parsed, moved to exactly sized
+  // node lists once a node is closed.
+  //
+  XML_NODE   **Stack;
+  UINT32     StackCount;
+  UINT32     StackAllocCount;
+};
+
+//
+// Streaming plist reader context.
+//
+struct PLIST_READER_ {
+  XML_PARSER   Parser;
+  //
+  // Node describing the last event.
+  //
+  XML_NODE     Node;
+  //
+  // Opening tag of the first child, consumed while looking for children.
+  //
+  CONST CHAR8  *NextTag;
+  BOOLEAN      NextSelfClosing;
+  //
+  // Last opened node has no children and is closed by the next event.
+  //
+  BOOLEAN      PendingClose;
+  BOOLEAN      Failed;
+  BOOLEAN      Finished;
+  //
+  // Tag names and child counts of the open nodes, starting with plist.
+  //
+  UINT32       Depth;
+  CONST CHAR8  *Tags[XML_PARSER_NEST_LEVEL];
+  UINT32       Children[XML_PARSER_NEST_LEVEL];
+  //
+  // Binary plist read instead of the parser buffer, objects of the open
+  // nodes, node limit, and memory for converted contents with its
+  // positions when the nodes were opened.
+  //
+  BPLIST_DOCUMENT  *Binary;
+  BPLIST_NODE      Objects[XML_PARSER_NEST_LEVEL];
+  UINT32           NodesLeft;
+  XML_ARENA        Contents;
+  XML_ARENA_MARK   Marks[XML_PARSER_NEST_LEVEL];
 };
 
 //
@@ -133,10 +308,15 @@ PlistNodeTypes[PLIST_NODE_TYPE_MAX] = {
 };
 
 
+//
+// Parses the numeric argument out of the first AttributesLength bytes of
+// Attributes, which need not be terminated.
+//
 STATIC
 BOOLEAN
 XmlParseAttributeNumber (
   CONST CHAR8  *Attributes,
+  UINT32       AttributesLength,
   CONST CHAR8  *Argument,
   UINT32       ArgumentLength,
   UINT32       *ArgumentValue
@@ -144,6 +324,7 @@ XmlParseAttributeNumber (
 {
   CONST CHAR8  *ArgumentStart;
   CONST CHAR8  *ArgumentEnd;
+  CONST CHAR8  *AttributesEnd;
   UINTN        Number;
   CHAR8        NumberStr[16];
 
@@ -151,16 +332,27 @@ XmlParseAttributeNumber (
   // FIXME: This may give false positives.
   //
 
-  ArgumentStart = AsciiStrStr (Attributes, Argument);
-  if (ArgumentStart == NULL) {
+  if (AttributesLength < ArgumentLength) {
     return FALSE;
   }
 
+  AttributesEnd = Attributes + AttributesLength;
+  ArgumentStart = Attributes;
+  while (CompareMem (ArgumentStart, Argument, ArgumentLength) != 0) {
+    ++ArgumentStart;
+    if (ArgumentStart + ArgumentLength > AttributesEnd) {
+      return FALSE;
+    }
+  }
+
   ArgumentStart += ArgumentLength;
-  ArgumentEnd   = AsciiStrStr (ArgumentStart, "\"");
-  Number        = ArgumentEnd - ArgumentStart;
+  ArgumentEnd    = ArgumentStart;
+  while (ArgumentEnd < AttributesEnd && *ArgumentEnd != '"') {
+    ++ArgumentEnd;
+  }
 
-  if (ArgumentEnd == NULL || Number > sizeof (NumberStr) - 1) {
+  Number = ArgumentEnd - ArgumentStart;
+  if (ArgumentEnd == AttributesEnd || Number > sizeof (NumberStr) - 1) {
     return FALSE;
   }
 
@@ -172,35 +364,135 @@ XmlParseAttributeNumber (
 }
 
 //
-// Allocates the node with contents.
+// Allocates memory from the arena.
+//
+STATIC
+VOID *
+XmlArenaAllocate (
+  XML_ARENA  *Arena,
+  UINT32     Size
+  )
+{
+  XML_ARENA_BLOCK  *Block;
+  UINT32           BlockSize;
+  VOID             *Memory;
+
+  Size  = ALIGN_VALUE (Size, sizeof (UINT64));
+  Block = Arena->Blocks;
+
+  if (Block == NULL || Block->Size - Block->Used < Size) {
+    BlockSize = MAX (Arena->BlockSize, Size);
+    Block     = AllocatePool (sizeof (XML_ARENA_BLOCK) + BlockSize);
+    if (Block == NULL) {
+      return NULL;
+    }
+
+    Block->Next   = Arena->Blocks;
+    Block->Size   = BlockSize;
+    Block->Used   = 0;
+    Arena->Blocks = Block;
+  }
+
+  Memory       = (UINT8 *) Block->Data + Block->Used;
+  Block->Used += Size;
+  return Memory;
+}
+
+//
+// Remembers current arena position.
+//
+STATIC
+VOID
+XmlArenaMark (
+  XML_ARENA       *Arena,
+  XML_ARENA_MARK  *Mark
+  )
+{
+  Mark->Block = Arena->Blocks;
+  Mark->Used  = Arena->Blocks != NULL ? Arena->Blocks->Used : 0;
+}
+
+//
+// Frees memory allocated from the arena after the mark was taken.
+//
+STATIC
+VOID
+XmlArenaRelease (
+  XML_ARENA       *Arena,
+  XML_ARENA_MARK  *Mark
+  )
+{
+  XML_ARENA_BLOCK  *Block;
+
+  while (Arena->Blocks != Mark->Block) {
+    Block         = Arena->Blocks;
+    Arena->Blocks = Block->Next;
+    FreePool (Block);
+  }
+
+  if (Arena->Blocks != NULL) {
+    Arena->Blocks->Used = Mark->Used;
+  }
+}
+
+//
+// Frees all memory allocated from the arena.
+//
+STATIC
+VOID
+XmlArenaFree (
+  XML_ARENA  *Arena
+  )
+{
+  XML_ARENA_BLOCK  *Block;
+
+  while (Arena->Blocks != NULL) {
+    Block         = Arena->Blocks;
+    Arena->Blocks = Block->Next;
+    FreePool (Block);
+  }
+}
+
+//
+// Allocates the node with contents from the arena.
 //
 STATIC
 XML_NODE *
 XmlNodeCreate (
+  XML_ARENA      *Arena,
   CONST CHAR8    *Name,
   CONST CHAR8    *Attributes,
   CONST CHAR8    *Content,
   XML_NODE       *Real,
-  XML_NODE_LIST  *Children
+  XML_NODE_LIST  *Children,
+  BOOLEAN        InBuffer
   )
 {
   XML_NODE  *Node;
 
-  Node = AllocatePool (sizeof (XML_NODE));
+  Node = XmlArenaAllocate (Arena, sizeof (XML_NODE));
 
   if (Node != NULL) {
-    Node->Name       = Name;
-    Node->Attributes = Attributes;
-    Node->Content    = Content;
-    Node->Real       = Real;
-    Node->Children   = Children;
+    Node->Name        = Name;
+    Node->Attributes  = Attributes;
+    Node->Content     = Content;
+    Node->Real        = Real;
+    Node->Children    = Children;
+    Node->Lazy        = NULL;
+    Node->Malformed   = FALSE;
+    Node->InBuffer    = InBuffer;
+    Node->Arena       = Arena;
+    Node->DataDecoded = FALSE;
+    Node->DataInvalid = FALSE;
+    Node->DataSize    = 0;
   }
 
   return Node;
 }
 
 //
-// Adds child nodes to node.
+// Adds child nodes to node.  Parsed node lists are exactly sized, outgrown
+// lists stay in the arena.
 //
 STATIC
 BOOLEAN
@@ -231,9 +523,13 @@ XmlNodeChildPush (
   }
 
   //
-  // Insertion will exceed the limit.
+  // Insertion will exceed the limit.  Lists used to grow threefold from one
+  // entry, so the limit was always hit on the fast path above and a node
+  // could hold exactly XML_PARSER_NODE_COUNT children.  Parsed lists are
+  // exactly sized and may grow here at any count, so both paths check the
+  // same limit.
   //
-  if (NodeCount >= XML_PARSER_NODE_COUNT - 1) {
+  if (NodeCount >= XML_PARSER_NODE_COUNT) {
     return FALSE;
   }
 
@@ -243,7 +539,8 @@ XmlNodeChildPush (
   //
   AllocCount *= 3;
 
-  NewList = (XML_NODE_LIST *) AllocatePool (
+  NewList = XmlArenaAllocate (
+    Node->Arena,
     sizeof (XML_NODE_LIST) + sizeof (NewList->NodeList[0]) * AllocCount
     );
 
@@ -253,6 +550,7 @@ XmlNodeChildPush (
 
   NewList->NodeCount  = NodeCount + 1;
   NewList->AllocCount = AllocCount;
+  NewList->KeyIndex   = NULL;
 
   if (Node->Children != NULL) {
     CopyMem (
@@ -261,7 +559,10 @@ XmlNodeChildPush (
       sizeof (NewList->NodeList[0]) * NodeCount
       );
 
-    FreePool (Node->Children);
+    //
+    // The key index is rebuilt in place when large enough.
+    //
+    NewList->KeyIndex = Node->Children->KeyIndex;
   }
 
   NewList->NodeList[NodeCount] = Child;
@@ -270,15 +571,19 @@ XmlNodeChildPush (
   return TRUE;
 }
 
+//
+// Makes room for the reference, spans are allocated for lazily parsed
+// documents.
+//
 STATIC
 BOOLEAN
-XmlPushReference (
+XmlReserveReference (
   XML_REFLIST  *References,
-  XML_NODE     *Node,
   UINT32       ReferenceNumber
   )
 {
   XML_NODE   **NewReferences;
+  XML_SPAN   *NewSpans;
   UINT32     NewRefAllocCount;
 
   if (ReferenceNumber >= XML_PARSER_MAX_REFERENCE_COUNT) {
@@ -295,6 +600,15 @@ XmlPushReference (
       return FALSE;
     }
 
+    NewSpans = NULL;
+    if (References->Lazy) {
+      NewSpans = AllocateZeroPool (NewRefAllocCount * sizeof (References->RefSpans[0]));
+      if (NewSpans == NULL) {
+        FreePool (NewReferences);
+        return FALSE;
+      }
+    }
+
     if (References->RefList != NULL) {
       CopyMem (
         &NewReferences[0],
@@ -304,11 +618,20 @@ XmlPushReference (
       FreePool (References->RefList);
     }
 
+    if (References->RefSpans != NULL) {
+      CopyMem (
+        &NewSpans[0],
+        &References->RefSpans[0],
+        References->RefCount * sizeof (References->RefSpans[0])
+        );
+      FreePool (References->RefSpans);
+    }
+
     References->RefList       = NewReferences;
+    References->RefSpans      = NewSpans;
     References->RefAllocCount = NewRefAllocCount;
   }
 
-  References->RefList[ReferenceNumber] = Node;
   if (ReferenceNumber >= References->RefCount) {
     References->RefCount = ReferenceNumber + 1;
   }
@@ -316,9 +639,104 @@ XmlPushReference (
   return TRUE;
 }
 
+STATIC
+BOOLEAN
+XmlPushReference (
+  XML_REFLIST  *References,
+  XML_NODE     *Node,
+  UINT32       ReferenceNumber
+  )
+{
+  if (!XmlReserveReference (References, ReferenceNumber)) {
+    return FALSE;
+  }
+
+  References->RefList[ReferenceNumber] = Node;
+  return TRUE;
+}
+
+//
+// Records the markup of a reference skipped in a lazily parsed document.
+// A node parsed from the same markup is kept.
+//
+STATIC
+BOOLEAN
+XmlPushLazyReference (
+  XML_REFLIST  *References,
+  UINT32       ReferenceNumber,
+  UINT32       Start,
+  UINT32       End
+  )
+{
+  if (!XmlReserveReference (References, ReferenceNumber)) {
+    return FALSE;
+  }
+
+  if (References->RefSpans[ReferenceNumber].Start != Start
+    || References->RefSpans[ReferenceNumber].End != End) {
+    References->RefList[ReferenceNumber]        = NULL;
+    References->RefSpans[ReferenceNumber].Start = Start;
+    References->RefSpans[ReferenceNumber].End   = End;
+  }
+
+  return TRUE;
+}
+
+STATIC
+XML_NODE *
+XmlParseNode (
+  XML_PARSER  *Parser,
+  XML_REFLIST *References
+  );
+
+STATIC
+BOOLEAN
+XmlNodeExpand (
+  XML_NODE  *Node
+  );
+
+//
+// Parses a reference skipped in a lazily parsed document.  The markup is
+// copied, as the original is only parsed in place with its parent.
+//
+STATIC
+XML_NODE *
+XmlParseLazyReference (
+  XML_PARSER   *Parser,
+  XML_REFLIST  *References,
+  UINT32       ReferenceNumber
+  )
+{
+  XML_PARSER  Copy;
+  XML_SPAN    *Span;
+  XML_NODE    *Node;
+
+  Span = &References->RefSpans[ReferenceNumber];
+
+  ZeroMem (&Copy, sizeof (Copy));
+  Copy.Length = Span->End - Span->Start;
+  Copy.Arena  = Parser->Arena;
+  Copy.Buffer = XmlArenaAllocate (Parser->Arena, Copy.Length);
+  if (Copy.Buffer == NULL) {
+    return NULL;
+  }
+
+  CopyMem (Copy.Buffer, &Parser->Buffer[Span->Start], Copy.Length);
+
+  Node = XmlParseNode (&Copy, NULL);
+
+  if (Copy.Stack != NULL) {
+    FreePool (Copy.Stack);
+  }
+
+  References->RefList[ReferenceNumber] = Node;
+  return Node;
+}
+
 STATIC
 XML_NODE *
 XmlNodeReal (
+  XML_PARSER   *Parser,
   XML_REFLIST  *References,
   CONST CHAR8  *Attributes
   )
@@ -332,6 +750,7 @@ XmlNodeReal (
 
   HasArgument = XmlParseAttributeNumber (
     Attributes,
+    (UINT32) AsciiStrLen (Attributes),
     "IDREF=\"",
     L_STR_LEN ("IDREF=\""),
     &Number
@@ -341,28 +760,88 @@ XmlNodeReal (
     return NULL;
   }
 
+  //
+  // Skipped references are only visible after their markup, as they are
+  // when parsed in order.
+  //
+  if (References->RefList[Number] == NULL
+    && References->RefSpans != NULL
+    && References->RefSpans[Number].End != 0
+    && References->RefSpans[Number].End <= Parser->Position) {
+    return XmlParseLazyReference (Parser, References, Number);
+  }
+
   return References->RefList[Number];
 }
 
 //
-// Frees the resources allocated by the node.
+// Saves parsed child node until its parent is closed.
 //
 STATIC
-VOID
-XmlNodeFree (
-  XML_NODE  *Node
+BOOLEAN
+XmlParserStackPush (
+  XML_PARSER  *Parser,
+  XML_NODE    *Node
   )
 {
-  UINT32  Index;
-
-  if (Node->Children != NULL) {
-    for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
-      XmlNodeFree (Node->Children->NodeList[Index]);
+  XML_NODE  **NewStack;
+  UINT32    NewAllocCount;
+
+  if (Parser->StackCount == Parser->StackAllocCount) {
+    NewAllocCount = MAX (Parser->StackAllocCount * 2, 64);
+    NewStack      = ReallocatePool (
+      Parser->StackAllocCount * sizeof (Parser->Stack[0]),
+      NewAllocCount * sizeof (Parser->Stack[0]),
+      Parser->Stack
+      );
+    if (NewStack == NULL) {
+      return FALSE;
     }
-    FreePool (Node->Children);
+
+    Parser->Stack           = NewStack;
+    Parser->StackAllocCount = NewAllocCount;
+  }
+
+  Parser->Stack[Parser->StackCount++] = Node;
+  return TRUE;
+}
+
+//
+// Moves child nodes saved since StackBase to the node.
+//
+STATIC
+BOOLEAN
+XmlParserStackPop (
+  XML_PARSER  *Parser,
+  XML_NODE    *Node,
+  UINT32      StackBase
+  )
+{
+  XML_NODE_LIST  *List;
+  UINT32         NodeCount;
+
+  NodeCount = Parser->StackCount - StackBase;
+
+  List = XmlArenaAllocate (
+    Parser->Arena,
+    sizeof (XML_NODE_LIST) + sizeof (List->NodeList[0]) * NodeCount
+    );
+  if (List == NULL) {
+    return FALSE;
   }
 
-  FreePool (Node);
+  List->NodeCount  = NodeCount;
+  List->AllocCount = NodeCount;
+  List->KeyIndex   = NULL;
+  CopyMem (
+    &List->NodeList[0],
+    &Parser->Stack[StackBase],
+    sizeof (List->NodeList[0]) * NodeCount
+    );
+
+  Node->Children     = List;
+  Parser->StackCount = StackBase;
+  return TRUE;
 }
 
 STATIC
@@ -375,6 +854,11 @@ XmlFreeRefs (
     FreePool (References->RefList);
     References->RefList = NULL;
   }
+
+  if (References->RefSpans != NULL) {
+    FreePool (References->RefSpans);
+    References->RefSpans = NULL;
+  }
 }
 
 //
@@ -532,60 +1016,107 @@ XmlSkipWhitespace (
   XML_PARSER_INFO (Parser, "whitespace");
 
   while (Parser->Position < Parser->Length
-    && IsAsciiSpace (Parser->Buffer[Parser->Position])) {
+    && XML_IS_SPACE (Parser->Buffer[Parser->Position])) {
     Parser->Position++;
   }
 }
 
 //
-// Parses the name out of the an XML tag's ending.
-//
-// ---( Example )---
-// tag_name>
-// ---
+// Returns the position of the first Character at or after the parser's
+// position, or the parser's length when there is none.  Content is scanned
+// a machine word at a time.
 //
 STATIC
-CONST CHAR8 *
-XmlParseTagEnd (
-  XML_PARSER   *Parser,
-  BOOLEAN      *SelfClosing,
-  CONST CHAR8  **Attributes
+UINT32
+XmlParserFind (
+  XML_PARSER  *Parser,
+  CHAR8       Character
   )
 {
-  CHAR8   Current;
-  UINT32  Start;
-  UINT32  AttributeStart;
-  UINT32  Length = 0;
-  UINT32  NameLength = 0;
+  CONST CHAR8  *Current;
+  CONST CHAR8  *End;
+  UINTN        Repeated;
+  UINTN        Word;
+
+  Current = &Parser->Buffer[Parser->Position];
+  End     = &Parser->Buffer[Parser->Length];
+
+  while (Current < End && ((UINTN) Current & (sizeof (UINTN) - 1)) != 0) {
+    if (*Current == Character) {
+      return (UINT32) (Current - Parser->Buffer);
+    }
+    ++Current;
+  }
+
+  //
+  // A byte of Word is zero exactly where Current matches Character.
+  //
+  Repeated = XML_WORD_LOW * (UINT8) Character;
+  while ((UINTN) (End - Current) >= sizeof (UINTN)) {
+    Word = *(CONST UINTN *) Current ^ Repeated;
+    if (((Word - XML_WORD_LOW) & ~Word & XML_WORD_HIGH) != 0) {
+      break;
+    }
+    Current += sizeof (UINTN);
+  }
+
+  while (Current < End && *Current != Character) {
+    ++Current;
+  }
+
+  return (UINT32) (Current - Parser->Buffer);
+}
+
+//
+// Parses the name out of the an XML tag's ending.
+//
+// ---( Example )---
+// tag_name>
+// ---
+//
+STATIC
+CONST CHAR8 *
+XmlParseTagEnd (
+  XML_PARSER   *Parser,
+  BOOLEAN      *SelfClosing,
+  CONST CHAR8  **Attributes
+  )
+{
+  CHAR8   Current;
+  UINT32  Start;
+  UINT32  AttributeStart;
+  UINT32  Length = 0;
+  UINT32  NameLength = 0;
 
   XML_PARSER_INFO (Parser, "tag_end");
 
-  Current = XmlParserPeek (Parser, CURRENT_CHARACTER);
   Start = Parser->Position;
 
   //
   // Parse until `>' or a whitespace is reached.
   //
   while (Start + Length < Parser->Length) {
+    Current = Parser->Buffer[Start + Length];
     if (('/' == Current) || ('>' == Current)) {
       break;
     }
 
-    if (NameLength == 0 && IsAsciiSpace (Current)) {
+    if (NameLength == 0 && XML_IS_SPACE (Current)) {
       NameLength = Length;
 
       if (NameLength == 0) {
+        Parser->Position = Start + Length;
         XML_PARSER_ERROR (Parser, CURRENT_CHARACTER, "XmlParseTagEnd::expected tag name");
         return NULL;
       }
     }
 
-    XmlParserConsume (Parser, 1);
     Length++;
-
-    Current = XmlParserPeek (Parser, CURRENT_CHARACTER);
   }
 
+  Parser->Position = Start + Length;
+  Current = XmlParserPeek (Parser, CURRENT_CHARACTER);
+
   //
   // Handle attributes.
   //
@@ -593,7 +1124,7 @@ XmlParseTagEnd (
     if (Attributes != NULL && (Current == '/' || Current == '>')) {
       *Attributes = &Parser->Buffer[Start + NameLength];
       AttributeStart = NameLength;
-      while (AttributeStart < Length && IsAsciiSpace (**Attributes)) {
+      while (AttributeStart < Length && XML_IS_SPACE (**Attributes)) {
         (*Attributes)++;
         AttributeStart++;
       }
@@ -684,9 +1215,8 @@ XmlParseTagOpen (
     //
     // Skip the control sequence.
     //
-    do {
-      XmlParserConsume (Parser, 1);
-    } while (XmlParserPeek (Parser, CURRENT_CHARACTER) != '>' && Parser->Position < Parser->Length);
+    XmlParserConsume (Parser, 1);
+    Parser->Position = XmlParserFind (Parser, '>');
     XmlParserConsume (Parser, 1);
 
   } while (Parser->Position < Parser->Length);
@@ -766,7 +1296,6 @@ XmlParseContent (
 {
   UINTN  Start;
   UINTN  Length;
-  CHAR8  Current;
 
   XML_PARSER_INFO(Parser, "content");
 
@@ -776,21 +1305,12 @@ XmlParseContent (
   XmlSkipWhitespace (Parser);
 
   Start = Parser->Position;
-  Length = 0;
 
   //
   // Consume until `<' is reached.
   //
-  while (Start + Length < Parser->Length) {
-    Current = XmlParserPeek (Parser, CURRENT_CHARACTER);
-
-    if ('<' == Current) {
-      break;
-    } else {
-      XmlParserConsume (Parser, 1);
-      Length++;
-    }
-  }
+  Parser->Position = XmlParserFind (Parser, '<');
+  Length = Parser->Position - Start;
 
   //
   // Next character must be an `<' or we have reached end of file.
@@ -803,7 +1323,7 @@ XmlParseContent (
   //
   // Ignore tailing whitespace.
   //
-  while ((Length > 0) && IsAsciiSpace (Parser->Buffer[Start + Length - 1])) {
+  while ((Length > 0) && XML_IS_SPACE (Parser->Buffer[Start + Length - 1])) {
     Length--;
   }
 
@@ -834,20 +1354,25 @@ XmlBufferAppend (
   NewSize = *AllocSize;
 
   if (NewSize - *CurrentSize <= DataLength) {
+    //
+    // Grow geometrically to keep export linear on large documents.
+    //
     if (DataLength + 1 <= XML_EXPORT_MIN_ALLOCATION_SIZE) {
       NewSize += XML_EXPORT_MIN_ALLOCATION_SIZE;
     } else {
       NewSize += DataLength + 1;
     }
 
-    NewBuffer = AllocatePool (NewSize);
+    if (NewSize < *AllocSize * 2 && *AllocSize <= MAX_UINT32 / 2) {
+      NewSize = *AllocSize * 2;
+    }
+
+    NewBuffer = ReallocatePool (*CurrentSize, NewSize, *Buffer);
     if (NewBuffer == NULL) {
       XML_USAGE_ERROR("XmlBufferAppend::failed to allocate");
       return;
     }
 
-    CopyMem (NewBuffer, *Buffer, *CurrentSize);
-    FreePool (*Buffer);
     *Buffer    = NewBuffer;
     *AllocSize = NewSize;
   }
@@ -873,6 +1398,10 @@ XmlNodeExportRecursive (
   UINT32  NameLength;
 
   if (Skip != 0) {
+    if (Node->Lazy != NULL) {
+      XmlNodeExpand (Node);
+    }
+
     if (Node->Children != NULL) {
       for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
         XmlNodeExportRecursive (Node->Children->NodeList[Index], Buffer, AllocSize, CurrentSize, Skip - 1);
@@ -892,10 +1421,23 @@ XmlNodeExportRecursive (
     XmlBufferAppend (Buffer, AllocSize, CurrentSize, Node->Attributes, (UINT32)AsciiStrLen (Node->Attributes));
   }
 
-  if (Node->Children != NULL || Node->Content != NULL) {
+  if (Node->Children != NULL || Node->Content != NULL || Node->Lazy != NULL) {
     XmlBufferAppend (Buffer, AllocSize, CurrentSize, ">", L_STR_LEN (">"));
 
-    if (Node->Children != NULL) {
+    if (Node->Lazy != NULL) {
+      //
+      // Skipped children are left untouched in the source buffer, so their
+      // span is copied as is.  Parsed nodes are NUL-terminated in place and
+      // are printed from their names and contents instead.
+      //
+      XmlBufferAppend (
+        Buffer,
+        AllocSize,
+        CurrentSize,
+        &Node->Lazy->Document->Buffer.Buffer[Node->Lazy->Start],
+        Node->Lazy->End - Node->Lazy->Start
+        );
+    } else if (Node->Children != NULL) {
       for (Index = 0; Index < Node->Children->NodeCount; ++Index) {
         XmlNodeExportRecursive (Node->Children->NodeList[Index], Buffer, AllocSize, CurrentSize, 0);
       }
@@ -911,6 +1453,326 @@ XmlNodeExportRecursive (
   }
 }
 
+//
+// Skips the children of a lazily parsed node without modifying the buffer
+// and stops at its close tag.  Tag names, nesting, and child counts are
+// checked as when parsing, text content is not.  Skipped references are
+// recorded for XmlNodeReal.
+//
+STATIC
+BOOLEAN
+XmlSkipChildren (
+  XML_PARSER   *Parser,
+  XML_REFLIST  *References,
+  CONST CHAR8  *Name
+  )
+{
+  CONST CHAR8  *Buffer;
+  CHAR8        Current;
+  UINT32       Position;
+  UINT32       NameStart;
+  UINT32       NameLength;
+  UINT32       TagEnd;
+  UINT32       Depth;
+  UINT32       ReferenceNumber;
+  BOOLEAN      IsReference;
+
+  //
+  // Open descendants, the skipped node is at depth 0.
+  //
+  struct {
+    UINT32   NameStart;
+    UINT32   NameLength;
+    UINT32   Start;
+    UINT32   Children;
+    UINT32   ReferenceNumber;
+    BOOLEAN  IsReference;
+  } Open[XML_PARSER_NEST_LEVEL + 1];
+
+  Buffer           = Parser->Buffer;
+  Depth            = 0;
+  Open[0].Children = 0;
+
+  while (TRUE) {
+    Position         = XmlParserFind (Parser, '<');
+    Parser->Position = Position;
+    Current          = XmlParserPeek (Parser, NEXT_CHARACTER);
+
+    if (Current == 0) {
+      XML_PARSER_ERROR (Parser, CURRENT_CHARACTER, "XmlSkipChildren::expected close tag");
+      return FALSE;
+    }
+
+    //
+    // Skip the control sequence.
+    //
+    if (Current == '?' || Current == '!') {
+      XmlParserConsume (Parser, 2);
+      Parser->Position = XmlParserFind (Parser, '>');
+      XmlParserConsume (Parser, 1);
+      continue;
+    }
+
+    //
+    // Find the name and the end of the tag like XmlParseTagEnd.
+    //
+    NameStart  = Position + (Current == '/' ? 2 : 1);
+    NameLength = 0;
+    for (TagEnd = NameStart; TagEnd < Parser->Length; ++TagEnd) {
+      Current = Buffer[TagEnd];
+      if (Current == '/' || Current == '>') {
+        break;
+      }
+
+      if (NameLength == 0 && XML_IS_SPACE (Current)) {
+        NameLength = TagEnd - NameStart;
+        if (NameLength == 0) {
+          Parser->Position = TagEnd;
+          XML_PARSER_ERROR (Parser, CURRENT_CHARACTER, "XmlSkipChildren::expected tag name");
+          return FALSE;
+        }
+      }
+    }
+
+    if (NameLength == 0) {
+      NameLength = TagEnd - NameStart;
+    }
+
+    if (Buffer[Position + 1] == '/') {
+      if (TagEnd >= Parser->Length || Buffer[TagEnd] != '>') {
+        Parser->Position = TagEnd;
+        XML_PARSER_ERROR (Parser, CURRENT_CHARACTER, "XmlSkipChildren::expected tag end");
+        return FALSE;
+      }
+
+      //
+      // The close tag of the skipped node.
+      //
+      if (Depth == 0) {
+        if (AsciiStrLen (Name) != NameLength
+          || CompareMem (Name, &Buffer[NameStart], NameLength) != 0) {
+          XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::tag missmatch");
+          return FALSE;
+        }
+
+        return TRUE;
+      }
+
+      if (Open[Depth].NameLength != NameLength
+        || CompareMem (&Buffer[Open[Depth].NameStart], &Buffer[NameStart], NameLength) != 0) {
+        XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::tag missmatch");
+        return FALSE;
+      }
+
+      //
+      // Only nodes without children are references.
+      //
+      if (Open[Depth].IsReference && Open[Depth].Children == 0
+        && !XmlPushLazyReference (References, Open[Depth].ReferenceNumber, Open[Depth].Start, TagEnd + 1)) {
+        XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::reference");
+        return FALSE;
+      }
+
+      --Depth;
+      Parser->Position = TagEnd + 1;
+      continue;
+    }
+
+    if (Open[Depth].Children >= XML_PARSER_NODE_COUNT) {
+      XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::node count overflow");
+      return FALSE;
+    }
+
+    //
+    // The first child makes the parent enter the next nesting level.
+    //
+    if (Open[Depth].Children == 0 && Depth > 0
+      && Parser->Level + Depth > XML_PARSER_NEST_LEVEL) {
+      XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::level overflow");
+      return FALSE;
+    }
+
+    Open[Depth].Children++;
+
+    if (TagEnd + 1 < Parser->Length && Buffer[TagEnd] == '/' && Buffer[TagEnd + 1] == '>') {
+      Parser->Position = TagEnd + 2;
+      continue;
+    }
+
+    if (TagEnd >= Parser->Length || Buffer[TagEnd] != '>') {
+      Parser->Position = TagEnd;
+      XML_PARSER_ERROR (Parser, CURRENT_CHARACTER, "XmlSkipChildren::expected tag end");
+      return FALSE;
+    }
+
+    IsReference = FALSE;
+    if (References != NULL && NameStart + NameLength < TagEnd) {
+      IsReference = XmlParseAttributeNumber (
+        &Buffer[NameStart + NameLength],
+        TagEnd - NameStart - NameLength,
+        "ID=\"",
+        L_STR_LEN ("ID=\""),
+        &ReferenceNumber
+        );
+    }
+
+    //
+    // Guards Open, deeper nodes fail the level check above first.
+    //
+    if (Depth == XML_PARSER_NEST_LEVEL) {
+      XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlSkipChildren::level overflow");
+      return FALSE;
+    }
+
+    ++Depth;
+    Open[Depth].NameStart       = NameStart;
+    Open[Depth].NameLength      = NameLength;
+    Open[Depth].Start           = Position;
+    Open[Depth].Children        = 0;
+    Open[Depth].IsReference     = IsReference;
+    Open[Depth].ReferenceNumber = IsReference ? ReferenceNumber : 0;
+    Parser->Position            = TagEnd + 1;
+  }
+}
+
+//
+// Skips the children of a lazily parsed node, they are parsed by
+// XmlNodeExpand on first access.
+//
+STATIC
+BOOLEAN
+XmlParseLazyChildren (
+  XML_PARSER   *Parser,
+  XML_REFLIST  *References,
+  XML_NODE     *Node
+  )
+{
+  XML_LAZY_CHILDREN  *Lazy;
+
+  Lazy = XmlArenaAllocate (Parser->Arena, sizeof (XML_LAZY_CHILDREN));
+  if (Lazy == NULL) {
+    XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::lazy alloc fail");
+    return FALSE;
+  }
+
+  Lazy->Document = Parser->Lazy;
+  Lazy->Start    = Parser->Position;
+  Lazy->Level    = Parser->Level;
+
+  if (!XmlSkipChildren (Parser, References, Node->Name)) {
+    XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::lazy children");
+    return FALSE;
+  }
+
+  Lazy->End  = Parser->Position;
+  Node->Lazy = Lazy;
+  return TRUE;
+}
+
+//
+// Parses the children of an XML node up to its close tag.
+//
+STATIC
+BOOLEAN
+XmlParseChildren (
+  XML_PARSER   *Parser,
+  XML_REFLIST  *References,
+  XML_NODE     *Node,
+  BOOLEAN      *Unprefixed
+  )
+{
+  XML_NODE  *Child;
+  UINT32    StackBase;
+  BOOLEAN   HasChildren;
+
+  HasChildren = FALSE;
+  StackBase   = Parser->StackCount;
+
+  while ('/' != XmlParserPeek (Parser, NEXT_CHARACTER)) {
+
+    //
+    // Parse child node.
+    //
+    Child = XmlParseNode (Parser, References);
+    if (Child == NULL) {
+      if ('/' == XmlParserPeek (Parser, CURRENT_CHARACTER)) {
+        XML_PARSER_INFO (Parser, "child_end");
+        *Unprefixed = TRUE;
+        break;
+      }
+
+      XML_PARSER_ERROR (Parser, NEXT_CHARACTER, "XmlParseNode::child");
+      return FALSE;
+    }
+
+    if (Parser->StackCount - StackBase >= XML_PARSER_NODE_COUNT
+      || !XmlParserStackPush (Parser, Child)) {
+      XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node push fail");
+      return FALSE;
+    }
+
+    HasChildren = TRUE;
+  }
+
+  if (HasChildren && !XmlParserStackPop (Parser, Node, StackBase)) {
+    XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node push fail");
+    return FALSE;
+  }
+
+  return TRUE;
+}
+
+//
+// Parses the skipped children of a lazily parsed node.  Their own
+// children are skipped in turn.
+//
+// @return FALSE when the children are malformed.
+//
+STATIC
+BOOLEAN
+XmlNodeExpand (
+  XML_NODE  *Node
+  )
+{
+  XML_LAZY_CHILDREN  *Lazy;
+  XML_DOCUMENT       *Document;
+  XML_PARSER         Parser;
+  BOOLEAN            Unprefixed;
+  BOOLEAN            Result;
+
+  Lazy       = Node->Lazy;
+  Document   = Lazy->Document;
+  Node->Lazy = NULL;
+
+  ZeroMem (&Parser, sizeof (Parser));
+  Parser.Buffer   = Document->Buffer.Buffer;
+  Parser.Length   = Document->Buffer.Length;
+  Parser.Position = Lazy->Start;
+  Parser.Level    = Lazy->Level;
+  Parser.Arena    = &Document->Arena;
+  Parser.Lazy     = Document;
+  Unprefixed      = FALSE;
+
+  Result = XmlParseChildren (&Parser, Document->WithRefs ? &Document->References : NULL, Node, &Unprefixed);
+
+  if (Parser.Stack != NULL) {
+    FreePool (Parser.Stack);
+  }
+
+  //
+  // The buffer is already modified, so the node can neither be parsed
+  // again nor exported.  Partially parsed children stay in the arena.
+  //
+  if (!Result) {
+    XML_USAGE_ERROR ("XmlNodeExpand::malformed children");
+    Node->Children      = NULL;
+    Node->Malformed     = TRUE;
+    Document->Malformed = TRUE;
+  }
+
+  return Result;
+}
+
 //
 // Parses an XML fragment node.
 //
@@ -937,7 +1799,6 @@ XmlParseNode (
   CONST CHAR8  *TagClose;
   CONST CHAR8  *Attributes;
   XML_NODE     *Node;
-  XML_NODE     *Child;
   UINT32       ReferenceNumber;
   BOOLEAN      IsReference;
   BOOLEAN      SelfClosing;
@@ -964,7 +1825,7 @@ XmlParseNode (
 
   XmlSkipWhitespace (Parser);
 
-  Node = XmlNodeCreate (TagOpen, Attributes, NULL, XmlNodeReal (References, Attributes), NULL);
+  Node = XmlNodeCreate (Parser->Arena, TagOpen, Attributes, NULL, XmlNodeReal (Parser, References, Attributes), NULL, TRUE);
   if (Node == NULL) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node alloc fail");
     return NULL;
@@ -985,7 +1846,6 @@ XmlParseNode (
 
     if (Node->Content == NULL) {
       XML_PARSER_ERROR (Parser, 0, "XmlParseNode::content");
-      XmlNodeFree (Node);
       return NULL;
     }
 
@@ -995,6 +1855,7 @@ XmlParseNode (
     if (References != NULL && Node->Attributes != NULL) {
       IsReference = XmlParseAttributeNumber (
         Node->Attributes,
+        (UINT32) AsciiStrLen (Node->Attributes),
         "ID=\"",
         L_STR_LEN ("ID=\""),
         &ReferenceNumber
@@ -1011,45 +1872,27 @@ XmlParseNode (
 
     if (Parser->Level > XML_PARSER_NEST_LEVEL) {
       XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::level overflow");
-      XmlNodeFree (Node);
       return NULL;
     }
 
-    HasChildren = FALSE;
-
-    while ('/' != XmlParserPeek (Parser, NEXT_CHARACTER)) {
-
-      //
-      // Parse child node.
-      //
-      Child = XmlParseNode (Parser, References);
-      if (Child == NULL) {
-        if ('/' == XmlParserPeek (Parser, CURRENT_CHARACTER)) {
-          XML_PARSER_INFO (Parser, "child_end");
-          Unprefixed = TRUE;
-          break;
-        }
-
-        XML_PARSER_ERROR (Parser, NEXT_CHARACTER, "XmlParseNode::child");
-        XmlNodeFree (Node);
-        return NULL;
-      }
-
-      if (!XmlNodeChildPush (Node, Child)) {
-        XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::node push fail");
-        XmlNodeFree (Node);
-        XmlNodeFree (Child);
+    //
+    // Children of lazily parsed nodes are only skipped.
+    //
+    if (Parser->Lazy != NULL && '/' != XmlParserPeek (Parser, NEXT_CHARACTER)) {
+      if (!XmlParseLazyChildren (Parser, References, Node)) {
         return NULL;
       }
-
-      HasChildren = TRUE;
+    } else if (!XmlParseChildren (Parser, References, Node, &Unprefixed)) {
+      return NULL;
     }
 
     Parser->Level--;
 
+    HasChildren = Node->Children != NULL || Node->Lazy != NULL;
     if (!HasChildren && References != NULL && Attributes != NULL) {
       IsReference = XmlParseAttributeNumber (
         Node->Attributes,
+        (UINT32) AsciiStrLen (Node->Attributes),
         "ID=\"",
         L_STR_LEN ("ID=\""),
         &ReferenceNumber
@@ -1063,7 +1906,6 @@ XmlParseNode (
   TagClose = XmlParseTagClose (Parser, Unprefixed);
   if (TagClose == NULL) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::tag close");
-    XmlNodeFree (Node);
     return NULL;
   }
 
@@ -1072,29 +1914,31 @@ XmlParseNode (
   //
   if (AsciiStrCmp (TagOpen, TagClose) != 0) {
     XML_PARSER_ERROR (Parser, NO_CHARACTER, "XmlParseNode::tag missmatch");
-    XmlNodeFree (Node);
     return NULL;
   }
 
   if (IsReference && !XmlPushReference (References, Node, ReferenceNumber)) {
     XML_PARSER_ERROR (Parser, 0, "XmlParseNode::reference");
-    XmlNodeFree (Node);
     return NULL;
   }
 
   return Node;
 }
 
+//
+// Parses the document, children of lazily parsed nodes are only skipped.
+//
+STATIC
 XML_DOCUMENT *
-XmlDocumentParse (
+XmlDocumentParseMode (
   CHAR8    *Buffer,
   UINT32   Length,
-  BOOLEAN  WithRefs
+  BOOLEAN  WithRefs,
+  BOOLEAN  Lazy
   )
 {
   XML_NODE      *Root;
   XML_DOCUMENT  *Document;
-  XML_REFLIST   References;
 
   //
   // Initialize parser.
@@ -1103,7 +1947,6 @@ XmlDocumentParse (
   ZeroMem (&Parser, sizeof (Parser));
   Parser.Buffer = Buffer;
   Parser.Length = Length;
-  ZeroMem (&References, sizeof (References));
 
   //
   // An empty buffer can never contain a valid document.
@@ -1113,36 +1956,79 @@ XmlDocumentParse (
     return NULL;
   }
 
+  Document = AllocateZeroPool (sizeof (XML_DOCUMENT));
+
+  if (Document == NULL) {
+    XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::document allocation failed");
+    return NULL;
+  }
+
+  //
+  // Nodes and child lists take roughly as much memory as their markup,
+  // so most documents need a single arena block.  Lazily parsed documents
+  // are expected to be parsed in part, after this call.
+  //
+  Document->Arena.BlockSize = MAX (
+    ALIGN_VALUE (Lazy ? Length / XML_ARENA_LAZY_FRACTION : Length, sizeof (UINT64)),
+    XML_ARENA_MIN_BLOCK_SIZE
+    );
+  Document->Buffer.Buffer   = Buffer;
+  Document->Buffer.Length   = Length;
+  Document->WithRefs        = WithRefs;
+  Document->References.Lazy = Lazy;
+  Parser.Arena              = &Document->Arena;
+  Parser.Lazy               = Lazy ? Document : NULL;
+
   //
   // Parse the root node.
   //
-  Root = XmlParseNode (&Parser, WithRefs ? &References : NULL);
+  Root = XmlParseNode (&Parser, WithRefs ? &Document->References : NULL);
+
+  if (Parser.Stack != NULL) {
+    FreePool (Parser.Stack);
+  }
+
   if (Root == NULL) {
     XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::parsing document failed");
+    XmlArenaFree (&Document->Arena);
+    XmlFreeRefs (&Document->References);
+    FreePool (Document);
     return NULL;
   }
 
   //
   // Return parsed document.
+  // Further arena blocks are only needed if the estimate was wrong.
   //
-  Document = AllocatePool (sizeof(XML_DOCUMENT));
-
-  if (Document == NULL) {
-    XML_PARSER_ERROR (&Parser, NO_CHARACTER, "XmlDocumentParse::document allocation failed");
-    XmlNodeFree (Root);
-    XmlFreeRefs (&References);
-    return NULL;
-  }
-
-  Document->Buffer.Buffer = Buffer;
-  Document->Buffer.Length = Length;
   Document->Root = Root;
-  CopyMem (&Document->References, &References, sizeof (References));
+  if (!Lazy) {
+    Document->Arena.BlockSize = MAX (Document->Arena.BlockSize / 4, XML_ARENA_MIN_BLOCK_SIZE);
+  }
 
   return Document;
 }
 
-CHAR8 *
+XML_DOCUMENT *
+XmlDocumentParse (
+  CHAR8    *Buffer,
+  UINT32   Length,
+  BOOLEAN  WithRefs
+  )
+{
+  return XmlDocumentParseMode (Buffer, Length, WithRefs, FALSE);
+}
+
+XML_DOCUMENT *
+XmlDocumentParseLazy (
+  CHAR8    *Buffer,
+  UINT32   Length,
+  BOOLEAN  WithRefs
+  )
+{
+  return XmlDocumentParseMode (Buffer, Length, WithRefs, TRUE);
+}
+
+CHAR8 *
 XmlDocumentExport (
   XML_DOCUMENT  *Document,
   UINT32        *Length,
@@ -1163,6 +2049,12 @@ XmlDocumentExport (
   CurrentSize = 0;
   XmlNodeExportRecursive (Document->Root, &Buffer, &AllocSize, &CurrentSize, Skip);
 
+  if (Document->Malformed) {
+    XML_USAGE_ERROR ("XmlDocumentExport::malformed lazy children");
+    FreePool (Buffer);
+    return NULL;
+  }
+
   if (Length != NULL) {
     *Length = CurrentSize;
   }
@@ -1180,7 +2072,7 @@ XmlDocumentFree (
   XML_DOCUMENT  *Document
   )
 {
-  XmlNodeFree (Document->Root);
+  XmlArenaFree (&Document->Arena);
   XmlFreeRefs (&Document->References);
   FreePool (Document);
 }
@@ -1214,6 +2106,10 @@ XmlNodeChildren (
   XML_NODE  *Node
   )
 {
+  if (Node->Lazy != NULL) {
+    XmlNodeExpand (Node);
+  }
+
   return Node->Children ? Node->Children->NodeCount : 0;
 }
 
@@ -1223,6 +2119,10 @@ XmlNodeChild (
   UINT32    Child
   )
 {
+  if (Node->Lazy != NULL) {
+    XmlNodeExpand (Node);
+  }
+
   return Node->Children->NodeList[Child];
 }
 
@@ -1296,15 +2196,22 @@ XmlNodeAppend (
   CONST CHAR8  *Content
   )
 {
-  XML_NODE  *NewNode;
+  XML_NODE        *NewNode;
+  XML_ARENA_MARK  Mark;
 
-  NewNode = XmlNodeCreate (Name, Attributes, Content, NULL, NULL);
+  if ((Node->Lazy != NULL && !XmlNodeExpand (Node)) || Node->Malformed) {
+    return NULL;
+  }
+
+  XmlArenaMark (Node->Arena, &Mark);
+
+  NewNode = XmlNodeCreate (Node->Arena, Name, Attributes, Content, NULL, NULL, FALSE);
   if (NewNode == NULL) {
     return NULL;
   }
 
   if (!XmlNodeChildPush (Node, NewNode)) {
-    XmlNodeFree (NewNode);
+    XmlArenaRelease (Node->Arena, &Mark);
     return NULL;
   }
 
@@ -1372,6 +2279,10 @@ PlistNodeCast (
   }
 
   ChildrenNum = XmlNodeChildren (Node);
+  if (Node->Malformed) {
+    XML_USAGE_ERROR ("PlistNodeType::malformed children");
+    return NULL;
+  }
 
   switch (Type) {
     case PLIST_NODE_TYPE_DICT:
@@ -1428,6 +2339,141 @@ PlistDictChild (
   return XmlNodeChild (Node, Child);
 }
 
+STATIC
+UINT32
+PlistKeyHash (
+  CONST CHAR8  *Key
+  )
+{
+  UINT32  Hash;
+
+  //
+  // 32-bit FNV-1a.
+  //
+  Hash = 2166136261U;
+  while (*Key != '\0') {
+    Hash ^= (UINT8) *Key++;
+    Hash *= 16777619U;
+  }
+
+  return Hash;
+}
+
+//
+// Returns up to date key hash table of the dictionary or NULL.
+//
+STATIC
+XML_KEY_INDEX *
+PlistDictKeyIndex (
+  XML_NODE  *Node
+  )
+{
+  XML_NODE_LIST  *Children;
+  XML_KEY_INDEX  *KeyIndex;
+  CONST CHAR8    *Key;
+  UINT32         Count;
+  UINT32         NumSlots;
+  UINT32         Index;
+  UINT32         Slot;
+
+  Children = Node->Children;
+  KeyIndex = Children->KeyIndex;
+  if (KeyIndex != NULL && KeyIndex->NodeCount == Children->NodeCount) {
+    return KeyIndex;
+  }
+
+  //
+  // Keep load factor at or below 50% to have short probe sequences.
+  //
+  Count    = Children->NodeCount / 2;
+  NumSlots = 2 * XML_KEY_INDEX_MIN_COUNT;
+  while (NumSlots < Count * 2) {
+    NumSlots *= 2;
+  }
+
+  //
+  // Children were added since the table was built.  The table is reused
+  // while it has enough slots, outgrown ones are left in the arena.
+  //
+  if (KeyIndex == NULL || KeyIndex->Mask + 1 < NumSlots) {
+    if (Node->Arena == NULL) {
+      return NULL;
+    }
+
+    KeyIndex = XmlArenaAllocate (Node->Arena, sizeof (XML_KEY_INDEX) + NumSlots * sizeof (KeyIndex->Slots[0]));
+    if (KeyIndex == NULL) {
+      return NULL;
+    }
+
+    KeyIndex->Mask = NumSlots - 1;
+  }
+
+  ZeroMem (&KeyIndex->Slots[0], (KeyIndex->Mask + 1) * sizeof (KeyIndex->Slots[0]));
+
+  KeyIndex->NodeCount = Children->NodeCount;
+
+  //
+  // Insertion must happen in order for duplicate keys to resolve
+  // to the same entry as with the linear lookup.
+  //
+  for (Index = 0; Index < Count; ++Index) {
+    Key = PlistKeyValue (Children->NodeList[Index * 2]);
+    if (Key == NULL) {
+      continue;
+    }
+
+    Slot = PlistKeyHash (Key) & KeyIndex->Mask;
+    while (KeyIndex->Slots[Slot] != 0) {
+      Slot = (Slot + 1) & KeyIndex->Mask;
+    }
+    KeyIndex->Slots[Slot] = Index + 1;
+  }
+
+  Children->KeyIndex = KeyIndex;
+  return KeyIndex;
+}
+
+XML_NODE *
+PlistDictFind (
+  XML_NODE     *Node,
+  CONST CHAR8  *Key
+  )
+{
+  XML_KEY_INDEX  *KeyIndex;
+  CONST CHAR8    *CurrentKey;
+  XML_NODE       *Value;
+  UINT32         Count;
+  UINT32         Index;
+  UINT32         Slot;
+
+  Count = PlistDictChildren (Node);
+
+  if (Count >= XML_KEY_INDEX_MIN_COUNT) {
+    KeyIndex = PlistDictKeyIndex (Node);
+    if (KeyIndex != NULL) {
+      Slot = PlistKeyHash (Key) & KeyIndex->Mask;
+      while (KeyIndex->Slots[Slot] != 0) {
+        Index = KeyIndex->Slots[Slot] - 1;
+        if (AsciiStrCmp (XmlNodeContent (Node->Children->NodeList[Index * 2]), Key) == 0) {
+          return Node->Children->NodeList[Index * 2 + 1];
+        }
+        Slot = (Slot + 1) & KeyIndex->Mask;
+      }
+
+      return NULL;
+    }
+  }
+
+  for (Index = 0; Index < Count; ++Index) {
+    CurrentKey = PlistKeyValue (PlistDictChild (Node, Index, &Value));
+    if (CurrentKey != NULL && AsciiStrCmp (CurrentKey, Key) == 0) {
+      return Value;
+    }
+  }
+
+  return NULL;
+}
+
 CONST CHAR8 *
 PlistKeyValue (
   XML_NODE  *Node
@@ -1470,8 +2516,25 @@ PlistStringValue (
   return TRUE;
 }
 
+//
+// @return Node holding the data of a possibly referencing node.
+//
+STATIC
+XML_NODE *
+PlistDataNode (
+  XML_NODE  *Node
+  )
+{
+  return Node->Real != NULL ? Node->Real : Node;
+}
+
+//
+// Stores data node contents to Buffer, decoding them unless this was
+// already done in place.
+//
+STATIC
 BOOLEAN
-PlistDataValue (
+PlistDataCopy (
   XML_NODE  *Node,
   UINT8     *Buffer,
   UINT32    *Size
@@ -1481,11 +2544,25 @@ PlistDataValue (
   UINTN          Length;
   RETURN_STATUS  Result;
 
-  if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) == NULL) {
+  Node = PlistDataNode (Node);
+
+  if (Node->DataInvalid) {
     return FALSE;
   }
 
-  Content = XmlNodeContent (Node);
+  if (Node->DataDecoded) {
+    if (Node->DataSize > *Size) {
+      return FALSE;
+    }
+
+    if (Node->DataSize > 0) {
+      CopyMem (Buffer, Node->Content, Node->DataSize);
+    }
+    *Size = Node->DataSize;
+    return TRUE;
+  }
+
+  Content = Node->Content;
   if (Content == NULL) {
     *Size = 0;
     return TRUE;
@@ -1499,10 +2576,85 @@ PlistDataValue (
     return TRUE;
   }
 
+  return FALSE;
+}
+
+BOOLEAN
+PlistDataValue (
+  XML_NODE  *Node,
+  UINT8     *Buffer,
+  UINT32    *Size
+  )
+{
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) == NULL) {
+    return FALSE;
+  }
+
+  if (PlistDataCopy (Node, Buffer, Size)) {
+    return TRUE;
+  }
+
   *Size = 0;
   return FALSE;
 }
 
+BOOLEAN
+PlistDataDecode (
+  XML_NODE     *Node,
+  CONST UINT8  **Data  OPTIONAL,
+  UINT32       *Size   OPTIONAL
+  )
+{
+  CHAR8          *Content;
+  UINTN          Length;
+  RETURN_STATUS  Result;
+
+  if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) == NULL) {
+    return FALSE;
+  }
+
+  Node = PlistDataNode (Node);
+
+  if (Node->DataInvalid) {
+    return FALSE;
+  }
+
+  if (!Node->DataDecoded) {
+    if (!Node->InBuffer) {
+      return FALSE;
+    }
+
+    //
+    // Decoding never writes past the character being decoded, but content
+    // before an invalid character is already overwritten when decoding
+    // fails.  Such nodes are marked invalid for all later data calls.
+    //
+    Content = (CHAR8 *) Node->Content;
+    Length  = 0;
+    if (Content != NULL) {
+      Length = AsciiStrLen (Content);
+      Result = OcBase64Decode (Content, Length, (UINT8 *) Content, &Length);
+      if (RETURN_ERROR (Result)) {
+        Node->DataInvalid = TRUE;
+        return FALSE;
+      }
+    }
+
+    Node->DataSize    = (UINT32) Length;
+    Node->DataDecoded = TRUE;
+  }
+
+  if (Data != NULL) {
+    *Data = (CONST UINT8 *) Node->Content;
+  }
+
+  if (Size != NULL) {
+    *Size = Node->DataSize;
+  }
+
+  return TRUE;
+}
+
 BOOLEAN
 PlistBooleanValue (
   XML_NODE  *Node,
@@ -1569,24 +2721,9 @@ PlistMetaDataValue (
 {
   CONST CHAR8    *Content;
   UINTN          Length;
-  RETURN_STATUS  Result;
 
   if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) != NULL) {
-    Content = XmlNodeContent (Node);
-    if (Content != NULL) {
-
-      Length = *Size;
-      Result = OcBase64Decode (Content, AsciiStrLen (Content), Buffer, &Length);
-
-      if (!RETURN_ERROR (Result) && (UINT32) Length == Length) {
-        *Size = (UINT32) Length;
-      } else {
-        return FALSE;
-      }
-    } else {
-      *Size = 0;
-    }
-    return TRUE;
+    return PlistDataCopy (Node, Buffer, Size);
   }
 
   if (PlistNodeCast (Node, PLIST_NODE_TYPE_STRING) != NULL) {
@@ -1660,6 +2797,15 @@ PlistDataSize (
     return FALSE;
   }
 
+  if (PlistDataNode (Node)->DataInvalid) {
+    return FALSE;
+  }
+
+  if (PlistDataNode (Node)->DataDecoded) {
+    *Size = PlistDataNode (Node)->DataSize;
+    return TRUE;
+  }
+
   Content = XmlNodeContent (Node);
   if (Content != NULL) {
     *Size = (UINT32) AsciiStrLen (Content);
@@ -1679,6 +2825,15 @@ PlistMetaDataSize (
   CONST CHAR8  *Content;
 
   if (PlistNodeCast (Node, PLIST_NODE_TYPE_DATA) != NULL) {
+    if (PlistDataNode (Node)->DataInvalid) {
+      return FALSE;
+    }
+
+    if (PlistDataNode (Node)->DataDecoded) {
+      *Size = PlistDataNode (Node)->DataSize;
+      return TRUE;
+    }
+
     Content = XmlNodeContent (Node);
     if (Content != NULL) {
       *Size = (UINT32) AsciiStrLen (Content);
@@ -1711,3 +2866,485 @@ PlistMetaDataSize (
 
   return FALSE;
 }
+
+PLIST_READER *
+PlistReaderCreate (
+  CHAR8    *Buffer,
+  UINT32   Length
+  )
+{
+  PLIST_READER  *Reader;
+
+  if (Length == 0 || Length > XML_PARSER_MAX_SIZE) {
+    XML_USAGE_ERROR ("PlistReaderCreate::length is too small or too large");
+    return NULL;
+  }
+
+  Reader = AllocateZeroPool (sizeof (*Reader));
+  if (Reader == NULL) {
+    XML_USAGE_ERROR ("PlistReaderCreate::reader allocation failed");
+    return NULL;
+  }
+
+  Reader->Parser.Buffer = Buffer;
+  Reader->Parser.Length = Length;
+  Reader->Node.InBuffer = TRUE;
+
+  if (BplistIsBinary (Buffer, Length)) {
+    Reader->Binary = BplistDocumentParse ((CONST UINT8 *) Buffer, Length);
+    if (Reader->Binary == NULL) {
+      FreePool (Reader);
+      return NULL;
+    }
+
+    //
+    // Objects may be referenced more than once, so limit node count by
+    // buffer size to reject exponentially expanding documents.
+    //
+    Reader->NodesLeft          = Length;
+    Reader->Contents.BlockSize = XML_ARENA_MIN_BLOCK_SIZE;
+
+    //
+    // Allocate the first block, so that released contents keep it.
+    //
+    if (XmlArenaAllocate (&Reader->Contents, 0) == NULL) {
+      BplistDocumentFree (Reader->Binary);
+      FreePool (Reader);
+      return NULL;
+    }
+  }
+
+  return Reader;
+}
+
+//
+// Stops reading after a malformed node.
+//
+STATIC
+PLIST_EVENT
+PlistReaderFail (
+  PLIST_READER  *Reader,
+  CONST CHAR8   *Message
+  )
+{
+  XML_PARSER_ERROR (&Reader->Parser, NO_CHARACTER, Message);
+  Reader->Failed = TRUE;
+  return PLIST_EVENT_ERROR;
+}
+
+//
+// Opens a node, which children are to be read next.
+//
+STATIC
+PLIST_EVENT
+PlistReaderOpen (
+  PLIST_READER  *Reader,
+  CONST CHAR8   *Tag
+  )
+{
+  if (Reader->Depth >= XML_PARSER_NEST_LEVEL) {
+    return PlistReaderFail (Reader, "PlistReaderNext::level overflow");
+  }
+
+  Reader->Tags[Reader->Depth]     = Tag;
+  Reader->Children[Reader->Depth] = 0;
+  XmlArenaMark (&Reader->Contents, &Reader->Marks[Reader->Depth]);
+  Reader->Depth++;
+
+  return PLIST_EVENT_OPEN;
+}
+
+//
+// Closes last opened node, its closing tag must already be consumed.
+//
+STATIC
+PLIST_EVENT
+PlistReaderClose (
+  PLIST_READER  *Reader
+  )
+{
+  Reader->Depth--;
+  Reader->Node.Name        = Reader->Tags[Reader->Depth];
+  Reader->Node.Content     = NULL;
+  Reader->Node.DataDecoded = FALSE;
+  Reader->Node.DataInvalid = FALSE;
+
+  if (Reader->Depth > 0) {
+    return PLIST_EVENT_CLOSE;
+  }
+
+  if (Reader->Children[0] != 1) {
+    return PlistReaderFail (Reader, "PlistReaderNext::no single first node");
+  }
+
+  Reader->Finished = TRUE;
+  return PLIST_EVENT_END;
+}
+
+//
+// Consumes closing tag without `<' and matches it against Tag.
+//
+STATIC
+BOOLEAN
+PlistReaderCloseTag (
+  PLIST_READER  *Reader,
+  CONST CHAR8   *Tag
+  )
+{
+  CONST CHAR8  *TagClose;
+
+  TagClose = XmlParseTagClose (&Reader->Parser, TRUE);
+  return TagClose != NULL && AsciiStrCmp (Tag, TagClose) == 0;
+}
+
+//
+// Stores binary plist string or integer as node content.
+//
+STATIC
+BOOLEAN
+PlistReaderBinaryContent (
+  PLIST_READER  *Reader,
+  BPLIST_NODE   Object,
+  BOOLEAN       IsInteger
+  )
+{
+  CHAR8    *Content;
+  UINT32   Size;
+  UINT64   Value;
+  UINT64   Next;
+  BOOLEAN  Negative;
+
+  Negative = FALSE;
+
+  if (IsInteger) {
+    if (!BplistIntegerValue (Reader->Binary, Object, &Value, sizeof (Value))) {
+      return FALSE;
+    }
+
+    //
+    // Only 8-byte integers may have the sign bit set, and these are signed.
+    //
+    Negative = (INT64) Value < 0;
+    if (Negative) {
+      Value = 0 - Value;
+    }
+
+    //
+    // Enough for MIN_INT64 and MAX_UINT64 in decimal.
+    //
+    Size = 22;
+  } else if (!BplistStringSize (Reader->Binary, Object, &Size)) {
+    return FALSE;
+  }
+
+  Content = XmlArenaAllocate (&Reader->Contents, Size);
+  if (Content == NULL) {
+    return FALSE;
+  }
+
+  if (IsInteger) {
+    Content += Size - 1;
+    *Content = '\0';
+    do {
+      Next       = DivU64x32 (Value, 10);
+      *--Content = (CHAR8) ('0' + (Value - MultU64x32 (Next, 10)));
+      Value      = Next;
+    } while (Value != 0);
+
+    if (Negative) {
+      *--Content = '-';
+    }
+  } else {
+    BplistStringValue (Reader->Binary, Object, Content, &Size);
+  }
+
+  Reader->Node.Content = Content;
+  return TRUE;
+}
+
+//
+// Reads next binary plist node, emulating text plist events.
+//
+STATIC
+PLIST_EVENT
+PlistReaderNextBinary (
+  PLIST_READER  *Reader
+  )
+{
+  BPLIST_DOCUMENT  *Document;
+  BPLIST_NODE      Parent;
+  BPLIST_NODE      Object;
+  BPLIST_NODE      Value;
+  PLIST_NODE_TYPE  Type;
+  CONST UINT8      *Data;
+  UINT32           Position;
+  UINT32           Count;
+  BOOLEAN          IsDict;
+  BOOLEAN          IsKey;
+
+  Document = Reader->Binary;
+
+  //
+  // Enter plist root, which is not reported.
+  //
+  if (Reader->Depth == 0) {
+    Reader->Objects[0] = BPLIST_NODE_INVALID;
+    PlistReaderOpen (Reader, "plist");
+  }
+
+  Parent   = Reader->Objects[Reader->Depth - 1];
+  Position = Reader->Children[Reader->Depth - 1];
+  IsDict   = FALSE;
+
+  if (Reader->Depth == 1) {
+    Count = 1;
+  } else {
+    IsDict = BplistNodeCast (Document, Parent, PLIST_NODE_TYPE_DICT) != BPLIST_NODE_INVALID;
+    Count  = IsDict ? 2 * BplistDictChildren (Document, Parent) : BplistNodeChildren (Document, Parent);
+  }
+
+  if (Position == Count) {
+    return PlistReaderClose (Reader);
+  }
+
+  if (Reader->NodesLeft == 0) {
+    return PlistReaderFail (Reader, "PlistReaderNext::node count");
+  }
+  Reader->NodesLeft--;
+  Reader->Children[Reader->Depth - 1]++;
+
+  //
+  // Dictionary children are reported as keys followed by their values.
+  // Converted contents of the previous key and value or array element,
+  // including their children, are no longer used.
+  //
+  IsKey = IsDict && Position % 2 == 0;
+  if (IsKey || !IsDict) {
+    XmlArenaRelease (&Reader->Contents, &Reader->Marks[Reader->Depth - 1]);
+  }
+  if (Reader->Depth == 1) {
+    Object = BplistDocumentRoot (Document);
+  } else if (IsDict) {
+    Object = BplistDictChild (Document, Parent, Position / 2, &Value);
+    if (!IsKey) {
+      Object = Value;
+    }
+  } else {
+    Object = BplistNodeChild (Document, Parent, Position);
+  }
+
+  Type = BplistNodeType (Document, Object);
+  if (IsKey) {
+    if (Type != PLIST_NODE_TYPE_STRING) {
+      return PlistReaderFail (Reader, "PlistReaderNext::key type");
+    }
+    Type = PLIST_NODE_TYPE_KEY;
+  }
+
+  if (Type == PLIST_NODE_TYPE_MAX) {
+    return PlistReaderFail (Reader, "PlistReaderNext::unsupported object");
+  }
+
+  Reader->Node.Name        = PlistNodeTypes[Type];
+  Reader->Node.Content     = NULL;
+  Reader->Node.DataDecoded = FALSE;
+  Reader->Node.DataInvalid = FALSE;
+
+  switch (Type) {
+    case PLIST_NODE_TYPE_DICT:
+    case PLIST_NODE_TYPE_ARRAY:
+      if (Reader->Depth >= XML_PARSER_NEST_LEVEL) {
+        return PlistReaderFail (Reader, "PlistReaderNext::level overflow");
+      }
+      Reader->Objects[Reader->Depth] = Object;
+      return PlistReaderOpen (Reader, Reader->Node.Name);
+    case PLIST_NODE_TYPE_KEY:
+    case PLIST_NODE_TYPE_STRING:
+    case PLIST_NODE_TYPE_INTEGER:
+      if (!PlistReaderBinaryContent (Reader, Object, Type == PLIST_NODE_TYPE_INTEGER)) {
+        return PlistReaderFail (Reader, "PlistReaderNext::content");
+      }
+      break;
+    case PLIST_NODE_TYPE_DATA:
+      //
+      // Data is referenced as already decoded, see PlistDataDecode.
+      //
+      BplistDataValue (Document, Object, &Data, &Reader->Node.DataSize);
+      Reader->Node.Content     = (CONST CHAR8 *) Data;
+      Reader->Node.DataDecoded = TRUE;
+      break;
+    default:
+      //
+      // Reals and dates are reported without contents.
+      //
+      break;
+  }
+
+  return IsKey ? PLIST_EVENT_KEY : PLIST_EVENT_VALUE;
+}
+
+PLIST_EVENT
+PlistReaderNext (
+  PLIST_READER  *Reader,
+  XML_NODE      **Node
+  )
+{
+  XML_PARSER   *Parser;
+  CONST CHAR8  *Tag;
+  CONST CHAR8  *Child;
+  BOOLEAN      SelfClosing;
+  BOOLEAN      IsContainer;
+  UINT32       ChildLimit;
+
+  Parser = &Reader->Parser;
+  *Node  = &Reader->Node;
+
+  if (Reader->Failed) {
+    return PLIST_EVENT_ERROR;
+  }
+
+  if (Reader->Finished) {
+    return PLIST_EVENT_END;
+  }
+
+  if (Reader->Binary != NULL) {
+    return PlistReaderNextBinary (Reader);
+  }
+
+  if (Reader->PendingClose) {
+    Reader->PendingClose = FALSE;
+    return PlistReaderClose (Reader);
+  }
+
+  //
+  // Enter plist root, which is not reported.
+  //
+  if (Reader->Depth == 0) {
+    SelfClosing = FALSE;
+    Tag = XmlParseTagOpen (Parser, &SelfClosing, NULL);
+    if (Tag == NULL || SelfClosing || AsciiStrCmp (Tag, "plist") != 0) {
+      return PlistReaderFail (Reader, "PlistReaderNext::not plist root");
+    }
+
+    PlistReaderOpen (Reader, Tag);
+  }
+
+  if (Reader->NextTag != NULL) {
+    Tag                 = Reader->NextTag;
+    SelfClosing         = Reader->NextSelfClosing;
+    Reader->NextTag     = NULL;
+  } else {
+    SelfClosing = FALSE;
+    Tag = XmlParseTagOpen (Parser, &SelfClosing, NULL);
+    if (Tag == NULL) {
+      if ('/' != XmlParserPeek (Parser, CURRENT_CHARACTER)
+        || !PlistReaderCloseTag (Reader, Reader->Tags[Reader->Depth - 1])) {
+        return PlistReaderFail (Reader, "PlistReaderNext::tag close");
+      }
+
+      return PlistReaderClose (Reader);
+    }
+  }
+
+  //
+  // Plist root must have a single child.
+  //
+  ChildLimit = Reader->Depth == 1 ? 1 : XML_PARSER_NODE_COUNT;
+  if (Reader->Children[Reader->Depth - 1] >= ChildLimit) {
+    return PlistReaderFail (Reader, "PlistReaderNext::node count");
+  }
+  Reader->Children[Reader->Depth - 1]++;
+
+  Reader->Node.Name        = Tag;
+  Reader->Node.Content     = NULL;
+  Reader->Node.DataDecoded = FALSE;
+  Reader->Node.DataInvalid = FALSE;
+
+  IsContainer = AsciiStrCmp (Tag, PlistNodeTypes[PLIST_NODE_TYPE_DICT]) == 0
+    || AsciiStrCmp (Tag, PlistNodeTypes[PLIST_NODE_TYPE_ARRAY]) == 0;
+
+  if (!SelfClosing) {
+    XmlSkipWhitespace (Parser);
+
+    if ('<' != XmlParserPeek (Parser, CURRENT_CHARACTER)) {
+      Reader->Node.Content = XmlParseContent (Parser);
+      if (Reader->Node.Content == NULL || !PlistReaderCloseTag (Reader, Tag)) {
+        return PlistReaderFail (Reader, "PlistReaderNext::content");
+      }
+
+      IsContainer = FALSE;
+    } else {
+      SelfClosing = FALSE;
+      Child = XmlParseTagOpen (Parser, &SelfClosing, NULL);
+      if (Child != NULL) {
+        //
+        // Node has children, remember the first one for the next call.
+        //
+        Reader->NextTag         = Child;
+        Reader->NextSelfClosing = SelfClosing;
+        return PlistReaderOpen (Reader, Tag);
+      }
+
+      if ('/' != XmlParserPeek (Parser, CURRENT_CHARACTER)
+        || !PlistReaderCloseTag (Reader, Tag)) {
+        return PlistReaderFail (Reader, "PlistReaderNext::tag close");
+      }
+    }
+  }
+
+  //
+  // Empty dictionaries and arrays are still reported as containers.
+  //
+  if (IsContainer) {
+    Reader->PendingClose = TRUE;
+    return PlistReaderOpen (Reader, Tag);
+  }
+
+  if (AsciiStrCmp (Tag, PlistNodeTypes[PLIST_NODE_TYPE_KEY]) == 0) {
+    return PLIST_EVENT_KEY;
+  }
+
+  return PLIST_EVENT_VALUE;
+}
+
+BOOLEAN
+PlistReaderSkip (
+  PLIST_READER  *Reader
+  )
+{
+  XML_NODE  *Node;
+  UINT32    Level;
+
+  Level = 1;
+
+  while (Level > 0) {
+    switch (PlistReaderNext (Reader, &Node)) {
+      case PLIST_EVENT_OPEN:
+        ++Level;
+        break;
+      case PLIST_EVENT_CLOSE:
+        --Level;
+        break;
+      case PLIST_EVENT_KEY:
+      case PLIST_EVENT_VALUE:
+        break;
+      default:
+        return FALSE;
+    }
+  }
+
+  return TRUE;
+}
+
+VOID
+PlistReaderFree (
+  PLIST_READER  *Reader
+  )
+{
+  if (Reader->Binary != NULL) {
+    BplistDocumentFree (Reader->Binary);
+    XmlArenaFree (&Reader->Contents);
+  }
+
+  FreePool (Reader);
+}
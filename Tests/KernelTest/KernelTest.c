@@ -323,6 +323,8 @@ ApplyKernelPatches (
     } else {
       DEBUG ((DEBUG_WARN, "Patch success kernel\n"));
     }
+
+    PatcherFreeContext (&Patcher);
   } else {
     DEBUG ((DEBUG_WARN, "Failed to find kernel - %r\n", Status));
   }
@@ -0,0 +1,212 @@
+/** @file
+  Copyright (C) 2019, vit9696. All rights reserved.
+
+  All rights reserved.
+
+  This program and the accompanying materials
+  are licensed and made available under the terms and conditions of the BSD License
+  which accompanies this distribution.  The full text of the license may be found at
+  http://opensource.org/licenses/bsd-license.php
+
+  THE PROGRAM IS DISTRIBUTED UNDER THE BSD LICENSE ON AN "AS IS" BASIS,
+  WITHOUT WARRANTIES OR REPRESENTATIONS OF ANY KIND, EITHER EXPRESS OR IMPLIED.
+**/
+
+#include <Library/OcMiscLib.h>
+
+#include <sys/time.h>
+
+/*
+ clang -g -O2 -fsanitize=undefined,address -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h DataPatcher.c ../../Library/OcMiscLib/DataPatcher.c -o DataPatcher
+
+ ./DataPatcher [file]
+
+ Compares FindPattern results and performance with the original byte by byte
+ implementation on DSDT-sized and kernel-sized buffers, or on the given file.
+*/
+
+long long current_timestamp() {
+    struct timeval te;
+    gettimeofday(&te, NULL); // get current time
+    long long milliseconds = te.tv_sec*1000LL + te.tv_usec/1000; // calculate milliseconds
+    return milliseconds;
+}
+
+uint8_t *readFile(const char *str, uint32_t *size) {
+  FILE *f = fopen(str, "rb");
+
+  if (!f) return NULL;
+
+  fseek(f, 0, SEEK_END);
+  long fsize = ftell(f);
+  fseek(f, 0, SEEK_SET);
+
+  uint8_t *string = malloc(fsize + 1);
+  fread(string, fsize, 1, f);
+  fclose(f);
+
+  string[fsize] = 0;
+  *size = fsize;
+
+  return string;
+}
+
+//
+// Original FindPattern implementation used as a reference.
+//
+static INT32 FindPatternLegacy (
+  IN CONST UINT8   *Pattern,
+  IN CONST UINT8   *PatternMask OPTIONAL,
+  IN CONST UINT32  PatternSize,
+  IN CONST UINT8   *Data,
+  IN UINT32        DataSize,
+  IN INT32         DataOff
+  )
+{
+  BOOLEAN  Matches;
+  UINT32   Index;
+
+  if (PatternSize == 0 || DataSize == 0 || (DataOff < 0) || (UINT32)DataOff >= DataSize || DataSize - DataOff < PatternSize) {
+    return -1;
+  }
+
+  while (DataOff + PatternSize < DataSize) {
+    Matches = TRUE;
+    for (Index = 0; Index < PatternSize; ++Index) {
+      if ((PatternMask == NULL && Data[DataOff + Index] != Pattern[Index])
+      || (PatternMask != NULL && (Data[DataOff + Index] & PatternMask[Index]) != Pattern[Index])) {
+        Matches = FALSE;
+        break;
+      }
+    }
+
+    if (Matches) {
+      return DataOff;
+    }
+    ++DataOff;
+  }
+
+  return -1;
+}
+
+//
+// Code-like data: mostly small values and zeroes, so that anchors matter.
+//
+static void FillBuffer (uint8_t *Data, uint32_t Size) {
+  uint32_t Seed = 0x12345678;
+  for (uint32_t i = 0; i < Size; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    uint32_t r = (Seed >> 16) & 0xFF;
+    Data[i] = r < 96 ? 0 : (r < 160 ? 0x48 + (r & 7) : (uint8_t) r);
+  }
+}
+
+static int CheckPatterns (uint8_t *Data, uint32_t Size, int Iterations) {
+  uint32_t Seed = 0x87654321;
+  uint8_t  Pattern[16];
+  uint8_t  Mask[16];
+
+  for (int i = 0; i < Iterations; ++i) {
+    Seed = Seed * 1103515245 + 12345;
+    uint32_t PatternSize = 1 + (Seed >> 8) % 16;
+    uint32_t Offset      = (Seed >> 4) % (Size - PatternSize);
+    int      Masked      = (Seed >> 24) & 1;
+
+    for (uint32_t j = 0; j < PatternSize; ++j) {
+      Mask[j]    = ((Seed >> (j % 24)) & 3) == 0 ? 0xF0 : 0xFF;
+      Pattern[j] = Data[Offset + j] & (Masked ? Mask[j] : 0xFF);
+    }
+
+    //
+    // Sometimes look for absent patterns.
+    //
+    if (((Seed >> 28) & 3) == 0) {
+      Pattern[0] ^= Masked ? (Mask[0] & 0x10) : 0x5A;
+    }
+
+    for (INT32 Start = 0; Start >= 0 && (uint32_t) Start < Size; ) {
+      INT32 Expected = FindPatternLegacy (Pattern, Masked ? Mask : NULL, PatternSize, Data, Size, Start);
+      INT32 Actual   = FindPattern (Pattern, Masked ? Mask : NULL, PatternSize, Data, Size, Start);
+      if (Expected != Actual) {
+        printf ("Mismatch at %d size %u masked %d - %d vs %d\n", Start, PatternSize, Masked, Expected, Actual);
+        return -1;
+      }
+      Start = Expected < 0 ? -1 : Expected + 1;
+    }
+  }
+
+  return 0;
+}
+
+static void Benchmark (const char *Name, uint8_t *Data, uint32_t Size, int Rounds) {
+  //
+  // Absent patterns force full buffer scans.
+  //
+  static CONST UINT8 Pattern[] = { 0x48, 0x8B, 0x05, 0x11, 0x22, 0x33, 0x44, 0xC3 };
+  static CONST UINT8 Mask[]    = { 0xFF, 0xFF, 0xFF, 0xFF, 0xF0, 0xF0, 0xFF, 0xFF };
+  long long Start;
+  INT32     Result;
+
+  Result = 0;
+
+  Start = current_timestamp ();
+  for (int i = 0; i < Rounds; ++i) {
+    Result += FindPatternLegacy (Pattern, NULL, sizeof (Pattern), Data, Size, i & 3);
+    Result += FindPatternLegacy (Pattern, Mask, sizeof (Pattern), Data, Size, i & 3);
+  }
+  printf ("%s legacy: %lld ms\n", Name, current_timestamp () - Start);
+
+  Start = current_timestamp ();
+  for (int i = 0; i < Rounds; ++i) {
+    Result += FindPattern (Pattern, NULL, sizeof (Pattern), Data, Size, i & 3);
+    Result += FindPattern (Pattern, Mask, sizeof (Pattern), Data, Size, i & 3);
+  }
+  printf ("%s current: %lld ms (%d)\n", Name, current_timestamp () - Start, Result);
+}
+
+int main(int argc, char** argv) {
+  uint8_t  *Data;
+  uint32_t Size;
+
+  if (argc > 1) {
+    Data = readFile (argv[1], &Size);
+    if (Data == NULL || Size < 16) {
+      printf ("Read fail\n");
+      return -1;
+    }
+
+    if (CheckPatterns (Data, Size, 64) != 0) {
+      return -1;
+    }
+
+    Benchmark (argv[1], Data, Size, 16);
+    free (Data);
+    return 0;
+  }
+
+  //
+  // DSDT-sized buffer.
+  //
+  Size = 256 * 1024;
+  Data = malloc (Size);
+  FillBuffer (Data, Size);
+  if (CheckPatterns (Data, Size, 2048) != 0) {
+    return -1;
+  }
+  Benchmark ("DSDT", Data, Size, 256);
+  free (Data);
+
+  //
+  // Kernel-sized buffer.
+  //
+  Size = 24 * 1024 * 1024;
+  Data = malloc (Size);
+  FillBuffer (Data, Size);
+  if (CheckPatterns (Data, Size, 32) != 0) {
+    return -1;
+  }
+  Benchmark ("Kernel", Data, Size, 4);
+  free (Data);
+
+  return 0;
+}
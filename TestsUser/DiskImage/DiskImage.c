@@ -8,9 +8,9 @@
 
 /**
 
-clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c ../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
+clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageCache.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c ../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
 
-clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
+clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -fshort-wchar -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h DiskImage.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLib.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageLibInternal.c ../../Library/OcAppleDiskImageLib/OcAppleDiskImageCache.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcCompressionLib/zlib/zlib_uefi.c ../../Library/OcCompressionLib/zlib/adler32.c ../../Library/OcCompressionLib/zlib/deflate.c ../../Library/OcCompressionLib/zlib/crc32.c  ../../Library/OcCompressionLib/zlib/compress.c ../../Library/OcCompressionLib/zlib/infback.c ../../Library/OcCompressionLib/zlib/inffast.c  ../../Library/OcCompressionLib/zlib/inflate.c  ../../Library/OcCompressionLib/zlib/inftrees.c ../../Library/OcCompressionLib/zlib/trees.c ../../Library/OcCompressionLib/zlib/uncompr.c ../../Library/OcCryptoLib/Sha256.c  ../../Library/OcCryptoLib/Rsa2048Sha256.c ../../Library/OcAppleKeysLib/OcAppleKeysLib.c ../../Library/OcAppleChunklistLib/OcAppleChunklistLib.c ../../Library/OcAppleRamDiskLib/OcAppleRamDiskLib.c../../Library/OcFileLib/ReadFile.c ../../Library/OcFileLib/FileProtocol.c -o DiskImage
 rm -rf DICT fuzz*.log ; mkdir DICT ; UBSAN_OPTIONS='halt_on_error=1' ./DiskImage -jobs=4 DICT -rss_limit_mb=4096
 
 **/
@@ -46,7 +46,311 @@ uint8_t *readFile(const char *str, long *size) {
 #include <CommonCrypto/CommonDigest.h>
 #endif
 
+#define NUM_EXTENTS 20
+
+//
+// Splits the disk image into RAM disk extents.
+//
+static void initExtentTable (APPLE_RAM_DISK_EXTENT_TABLE *ExtentTable, uint8_t *Dmg, long DmgSize) {
+  ExtentTable->Signature   = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+  ExtentTable->Version     = APPLE_RAM_DISK_EXTENT_VERSION;
+  ExtentTable->Reserved    = 0;
+  ExtentTable->Signature2  = APPLE_RAM_DISK_EXTENT_SIGNATURE;
+
+  ExtentTable->ExtentCount = MIN (NUM_EXTENTS, ARRAY_SIZE (ExtentTable->Extents));
+
+  UINT32 Index;
+  for (Index = 0; Index < ExtentTable->ExtentCount; ++Index) {
+    ExtentTable->Extents[Index].Start = (uintptr_t)Dmg + (Index * (DmgSize / ExtentTable->ExtentCount));
+    ExtentTable->Extents[Index].Length = (DmgSize / ExtentTable->ExtentCount);
+  }
+  if (Index != 0) {
+    ExtentTable->Extents[Index - 1].Length += (DmgSize - (Index * (DmgSize / ExtentTable->ExtentCount)));
+  }
+}
+
+//
+// Reads the disk image sector by sector with chunklist verification on read.
+// When Altered is set, a byte of the first chunk with data is changed first.
+//
+// @return Number of failed sector reads or -1 on setup failure.
+//
+static long readVerifyOnRead (uint8_t *Dmg, long DmgSize, OC_APPLE_CHUNKLIST_CONTEXT *ChunklistContext, int Altered, int *Attached, int *StateFreed) {
+  OC_APPLE_DISK_IMAGE_CONTEXT DmgContext;
+  APPLE_RAM_DISK_EXTENT_TABLE ExtentTable;
+  APPLE_DISK_IMAGE_CHUNK      *Chunk;
+  uint8_t                     *Copy;
+  uint8_t                     Sector[APPLE_DISK_IMAGE_SECTOR_SIZE];
+  long                        Failures;
+
+  Copy = malloc (DmgSize);
+  if (Copy == NULL) {
+    return -1;
+  }
+  memcpy (Copy, Dmg, DmgSize);
+  initExtentTable (&ExtentTable, Copy, DmgSize);
+
+  if (!OcAppleDiskImageInitializeContext (&DmgContext, &ExtentTable, DmgSize)) {
+    free (Copy);
+    return -1;
+  }
+
+  if (Altered) {
+    Chunk = NULL;
+    for (UINT32 Index = 0; Index < DmgContext.ChunkCount; ++Index) {
+      Chunk = DmgContext.Chunks[Index].Chunk;
+      if ((Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_RAW || Chunk->Type == APPLE_DISK_IMAGE_CHUNK_TYPE_ZLIB)
+        && Chunk->CompressedLength > 0) {
+        break;
+      }
+      Chunk = NULL;
+    }
+    if (Chunk == NULL) {
+      OcAppleDiskImageFreeContext (&DmgContext);
+      free (Copy);
+      return -1;
+    }
+    Copy[Chunk->CompressedOffset + Chunk->CompressedLength / 2] ^= 0x40;
+  }
+
+  //
+  // The altered byte may share a chunklist chunk with the plist, which is
+  // verified right away. No sector can be read then.
+  //
+  *Attached = OcAppleDiskImageVerifyDataOnRead (&DmgContext, ChunklistContext);
+  if (*Attached) {
+    Failures = 0;
+    for (UINT64 Lba = 0; Lba < DmgContext.SectorCount; ++Lba) {
+      if (!OcAppleDiskImageRead (&DmgContext, Lba, sizeof (Sector), Sector)) {
+        ++Failures;
+      }
+    }
+  } else {
+    Failures = (long) DmgContext.SectorCount;
+  }
+
+  *StateFreed = DmgContext.Chunklist == NULL
+    && DmgContext.ChunklistOffsets == NULL
+    && DmgContext.ChunklistVerified == NULL;
+
+  OcAppleDiskImageFreeContext (&DmgContext);
+  free (Copy);
+  return Failures;
+}
+
+//
+// Checks chunklist verification on read for disk image and chunklist pairs:
+// intact images read fully and drop verification state once all chunks are
+// verified, altered chunks fail to read and keep the state. When the altered
+// chunk is verified right away, setup fails and leaves no state behind.
+//
+static int testVerifyOnRead (int argc, char *argv[]) {
+  int Failed = 0;
+
+  for (int i = 0; i < (argc - 1); i+=2) {
+    uint8_t *Dmg;
+    long    DmgSize;
+    uint8_t *Chunklist;
+    long    ChunklistSize;
+    long    Failures;
+    long    AlteredFailures;
+    int     Attached;
+    int     StateFreed;
+    int     AlteredAttached;
+    int     AlteredStateFreed;
+
+    OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
+
+    Dmg       = readFile (argv[i], &DmgSize);
+    Chunklist = readFile (argv[i + 1], &ChunklistSize);
+    if (Dmg == NULL || Chunklist == NULL
+      || !OcAppleChunklistInitializeContext (&ChunklistContext, Chunklist, ChunklistSize)
+      || !OcAppleChunklistVerifySignature (&ChunklistContext, (RSA_PUBLIC_KEY *)PkDataBase[0].PublicKey)) {
+      printf ("%s: chunklist error\n", argv[i]);
+      Failed = 1;
+      free (Dmg);
+      free (Chunklist);
+      continue;
+    }
+
+    Attached          = 0;
+    StateFreed        = 0;
+    AlteredAttached   = 0;
+    AlteredStateFreed = 1;
+    Failures          = readVerifyOnRead (Dmg, DmgSize, &ChunklistContext, 0, &Attached, &StateFreed);
+    AlteredFailures   = readVerifyOnRead (Dmg, DmgSize, &ChunklistContext, 1, &AlteredAttached, &AlteredStateFreed);
+
+    if (Failures != 0 || !Attached || !StateFreed || AlteredFailures <= 0 || AlteredStateFreed == AlteredAttached) {
+      Failed = 1;
+    }
+
+    printf (
+      "%s: failed reads %ld, state freed %d, altered attached %d, altered failed reads %ld, altered state freed %d\n",
+      argv[i],
+      Failures,
+      StateFreed,
+      AlteredAttached,
+      AlteredFailures,
+      AlteredStateFreed
+      );
+
+    free (Dmg);
+    free (Chunklist);
+  }
+
+  return Failed;
+}
+
+static CONST UINT8 *mFileData;
+static UINTN       mFileSize;
+static UINTN       mFilePosition;
+static CONST VOID  *mFileLastRead;
+static UINTN       mFileLastReadSize;
+static UINTN       mLateHandled;
+
+static EFI_STATUS EFIAPI fileSetPosition (EFI_FILE_PROTOCOL *This, UINT64 Position) {
+  if (Position > mFileSize) {
+    return EFI_INVALID_PARAMETER;
+  }
+  mFilePosition = (UINTN)Position;
+  return EFI_SUCCESS;
+}
+
+static EFI_STATUS EFIAPI fileRead (EFI_FILE_PROTOCOL *This, UINTN *BufferSize, VOID *Buffer) {
+  *BufferSize = MIN (*BufferSize, mFileSize - mFilePosition);
+  memcpy (Buffer, mFileData + mFilePosition, *BufferSize);
+  mFilePosition    += *BufferSize;
+  mFileLastRead     = Buffer;
+  mFileLastReadSize = *BufferSize;
+  return EFI_SUCCESS;
+}
+
+//
+// Hashes loaded pieces, which must be handled right after being read.
+//
+static VOID streamHandler (VOID *Context, CONST VOID *Data, UINTN Size) {
+  if (Data != mFileLastRead || Size != mFileLastReadSize) {
+    ++mLateHandled;
+  }
+  OcAppleChunklistStreamUpdate (Context, Data, Size);
+}
+
+//
+// Loads the disk image into RAM disk extents while streaming it through the
+// chunklist, and verifies the loaded data against the chunklist as well.
+//
+// @return 0 when both verifications agree, 1 otherwise.
+//
+static int loadStream (uint8_t *Dmg, long DmgSize, OC_APPLE_CHUNKLIST_CONTEXT *ChunklistContext, int *Verified) {
+  EFI_FILE_PROTOCOL           File;
+  OC_APPLE_CHUNKLIST_STREAM   Stream;
+  OC_APPLE_DISK_IMAGE_CONTEXT DmgContext;
+  APPLE_RAM_DISK_EXTENT_TABLE ExtentTable;
+  uint8_t                     *Loaded;
+  BOOLEAN                     Streamed;
+  BOOLEAN                     Eager;
+
+  Loaded = calloc (1, DmgSize);
+  if (Loaded == NULL) {
+    return 1;
+  }
+  initExtentTable (&ExtentTable, Loaded, DmgSize);
+
+  memset (&File, 0, sizeof (File));
+  File.Revision    = EFI_FILE_PROTOCOL_REVISION;
+  File.Read        = fileRead;
+  File.SetPosition = fileSetPosition;
+
+  mFileData     = Dmg;
+  mFileSize     = DmgSize;
+  mFilePosition = 0;
+  mLateHandled  = 0;
+
+  OcAppleChunklistStreamInit (&Stream, ChunklistContext);
+  Streamed = OcAppleRamDiskLoadFileEx (&ExtentTable, &File, DmgSize, streamHandler, &Stream)
+    && OcAppleChunklistStreamFinal (&Stream);
+
+  Eager = OcAppleDiskImageInitializeContext (&DmgContext, &ExtentTable, DmgSize);
+  if (Eager) {
+    Eager = OcAppleDiskImageVerifyData (&DmgContext, ChunklistContext);
+    OcAppleDiskImageFreeContext (&DmgContext);
+  }
+
+  free (Loaded);
+
+  *Verified = Streamed;
+  return Streamed != Eager || mLateHandled != 0;
+}
+
+//
+// Checks that disk image and chunklist pairs verify the same way when
+// streamed through the chunklist while loading and when verified after
+// loading, both as is and with a changed byte.
+//
+static int testStream (int argc, char *argv[]) {
+  int Failed = 0;
+
+  for (int i = 0; i < (argc - 1); i+=2) {
+    uint8_t *Dmg;
+    long    DmgSize;
+    uint8_t *Chunklist;
+    long    ChunklistSize;
+    int     Mismatch;
+    int     Verified;
+    int     AlteredVerified;
+
+    OC_APPLE_CHUNKLIST_CONTEXT ChunklistContext;
+
+    Dmg       = readFile (argv[i], &DmgSize);
+    Chunklist = readFile (argv[i + 1], &ChunklistSize);
+    if (Dmg == NULL || Chunklist == NULL || DmgSize == 0
+      || !OcAppleChunklistInitializeContext (&ChunklistContext, Chunklist, ChunklistSize)
+      || !OcAppleChunklistVerifySignature (&ChunklistContext, (RSA_PUBLIC_KEY *)PkDataBase[0].PublicKey)) {
+      printf ("%s: chunklist error\n", argv[i]);
+      Failed = 1;
+      free (Dmg);
+      free (Chunklist);
+      continue;
+    }
+
+    Verified        = 0;
+    AlteredVerified = 1;
+    Mismatch        = loadStream (Dmg, DmgSize, &ChunklistContext, &Verified);
+    Dmg[DmgSize / 2] ^= 0x40;
+    Mismatch       |= loadStream (Dmg, DmgSize, &ChunklistContext, &AlteredVerified);
+
+    if (Mismatch || !Verified || AlteredVerified) {
+      Failed = 1;
+    }
+
+    printf (
+      "%s: mismatch %d, verified %d, altered verified %d\n",
+      argv[i],
+      Mismatch,
+      Verified,
+      AlteredVerified
+      );
+
+    free (Dmg);
+    free (Chunklist);
+  }
+
+  return Failed;
+}
+
 int main (int argc, char *argv[]) {
+  //
+  // ./DiskImage verify-on-read image.dmg image.chunklist [...]
+  // ./DiskImage stream image.dmg image.chunklist [...]
+  //
+  if (argc > 1 && strcmp (argv[1], "verify-on-read") == 0) {
+    return testVerifyOnRead (argc - 2, argv + 2);
+  }
+
+  if (argc > 1 && strcmp (argv[1], "stream") == 0) {
+    return testStream (argc - 2, argv + 2);
+  }
+
   if (argc < 2) {
     printf ("Please provide a valid Disk Image path.\n");
     return -1;
@@ -77,23 +381,7 @@ int main (int argc, char *argv[]) {
     OC_APPLE_DISK_IMAGE_CONTEXT DmgContext;
     APPLE_RAM_DISK_EXTENT_TABLE ExtentTable;
 
-#define NUM_EXTENTS 20
-
-    ExtentTable.Signature   = APPLE_RAM_DISK_EXTENT_SIGNATURE;
-    ExtentTable.Version     = APPLE_RAM_DISK_EXTENT_VERSION;
-    ExtentTable.Reserved    = 0;
-    ExtentTable.Signature2  = APPLE_RAM_DISK_EXTENT_SIGNATURE;
-
-    ExtentTable.ExtentCount = MIN (NUM_EXTENTS, ARRAY_SIZE (ExtentTable.Extents));
-
-    UINT32 Index;
-    for (Index = 0; Index < ExtentTable.ExtentCount; ++Index) {
-      ExtentTable.Extents[Index].Start = (uintptr_t)Dmg + (Index * (DmgSize / ExtentTable.ExtentCount));
-      ExtentTable.Extents[Index].Length = (DmgSize / ExtentTable.ExtentCount);
-    }
-    if (Index != 0) {
-      ExtentTable.Extents[Index - 1].Length += (DmgSize - (Index * (DmgSize / ExtentTable.ExtentCount)));
-    }
+    initExtentTable (&ExtentTable, Dmg, DmgSize);
 
     Result = OcAppleDiskImageInitializeContext (&DmgContext, &ExtentTable, DmgSize);
     if (!Result) {
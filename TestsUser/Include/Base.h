@@ -527,6 +527,7 @@ STATIC inline EFI_STATUS FreePool(void *x) { free (x); return EFI_SUCCESS; }
 #define AsciiStrStr strstr
 #define AsciiStrnCmp strncmp
 #define AsciiStrSize(x) (strlen(x) + 1)
+#define AsciiStrnLenS strnlen
 #define AsciiStrnCpyS(a, b, c, d) oc_strlcpy(a, c, b)
 #define AsciiStrDecimalToUint64(a) (strtoull)(a, NULL, 10)
 #define AsciiStrHexToUint64(a) (strtoull)(a, NULL, 16)
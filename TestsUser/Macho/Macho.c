@@ -290,9 +290,101 @@ static int FeedMacho(void *file, uint32_t size) {
     }
   }
 
+  MachoFreeIndices (&Context);
   return code != 963;
 }
 
+static MACH_NLIST_64 *NearestSymbolLinear(OC_MACHO_CONTEXT *Context, UINT64 Address) {
+  MACH_NLIST_64 *Nearest = NULL;
+  MACH_NLIST_64 *Symbol;
+  uint32_t index;
+
+  for (index = 0; (Symbol = MachoGetSymbolByIndex64 (Context, index)) != NULL; index++) {
+    if ((Symbol->Type & MACH_N_TYPE_STAB) == 0 && MachoSymbolIsSection (Symbol)
+      && Symbol->Value <= Address && (Nearest == NULL || Symbol->Value > Nearest->Value)) {
+      Nearest = Symbol;
+    }
+  }
+
+  return Nearest;
+}
+
+static int ProbeNearestSymbol(OC_MACHO_CONTEXT *Context, uint32_t *checked) {
+  MACH_NLIST_64 *Symbol;
+  MACH_NLIST_64 *Expected;
+  MACH_NLIST_64 *Nearest;
+  UINT64 Address;
+  UINT64 Offset;
+  uint32_t index;
+  uint32_t delta;
+  int code = 0;
+
+  //
+  // Probe at, around and between symbol values.
+  //
+  for (index = 0; (Symbol = MachoGetSymbolByIndex64 (Context, index)) != NULL; index++) {
+    for (delta = 0; delta < 3; delta++) {
+      Address = Symbol->Value + delta - 1;
+      Expected = NearestSymbolLinear (Context, Address);
+      Offset = MAX_UINT64;
+      Nearest = MachoGetNearestSymbolByValue64 (Context, Address, &Offset);
+      if (Nearest != Expected || (Nearest != NULL && Offset != Address - Nearest->Value)) {
+        printf("Nearest symbol mismatch at %llx\n", (unsigned long long) Address);
+        code = 1;
+      }
+      (*checked)++;
+    }
+  }
+
+  Expected = NearestSymbolLinear (Context, MAX_UINT64);
+  if (MachoGetNearestSymbolByValue64 (Context, MAX_UINT64, NULL) != Expected) {
+    printf("Nearest symbol mismatch at top\n");
+    code = 1;
+  }
+
+  return code;
+}
+
+static int TestNearestSymbol(void *file, uint32_t size) {
+  OC_MACHO_CONTEXT Context;
+  if (!MachoInitializeContext (&Context, file, size)) {
+    return -1;
+  }
+
+  MACH_NLIST_64 *Symbol;
+  MACH_NLIST_64 *Other;
+  uint32_t index;
+  uint32_t checked = 0;
+  int code = 0;
+
+  code |= ProbeNearestSymbol (&Context, &checked);
+
+  //
+  // Values set through the index must keep it sorted, including moves onto
+  // the value of another symbol.
+  //
+  for (index = 0; (Symbol = MachoGetSymbolByIndex64 (&Context, index)) != NULL; index += 7) {
+    Other = MachoGetSymbolByIndex64 (&Context, index / 2);
+    MachoSetSymbolValue64 (&Context, Symbol, (index % 2) == 0 ? Other->Value : Symbol->Value + 0x11);
+  }
+
+  code |= ProbeNearestSymbol (&Context, &checked);
+
+  //
+  // Relocation must drop the index.
+  //
+  for (index = 0; (Symbol = MachoGetSymbolByIndex64 (&Context, index)) != NULL; index++) {
+    MachoRelocateSymbol64 (&Context, 0x100000000, Symbol);
+  }
+
+  code |= ProbeNearestSymbol (&Context, &checked);
+
+  printf("Nearest symbol checked %u addresses\n", checked);
+
+  MachoFreeIndices (&Context);
+  return code;
+}
+
 int main(int argc, char** argv) {
   uint32_t f;
   uint8_t *b;
@@ -301,7 +393,8 @@ int main(int argc, char** argv) {
     return -1;
   }
 
-  return FeedMacho (b, f);
+  int code = FeedMacho (b, f);
+  return TestNearestSymbol (b, f) != 0 ? -1 : code;
 }
 
 INT32 LLVMFuzzerTestOneInput(CONST UINT8 *Data, UINTN Size) {
@@ -20,19 +20,28 @@
 #include <sys/time.h>
 
 /*
- clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -I../../../UefiCpuPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
+ clang -g -fsanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -I../../../UefiCpuPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/LinkedCache.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
 
  for fuzzing:
- clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
+ clang-mp-7.0 -DFUZZING_TEST=1 -g -fsanitize=undefined,address,fuzzer -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/LinkedCache.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c -o Prelinked
  rm -rf DICT fuzz*.log ; mkdir DICT ; find /System/Library/Extensions/<< * >>/Contents/MacOS -type f -exec cp {} DICT \; UBSAN_OPTIONS='halt_on_error=1' ./Prelinked -jobs=4 DICT -rss_limit_mb=4096
 
  rm -rf Prelinked.dSYM DICT fuzz*.log Prelinked
 
- clang -DTEST_SLE=1 -g -O3 -fno-sanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c  -o Prelinked
+ clang -DTEST_SLE=1 -g -O3 -fno-sanitize=undefined,address -Wno-incompatible-pointer-types-discards-qualifiers -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Prelinked.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcMachoLib/CxxSymbols.c ../../Library/OcMachoLib/Header.c ../../Library/OcMachoLib/Relocations.c ../../Library/OcMachoLib/Symbols.c ../../Library/OcAppleKernelLib/PrelinkedContext.c ../../Library/OcAppleKernelLib/PrelinkedKext.c ../../Library/OcAppleKernelLib/LinkedCache.c ../../Library/OcAppleKernelLib/KextPatcher.c ../../Library/OcMiscLib/DataPatcher.c ../../Library/OcAppleKernelLib/Link.c ../../Library/OcAppleKernelLib/Vtables.c ../../Library/OcAppleKernelLib/KernelReader.c ../../Library/OcCompressionLib/lzss/lzss.c ../../Library/OcCompressionLib/lzvn/lzvn.c ../../Tests/KernelTest/Lilu.c ../../Tests/KernelTest/Vsmc.c  -o Prelinked
 
  for i in /System/Library/Extensions/<< * >>.kext ; do plist=$i/Contents/Info.plist ; kext="$i/Contents/MacOS/$(/usr/libexec/PlistBuddy -c 'Print CFBundleExecutable' "$plist")" ; echo "$kext $plist" ; ./Prelinked prelinkedkernel.unpack "$kext" "$plist" ; done
 
  /[^\n]+\nPassed.kext injected - 0x8[^\n]+
+
+ for linear vs hashed symbol lookup benchmark add -DTEST_SYMBOL_LOOKUP=1 to the optimised build above:
+ ./Prelinked prelinkedkernel.unpack
+
+ for linked cache round-trip with intact and corrupted caches add -DTEST_LINKED_CACHE=1 to the first build above:
+ ./Prelinked prelinkedkernel.unpack
+
+ for batched vs sequential generic patch comparison on Lilu add -DTEST_GENERIC_PATCHES=1 to the first build above:
+ ./Prelinked
 */
 
 STATIC CHAR8 KextInfoPlistData[] = {
@@ -412,11 +421,497 @@ ApplyKernelPatches (
     } else {
       DEBUG ((DEBUG_WARN, "Patch success kernel\n"));
     }
+
+    PatcherFreeContext (&Patcher);
   } else {
     DEBUG ((DEBUG_WARN, "Failed to find kernel - %r\n", Status));
   }
 }
 
+#ifdef TEST_SYMBOL_LOOKUP
+#include "../../Library/OcAppleKernelLib/PrelinkedInternal.h"
+
+STATIC
+VOID
+BenchmarkSymbolLookup (
+  PRELINKED_CONTEXT  *Context
+  )
+{
+  EFI_STATUS      Status;
+  PRELINKED_KEXT  *Kernel;
+  PRELINKED_KEXT  Lookup;
+  UINT32          *SymbolHash;
+  UINT32          Index;
+  UINT32          Step;
+  UINT32          Found;
+  UINT32          Pass;
+  UINT32          Repeat;
+  long long       Start;
+
+  Kernel = InternalCachedPrelinkedKernel (Context);
+  if (Kernel == NULL) {
+    printf("Kernel lookup fail\n");
+    return;
+  }
+
+  Status = InternalScanPrelinkedKext (Kernel, Context, TRUE);
+  if (EFI_ERROR (Status)) {
+    printf("Kernel scan fail %zx\n", Status);
+    return;
+  }
+
+  //
+  // Resolve kernel symbols through a dummy kext, like InternalSolveSymbolNonWeak64 does.
+  //
+  ZeroMem (&Lookup, sizeof (Lookup));
+  Lookup.Dependencies[0] = Kernel;
+
+  Step       = Kernel->NumberOfSymbols / 4096 + 1;
+  SymbolHash = Kernel->LinkedSymbolHash;
+
+  for (Pass = 0; Pass < 2; ++Pass) {
+    Kernel->LinkedSymbolHash = Pass == 0 ? NULL : SymbolHash;
+    Found = 0;
+    Start = current_timestamp();
+
+    for (Repeat = 0; Repeat < 16; ++Repeat) {
+      for (Index = 0; Index < Kernel->NumberOfSymbols; Index += Step) {
+        if (InternalOcGetSymbolName (Context, &Lookup, Kernel->LinkedSymbolTable[Index].Name, OcGetSymbolFirstLevel) != NULL) {
+          ++Found;
+        }
+      }
+    }
+
+    printf (
+      "%s lookup of %u symbols (%u found) out of %u in %lld ms\n",
+      Pass == 0 ? "Linear" : "Hashed",
+      16 * ((Kernel->NumberOfSymbols + Step - 1) / Step),
+      Found,
+      Kernel->NumberOfSymbols,
+      current_timestamp() - Start
+      );
+  }
+
+  Kernel->LinkedSymbolHash = SymbolHash;
+}
+#endif
+
+#ifdef TEST_LINKED_CACHE
+#include "../../Library/OcAppleKernelLib/PrelinkedInternal.h"
+
+enum {
+  LinkedCacheIntact,
+  LinkedCacheFullHash,
+  LinkedCacheUnsortedValueOrder,
+  LinkedCacheModeMax
+};
+
+STATIC CONST CHAR8 *mLinkedCacheModes[LinkedCacheModeMax] = {
+  "intact",
+  "full hash",
+  "unsorted value order"
+};
+
+STATIC
+VOID
+CorruptLinkedCache (
+  IN OUT UINT8   *Cache,
+  IN     UINT32  Mode
+  )
+{
+  PRELINKED_LINKED_CACHE_KEXT  *CacheKext;
+  UINT32                       *Indices;
+  UINT32                       Index;
+  UINT32                       Entry;
+
+  //
+  // The kernel always comes first.
+  //
+  CacheKext = (PRELINKED_LINKED_CACHE_KEXT *) ((PRELINKED_LINKED_CACHE_HEADER *) Cache + 1);
+
+  if (Mode == LinkedCacheFullHash && CacheKext->HashOffset != 0) {
+    Indices = (UINT32 *) &Cache[CacheKext->HashOffset];
+    for (Index = 0; Index <= CacheKext->LinkedSymbolHashMask; ++Index) {
+      if (Indices[Index] == 0) {
+        Indices[Index] = 1;
+      }
+    }
+  } else if (Mode == LinkedCacheUnsortedValueOrder && CacheKext->ValueOrderOffset != 0) {
+    Indices = (UINT32 *) &Cache[CacheKext->ValueOrderOffset];
+    Entry                                     = Indices[0];
+    Indices[0]                                = Indices[CacheKext->NumberOfSymbols - 1];
+    Indices[CacheKext->NumberOfSymbols - 1]   = Entry;
+  }
+}
+
+STATIC
+VOID
+TestLinkedCache (
+  IN CONST UINT8  *Kernel,
+  IN UINT32       KernelSize,
+  IN UINT32       AllocSize
+  )
+{
+  EFI_STATUS         Status;
+  PRELINKED_CONTEXT  Context;
+  PRELINKED_CONTEXT  CachedContext;
+  UINT8              *Buffer;
+  UINT8              *CachedBuffer;
+  VOID               *Cache;
+  VOID               *CachedCache;
+  UINT32             CacheSize;
+  PRELINKED_KEXT     *Expected;
+  PRELINKED_KEXT     *Actual;
+  PRELINKED_KEXT     ExpectedLookup;
+  PRELINKED_KEXT     ActualLookup;
+  CONST PRELINKED_KEXT_SYMBOL *ExpectedSymbol;
+  CONST PRELINKED_KEXT_SYMBOL *ActualSymbol;
+  UINT32             Mode;
+  UINT32             Index;
+  UINT32             Mismatches;
+
+  Buffer = AllocateCopyPool (AllocSize, Kernel);
+  if (Buffer == NULL
+    || EFI_ERROR (PrelinkedContextInit (&Context, Buffer, KernelSize, AllocSize))) {
+    printf("Linked cache context fail\n");
+    abort();
+  }
+
+  Status = PrelinkedExportLinkedCache (&Context, &Cache, &CacheSize);
+  if (EFI_ERROR (Status)) {
+    printf("Linked cache export fail %zx\n", Status);
+    abort();
+  }
+
+  Expected = InternalCachedPrelinkedKernel (&Context);
+  ZeroMem (&ExpectedLookup, sizeof (ExpectedLookup));
+  ExpectedLookup.Dependencies[0] = Expected;
+
+  for (Mode = 0; Mode < LinkedCacheModeMax; ++Mode) {
+    CachedBuffer = AllocateCopyPool (AllocSize, Kernel);
+    if (CachedBuffer == NULL
+      || EFI_ERROR (PrelinkedContextInit (&CachedContext, CachedBuffer, KernelSize, AllocSize))) {
+      printf("Linked cache context fail\n");
+      abort();
+    }
+
+    CachedCache = AllocateCopyPool (CacheSize, Cache);
+    if (CachedCache == NULL) {
+      abort();
+    }
+    CorruptLinkedCache (CachedCache, Mode);
+
+    Status = PrelinkedImportLinkedCache (&CachedContext, CachedCache, CacheSize);
+    if (EFI_ERROR (Status)) {
+      FreePool (CachedCache);
+    }
+
+    //
+    // Corrupted kernel entry must be skipped and the kernel linked as usual.
+    //
+    Actual = InternalCachedPrelinkedKernel (&CachedContext);
+    if (EFI_ERROR (Status) || Actual == NULL || Actual->LinkedCached != (Mode == LinkedCacheIntact)
+      || EFI_ERROR (InternalScanPrelinkedKext (Actual, &CachedContext, TRUE))) {
+      printf("Linked cache %s import fail %zx\n", mLinkedCacheModes[Mode], Status);
+      abort();
+    }
+
+    ZeroMem (&ActualLookup, sizeof (ActualLookup));
+    ActualLookup.Dependencies[0] = Actual;
+
+    Mismatches = 0;
+    for (Index = 0; Index < Expected->NumberOfSymbols; ++Index) {
+      ExpectedSymbol = InternalOcGetSymbolName (&Context, &ExpectedLookup, Expected->LinkedSymbolTable[Index].Name, OcGetSymbolFirstLevel);
+      ActualSymbol   = InternalOcGetSymbolName (&CachedContext, &ActualLookup, Expected->LinkedSymbolTable[Index].Name, OcGetSymbolFirstLevel);
+      if (ExpectedSymbol == NULL || ActualSymbol == NULL || ExpectedSymbol->Value != ActualSymbol->Value) {
+        ++Mismatches;
+        continue;
+      }
+
+      ExpectedSymbol = InternalOcGetSymbolValue (&Context, &ExpectedLookup, Expected->LinkedSymbolTable[Index].Value, OcGetSymbolFirstLevel);
+      ActualSymbol   = InternalOcGetSymbolValue (&CachedContext, &ActualLookup, Expected->LinkedSymbolTable[Index].Value, OcGetSymbolFirstLevel);
+      if (ExpectedSymbol == NULL || ActualSymbol == NULL || AsciiStrCmp (ExpectedSymbol->Name, ActualSymbol->Name) != 0) {
+        ++Mismatches;
+      }
+    }
+
+    Status = PrelinkedInjectPrepare (&CachedContext);
+    if (!EFI_ERROR (Status)) {
+      Status = PrelinkedInjectKext (
+        &CachedContext,
+        "/Library/Extensions/Lilu.kext",
+        LiluKextInfoPlistData,
+        LiluKextInfoPlistDataSize,
+        "Contents/MacOS/Lilu",
+        LiluKextData,
+        LiluKextDataSize
+        );
+    }
+
+    printf (
+      "Linked cache %s - %u mismatches out of %u symbols, Lilu.kext injected - %zx\n",
+      mLinkedCacheModes[Mode],
+      Mismatches,
+      Expected->NumberOfSymbols,
+      Status
+      );
+
+    if (Mismatches != 0 || EFI_ERROR (Status)) {
+      abort();
+    }
+
+    PrelinkedContextFree (&CachedContext);
+    FreePool (CachedBuffer);
+  }
+
+  FreePool (Cache);
+  PrelinkedContextFree (&Context);
+  FreePool (Buffer);
+}
+#endif
+
+#ifdef TEST_GENERIC_PATCHES
+STATIC UINT32 mPatchSeed = 0x12345678;
+
+STATIC
+UINT32
+PatchRandom (
+  IN UINT32  Limit
+  )
+{
+  mPatchSeed ^= mPatchSeed << 13;
+  mPatchSeed ^= mPatchSeed >> 17;
+  mPatchSeed ^= mPatchSeed << 5;
+  return Limit > 0 ? mPatchSeed % Limit : 0;
+}
+
+STATIC
+VOID
+TestGenericPatches (
+  VOID
+  )
+{
+  EFI_STATUS             Status;
+  EFI_STATUS             BatchStatus;
+  PATCHER_CONTEXT        Original;
+  PATCHER_CONTEXT        Sequential;
+  PATCHER_CONTEXT        Batched;
+  UINT8                  *SequentialImage;
+  UINT8                  *BatchedImage;
+  UINT32                 NumSymbols;
+  CONST MACH_NLIST_64    *SymbolTable;
+  MACH_SEGMENT_COMMAND_64 *LinkEdit;
+  UINT8                  *Base;
+  UINT32                 Start;
+  UINT32                 HeaderSize;
+  PATCHER_GENERIC_PATCH  Patches[8];
+  UINT8                  Data[ARRAY_SIZE (Patches)][4][12];
+  EFI_STATUS             Statuses[ARRAY_SIZE (Patches)];
+  EFI_STATUS             Expected[ARRAY_SIZE (Patches)];
+  UINT32                 PatchCount;
+  UINT32                 Trial;
+  UINT32                 Index;
+  UINT32                 Byte;
+  UINT32                 Offset;
+  UINT32                 Applied;
+  BOOLEAN                Symbolic;
+
+  Status = PatcherInitContextFromBuffer (&Original, LiluKextData, LiluKextDataSize);
+  if (EFI_ERROR (Status)) {
+    printf("Patcher context fail %zx\n", Status);
+    abort();
+  }
+
+  NumSymbols      = MachoGetSymbolTable (&Original.MachContext, &SymbolTable, NULL, NULL, NULL, NULL, NULL, NULL, NULL);
+  LinkEdit        = MachoGetSegmentByName64 (&Original.MachContext, "__LINKEDIT");
+  HeaderSize      = sizeof (MACH_HEADER_64) + MachoGetMachHeader64 (&Original.MachContext)->CommandsSize;
+  SequentialImage = AllocatePool (LiluKextDataSize);
+  BatchedImage    = AllocatePool (LiluKextDataSize);
+  if (NumSymbols == 0 || LinkEdit == NULL || SequentialImage == NULL || BatchedImage == NULL) {
+    abort();
+  }
+
+  Applied = 0;
+
+  for (Trial = 0; Trial < 5000; ++Trial) {
+    CopyMem (SequentialImage, LiluKextData, LiluKextDataSize);
+    CopyMem (BatchedImage, LiluKextData, LiluKextDataSize);
+
+    //
+    // Short patterns taken from the image match in many places, and patterns
+    // taken from an earlier replacement only match after it is applied.
+    // Symbol bases are resolved before patching, so Mach-O header and
+    // __LINKEDIT are left intact when any patch has a symbol base.
+    //
+    Symbolic   = PatchRandom (2) == 0;
+    PatchCount = PatchRandom (ARRAY_SIZE (Patches)) + 1;
+    ZeroMem (Patches, sizeof (Patches));
+    for (Index = 0; Index < PatchCount; ++Index) {
+      Patches[Index].Size = PatchRandom (PatchRandom (4) == 0 ? 12 : 3) + 1;
+      for (Byte = 0; Byte < Patches[Index].Size; ++Byte) {
+        Data[Index][1][Byte] = (UINT8) PatchRandom (4);
+        Data[Index][2][Byte] = (UINT8) PatchRandom (256);
+        Data[Index][3][Byte] = (UINT8) PatchRandom (256);
+      }
+
+      Start = 0;
+      if (Symbolic) {
+        do {
+          Patches[Index].Base = MachoGetSymbolName64 (
+            &Original.MachContext,
+            MachoGetSymbolByIndex64 (&Original.MachContext, PatchRandom (NumSymbols))
+            );
+          if (EFI_ERROR (PatcherGetSymbolAddress (&Original, Patches[Index].Base, &Base))) {
+            break;
+          }
+          Start = (UINT32) (Base - LiluKextData);
+        } while (Start < HeaderSize || Start >= LinkEdit->FileOffset);
+      }
+
+      if (PatchRandom (16) != 0) {
+        if (Index > 0 && Patches[Index - 1].Size >= Patches[Index].Size && PatchRandom (3) == 0) {
+          CopyMem (Data[Index][0], Patches[Index - 1].Replace, Patches[Index].Size);
+        } else {
+          Offset = PatchRandom (LiluKextDataSize - Patches[Index].Size);
+          CopyMem (Data[Index][0], &LiluKextData[Offset], Patches[Index].Size);
+        }
+        Patches[Index].Find = Data[Index][0];
+      }
+
+      Patches[Index].Replace     = Data[Index][1];
+      Patches[Index].Mask        = PatchRandom (4) == 0 ? Data[Index][2] : NULL;
+      Patches[Index].ReplaceMask = PatchRandom (4) == 0 ? Data[Index][3] : NULL;
+      Patches[Index].Count       = PatchRandom (4);
+      Patches[Index].Skip        = PatchRandom (3);
+      Patches[Index].Limit       = PatchRandom (4) == 0 ? PatchRandom (LiluKextDataSize) : 0;
+      if (Symbolic && (Patches[Index].Limit == 0 || Patches[Index].Limit > LinkEdit->FileOffset - Start)) {
+        Patches[Index].Limit = (UINT32) LinkEdit->FileOffset - Start;
+      }
+    }
+
+    if (EFI_ERROR (PatcherInitContextFromBuffer (&Sequential, SequentialImage, LiluKextDataSize))
+      || EFI_ERROR (PatcherInitContextFromBuffer (&Batched, BatchedImage, LiluKextDataSize))) {
+      abort();
+    }
+
+    for (Index = 0; Index < PatchCount; ++Index) {
+      Expected[Index] = PatcherApplyGenericPatch (&Sequential, &Patches[Index]);
+      if (!EFI_ERROR (Expected[Index])) {
+        ++Applied;
+      }
+    }
+
+    BatchStatus = PatcherApplyGenericPatches (&Batched, Patches, PatchCount, Statuses);
+
+    for (Index = 0; Index < PatchCount; ++Index) {
+      if (Statuses[Index] != Expected[Index]
+        || (EFI_ERROR (Expected[Index]) && !EFI_ERROR (BatchStatus))) {
+        break;
+      }
+    }
+
+    if (Index < PatchCount || CompareMem (SequentialImage, BatchedImage, LiluKextDataSize) != 0) {
+      printf("Generic patches mismatch in trial %u\n", Trial);
+      abort();
+    }
+
+    PatcherFreeContext (&Sequential);
+    PatcherFreeContext (&Batched);
+  }
+
+  printf("Generic patches match in %u trials, %u patches applied\n", Trial, Applied);
+
+  FreePool (SequentialImage);
+  FreePool (BatchedImage);
+  PatcherFreeContext (&Original);
+}
+#endif
+
+STATIC
+VOID
+TestInjectKexts (
+  IN CONST UINT8  *Kernel,
+  IN UINT32       KernelSize,
+  IN UINT32       AllocSize
+  )
+{
+  EFI_STATUS             Status;
+  PRELINKED_CONTEXT      Context;
+  UINT8                  *Buffer;
+  UINT32                 PrelinkedSize;
+  UINT64                 TextFileSize;
+  UINT64                 LastLoadAddress;
+  UINT32                 Index;
+  PRELINKED_INJECT_KEXT  Kexts[4];
+
+  Buffer = AllocateCopyPool (AllocSize, Kernel);
+  if (Buffer == NULL
+    || EFI_ERROR (PrelinkedContextInit (&Context, Buffer, KernelSize, AllocSize))
+    || EFI_ERROR (PrelinkedInjectPrepare (&Context))) {
+    printf("Batched injection context fail\n");
+    abort();
+  }
+
+  PrelinkedSize   = Context.PrelinkedSize;
+  TextFileSize    = Context.PrelinkedTextSegment->FileSize;
+  LastLoadAddress = Context.PrelinkedLastLoadAddress;
+
+  //
+  // VirtualSMC depends on Lilu, so it goes first to check the ordering, and
+  // a truncated executable checks that failures leave no traces.
+  //
+  ZeroMem (Kexts, sizeof (Kexts));
+  Kexts[0].BundlePath     = "/Library/Extensions/VirtualSMC.kext";
+  Kexts[0].InfoPlist      = VsmcKextInfoPlistData;
+  Kexts[0].InfoPlistSize  = VsmcKextInfoPlistDataSize;
+  Kexts[0].ExecutablePath = "Contents/MacOS/VirtualSMC";
+  Kexts[0].Executable     = VsmcKextData;
+  Kexts[0].ExecutableSize = VsmcKextDataSize;
+  Kexts[1].BundlePath     = "/Library/Extensions/Broken.kext";
+  Kexts[1].InfoPlist      = KextInfoPlistData;
+  Kexts[1].InfoPlistSize  = sizeof (KextInfoPlistData);
+  Kexts[1].ExecutablePath = "Contents/MacOS/Broken";
+  Kexts[1].Executable     = LiluKextData;
+  Kexts[1].ExecutableSize = 64;
+  Kexts[2].BundlePath     = "/Library/Extensions/Lilu.kext";
+  Kexts[2].InfoPlist      = LiluKextInfoPlistData;
+  Kexts[2].InfoPlistSize  = LiluKextInfoPlistDataSize;
+  Kexts[2].ExecutablePath = "Contents/MacOS/Lilu";
+  Kexts[2].Executable     = LiluKextData;
+  Kexts[2].ExecutableSize = LiluKextDataSize;
+  Kexts[3].BundlePath     = "/Library/Extensions/TestDriver.kext";
+  Kexts[3].InfoPlist      = KextInfoPlistData;
+  Kexts[3].InfoPlistSize  = sizeof (KextInfoPlistData);
+
+  Status = PrelinkedInjectKexts (&Context, Kexts, ARRAY_SIZE (Kexts));
+
+  for (Index = 0; Index < ARRAY_SIZE (Kexts); ++Index) {
+    DEBUG ((DEBUG_WARN, "%a batch injected - %r\n", Kexts[Index].BundlePath, Kexts[Index].Status));
+  }
+
+  //
+  // Only Lilu and VirtualSMC executables must be accounted, and equally in all sizes.
+  //
+  if (!EFI_ERROR (Status)
+    || EFI_ERROR (Kexts[0].Status) || !EFI_ERROR (Kexts[1].Status)
+    || EFI_ERROR (Kexts[2].Status) || EFI_ERROR (Kexts[3].Status)
+    || Context.PrelinkedSize - PrelinkedSize != Context.PrelinkedTextSegment->FileSize - TextFileSize
+    || Context.PrelinkedSize - PrelinkedSize != Context.PrelinkedLastLoadAddress - LastLoadAddress
+    || Context.PrelinkedSize - PrelinkedSize < MACHO_ALIGN (LiluKextDataSize)) {
+    printf("Batched injection fail\n");
+    abort();
+  }
+
+  Status = PrelinkedInjectComplete (&Context);
+  if (EFI_ERROR (Status)) {
+    printf("Batched injection complete error %zx\n", Status);
+    abort();
+  }
+
+  PrelinkedContextFree (&Context);
+  FreePool (Buffer);
+}
+
 #ifdef FUZZING_TEST
 #define main no_main
 #endif
@@ -458,6 +953,10 @@ GetFileSize (
 int wrap_main(int argc, char** argv) {
   UINT32 AllocSize;
   PRELINKED_CONTEXT Context;
+#ifdef TEST_GENERIC_PATCHES
+  TestGenericPatches ();
+  return 0;
+#endif
   const char *name = argc > 1 ? argv[1] : "/System/Library/PrelinkedKernels/prelinkedkernel";
   if ((Prelinked = readFile(name, &PrelinkedSize)) == NULL) {
     printf("Read fail\n");
@@ -498,9 +997,21 @@ int wrap_main(int argc, char** argv) {
   ApplyKernelPatches (Prelinked, PrelinkedSize);
 #endif
 
+#ifdef TEST_LINKED_CACHE
+  TestLinkedCache (Prelinked, PrelinkedSize, AllocSize);
+#endif
+
+#ifndef TEST_SLE
+  TestInjectKexts (Prelinked, PrelinkedSize, AllocSize);
+#endif
+
   EFI_STATUS Status = PrelinkedContextInit (&Context, Prelinked, PrelinkedSize, AllocSize);
 
   if (!EFI_ERROR (Status)) {
+#ifdef TEST_SYMBOL_LOOKUP
+    BenchmarkSymbolLookup (&Context);
+#endif
+
     ApplyKextPatches (&Context);
 
     Status = PrelinkedInjectPrepare (&Context);
@@ -14,19 +14,40 @@
 
 #include <Library/OcTemplateLib.h>
 #include <Library/OcSerializeLib.h>
+#include <Library/OcXmlLib.h>
 #include <Library/OcMiscLib.h>
 #include <Library/OcConfigurationLib.h>
 
+#include <stdarg.h>
 #include <sys/time.h>
 
+#if defined(__SANITIZE_ADDRESS__)
+#define TEST_ADDRESS_SANITIZER 1
+#elif defined(__has_feature)
+#if __has_feature(address_sanitizer)
+#define TEST_ADDRESS_SANITIZER 1
+#endif
+#endif
+
+#ifdef TEST_ADDRESS_SANITIZER
+#include <sanitizer/asan_interface.h>
+#endif
+
 /*
- clang -g -fsanitize=undefined,address -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Serialized.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcConfigurationLib/OcConfigurationLib.c -o Serialized
+ clang -g -fsanitize=undefined,address -I../Include -I../../Include -I../../../MdePkg/Include/ -I../../../EfiPkg/Include/ -include ../Include/Base.h Serialized.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcConfigurationLib/OcConfigurationLib.c -o Serialized
 
  for fuzzing:
- clang-mp-7.0 -Dmain=__main -g -fsanitize=undefined,address,fuzzer -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h Serialized.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcConfigurationLib/OcConfigurationLib.c -o Serialized
+ clang-mp-7.0 -Dmain=__main -g -fsanitize=undefined,address,fuzzer -I../Include -I../../Include -I../../../MdePkg/Include/ -include ../Include/Base.h Serialized.c ../../Library/OcXmlLib/OcXmlLib.c ../../Library/OcXmlLib/BinaryPlist.c ../../Library/OcTemplateLib/OcTemplateLib.c ../../Library/OcSerializeLib/OcSerializeLib.c ../../Library/OcMiscLib/Base64Decode.c ../../Library/OcStringLib/OcAsciiLib.c ../../Library/OcConfigurationLib/OcConfigurationLib.c -o Serialized
  rm -rf DICT fuzz*.log ; mkdir DICT ; cp Serialized.plist DICT ; ./Serialized -jobs=4 DICT
 
  rm -rf Serialized.dSYM DICT fuzz*.log Serialized
+
+ for parse throughput:
+ ./Serialized file.plist 100
+ for binary plist export (binary configs are parsed as usual):
+ ./Serialized file.plist bplist file.bin
+ for streamed, binary, and node tree equivalence on generated configs:
+ ./Serialized equivalence 600
 */
 
 
@@ -57,14 +78,857 @@ uint8_t *readFile(const char *str, uint32_t *size) {
   return string;
 }
 
+//
+// Generated configuration schema covering dictionaries, arrays, maps,
+// values, and blobs.
+//
+#define TEST_ENTRY_FIELDS(_, __) \
+  _(BOOLEAN                     , Enabled          ,     , FALSE                       , ()                   ) \
+  _(OC_STRING                   , Comment          ,     , OC_STRING_CONSTR ("", _, __), OC_DESTR (OC_STRING) ) \
+  _(UINT32                      , Count            ,     , 0                           , ()                   ) \
+  _(OC_DATA                     , Data             ,     , OC_EDATA_CONSTR (_, __)     , OC_DESTR (OC_DATA)   ) \
+  _(UINT8                       , Fixed            , [4] , {0}                         , ()                   )
+  OC_DECLARE (TEST_ENTRY)
+
+#define TEST_ENTRY_ARRAY_FIELDS(_, __) \
+  OC_ARRAY (TEST_ENTRY, _, __)
+  OC_DECLARE (TEST_ENTRY_ARRAY)
+
+#define TEST_ENTRY_MAP_FIELDS(_, __) \
+  OC_MAP (OC_STRING, TEST_ENTRY, _, __)
+  OC_DECLARE (TEST_ENTRY_MAP)
+
+#define TEST_OPTIONS_FIELDS(_, __) \
+  _(BOOLEAN                     , Flag             ,     , FALSE                       , ()                   ) \
+  _(UINT64                      , Number           ,     , 0                           , ()                   )
+  OC_DECLARE (TEST_OPTIONS)
+
+#define TEST_CONFIG_FIELDS(_, __) \
+  _(OC_ASSOC                    , Assoc            ,     , OC_CONSTR2 (OC_ASSOC, _, __)          , OC_DESTR (OC_ASSOC)          ) \
+  _(TEST_ENTRY_ARRAY            , Entries          ,     , OC_CONSTR2 (TEST_ENTRY_ARRAY, _, __)  , OC_DESTR (TEST_ENTRY_ARRAY)  ) \
+  _(TEST_ENTRY_MAP              , Named            ,     , OC_CONSTR2 (TEST_ENTRY_MAP, _, __)    , OC_DESTR (TEST_ENTRY_MAP)    ) \
+  _(TEST_OPTIONS                , Options          ,     , OC_CONSTR2 (TEST_OPTIONS, _, __)      , OC_DESTR (TEST_OPTIONS)      ) \
+  _(OC_STRING                   , Title            ,     , OC_STRING_CONSTR ("", _, __)          , OC_DESTR (OC_STRING)         )
+  OC_DECLARE (TEST_CONFIG)
+
+OC_STRUCTORS       (TEST_ENTRY, ())
+OC_ARRAY_STRUCTORS (TEST_ENTRY_ARRAY)
+OC_MAP_STRUCTORS   (TEST_ENTRY_MAP)
+OC_STRUCTORS       (TEST_OPTIONS, ())
+OC_STRUCTORS       (TEST_CONFIG, ())
+
+STATIC
+OC_SCHEMA
+mTestEntrySchemaEntry[] = {
+  OC_SCHEMA_STRING_IN    ("Comment",        TEST_ENTRY, Comment),
+  OC_SCHEMA_INTEGER_IN   ("Count",          TEST_ENTRY, Count),
+  OC_SCHEMA_DATA_IN      ("Data",           TEST_ENTRY, Data),
+  OC_SCHEMA_BOOLEAN_IN   ("Enabled",        TEST_ENTRY, Enabled),
+  OC_SCHEMA_DATAF_IN     ("Fixed",          TEST_ENTRY, Fixed),
+};
+
+STATIC
+OC_SCHEMA
+mTestEntrySchema = OC_SCHEMA_DICT (NULL, mTestEntrySchemaEntry);
+
+STATIC
+OC_SCHEMA
+mTestAssocEntrySchema = OC_SCHEMA_MDATA (NULL);
+
+STATIC
+OC_SCHEMA
+mTestOptionsSchema[] = {
+  OC_SCHEMA_BOOLEAN_IN   ("Flag",           TEST_CONFIG, Options.Flag),
+  OC_SCHEMA_INTEGER_IN   ("Number",         TEST_CONFIG, Options.Number),
+};
+
+STATIC
+OC_SCHEMA
+mTestRootSchema[] = {
+  OC_SCHEMA_MAP_IN       ("Assoc",          TEST_CONFIG, Assoc, &mTestAssocEntrySchema),
+  OC_SCHEMA_ARRAY_IN     ("Entries",        TEST_CONFIG, Entries, &mTestEntrySchema),
+  OC_SCHEMA_MAP_IN       ("Named",          TEST_CONFIG, Named, &mTestEntrySchema),
+  OC_SCHEMA_DICT         ("Options",        mTestOptionsSchema),
+  OC_SCHEMA_STRING_IN    ("Title",          TEST_CONFIG, Title),
+};
+
+STATIC
+OC_SCHEMA_INFO
+mTestRootInfo = {
+  .Dict = {mTestRootSchema, ARRAY_SIZE (mTestRootSchema)}
+};
+
+typedef struct {
+  char      *Buffer;
+  uint32_t  Size;
+  uint32_t  AllocSize;
+  uint32_t  Seed;
+} TEST_GEN;
+
+static uint32_t genRandom(TEST_GEN *g, uint32_t n) {
+  g->Seed ^= g->Seed << 13;
+  g->Seed ^= g->Seed >> 17;
+  g->Seed ^= g->Seed << 5;
+  return g->Seed % n;
+}
+
+static void genPrint(TEST_GEN *g, const char *format, ...) {
+  va_list args;
+  int     len;
+
+  va_start(args, format);
+  len = vsnprintf(NULL, 0, format, args);
+  va_end(args);
+
+  if (g->Size + len + 1 > g->AllocSize) {
+    g->AllocSize = (g->Size + len + 1) * 2;
+    g->Buffer    = realloc(g->Buffer, g->AllocSize);
+  }
+
+  va_start(args, format);
+  vsnprintf(g->Buffer + g->Size, len + 1, format, args);
+  va_end(args);
+  g->Size += len;
+}
+
+static void genData(TEST_GEN *g) {
+  static const char *data[] = {"", "AQID", "AAECAwQFBgcICQoLDA0ODxAREhM=", "AAEC\n  AwQ=", "3q2+7w=="};
+  genPrint(g, "<data>%s</data>", data[genRandom(g, 5)]);
+}
+
+static void genKey(TEST_GEN *g, const char *name) {
+  switch (genRandom(g, 20)) {
+    case 0: genPrint(g, "<key>#%s</key>", name); break;
+    case 1: genPrint(g, "<key>Unknown%u</key>", genRandom(g, 10)); break;
+    default: genPrint(g, "<key>%s</key>", name); break;
+  }
+}
+
+//
+// Prints a random value, which never matches the schema.
+//
+static void genAny(TEST_GEN *g, uint32_t depth) {
+  uint32_t n;
+
+  switch (depth > 3 ? genRandom(g, 5) : genRandom(g, 7)) {
+    case 0: genPrint(g, genRandom(g, 2) ? "<true/>" : "<false/>"); break;
+    case 1: genPrint(g, genRandom(g, 4) ? "<integer>%u</integer>" : "<integer>-%u</integer>", genRandom(g, 100000)); break;
+    case 2: genPrint(g, genRandom(g, 2) ? "<string>s%u</string>" : "<string/>", genRandom(g, 1000)); break;
+    case 3: genData(g); break;
+    case 4: genPrint(g, "<dict/>"); break;
+    case 5:
+      genPrint(g, "<array>");
+      for (n = genRandom(g, 4); n > 0; n--) genAny(g, depth + 1);
+      genPrint(g, "</array>");
+      break;
+    default:
+      genPrint(g, "<dict>");
+      for (n = genRandom(g, 4); n > 0; n--) {
+        genPrint(g, "<key>k%u</key>", genRandom(g, 5));
+        genAny(g, depth + 1);
+      }
+      genPrint(g, "</dict>");
+      break;
+  }
+}
+
+static void genEntry(TEST_GEN *g, uint32_t depth) {
+  if (genRandom(g, 20) == 0) {
+    genAny(g, depth);
+    return;
+  }
+
+  genPrint(g, "<dict>\n");
+  if (genRandom(g, 4)) {
+    genKey(g, "Comment");
+    genPrint(g, genRandom(g, 8) ? "<string>Entry %u with some text</string>\n" : "<string/>\n", genRandom(g, 1000));
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Count");
+    genPrint(g, "<integer>%u</integer>\n", genRandom(g, 1000000));
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Data");
+    genData(g);
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Enabled");
+    genPrint(g, genRandom(g, 2) ? "<true/>\n" : "<false/>\n");
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Fixed");
+    genPrint(g, genRandom(g, 4) ? "<data>AQIDBA==</data>\n" : "<data>AQID</data>\n");
+  }
+  if (genRandom(g, 10) == 0) {
+    genKey(g, "Extra");
+    genAny(g, depth + 1);
+  }
+  genPrint(g, "</dict>\n");
+}
+
+static void genConfig(TEST_GEN *g) {
+  uint32_t n;
+
+  genPrint(g, "<?xml version=\"1.0\" encoding=\"UTF-8\"?>\n<plist version=\"1.0\">\n<dict>\n");
+  if (genRandom(g, 4)) {
+    genKey(g, "Assoc");
+    genPrint(g, "<dict>\n");
+    for (n = genRandom(g, 5); n > 0; n--) {
+      genKey(g, genRandom(g, 2) ? "layout-id" : "model");
+      switch (genRandom(g, 4)) {
+        case 0: genPrint(g, "<string>Model %u</string>\n", genRandom(g, 100)); break;
+        case 1: genPrint(g, genRandom(g, 4) ? "<integer>%u</integer>\n" : "<integer>-%u</integer>\n", genRandom(g, 100000)); break;
+        case 2: genPrint(g, genRandom(g, 2) ? "<true/>\n" : "<false/>\n"); break;
+        default: genData(g); break;
+      }
+    }
+    genPrint(g, "</dict>\n");
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Entries");
+    genPrint(g, "<array>\n");
+    for (n = genRandom(g, 6); n > 0; n--) genEntry(g, 2);
+    genPrint(g, "</array>\n");
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Named");
+    genPrint(g, "<dict>\n");
+    for (n = genRandom(g, 6); n > 0; n--) {
+      genKey(g, genRandom(g, 2) ? "First" : "Second");
+      genEntry(g, 2);
+    }
+    genPrint(g, "</dict>\n");
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Options");
+    genPrint(g, "<dict>\n");
+    if (genRandom(g, 2)) {
+      genKey(g, "Flag");
+      genPrint(g, genRandom(g, 2) ? "<true/>\n" : "<false/>\n");
+    }
+    if (genRandom(g, 2)) {
+      genKey(g, "Number");
+      genPrint(g, "<integer>%u%u</integer>\n", genRandom(g, 100000), genRandom(g, 100000));
+    }
+    genPrint(g, "</dict>\n");
+  }
+  if (genRandom(g, 4)) {
+    genKey(g, "Title");
+    genPrint(g, "<string>Config %u</string>\n", genRandom(g, 1000));
+  }
+  genPrint(g, "</dict>\n</plist>\n");
+}
+
+static void dumpBlob(FILE *f, OC_DATA *blob) {
+  fprintf(f, "%u:", blob->Size);
+  for (uint32_t i = 0; i < blob->Size; i++) fprintf(f, "%02x", OC_BLOB_GET (blob)[i]);
+  fprintf(f, "\n");
+}
+
+static void dumpEntry(FILE *f, TEST_ENTRY *entry) {
+  fprintf(f, "%d %u %02x%02x%02x%02x ", entry->Enabled, entry->Count,
+    entry->Fixed[0], entry->Fixed[1], entry->Fixed[2], entry->Fixed[3]);
+  dumpBlob(f, (OC_DATA *) &entry->Comment);
+  dumpBlob(f, &entry->Data);
+}
+
+static void dumpConfig(FILE *f, TEST_CONFIG *config) {
+  uint32_t i;
+
+  fprintf(f, "assoc %u\n", config->Assoc.Count);
+  for (i = 0; i < config->Assoc.Count; i++) {
+    dumpBlob(f, (OC_DATA *) config->Assoc.Keys[i]);
+    dumpBlob(f, config->Assoc.Values[i]);
+  }
+  fprintf(f, "entries %u\n", config->Entries.Count);
+  for (i = 0; i < config->Entries.Count; i++) dumpEntry(f, config->Entries.Values[i]);
+  fprintf(f, "named %u\n", config->Named.Count);
+  for (i = 0; i < config->Named.Count; i++) {
+    dumpBlob(f, (OC_DATA *) config->Named.Keys[i]);
+    dumpEntry(f, config->Named.Values[i]);
+  }
+  fprintf(f, "options %d %llu\n", config->Options.Flag, (unsigned long long) config->Options.Number);
+  dumpBlob(f, (OC_DATA *) &config->Title);
+}
+
+//
+// Parses the document into a dump of TEST_CONFIG, with a node tree when
+// Tree is set (lazily parsed when it is 2) and streaming otherwise.
+//
+static char *parseConfig(const char *plist, uint32_t size, int tree) {
+  TEST_CONFIG   config;
+  XML_DOCUMENT  *doc;
+  XML_NODE      *root;
+  char          *copy;
+  char          *dump;
+  size_t        dumpSize;
+  FILE          *f;
+  BOOLEAN       success;
+
+  copy = malloc(size + 1);
+  memcpy(copy, plist, size);
+  copy[size] = '\0';
+
+  TEST_CONFIG_CONSTRUCT (&config, sizeof (config));
+  if (tree) {
+    doc     = tree == 2 ? XmlDocumentParseLazy (copy, size, FALSE) : XmlDocumentParse (copy, size, FALSE);
+    root    = doc != NULL ? PlistNodeCast (PlistDocumentRoot (doc), PLIST_NODE_TYPE_DICT) : NULL;
+    success = root != NULL;
+    if (success) {
+      ParseSerializedDict (&config, root, &mTestRootInfo);
+    }
+    if (doc != NULL) {
+      XmlDocumentFree (doc);
+    }
+  } else {
+    success = ParseSerialized (&config, &mTestRootInfo, copy, size);
+  }
+
+  dump = NULL;
+  f = open_memstream(&dump, &dumpSize);
+  fprintf(f, "%d\n", success);
+  dumpConfig(f, &config);
+  fclose(f);
+
+  TEST_CONFIG_DESTRUCT (&config, sizeof (config));
+  free(copy);
+  return dump;
+}
+
+//
+// Exports the document as a binary plist.
+//
+static uint8_t *exportBinary(const char *plist, uint32_t size, uint32_t *binarySize) {
+  XML_DOCUMENT  *doc;
+  char          *copy;
+  uint8_t       *binary;
+
+  copy = malloc(size + 1);
+  memcpy(copy, plist, size);
+  copy[size] = '\0';
+
+  doc    = XmlDocumentParse (copy, size, FALSE);
+  binary = doc != NULL ? BplistExport (PlistDocumentRoot (doc), binarySize) : NULL;
+  if (doc != NULL) {
+    XmlDocumentFree (doc);
+  }
+
+  free(copy);
+  return binary;
+}
+
+//
+// Prints the document as read by the plist reader, with data in hex.
+//
+static char *printPlist(const char *plist, uint32_t size) {
+  PLIST_READER  *reader;
+  XML_NODE      *node;
+  PLIST_EVENT   event;
+  char          *copy;
+  char          *dump;
+  size_t        dumpSize;
+  FILE          *f;
+  UINT8         *data;
+  UINT32        dataSize;
+
+  copy = malloc(size + 1);
+  memcpy(copy, plist, size);
+  copy[size] = '\0';
+
+  dump = NULL;
+  f = open_memstream(&dump, &dumpSize);
+
+  reader = PlistReaderCreate (copy, size);
+  event  = reader != NULL ? PlistReaderNext (reader, &node) : PLIST_EVENT_ERROR;
+  while (event != PLIST_EVENT_END && event != PLIST_EVENT_ERROR) {
+    if (event == PLIST_EVENT_OPEN) {
+      fprintf(f, "<%s>", XmlNodeName (node));
+    } else if (event == PLIST_EVENT_CLOSE) {
+      fprintf(f, "</%s>", XmlNodeName (node));
+    } else if (PlistNodeCast (node, PLIST_NODE_TYPE_DATA) != NULL) {
+      fprintf(f, "<data>");
+      if (PlistDataSize (node, &dataSize) && dataSize > 0) {
+        data = malloc(dataSize);
+        if (PlistDataValue (node, data, &dataSize)) {
+          for (UINT32 i = 0; i < dataSize; i++) fprintf(f, "%02x", data[i]);
+        }
+        free(data);
+      }
+      fprintf(f, "</data>");
+    } else if (XmlNodeContent (node) != NULL || PlistNodeCast (node, PLIST_NODE_TYPE_STRING) != NULL) {
+      //
+      // Empty strings are exported as such and read back with contents.
+      //
+      fprintf(f, "<%s>%s</%s>", XmlNodeName (node),
+        XmlNodeContent (node) != NULL ? XmlNodeContent (node) : "", XmlNodeName (node));
+    } else {
+      fprintf(f, "<%s/>", XmlNodeName (node));
+    }
+    event = PlistReaderNext (reader, &node);
+  }
+
+  fprintf(f, "%s\n", event == PLIST_EVENT_END ? "end" : "error");
+  fclose(f);
+
+  if (reader != NULL) {
+    PlistReaderFree (reader);
+  }
+  free(copy);
+  return dump;
+}
+
+//
+// Checks that invalid values are rejected: data failing in place decoding
+// stays invalid, and empty integers are not exported.
+//
+static int testInvalidValues(void) {
+  static const char *invalid[] = {"AAAA*", "PT09*", "AQIDBAUG\n  Bw!A"};
+  XML_DOCUMENT  *doc;
+  XML_NODE      *node;
+  char          plist[64];
+  UINT8         data[16];
+  UINT32        size;
+  int           failed;
+
+  failed = 0;
+
+  for (uint32_t i = 0; i < ARRAY_SIZE (invalid); i++) {
+    snprintf(plist, sizeof (plist), "<plist><data>%s</data></plist>", invalid[i]);
+    doc  = XmlDocumentParse (plist, (UINT32) strlen(plist), FALSE);
+    node = doc != NULL ? PlistDocumentRoot (doc) : NULL;
+    size = sizeof (data);
+    if (node == NULL
+      || PlistDataDecode (node, NULL, NULL)
+      || PlistDataDecode (node, NULL, NULL)
+      || PlistDataSize (node, &size)
+      || PlistMetaDataSize (node, &size)
+      || PlistDataValue (node, data, &size)) {
+      DEBUG((EFI_D_ERROR, "Invalid data %u accepted\n", i));
+      failed = 1;
+    }
+    if (doc != NULL) {
+      XmlDocumentFree (doc);
+    }
+  }
+
+  snprintf(plist, sizeof (plist), "<plist><array><integer/></array></plist>");
+  doc  = XmlDocumentParse (plist, (UINT32) strlen(plist), FALSE);
+  if (doc == NULL || BplistExport (PlistDocumentRoot (doc), &size) != NULL) {
+    DEBUG((EFI_D_ERROR, "Empty integer exported\n"));
+    failed = 1;
+  }
+  if (doc != NULL) {
+    XmlDocumentFree (doc);
+  }
+
+  return failed;
+}
+
+//
+// Prints the node tree as visited through the plist API.
+//
+static void walkNode(FILE *f, XML_NODE *node) {
+  XML_NODE  *value;
+  UINT32    count;
+
+  if (PlistNodeCast (node, PLIST_NODE_TYPE_DICT) != NULL) {
+    count = PlistDictChildren (node);
+    fprintf(f, "{");
+    for (UINT32 i = 0; i < count; i++) {
+      fprintf(f, "%s=", PlistKeyValue (PlistDictChild (node, i, &value)));
+      walkNode(f, value);
+    }
+    fprintf(f, "}");
+  } else if (PlistNodeCast (node, PLIST_NODE_TYPE_ARRAY) != NULL) {
+    count = XmlNodeChildren (node);
+    fprintf(f, "[");
+    for (UINT32 i = 0; i < count; i++) {
+      walkNode(f, XmlNodeChild (node, i));
+    }
+    fprintf(f, "]");
+  } else if (node != NULL) {
+    fprintf(f, "<%s>%s;", XmlNodeName (node), XmlNodeContent (node) != NULL ? XmlNodeContent (node) : "");
+  } else {
+    fprintf(f, "!");
+  }
+}
+
+//
+// Parses the document with references, eagerly or lazily, and prints
+// its walk followed by its export.
+//
+static char *printTree(const char *plist, uint32_t size, int lazy) {
+  XML_DOCUMENT  *doc;
+  char          *copy;
+  char          *dump;
+  char          *exported;
+  size_t        dumpSize;
+  FILE          *f;
+
+  copy = malloc(size + 1);
+  memcpy(copy, plist, size);
+  copy[size] = '\0';
+
+  doc = lazy ? XmlDocumentParseLazy (copy, size, TRUE) : XmlDocumentParse (copy, size, TRUE);
+  if (doc == NULL) {
+    free(copy);
+    return NULL;
+  }
+
+  dump = NULL;
+  f = open_memstream(&dump, &dumpSize);
+  walkNode(f, PlistDocumentRoot (doc));
+  exported = XmlDocumentExport (doc, NULL, 0);
+  fprintf(f, "\n%s\n", exported != NULL ? exported : "(null)");
+  fclose(f);
+
+  if (exported != NULL) {
+    FreePool (exported);
+  }
+  XmlDocumentFree (doc);
+  free(copy);
+  return dump;
+}
+
+//
+// Checks that lazily parsed documents read and export as eagerly parsed
+// ones, including references, and that children found malformed on
+// expansion fail casts, lookups, and export.
+//
+static int testLazy(uint32_t count) {
+  static const char *valid[] = {
+    "<plist><dict><key>A</key><array><string ID=\"0\">a</string><string IDREF=\"0\"/></array></dict></plist>",
+    "<plist><dict><key>A</key><array><string IDREF=\"1\"/><string ID=\"1\">a</string></array></dict></plist>",
+    "<plist><dict><key>A</key><dict><key>B</key><integer ID=\"2\">5</integer></dict>"
+      "<key>C</key><array><integer IDREF=\"2\"/><dict><key>D</key><integer IDREF=\"2\"/></dict></array></dict></plist>",
+    "<plist><dict><key>A</key><array><dict ID=\"3\"><key>x</key><data>AQI=</data></dict></array>"
+      "<key>B</key><dict IDREF=\"3\"/><key>C</key><string IDREF=\"9\"/></dict></plist>",
+    "<plist><dict><key>A</key><array><string>a&amp;b</string><!-- c --><string>&lt;</string></array></dict></plist>",
+  };
+  static const char *malformed[] = {
+    "<plist><dict><key>A</key><array><array>junk<string>a</string></array></array></dict></plist>",
+    "<plist><dict><key>A</key><array><string>a</string>junk</array></dict></plist>",
+    "<plist><dict><key>A</key><array><string>a</string>&lt;</array></dict></plist>",
+  };
+  XML_DOCUMENT  *doc;
+  XML_NODE      *root;
+  TEST_GEN      g;
+  char          copy[128];
+  char          *eager;
+  char          *lazy;
+  char          *exported;
+  uint32_t      failed;
+
+  failed = 0;
+
+  for (uint32_t i = 0; i < ARRAY_SIZE (valid); i++) {
+    eager = printTree(valid[i], (uint32_t) strlen(valid[i]), 0);
+    lazy  = printTree(valid[i], (uint32_t) strlen(valid[i]), 1);
+    if (eager == NULL || lazy == NULL || strcmp(eager, lazy) != 0) {
+      DEBUG((EFI_D_ERROR, "Lazy document %u differs:\n%a%a", i, eager, lazy));
+      ++failed;
+    }
+    free(eager);
+    free(lazy);
+  }
+
+  for (uint32_t i = 0; i < ARRAY_SIZE (malformed); i++) {
+    strcpy(copy, malformed[i]);
+    doc      = XmlDocumentParseLazy (copy, (UINT32) strlen(copy), TRUE);
+    root     = doc != NULL ? PlistNodeCast (PlistDocumentRoot (doc), PLIST_NODE_TYPE_DICT) : NULL;
+    exported = root != NULL ? XmlDocumentExport (doc, NULL, 0) : NULL;
+    if (root == NULL || exported == NULL) {
+      DEBUG((EFI_D_ERROR, "Malformed lazy document %u not parsed\n", i));
+      ++failed;
+    } else if (PlistNodeCast (PlistDictFind (root, "A"), PLIST_NODE_TYPE_ARRAY) != NULL
+      || XmlDocumentExport (doc, NULL, 0) != NULL) {
+      DEBUG((EFI_D_ERROR, "Malformed lazy document %u accepted\n", i));
+      ++failed;
+    }
+    if (exported != NULL) {
+      FreePool (exported);
+    }
+    if (doc != NULL) {
+      XmlDocumentFree (doc);
+    }
+  }
+
+  for (uint32_t i = 0; i < count; i++) {
+    memset(&g, 0, sizeof (g));
+    g.Seed = i * 2654435761U + 1;
+    genConfig(&g);
+
+    eager = parseConfig(g.Buffer, g.Size, 1);
+    lazy  = parseConfig(g.Buffer, g.Size, 2);
+    if (strcmp(eager, lazy) != 0) {
+      DEBUG((EFI_D_ERROR, "Lazy config %u differs:\n%a\n", i, g.Buffer));
+      ++failed;
+    }
+    free(eager);
+    free(lazy);
+    free(g.Buffer);
+  }
+
+  return failed;
+}
+
+//
+// Checks dynamic blob values allocated and freed across slab boundaries.
+// Values must keep their contents while neighbours in the same slab are
+// freed and reallocated, and slabs must be released once all their values
+// are freed.
+//
+#define TEST_BLOB_COUNT  200
+
+static int testBlobSlabs(void) {
+  static const uint32_t sizes[] = { 65, 128, 129, 256, 257, 1024, 1025, 4096 };
+  OC_STRING  *blobs;
+  char       *values[TEST_BLOB_COUNT];
+  char       *value;
+  uint32_t   size;
+  uint32_t   failed;
+
+  blobs = malloc(TEST_BLOB_COUNT * sizeof (*blobs));
+  if (blobs == NULL) {
+    return 1;
+  }
+
+  failed = 0;
+
+  for (uint32_t i = 0; i < TEST_BLOB_COUNT; i++) {
+    OC_STRING_CONSTRUCT (&blobs[i], sizeof (blobs[i]));
+  }
+
+  for (uint32_t round = 0; round < ARRAY_SIZE (sizes); round++) {
+    //
+    // Odd rounds only replace every other value, so replaced values come
+    // from slabs shared with values still in use.
+    //
+    for (uint32_t i = round % 2; i < TEST_BLOB_COUNT; i += 1 + round % 2) {
+      size  = sizes[(round + i) % ARRAY_SIZE (sizes)];
+      value = OcBlobAllocate (&blobs[i], size, NULL);
+      if (value == NULL) {
+        ++failed;
+        continue;
+      }
+      memset(value, (int) (i + round), size);
+      values[i] = value;
+    }
+
+    for (uint32_t i = 0; i < TEST_BLOB_COUNT; i++) {
+      value = OC_BLOB_GET (&blobs[i]);
+      if (value == NULL || value != values[i]) {
+        ++failed;
+        continue;
+      }
+      for (uint32_t j = 1; j < blobs[i].Size; j++) {
+        if (value[j] != value[0]) {
+          DEBUG((EFI_D_ERROR, "Blob %u overwritten in round %u\n", i, round));
+          ++failed;
+          break;
+        }
+      }
+    }
+  }
+
+  //
+  // Free from both ends to empty slabs in different orders.
+  //
+  for (uint32_t i = 0; i < TEST_BLOB_COUNT / 2; i++) {
+    OC_STRING_DESTRUCT (&blobs[i], sizeof (blobs[i]));
+    OC_STRING_DESTRUCT (&blobs[TEST_BLOB_COUNT - 1 - i], sizeof (blobs[i]));
+  }
+
+#ifdef TEST_ADDRESS_SANITIZER
+  for (uint32_t i = 0; i < TEST_BLOB_COUNT; i++) {
+    if (!__asan_address_is_poisoned (values[i])) {
+      DEBUG((EFI_D_ERROR, "Blob %u memory was not released\n", i));
+      ++failed;
+    }
+  }
+#endif
+
+  free(blobs);
+  DEBUG((EFI_D_ERROR, "Blob slabs %a\n", failed == 0 ? "passed" : "failed"));
+  return failed;
+}
+
+//
+// Checks binary plist key lookup, including multibyte keys compared against
+// truncated and extended lookup keys.
+//
+static int testBinaryDictFind(void) {
+  static const char *plist =
+    "<plist><dict>"
+    "<key>a</key><integer>1</integer>"
+    "<key>ab</key><integer>2</integer>"
+    "<key>\xc3\xa9t\xc3\xa9</key><integer>3</integer>"
+    "<key>x\xf0\x9f\x98\x80</key><integer>4</integer>"
+    "</dict></plist>";
+  static const struct {
+    const char *key;
+    int64_t    value;
+  } lookups[] = {
+    { "a", 1 },
+    { "ab", 2 },
+    { "\xc3\xa9t\xc3\xa9", 3 },
+    { "x\xf0\x9f\x98\x80", 4 },
+    { "", -1 },
+    { "abc", -1 },
+    { "\xc3", -1 },
+    { "\xc3\xa9t\xc3", -1 },
+    { "\xc3\xa9t\xc3\xa9t", -1 },
+    { "x\xf0\x9f\x98", -1 },
+    { "x\xf0\x9f\x98\x80\x80", -1 },
+  };
+  BPLIST_DOCUMENT  *doc;
+  BPLIST_NODE      node;
+  uint8_t          *binary;
+  uint32_t         binarySize;
+  INT64            value;
+  uint32_t         failed;
+
+  failed = 0;
+  binary = exportBinary(plist, (uint32_t) strlen(plist), &binarySize);
+  doc    = binary != NULL ? BplistDocumentParse (binary, binarySize) : NULL;
+  if (doc == NULL) {
+    DEBUG((EFI_D_ERROR, "Binary dict lookup document failed\n"));
+    if (binary != NULL) {
+      FreePool (binary);
+    }
+    return 1;
+  }
+
+  for (uint32_t i = 0; i < ARRAY_SIZE (lookups); i++) {
+    node = BplistDictFind (doc, BplistDocumentRoot (doc), lookups[i].key);
+    if (lookups[i].value < 0
+      ? node != BPLIST_NODE_INVALID
+      : (node == BPLIST_NODE_INVALID || !BplistIntegerValue (doc, node, &value, sizeof (value)) || value != lookups[i].value)) {
+      DEBUG((EFI_D_ERROR, "Binary dict lookup %u failed\n", i));
+      ++failed;
+    }
+  }
+
+  BplistDocumentFree (doc);
+  FreePool (binary);
+  return failed;
+}
+
+//
+// Checks that streamed XML and binary plists and parsed node trees
+// produce the same configuration on generated documents, and that
+// binary plists read back as the XML they were exported from.
+//
+static int testEquivalence(uint32_t count) {
+  TEST_GEN  g;
+  uint8_t   *binary;
+  uint32_t  binarySize;
+  char      *stream;
+  char      *tree;
+  char      *streamBinary;
+  char      *xml;
+  char      *xmlBinary;
+  uint32_t  failed;
+
+  failed = 0;
+
+  for (uint32_t i = 0; i < count; i++) {
+    memset(&g, 0, sizeof (g));
+    g.Seed = i * 2654435761U + 1;
+    genConfig(&g);
+
+    stream       = parseConfig(g.Buffer, g.Size, 0);
+    tree         = parseConfig(g.Buffer, g.Size, 1);
+    binary       = exportBinary(g.Buffer, g.Size, &binarySize);
+    streamBinary = binary != NULL ? parseConfig((char *) binary, binarySize, 0) : NULL;
+    xml          = printPlist(g.Buffer, g.Size);
+    xmlBinary    = binary != NULL ? printPlist((char *) binary, binarySize) : NULL;
+
+    if (strcmp(stream, tree) != 0 || streamBinary == NULL || strcmp(stream, streamBinary) != 0
+      || xmlBinary == NULL || strcmp(xml, xmlBinary) != 0) {
+      DEBUG((EFI_D_ERROR, "Config %u differs:\n%a\n", i, g.Buffer));
+      ++failed;
+    }
+
+    free(stream);
+    free(tree);
+    free(streamBinary);
+    free(xml);
+    free(xmlBinary);
+    if (binary != NULL) {
+      FreePool (binary);
+    }
+    free(g.Buffer);
+  }
+
+  DEBUG((EFI_D_ERROR, "Equivalence %u of %u configs\n", count - failed, count));
+  failed += testInvalidValues();
+  failed += testBinaryDictFind();
+  failed += testBlobSlabs();
+  failed += testLazy(count);
+  return failed == 0 ? 0 : -1;
+}
+
 int main(int argc, char** argv) {
   uint32_t f;
   uint8_t *b;
+
+  if (argc > 1 && strcmp(argv[1], "equivalence") == 0) {
+    return testEquivalence(argc > 2 ? (uint32_t) strtoul(argv[2], NULL, 10) : 600);
+  }
   if ((b = readFile(argc > 1 ? argv[1] : "Serialized.plist", &f)) == NULL) {
     printf("Read fail\n");
     return -1;
   }
 
+  if (argc > 3 && strcmp(argv[2], "bplist") == 0) {
+    XML_DOCUMENT *doc = XmlDocumentParse ((CHAR8 *) b, f, FALSE);
+    UINT32 len = 0;
+    UINT8 *out = doc != NULL ? BplistExport (PlistDocumentRoot (doc), &len) : NULL;
+    FILE *o = out != NULL ? fopen(argv[3], "wb") : NULL;
+    if (o != NULL) {
+      fwrite(out, len, 1, o);
+      fclose(o);
+    }
+    DEBUG((EFI_D_ERROR, "Exported %u bytes - %a\n", len, o != NULL ? "success" : "failure"));
+    if (out != NULL) {
+      FreePool (out);
+    }
+    if (doc != NULL) {
+      XmlDocumentFree (doc);
+    }
+    free(b);
+    return o != NULL ? 0 : -1;
+  }
+
+  if (argc > 2) {
+    //
+    // Parser modifies the buffer, so parse a fresh copy each round.
+    //
+    uint32_t rounds = (uint32_t) strtoul(argv[2], NULL, 10);
+    uint8_t *copy = malloc(f + 1);
+    long long total = 0;
+    uint32_t parsed = 0;
+
+    for (uint32_t i = 0; copy != NULL && i < rounds; ++i) {
+      memcpy(copy, b, f + 1);
+      long long start = current_timestamp();
+      XML_DOCUMENT *doc = XmlDocumentParse ((CHAR8 *) copy, f, TRUE);
+      total += current_timestamp() - start;
+      if (doc != NULL) {
+        XmlDocumentFree (doc);
+        ++parsed;
+      }
+    }
+
+    DEBUG((EFI_D_ERROR, "Parsed %u of %u in %llu ms, %llu KB/s\n", parsed, rounds, total,
+      total > 0 ? (unsigned long long) f * rounds / total : 0ULL));
+
+    free(copy);
+    free(b);
+    return 0;
+  }
+
   long long a = current_timestamp();
 
   OC_GLOBAL_CONFIG   Config;